@@ -0,0 +1,124 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "blockhashtree.h"
+
+namespace {
+
+// два простых модуля меньше 2^31: произведение остатков помещается в quint64 без переполнения
+constexpr quint64 kModA = 2147483647; // 2^31 - 1
+constexpr quint64 kModB = 2147483629; // 2^31 - 19
+constexpr quint64 kBaseA = 911382323;
+constexpr quint64 kBaseB = 972663749;
+
+} // namespace
+
+quint64 BlockHashTree::lineHash(QStringView line)
+{
+    quint64 hash = 14695981039346656037ULL;
+    for (QChar c : line) {
+        hash ^= c.unicode();
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+QList<quint64> BlockHashTree::hashLines(QStringView text)
+{
+    // как блоки QTextDocument: n переводов строки - n + 1 строка, пустой текст - одна пустая строка
+    QList<quint64> hashes;
+    qsizetype start = 0;
+    while (true) {
+        const qsizetype end = text.indexOf(QLatin1Char('\n'), start);
+        hashes.append(lineHash(text.mid(start, (end < 0 ? text.size() : end) - start)));
+        if (end < 0) break;
+        start = end + 1;
+    }
+    return hashes;
+}
+
+BlockHashTree::Node BlockHashTree::leaf(quint64 lineHash)
+{
+    Node node;
+    node.a = quint32(lineHash % kModA);
+    node.b = quint32((lineHash >> 31) % kModB);
+    node.powA = quint32(kBaseA);
+    node.powB = quint32(kBaseB);
+    return node;
+}
+
+BlockHashTree::Node BlockHashTree::combine(const Node& left, const Node& right)
+{
+    // hash(left + right) = hash(left) * base^len(right) + hash(right)
+    Node node;
+    node.a = quint32((quint64(left.a) * right.powA + right.a) % kModA);
+    node.b = quint32((quint64(left.b) * right.powB + right.b) % kModB);
+    node.powA = quint32(quint64(left.powA) * right.powA % kModA);
+    node.powB = quint32(quint64(left.powB) * right.powB % kModB);
+    return node;
+}
+
+void BlockHashTree::rebuild(const QList<quint64>& lineHashes)
+{
+    m_lineCount = int(lineHashes.size());
+    m_size = 1;
+    while (m_size < m_lineCount) {
+        m_size *= 2;
+    }
+    m_nodes.fill(Node(), 2 * m_size);
+    for (int i = 0; i < m_lineCount; ++i) {
+        m_nodes[m_size + i] = leaf(lineHashes.at(i));
+    }
+    for (int i = m_size - 1; i > 0; --i) {
+        m_nodes[i] = combine(m_nodes.at(2 * i), m_nodes.at(2 * i + 1));
+    }
+}
+
+void BlockHashTree::setLine(int index, quint64 lineHash)
+{
+    if (index < 0 || index >= m_lineCount) return;
+    int node = m_size + index;
+    m_nodes[node] = leaf(lineHash);
+    for (node /= 2; node > 0; node /= 2) {
+        m_nodes[node] = combine(m_nodes.at(2 * node), m_nodes.at(2 * node + 1));
+    }
+}
+
+quint64 BlockHashTree::rangeHash(int first, int count) const
+{
+    // снизу вверх: левый край копится слева направо, правый - справа налево, порядок строк сохраняется
+    Node left;
+    Node right;
+    int l = m_size + qBound(0, first, m_lineCount);
+    int r = m_size + qBound(0, first + count, m_lineCount);
+    while (l < r) {
+        if (l & 1) {
+            left = combine(left, m_nodes.at(l++));
+        }
+        if (r & 1) {
+            right = combine(m_nodes.at(--r), right);
+        }
+        l /= 2;
+        r /= 2;
+    }
+    const Node total = combine(left, right);
+    return (quint64(total.a) << 31) | total.b;
+}
+
+QList<QPair<int, int>> BlockHashTree::children(int first, int count)
+{
+    QList<QPair<int, int>> parts;
+    if (count <= FanOut) {
+        for (int i = 0; i < count; ++i) {
+            parts.append({first + i, 1});
+        }
+        return parts;
+    }
+    for (int i = 0; i < FanOut; ++i) {
+        const int begin = first + int(qint64(count) * i / FanOut);
+        const int end = first + int(qint64(count) * (i + 1) / FanOut);
+        parts.append({begin, end - begin});
+    }
+    return parts;
+}
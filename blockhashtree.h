@@ -0,0 +1,52 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef BLOCKHASHTREE_H
+#define BLOCKHASHTREE_H
+
+#include <QList>
+#include <QPair>
+#include <QStringView>
+
+// хеши строк документа и дерево отрезков над ними для сверки клиента с сервером
+// хеш диапазона строк - полиномиальный (rolling) хеш по хешам строк: он одинаков при любом разбиении
+// диапазона на части, поэтому считается из узлов дерева за O(log n) и совпадает у клиента и сервера
+// при одинаковом тексте; смена одной строки пересчитывает только путь от ее листа до корня
+class BlockHashTree
+{
+public:
+    static constexpr int FanOut = 16; // частей на уровень при поиске расхождения
+
+    static quint64 lineHash(QStringView line); // FNV-1a по UTF-16, не зависит от платформы и версии Qt
+    static QList<quint64> hashLines(QStringView text); // строки текста, разделенные '\n'
+
+    void rebuild(const QList<quint64>& lineHashes); // O(n)
+    void setLine(int index, quint64 lineHash); // O(log n)
+    int lineCount() const { return m_lineCount; }
+
+    // 62 бита: два хеша по модулям около 2^31; диапазон прижимается к числу строк
+    quint64 rangeHash(int first, int count) const;
+    quint64 rootHash() const { return rangeHash(0, m_lineCount); }
+    // укороченный хеш части при поиске расхождения; полный хеш корня проверяет результат
+    static int shortHash(quint64 hash) { return int(hash & 0x7fffffff); }
+    // части диапазона (first, count) для следующего уровня поиска, одинаковые у клиента и сервера
+    static QList<QPair<int, int>> children(int first, int count);
+
+private:
+    struct Node
+    {
+        quint32 a = 0;
+        quint32 b = 0;
+        quint32 powA = 1; // основание в степени числа строк узла, для склейки с соседом
+        quint32 powB = 1;
+    };
+    static Node leaf(quint64 lineHash);
+    static Node combine(const Node& left, const Node& right);
+
+    QList<Node> m_nodes; // корень - 1, листья начинаются с m_size; пустые листья - нейтральные узлы
+    int m_size = 0;
+    int m_lineCount = 0;
+};
+
+#endif // BLOCKHASHTREE_H
@@ -7,6 +7,7 @@
 
 #include <QKeyEvent>
 #include <QTextCursor>
+#include <QTextBlock>
 #include <QPlainTextEdit>
 
 // класс для автоскобок и
@@ -16,6 +17,10 @@ class CodePlainTextEdit : public QPlainTextEdit
 public:
     explicit CodePlainTextEdit(QWidget *parent = nullptr);
 
+    // доступ к геометрии блоков для слоев поверх viewport (удаленные курсоры)
+    QTextBlock firstVisibleTextBlock() const { return firstVisibleBlock(); }
+    QRectF visibleBlockRect(const QTextBlock& block) const { return blockBoundingGeometry(block).translated(contentOffset()); }
+
 protected:
     void keyPressEvent(QKeyEvent *event) override;
     void wheelEvent(QWheelEvent* event) override;
@@ -0,0 +1,350 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "collabconnection.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QTimer>
+#include <QWebSocket>
+#include <utility>
+
+CollabConnection::CollabConnection(QObject *parent)
+    : QObject(parent)
+{
+    m_thread.setObjectName("CollabNetwork");
+    m_worker = new CollabSocketWorker(this);
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+
+    // сигналы из сетевого потока приходят в поток GUI через очередь событий
+    connect(m_worker, &CollabSocketWorker::connected, this, &CollabConnection::connected);
+    connect(m_worker, &CollabSocketWorker::disconnected, this, &CollabConnection::disconnected);
+    connect(m_worker, &CollabSocketWorker::stateChanged, this, &CollabConnection::stateChanged);
+    connect(m_worker, &CollabSocketWorker::inboundReady, this, &CollabConnection::drainInbound);
+    connect(m_worker, &CollabSocketWorker::degradedChanged, this, &CollabConnection::degradedChanged);
+    m_thread.start();
+}
+
+CollabConnection::~CollabConnection()
+{
+    CollabSocketWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker]() { worker->abort(); }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait(); // воркер с сокетом удаляется при завершении потока
+}
+
+void CollabConnection::open(const QUrl& url)
+{
+    m_state.store(QAbstractSocket::ConnectingState, std::memory_order_release);
+    CollabSocketWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker, url]() { worker->open(url); }, Qt::QueuedConnection);
+}
+
+void CollabConnection::close()
+{
+    CollabSocketWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker]() { worker->close(); }, Qt::QueuedConnection);
+}
+
+void CollabConnection::abort()
+{
+    CollabSocketWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker]() { worker->abort(); }, Qt::QueuedConnection);
+}
+
+void CollabConnection::send(const QJsonObject& message)
+{
+    m_outbound.push(message);
+    // одно пробуждение на пачку сообщений: пока воркер не начал разбор очереди, новые события не нужны
+    if (!m_outboundWakePending.exchange(true, std::memory_order_acq_rel)) {
+        CollabSocketWorker *worker = m_worker;
+        QMetaObject::invokeMethod(worker, [worker]() { worker->drainOutbound(); }, Qt::QueuedConnection);
+    }
+}
+
+bool CollabConnection::startRecording(const QString& path, QString *error)
+{
+    auto recorder = std::make_shared<SessionRecorder>();
+    if (!recorder->open(path)) {
+        if (error) {
+            *error = recorder->errorString();
+        }
+        return false;
+    }
+    // дальше файлом владеет сетевой поток, прежняя запись закрывается там же
+    CollabSocketWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker, recorder]() { worker->setRecorder(recorder); }, Qt::QueuedConnection);
+    m_recording = true;
+    return true;
+}
+
+void CollabConnection::stopRecording()
+{
+    if (!std::exchange(m_recording, false)) return;
+    CollabSocketWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker]() { worker->setRecorder(nullptr); }, Qt::QueuedConnection);
+}
+
+void CollabConnection::setInboundLimits(int senderRate, int highWatermark)
+{
+    CollabSocketWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker, senderRate, highWatermark]() {
+        worker->setInboundLimits(senderRate, highWatermark);
+    }, Qt::QueuedConnection);
+}
+
+CollabConnection::InboundPressure CollabConnection::inboundPressure() const
+{
+    InboundPressure pressure;
+    pressure.depth = m_inboundDepth.load(std::memory_order_relaxed);
+    pressure.maxDepth = m_inboundMaxDepth.load(std::memory_order_relaxed);
+    pressure.coalesced = m_coalesced.load(std::memory_order_relaxed);
+    pressure.dropped = m_dropped.load(std::memory_order_relaxed);
+    pressure.degraded = m_degraded.load(std::memory_order_relaxed);
+    return pressure;
+}
+
+void CollabConnection::drainInbound()
+{
+    m_inboundWakePending.store(false, std::memory_order_release); // до разбора: все, что придет дальше, разбудит нас снова
+    QElapsedTimer budget;
+    budget.start();
+    InboundMessage message;
+    while (m_inbound.tryPop(message)) {
+        m_inboundDepth.fetch_sub(1, std::memory_order_relaxed);
+        emit messageReceived(message);
+        if (budget.elapsed() >= DrainBudgetMs && !m_inbound.isEmpty()) {
+            // остальное - в следующем проходе, после ввода и отрисовки; порядок сообщений не меняется
+            if (!m_inboundWakePending.exchange(true, std::memory_order_acq_rel)) {
+                QMetaObject::invokeMethod(this, &CollabConnection::drainInbound, Qt::QueuedConnection);
+            }
+            return;
+        }
+    }
+}
+
+CollabSocketWorker::CollabSocketWorker(CollabConnection *connection)
+    : m_connection(connection)
+    , m_heldTimer(new QTimer(this)) // переезжает в сетевой поток вместе с воркером
+{
+    m_clock.start();
+    m_heldTimer->setInterval(HeldFlushMs);
+    connect(m_heldTimer, &QTimer::timeout, this, &CollabSocketWorker::flushHeld);
+}
+
+void CollabSocketWorker::setInboundLimits(int senderRate, int highWatermark)
+{
+    m_admission.setSenderRate(senderRate);
+    m_admission.setHighWatermark(highWatermark);
+}
+
+// сокет создается уже в сетевом потоке, чтобы его таймеры и уведомления жили там же
+void CollabSocketWorker::ensureSocket()
+{
+    if (m_socket) {
+        return;
+    }
+    m_socket = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+    connect(m_socket, &QWebSocket::connected, this, &CollabSocketWorker::onConnected);
+    connect(m_socket, &QWebSocket::disconnected, this, &CollabSocketWorker::disconnected);
+    connect(m_socket, &QWebSocket::textMessageReceived, this, &CollabSocketWorker::onTextMessage);
+    connect(m_socket, &QWebSocket::binaryMessageReceived, this, &CollabSocketWorker::onBinaryMessage);
+    connect(m_socket, &QWebSocket::bytesWritten, this, [this](qint64 bytes) {
+        m_connection->m_pendingBytes.fetch_sub(qMin(bytes, m_connection->m_pendingBytes.load()), std::memory_order_relaxed);
+    });
+    connect(m_socket, &QWebSocket::stateChanged, this, [this](QAbstractSocket::SocketState state) {
+        m_connection->m_state.store(state, std::memory_order_release);
+        if (state == QAbstractSocket::UnconnectedState) {
+            m_connection->m_pendingBytes.store(0, std::memory_order_relaxed);
+        }
+        emit stateChanged(state);
+    });
+}
+
+void CollabSocketWorker::open(const QUrl& url)
+{
+    ensureSocket();
+    if (m_socket->state() != QAbstractSocket::UnconnectedState) {
+        m_socket->abort();
+    }
+    m_socket->open(url);
+}
+
+void CollabSocketWorker::close()
+{
+    if (!m_socket) return;
+    drainOutbound(); // leave_session и прочее, отправленное перед закрытием, должно уйти
+    m_socket->close();
+}
+
+void CollabSocketWorker::abort()
+{
+    if (!m_socket) return;
+    m_socket->abort();
+}
+
+void CollabSocketWorker::onConnected()
+{
+    // новое соединение: снова JSON и пустые таблицы номеров, до согласования в session_info
+    m_codec.reset();
+    m_chunker.reset();
+    m_chunkedWireBytes = 0;
+    m_admission.reset();
+    m_heldTimer->stop();
+    publishPressure();
+    m_connection->m_binary.store(false, std::memory_order_relaxed);
+    m_connection->m_state.store(QAbstractSocket::ConnectedState, std::memory_order_release);
+    emit connected();
+}
+
+void CollabSocketWorker::drainOutbound()
+{
+    m_connection->m_outboundWakePending.store(false, std::memory_order_release);
+    QJsonObject message;
+    while (m_connection->m_outbound.tryPop(message)) {
+        if (!m_socket || m_socket->state() != QAbstractSocket::ConnectedState) {
+            continue; // соединения нет - отправлять некуда, как и раньше при записи в закрытый сокет
+        }
+        const QList<QJsonObject> frames = CollabChunker::split(message, m_connection->maxFrameBytes());
+        qint64 wireBytes = 0;
+        for (const QJsonObject& frame : frames) {
+            qint64 sent = 0;
+            if (m_codec.isBinary()) {
+                sent = m_socket->sendBinaryMessage(m_codec.encode(frame));
+            } else {
+                sent = m_socket->sendTextMessage(QString::fromUtf8(QJsonDocument(frame).toJson(QJsonDocument::Compact)));
+            }
+            m_connection->m_pendingBytes.fetch_add(sent, std::memory_order_relaxed);
+            wireBytes += sent;
+        }
+        if (m_recorder) {
+            m_recorder->record(SessionRecorder::Direction::Outbound, message, int(wireBytes));
+        }
+    }
+}
+
+void CollabSocketWorker::onTextMessage(const QString& message)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const QByteArray utf8 = message.toUtf8();
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(utf8, &error);
+    if (error.error != QJsonParseError::NoError || !document.isObject()) {
+        qWarning() << "Не удалось разобрать сообщение сервера:" << error.errorString();
+        return;
+    }
+    deliver(document.object(), utf8.size(), timer);
+}
+
+void CollabSocketWorker::onBinaryMessage(const QByteArray& message)
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = false;
+    QJsonObject decoded = m_codec.decode(message, &ok);
+    if (!ok) {
+        qWarning() << "Не удалось разобрать бинарное сообщение сервера, байт:" << message.size();
+        return;
+    }
+    deliver(std::move(decoded), message.size(), timer);
+}
+
+void CollabSocketWorker::deliver(QJsonObject message, int wireBytes, const QElapsedTimer& timer)
+{
+    // большой снимок приходит частями; поток GUI получает его одним сообщением, когда придет последняя
+    m_chunkedWireBytes += wireBytes;
+    if (!m_chunker.accept(message)) {
+        return;
+    }
+    wireBytes = std::exchange(m_chunkedWireBytes, 0);
+
+    if (message.contains("text_compressed")) {
+        // формат qCompress: 4 байта длины (big-endian) и поток zlib, в JSON - base64
+        const QByteArray compressed = QByteArray::fromBase64(message["text_compressed"].toString().toLatin1());
+        const QByteArray utf8 = qUncompress(compressed);
+        if (utf8.isEmpty() && !compressed.isEmpty()) {
+            qWarning() << "Не удалось распаковать снимок документа, байт:" << compressed.size();
+        }
+        message.remove("text_compressed");
+        message["text"] = QString::fromUtf8(utf8);
+    }
+
+    if (m_recorder) {
+        m_recorder->record(SessionRecorder::Direction::Inbound, message, wireBytes);
+    }
+
+    // поля читаются здесь один раз, поток GUI получает готовую структуру нужного типа
+    InboundMessage inbound = ServerMessageDecoder::decode(message);
+    if (inbound.type == ServerMessageType::SessionInfo
+        && message["protocol"].toString() == CollabCodec::CborProtocolName) {
+        // сервер выбрал формат из нашего списка protocols, следующие кадры в обе стороны идут в нем
+        m_codec.setFormat(CollabCodec::Format::Cbor);
+        m_connection->m_binary.store(true, std::memory_order_relaxed);
+    }
+    inbound.wireBytes = wireBytes;
+    inbound.decodeNs = timer.nsecsElapsed();
+
+    // курсоры и чат под нагрузкой придерживаются или отбрасываются, все остальное проходит всегда
+    const int depth = m_connection->m_inboundDepth.load(std::memory_order_relaxed);
+    switch (m_admission.admit(inbound, depth, m_clock.nsecsElapsed())) {
+    case InboundAdmission::Decision::Deliver:
+        // придержанные курсоры - раньше правок, которые пришли после них, иначе их позиции устареют;
+        // в перегрузке тоже, но только перед сообщениями документа: курсоров не больше, чем участников
+        if (m_admission.hasHeld()
+            && (!m_admission.isDegraded() || InboundAdmission::priorityOf(inbound.type) == InboundAdmission::Priority::Document)) {
+            flushHeld();
+        }
+        push(std::move(inbound));
+        break;
+    case InboundAdmission::Decision::Hold:
+        if (!m_heldTimer->isActive()) {
+            m_heldTimer->start();
+        }
+        break;
+    case InboundAdmission::Decision::Drop:
+        break;
+    }
+    publishPressure();
+}
+
+void CollabSocketWorker::push(InboundMessage message)
+{
+    const int depth = m_connection->m_inboundDepth.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (depth > m_connection->m_inboundMaxDepth.load(std::memory_order_relaxed)) {
+        m_connection->m_inboundMaxDepth.store(depth, std::memory_order_relaxed);
+    }
+    m_connection->m_inbound.push(std::move(message));
+    if (!m_connection->m_inboundWakePending.exchange(true, std::memory_order_acq_rel)) {
+        emit inboundReady();
+    }
+}
+
+void CollabSocketWorker::flushHeld()
+{
+    const int depth = m_connection->m_inboundDepth.load(std::memory_order_relaxed);
+    const QList<InboundMessage> held = m_admission.takeHeld(depth, m_clock.nsecsElapsed());
+    for (const InboundMessage& message : held) {
+        push(message);
+    }
+    // пока перегрузка, таймер нужен и для ее снятия
+    if (!m_admission.isDegraded()) {
+        m_heldTimer->stop();
+    }
+    publishPressure();
+}
+
+void CollabSocketWorker::publishPressure()
+{
+    m_connection->m_coalesced.store(m_admission.coalescedCount(), std::memory_order_relaxed);
+    m_connection->m_dropped.store(m_admission.droppedCount(), std::memory_order_relaxed);
+    const bool degraded = m_admission.isDegraded();
+    if (m_connection->m_degraded.exchange(degraded, std::memory_order_relaxed) != degraded) {
+        if (degraded && !m_heldTimer->isActive()) {
+            m_heldTimer->start(); // выход из перегрузки проверяется и без новых сообщений
+        }
+        emit degradedChanged(degraded);
+    }
+}
@@ -0,0 +1,146 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef COLLABCONNECTION_H
+#define COLLABCONNECTION_H
+
+#include <QObject>
+#include <QAbstractSocket>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QThread>
+#include <QUrl>
+#include <atomic>
+#include <memory>
+#include "collabmessages.h"
+#include "collabprotocol.h"
+#include "inboundadmission.h"
+#include "sessionrecorder.h"
+#include "spscqueue.h"
+
+class QTimer;
+class QWebSocket;
+
+class CollabSocketWorker;
+
+// соединение с сервером совместной работы
+// сокет, кодек и (де)сериализация живут в отдельном потоке; с потоком GUI обмен идет через две
+// очереди SpscQueue, а поток GUI получает готовые InboundMessage и только применяет их
+// все методы вызываются из потока GUI
+class CollabConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    // состояние входящего потока для индикатора и окна статистики
+    struct InboundPressure
+    {
+        int depth = 0; // ждут обработки в потоке GUI
+        int maxDepth = 0;
+        qint64 coalesced = 0; // положений курсора заменено более новыми
+        qint64 dropped = 0; // сообщений чата сверх предела отправителя
+        bool degraded = false;
+    };
+
+    explicit CollabConnection(QObject *parent = nullptr);
+    ~CollabConnection() override;
+
+    void open(const QUrl& url);
+    void close(); // после отправки всего, что уже поставлено в очередь
+    void abort();
+    void send(const QJsonObject& message); // кодирование и запись - в сетевом потоке
+
+    QAbstractSocket::SocketState state() const { return QAbstractSocket::SocketState(m_state.load(std::memory_order_acquire)); }
+    bool isConnected() const { return state() == QAbstractSocket::ConnectedState; }
+    qint64 pendingBytes() const { return m_pendingBytes.load(std::memory_order_relaxed); } // закодировано, но еще не ушло в сеть
+    bool isBinary() const { return m_binary.load(std::memory_order_relaxed); } // договорились о bam-cbor-1
+    // предел исходящего кадра, длинный text уходит частями (CollabChunker)
+    void setMaxFrameBytes(int bytes) { m_maxFrameBytes.store(bytes, std::memory_order_relaxed); }
+    int maxFrameBytes() const { return m_maxFrameBytes.load(std::memory_order_relaxed); }
+    // запись всех сообщений в обе стороны для bam_replay; файл открывается здесь, пишется в сетевом потоке
+    bool startRecording(const QString& path, QString *error = nullptr);
+    void stopRecording();
+    bool isRecording() const { return m_recording; }
+    // предел курсоров и чата от одного отправителя (в секунду, 0 - без предела) и длина очереди к потоку GUI,
+    // после которой курсоры придерживаются (InboundAdmission)
+    void setInboundLimits(int senderRate, int highWatermark);
+    InboundPressure inboundPressure() const;
+
+    static constexpr int DrainBudgetMs = 8; // столько поток GUI разбирает очередь за один проход цикла событий
+
+signals:
+    void connected();
+    void disconnected();
+    void stateChanged(QAbstractSocket::SocketState state);
+    void messageReceived(const InboundMessage& message); // по одному, в порядке прихода
+    void degradedChanged(bool degraded); // вход или выход из режима перегрузки
+
+private:
+    friend class CollabSocketWorker;
+    void drainInbound();
+
+    QThread m_thread;
+    CollabSocketWorker *m_worker = nullptr;
+    SpscQueue<QJsonObject> m_outbound; // GUI -> сеть
+    SpscQueue<InboundMessage> m_inbound; // сеть -> GUI
+    std::atomic<bool> m_outboundWakePending{false};
+    std::atomic<bool> m_inboundWakePending{false};
+    std::atomic<int> m_inboundDepth{0};
+    std::atomic<int> m_inboundMaxDepth{0};
+    std::atomic<qint64> m_coalesced{0};
+    std::atomic<qint64> m_dropped{0};
+    std::atomic<bool> m_degraded{false};
+    std::atomic<int> m_state{QAbstractSocket::UnconnectedState};
+    std::atomic<qint64> m_pendingBytes{0};
+    std::atomic<bool> m_binary{false};
+    std::atomic<int> m_maxFrameBytes{CollabChunker::DefaultMaxFrameBytes};
+    bool m_recording = false;
+};
+
+// часть соединения в сетевом потоке; создается и удаляется CollabConnection
+class CollabSocketWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CollabSocketWorker(CollabConnection *connection);
+
+    void open(const QUrl& url);
+    void close();
+    void abort();
+    void drainOutbound();
+    void setRecorder(std::shared_ptr<SessionRecorder> recorder) { m_recorder = std::move(recorder); }
+    void setInboundLimits(int senderRate, int highWatermark);
+
+signals:
+    void connected();
+    void disconnected();
+    void stateChanged(QAbstractSocket::SocketState state);
+    void inboundReady();
+    void degradedChanged(bool degraded);
+
+private:
+    void ensureSocket();
+    void onConnected();
+    void onTextMessage(const QString& message);
+    void onBinaryMessage(const QByteArray& message);
+    void deliver(QJsonObject message, int wireBytes, const QElapsedTimer& timer);
+    void push(InboundMessage message); // в очередь к потоку GUI
+    void flushHeld(); // придержанные курсоры, раз в HeldFlushMs
+    void publishPressure();
+
+    CollabConnection *m_connection;
+    QWebSocket *m_socket = nullptr;
+    CollabCodec m_codec;
+    CollabChunker m_chunker; // сборка сообщений, пришедших частями
+    int m_chunkedWireBytes = 0; // байт в уже пришедших частях собираемого сообщения
+    std::shared_ptr<SessionRecorder> m_recorder; // nullptr - запись выключена
+    InboundAdmission m_admission;
+    QElapsedTimer m_clock; // время для корзин отправителей
+    QTimer *m_heldTimer = nullptr;
+
+    static constexpr int HeldFlushMs = 100; // под нагрузкой курсоры участников обновляются 10 раз в секунду
+};
+
+#endif // COLLABCONNECTION_H
@@ -0,0 +1,294 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "collabmessages.h"
+#include <QHash>
+#include <QJsonValue>
+#include <iterator>
+
+namespace {
+
+// имена в порядке ServerMessageType, Unknown - пустая строка
+const char *const kServerTypeNames[] = {
+    "", "insert", "delete", "batch", "ack", "cursor_position_update", "chat_message",
+    "file_content_update", "session_info", "user_list_update", "user_disconnected",
+    "mute_notification", "muted_status_update", "admin_changed", "session_saved", "error",
+    "document_info", "document_closed", "hash_ranges", "block_text", "user_joined",
+};
+static_assert(std::size(kServerTypeNames) == size_t(ServerMessageType::Count),
+              "kServerTypeNames должен совпадать с ServerMessageType");
+
+const QHash<QString, ServerMessageType>& serverTypeIndex()
+{
+    static const QHash<QString, ServerMessageType> index = [] {
+        QHash<QString, ServerMessageType> result;
+        for (int i = 1; i < int(ServerMessageType::Count); ++i) {
+            result.insert(QString::fromLatin1(kServerTypeNames[i]), ServerMessageType(i));
+        }
+        return result;
+    }();
+    return index;
+}
+
+// mute_end_time: null - мьют снят, число - время окончания
+void readMuteEndTime(const QJsonObject& object, bool& hasMuteEndTime, qint64& muteEndTime)
+{
+    const QJsonValue value = object.value(QLatin1String("mute_end_time"));
+    hasMuteEndTime = !value.isUndefined();
+    if (hasMuteEndTime && !value.isNull()) {
+        muteEndTime = value.toInteger();
+    }
+}
+
+CollabUser readUser(const QJsonObject& object)
+{
+    CollabUser user;
+    user.clientId = object.value(QLatin1String("client_id")).toString();
+    user.username = object.value(QLatin1String("username")).toString();
+    user.color = QColor(object.value(QLatin1String("color")).toString());
+    user.isAdmin = object.value(QLatin1String("is_admin")).toBool();
+    readMuteEndTime(object, user.hasMuteEndTime, user.muteEndTime);
+    return user;
+}
+
+} // namespace
+
+ServerMessageType ServerMessageDecoder::typeOf(const QString& name)
+{
+    return serverTypeIndex().value(name, ServerMessageType::Unknown);
+}
+
+QString ServerMessageDecoder::typeName(ServerMessageType type)
+{
+    if (type <= ServerMessageType::Unknown || type >= ServerMessageType::Count) {
+        return QStringLiteral("?");
+    }
+    return QString::fromLatin1(kServerTypeNames[int(type)]);
+}
+
+QList<CollabOp> ServerMessageDecoder::decodeOps(const QJsonArray& array, bool *allValid)
+{
+    QList<CollabOp> ops;
+    ops.reserve(array.size());
+    bool valid = true;
+    for (const QJsonValue& value : array) {
+        bool ok = false;
+        const CollabOp op = CollabOp::fromJson(value.toObject(), &ok);
+        if (ok) {
+            ops.append(op);
+        } else {
+            valid = false;
+        }
+    }
+    if (allValid) {
+        *allValid = valid;
+    }
+    return ops;
+}
+
+CursorMessage ServerMessageDecoder::decodeCursor(const QString& clientId, const QJsonObject& object)
+{
+    CursorMessage cursor;
+    cursor.path = object.value(QLatin1String("path")).toString();
+    cursor.clientId = clientId;
+    cursor.position = object.value(QLatin1String("position")).toInt();
+    cursor.anchor = object.value(QLatin1String("anchor")).toInt(-1);
+    cursor.username = object.value(QLatin1String("username")).toString();
+    cursor.color = QColor(object.value(QLatin1String("color")).toString());
+    return cursor;
+}
+
+InboundMessage ServerMessageDecoder::decode(const QJsonObject& message)
+{
+    InboundMessage inbound;
+    inbound.typeName = message.value(QLatin1String("type")).toString();
+    inbound.type = typeOf(inbound.typeName);
+
+    switch (inbound.type) {
+    case ServerMessageType::Insert:
+    case ServerMessageType::Delete:
+    case ServerMessageType::Batch: {
+        OpsMessage ops;
+        ops.path = message.value(QLatin1String("path")).toString();
+        ops.senderId = message.value(QLatin1String("client_id")).toString();
+        ops.revision = message.value(QLatin1String("revision")).toInt(-1);
+        ops.ops = decodeOps(inbound.type == ServerMessageType::Batch ? message.value(QLatin1String("ops")).toArray()
+                                                                     : QJsonArray{message},
+                            &ops.valid);
+        inbound.payload = std::move(ops);
+        break;
+    }
+    case ServerMessageType::Ack:
+        inbound.payload = AckMessage{message.value(QLatin1String("path")).toString(),
+                                     message.value(QLatin1String("revision")).toInt()};
+        break;
+    case ServerMessageType::CursorPositionUpdate:
+        inbound.payload = decodeCursor(message.value(QLatin1String("client_id")).toString(), message);
+        break;
+    case ServerMessageType::ChatMessage:
+        inbound.payload = ChatTextMessage{message.value(QLatin1String("username")).toString(),
+                                          message.value(QLatin1String("text_message")).toString(),
+                                          message.value(QLatin1String("client_id")).toString()};
+        break;
+    case ServerMessageType::FileContentUpdate:
+        inbound.payload = FileContentMessage{message.value(QLatin1String("path")).toString(),
+                                             message.value(QLatin1String("text")).toString(),
+                                             message.value(QLatin1String("revision")).toInt(-1)};
+        break;
+    case ServerMessageType::SessionInfo: {
+        SessionInfoMessage info;
+        info.sessionId = message.value(QLatin1String("session_id")).toString();
+        info.creatorClientId = message.value(QLatin1String("creator_client_id")).toString();
+        for (const QJsonValue& feature : message.value(QLatin1String("features")).toArray()) {
+            info.features.append(feature.toString());
+        }
+        info.path = message.value(QLatin1String("path")).toString();
+        info.revision = message.value(QLatin1String("revision")).toInt(-1);
+        info.text = message.value(QLatin1String("text")).toString();
+        info.seed = message.value(QLatin1String("seed")).toBool();
+        const QJsonObject cursors = message.value(QLatin1String("cursors")).toObject();
+        info.cursors.reserve(cursors.size());
+        for (auto it = cursors.constBegin(); it != cursors.constEnd(); ++it) {
+            CursorMessage cursor = decodeCursor(it.key(), it.value().toObject());
+            cursor.path = info.path;
+            info.cursors.append(cursor);
+        }
+        // catch_up: [{client_id, revision, ops}, ...] строго по порядку ревизий
+        info.hasCatchUp = message.contains(QLatin1String("catch_up"));
+        const QJsonArray catchUp = message.value(QLatin1String("catch_up")).toArray();
+        info.catchUp.reserve(catchUp.size());
+        for (const QJsonValue& value : catchUp) {
+            const QJsonObject entry = value.toObject();
+            bool valid = true;
+            info.catchUp.append(CatchUpEntry{entry.value(QLatin1String("client_id")).toString(),
+                                             entry.value(QLatin1String("revision")).toInt(-1),
+                                             decodeOps(entry.value(QLatin1String("ops")).toArray(), &valid)});
+            info.catchUpValid = info.catchUpValid && valid;
+        }
+        inbound.payload = std::move(info);
+        break;
+    }
+    case ServerMessageType::UserListUpdate: {
+        UserListMessage list;
+        const QJsonArray users = message.value(QLatin1String("users")).toArray();
+        list.users.reserve(users.size());
+        for (const QJsonValue& value : users) {
+            list.users.append(readUser(value.toObject()));
+        }
+        inbound.payload = std::move(list);
+        break;
+    }
+    case ServerMessageType::UserJoined:
+        inbound.payload = UserJoinedMessage{readUser(message)};
+        break;
+    case ServerMessageType::UserDisconnected:
+        inbound.payload = UserDisconnectedMessage{message.value(QLatin1String("client_id")).toString(),
+                                                  message.value(QLatin1String("username")).toString()};
+        break;
+    case ServerMessageType::MuteNotification:
+        inbound.payload = MuteNotificationMessage{message.value(QLatin1String("duration")).toInt()};
+        break;
+    case ServerMessageType::MutedStatusUpdate: {
+        MutedStatusMessage status;
+        status.clientId = message.value(QLatin1String("client_id")).toString();
+        status.isMuted = message.value(QLatin1String("is_muted")).toBool();
+        readMuteEndTime(message, status.hasMuteEndTime, status.muteEndTime);
+        inbound.payload = std::move(status);
+        break;
+    }
+    case ServerMessageType::AdminChanged:
+        inbound.payload = AdminChangedMessage{message.value(QLatin1String("new_admin_id")).toString()};
+        break;
+    case ServerMessageType::SessionSaved:
+        inbound.payload = SessionSavedMessage{message.value(QLatin1String("days")).toInt()};
+        break;
+    case ServerMessageType::Error: {
+        ErrorMessage error;
+        error.message = message.value(QLatin1String("message")).toString();
+        error.sessionId = message.value(QLatin1String("session_id")).toString();
+        error.hasDays = message.contains(QLatin1String("days"));
+        error.days = message.value(QLatin1String("days")).toInt();
+        inbound.payload = std::move(error);
+        break;
+    }
+    case ServerMessageType::DocumentInfo: {
+        DocumentInfoMessage document;
+        document.path = message.value(QLatin1String("path")).toString();
+        document.revision = message.value(QLatin1String("revision")).toInt(-1);
+        document.text = message.value(QLatin1String("text")).toString();
+        document.seed = message.value(QLatin1String("seed")).toBool();
+        const QJsonObject cursors = message.value(QLatin1String("cursors")).toObject();
+        document.cursors.reserve(cursors.size());
+        for (auto it = cursors.constBegin(); it != cursors.constEnd(); ++it) {
+            CursorMessage cursor = decodeCursor(it.key(), it.value().toObject());
+            cursor.path = document.path;
+            document.cursors.append(cursor);
+        }
+        inbound.payload = std::move(document);
+        break;
+    }
+    case ServerMessageType::DocumentClosed:
+        inbound.payload = DocumentClosedMessage{message.value(QLatin1String("path")).toString(),
+                                                message.value(QLatin1String("client_id")).toString()};
+        break;
+    case ServerMessageType::HashRanges: {
+        HashRangesMessage hashes;
+        hashes.path = message.value(QLatin1String("path")).toString();
+        hashes.revision = message.value(QLatin1String("revision")).toInt(-1);
+        hashes.lines = message.value(QLatin1String("lines")).toInt();
+        for (const QJsonValue& value : message.value(QLatin1String("ranges")).toArray()) {
+            const QJsonObject object = value.toObject();
+            HashRange range{object.value(QLatin1String("first")).toInt(), object.value(QLatin1String("count")).toInt(), {}};
+            for (const QJsonValue& hash : object.value(QLatin1String("hashes")).toArray()) {
+                range.hashes.append(hash.toInt());
+            }
+            hashes.ranges.append(std::move(range));
+        }
+        inbound.payload = std::move(hashes);
+        break;
+    }
+    case ServerMessageType::BlockText:
+        inbound.payload = BlockTextMessage{message.value(QLatin1String("path")).toString(),
+                                           message.value(QLatin1String("revision")).toInt(-1),
+                                           message.value(QLatin1String("first")).toInt(),
+                                           message.value(QLatin1String("count")).toInt(),
+                                           message.value(QLatin1String("lines")).toInt(),
+                                           message.value(QLatin1String("text")).toString(),
+                                           message.value(QLatin1String("hash")).toString().toULongLong(nullptr, 16)};
+        break;
+    case ServerMessageType::Unknown:
+    case ServerMessageType::Count:
+        break;
+    }
+    return inbound;
+}
+
+void ServerMessageStats::record(const InboundMessage& message, qint64 handleNs)
+{
+    Entry& entry = m_entries[size_t(message.type)];
+    ++entry.count;
+    entry.bytes += message.wireBytes;
+    entry.decodeNs += message.decodeNs;
+    entry.handleNs += handleNs;
+    entry.maxHandleNs = qMax(entry.maxHandleNs, handleNs);
+}
+
+void ServerMessageStats::reset()
+{
+    m_entries.fill(Entry());
+    m_applyNs = 0;
+}
+
+ServerMessageStats::Entry ServerMessageStats::total() const
+{
+    Entry sum;
+    for (const Entry& entry : m_entries) {
+        sum.count += entry.count;
+        sum.bytes += entry.bytes;
+        sum.decodeNs += entry.decodeNs;
+        sum.handleNs += entry.handleNs;
+        sum.maxHandleNs = qMax(sum.maxHandleNs, entry.maxHandleNs);
+    }
+    return sum;
+}
@@ -0,0 +1,278 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef COLLABMESSAGES_H
+#define COLLABMESSAGES_H
+
+#include <QColor>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <variant>
+#include "collabop.h"
+
+// типы сообщений сервера; номер типа - индекс в таблице обработчиков и в счетчиках
+enum class ServerMessageType {
+    Unknown,
+    Insert,
+    Delete,
+    Batch,
+    Ack,
+    CursorPositionUpdate,
+    ChatMessage,
+    FileContentUpdate,
+    SessionInfo,
+    UserListUpdate,
+    UserDisconnected,
+    MuteNotification,
+    MutedStatusUpdate,
+    AdminChanged,
+    SessionSaved,
+    Error,
+    DocumentInfo,
+    DocumentClosed,
+    HashRanges,
+    BlockText,
+    UserJoined,
+    Count
+};
+
+// insert/delete/batch: одна пачка операций от одного отправителя
+// path во всех сообщениях документа - путь относительно корня проекта, пустой - общий буфер сессии
+struct OpsMessage
+{
+    QString path;
+    QString senderId;
+    int revision = -1; // -1 - сервер без OT
+    QList<CollabOp> ops;
+    bool valid = true; // false - часть операций неразборчива, применять пачку нельзя
+};
+
+struct AckMessage
+{
+    QString path;
+    int revision = 0;
+};
+
+// cursor_position_update, а также запись в cursors из session_info
+struct CursorMessage
+{
+    QString path;
+    QString clientId;
+    int position = 0;
+    int anchor = -1; // -1 - выделения нет
+    QString username;
+    QColor color;
+};
+
+struct ChatTextMessage
+{
+    QString username;
+    QString text;
+    QString senderId; // client_id отправителя, может отсутствовать
+};
+
+struct FileContentMessage
+{
+    QString path;
+    QString text;
+    int revision = -1; // -1 - без ревизии (сервер без OT)
+};
+
+// пачка из catch_up: то, что сервер принял после нашей ревизии
+struct CatchUpEntry
+{
+    QString senderId;
+    int revision = -1;
+    QList<CollabOp> ops;
+};
+
+struct SessionInfoMessage
+{
+    QString sessionId;
+    QString creatorClientId;
+    QStringList features;
+    QString path; // документ, на который подписал вход
+    int revision = -1; // -1 - сервер без OT
+    QString text; // text_compressed уже распакован
+    bool seed = false; // документ создан пустым по нашему text_length, содержимое ждут от нас операциями
+    QList<CursorMessage> cursors;
+    bool hasCatchUp = false;
+    bool catchUpValid = true; // false - в catch_up есть неразборчивая операция, догонять нельзя
+    QList<CatchUpEntry> catchUp;
+};
+
+// участник сессии из user_list_update и user_joined
+struct CollabUser
+{
+    QString clientId;
+    QString username;
+    QColor color;
+    bool isAdmin = false;
+    bool hasMuteEndTime = false; // поле mute_end_time пришло
+    qint64 muteEndTime = -1; // -1 - пришел null, мьют снят
+};
+
+struct UserListMessage
+{
+    QList<CollabUser> users;
+};
+
+// user_joined: вошел новый участник или вернулся прежний (тогда запись заменяется)
+struct UserJoinedMessage
+{
+    CollabUser user;
+};
+
+struct UserDisconnectedMessage
+{
+    QString clientId;
+    QString username;
+};
+
+struct MuteNotificationMessage
+{
+    int duration = 0; // 0 - бессрочно
+};
+
+struct MutedStatusMessage
+{
+    QString clientId;
+    bool isMuted = false;
+    bool hasMuteEndTime = false;
+    qint64 muteEndTime = -1; // -1 - пришел null, мьют снят
+};
+
+struct AdminChangedMessage
+{
+    QString newAdminId;
+};
+
+struct SessionSavedMessage
+{
+    int days = 0;
+};
+
+// ответ на open_document: состояние документа, на который клиент подписался
+struct DocumentInfoMessage
+{
+    QString path;
+    int revision = -1;
+    QString text; // text_compressed уже распакован
+    bool seed = false; // как в SessionInfoMessage
+    QList<CursorMessage> cursors;
+};
+
+// участник закрыл документ, его курсор в нем больше не показывается
+struct DocumentClosedMessage
+{
+    QString path;
+    QString clientId;
+};
+
+// hash_ranges: укороченные хеши частей диапазонов строк серверного документа (поиск расхождения)
+struct HashRange
+{
+    int first = 0;
+    int count = 0;
+    QList<int> hashes; // по BlockHashTree::children(first, count)
+};
+
+struct HashRangesMessage
+{
+    QString path;
+    int revision = -1;
+    int lines = 0; // строк в документе на сервере
+    QList<HashRange> ranges;
+};
+
+// block_text: строки [first, first + count) серверного документа и хеш всего документа для проверки починки
+struct BlockTextMessage
+{
+    QString path;
+    int revision = -1;
+    int first = 0;
+    int count = 0;
+    int lines = 0;
+    QString text; // с '\n' после последней строки, если она не последняя в документе
+    quint64 hash = 0;
+};
+
+struct ErrorMessage
+{
+    QString message;
+    QString sessionId;
+    bool hasDays = false;
+    int days = 0;
+};
+
+using ServerMessagePayload = std::variant<std::monostate, OpsMessage, AckMessage, CursorMessage, ChatTextMessage,
+                                          FileContentMessage, SessionInfoMessage, UserListMessage, UserDisconnectedMessage,
+                                          MuteNotificationMessage, MutedStatusMessage, AdminChangedMessage,
+                                          SessionSavedMessage, ErrorMessage, DocumentInfoMessage, DocumentClosedMessage,
+                                          HashRangesMessage, BlockTextMessage, UserJoinedMessage>;
+
+// сообщение сервера, уже разобранное в сетевом потоке: тип определен один раз, поля прочитаны один раз
+struct InboundMessage
+{
+    ServerMessageType type = ServerMessageType::Unknown;
+    QString typeName; // как пришло в поле type, для журнала неизвестных сообщений
+    ServerMessagePayload payload;
+    int wireBytes = 0; // размер кадра в сети
+    qint64 decodeNs = 0; // время разбора в сетевом потоке
+
+    template <typename T>
+    const T& as() const { return std::get<T>(payload); }
+};
+
+// разбор сообщений сервера в типизированные структуры
+class ServerMessageDecoder
+{
+public:
+    static ServerMessageType typeOf(const QString& name); // по таблице, один поиск в хеше
+    static QString typeName(ServerMessageType type);
+    // правки документа: применяются отложенно, поэтому перед остальными сообщениями очередь правок сбрасывается
+    static bool isEdit(ServerMessageType type)
+    {
+        return type == ServerMessageType::Insert || type == ServerMessageType::Delete || type == ServerMessageType::Batch;
+    }
+
+    static InboundMessage decode(const QJsonObject& message);
+
+private:
+    static QList<CollabOp> decodeOps(const QJsonArray& array, bool *allValid = nullptr);
+    static CursorMessage decodeCursor(const QString& clientId, const QJsonObject& object);
+};
+
+// счетчики по типам сообщений сервера: сколько пришло, сколько байт, сколько времени ушло на разбор и обработку
+// пишутся только из потока GUI
+class ServerMessageStats
+{
+public:
+    struct Entry
+    {
+        qint64 count = 0;
+        qint64 bytes = 0;
+        qint64 decodeNs = 0;
+        qint64 handleNs = 0;
+        qint64 maxHandleNs = 0;
+    };
+
+    void record(const InboundMessage& message, qint64 handleNs);
+    void recordApply(qint64 ns) { m_applyNs += ns; } // отложенное применение чужих правок
+    void reset();
+
+    const Entry& entry(ServerMessageType type) const { return m_entries[size_t(type)]; }
+    Entry total() const;
+    qint64 applyNs() const { return m_applyNs; }
+
+private:
+    std::array<Entry, size_t(ServerMessageType::Count)> m_entries{};
+    qint64 m_applyNs = 0;
+};
+
+#endif // COLLABMESSAGES_H
@@ -0,0 +1,177 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "collabop.h"
+
+namespace {
+
+int charWireLength(char16_t c)
+{
+    if (c < 0x20) {
+        // управляющие символы в JSON: короткое экранирование или \uXXXX
+        return (c == '\n' || c == '\r' || c == '\t' || c == '\b' || c == '\f') ? 2 : CollabOp::MaxWireBytesPerChar;
+    }
+    if (c == '"' || c == '\\') return 2;
+    if (c < 0x80) return 1;
+    if (c < 0x800) return 2;
+    return 3; // половинка суррогатной пары тоже считается за 3, пара в UTF-8 - 4 байта
+}
+
+} // namespace
+
+CollabOp CollabOp::makeInsert(int position, const QString& text)
+{
+    CollabOp op;
+    op.type = Insert;
+    op.position = position;
+    op.text = text;
+    return op;
+}
+
+CollabOp CollabOp::makeDelete(int position, int count)
+{
+    CollabOp op;
+    op.type = Delete;
+    op.position = position;
+    op.count = count;
+    return op;
+}
+
+bool CollabOp::tryMerge(const CollabOp& next, int maxLength)
+{
+    if (length() + next.length() > maxLength) {
+        return false; // не раздуваем одну операцию до огромного кадра
+    }
+
+    if (type == Insert && next.type == Insert) {
+        // набор подряд или вставка внутрь только что набранного текста
+        if (next.position >= position && next.position <= position + text.length()) {
+            text.insert(next.position - position, next.text);
+            return true;
+        }
+        return false;
+    }
+
+    if (type == Delete && next.type == Delete) {
+        if (next.position + next.count == position) { // backspace, удаление идет влево
+            position = next.position;
+            count += next.count;
+            return true;
+        }
+        if (next.position == position) { // delete, удаление идет вправо
+            count += next.count;
+            return true;
+        }
+        return false;
+    }
+
+    if (type == Insert && next.type == Delete) {
+        // стерли часть только что набранного, но еще не отправленного текста
+        if (next.position >= position && next.position + next.count <= position + text.length()) {
+            text.remove(next.position - position, next.count);
+            return true;
+        }
+        return false;
+    }
+
+    // удаление + вставка (замена выделения) не склеиваем, это две разные операции
+    return false;
+}
+
+bool CollabOp::touches(const CollabOp& next) const
+{
+    // диапазон документа после применения этой операции
+    int begin = position;
+    int end = (type == Insert) ? position + text.length() : position;
+    // диапазон, который затрагивает следующая операция
+    int nextBegin = next.position;
+    int nextEnd = (next.type == Delete) ? next.position + next.count : next.position;
+    return nextBegin <= end && nextEnd >= begin;
+}
+
+int CollabOp::wireSize() const
+{
+    return WireOverheadBytes + (type == Insert ? wireLength(text) : 0);
+}
+
+QList<CollabOp> CollabOp::split(int maxBytes) const
+{
+    if (type != Insert || wireSize() <= maxBytes) {
+        return {*this};
+    }
+    // куски встают подряд: каждый следующий - сразу за предыдущим
+    const int budget = qMax(1, maxBytes - WireOverheadBytes);
+    QList<CollabOp> pieces;
+    int offset = 0;
+    while (offset < text.length()) {
+        const int length = fitWireLength(QStringView(text).mid(offset), budget);
+        pieces.append(makeInsert(position + offset, text.mid(offset, length)));
+        offset += length;
+    }
+    return pieces;
+}
+
+int CollabOp::wireLength(QStringView text)
+{
+    int bytes = 0;
+    for (QChar c : text) {
+        bytes += charWireLength(c.unicode());
+    }
+    return bytes;
+}
+
+int CollabOp::fitWireLength(QStringView text, int maxBytes)
+{
+    int bytes = 0;
+    qsizetype length = 0;
+    while (length < text.size()) {
+        bytes += charWireLength(text.at(length).unicode());
+        if (bytes > maxBytes) break;
+        ++length;
+    }
+    if (length > 0 && length < text.size() && text.at(length - 1).isHighSurrogate()) {
+        --length; // пара уйдет целиком в следующий кусок
+    }
+    if (length == 0 && !text.isEmpty()) {
+        length = (text.size() > 1 && text.at(0).isHighSurrogate()) ? 2 : 1;
+    }
+    return int(length);
+}
+
+QJsonObject CollabOp::toJson() const
+{
+    QJsonObject obj;
+    obj["type"] = (type == Insert) ? "insert" : "delete";
+    obj["position"] = position;
+    if (type == Insert) {
+        obj["text"] = text;
+    } else {
+        obj["count"] = count;
+    }
+    return obj;
+}
+
+CollabOp CollabOp::fromJson(const QJsonObject& obj, bool *ok)
+{
+    CollabOp op;
+    QString type = obj.value("type").toString();
+    bool valid = true;
+    op.position = obj.value("position").toInt(-1);
+    if (type == "insert") {
+        op.type = Insert;
+        op.text = obj.value("text").toString();
+    } else if (type == "delete") {
+        op.type = Delete;
+        op.count = obj.value("count").toInt();
+    } else {
+        valid = false;
+    }
+    if (op.position < 0) {
+        valid = false;
+    }
+    if (ok) {
+        *ok = valid;
+    }
+    return op;
+}
@@ -0,0 +1,51 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef COLLABOP_H
+#define COLLABOP_H
+
+#include <QString>
+#include <QStringView>
+#include <QJsonObject>
+#include <QList>
+
+// одна операция правки совместного документа (то, что раньше жило прямо в JSON insert/delete)
+struct CollabOp
+{
+    enum Type { Insert, Delete };
+
+    Type type = Insert;
+    int position = 0; // абсолютная позиция в документе
+    QString text; // вставляемый текст (только для Insert)
+    int count = 0; // количество удаляемых символов (только для Delete)
+
+    static CollabOp makeInsert(int position, const QString& text);
+    static CollabOp makeDelete(int position, int count);
+
+    int length() const { return type == Insert ? int(text.length()) : count; }
+    bool isNoop() const { return length() <= 0; }
+
+    // пытается склеить следующую операцию того же клиента в эту (набор подряд, backspace, delete)
+    bool tryMerge(const CollabOp& next, int maxLength);
+    // касается ли следующая операция диапазона этой, используется для решения "сбросить очередь или нет"
+    bool touches(const CollabOp& next) const;
+
+    // оценка сверху размера операции в кадре (JSON с экранированием; CBOR всегда не больше)
+    int wireSize() const;
+    // большая вставка - подряд идущими вставками, каждая не больше maxBytes в кадре; остальное как есть
+    QList<CollabOp> split(int maxBytes) const;
+    // оценка сверху размера строки в кадре
+    static int wireLength(QStringView text);
+    // сколько символов с начала text помещается в maxBytes; суррогатная пара не разрывается, хотя бы один символ
+    static int fitWireLength(QStringView text, int maxBytes);
+
+    static constexpr int WireOverheadBytes = 64; // type, position/count, скобки и кавычки
+    static constexpr int MaxWireBytesPerChar = 6; // \uXXXX в JSON
+
+    // поля операции без client_id, формат совпадает с сообщениями insert/delete
+    QJsonObject toJson() const;
+    static CollabOp fromJson(const QJsonObject& obj, bool *ok = nullptr);
+};
+
+#endif // COLLABOP_H
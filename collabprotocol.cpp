@@ -0,0 +1,289 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "collabprotocol.h"
+#include "collabop.h"
+#include <QCborArray>
+#include <QCborParserError>
+#include <QDebug>
+#include <QJsonArray>
+#include <cmath>
+#include <iterator>
+
+const QString CollabCodec::CborProtocolName = QStringLiteral("bam-cbor-1");
+const QString CollabCodec::JsonProtocolName = QStringLiteral("json");
+
+namespace {
+
+// номера полей и типов - это индексы в таблицах, новые имена дописываются только в конец,
+// иначе старые клиенты и сервер перестанут понимать друг друга
+const char *const kFieldNames[] = {
+    "type", "client_id", "position", "text", "count", "revision", "ops", "session_id",
+    "username", "color", "text_message", "password", "duration", "target_client_id",
+    "new_admin_id", "creator_client_id", "cursors", "users", "is_admin", "mute_end_time",
+    "is_muted", "message", "days", "features", "protocols", "protocol", "anchor",
+    "since_revision", "catch_up", "text_compressed", "snapshot_compression", "path",
+    "chunks", "chunk_field", "data", "text_length", "seed", "lines", "hash", "ranges", "first", "hashes",
+};
+
+const char *const kTypeNames[] = {
+    "insert", "delete", "batch", "ack", "cursor_position_update", "chat_message",
+    "file_content_update", "session_info", "user_list_update", "user_disconnected",
+    "mute_notification", "muted_status_update", "admin_changed", "session_saved", "error",
+    "create_session", "join_session", "leave_session", "save_session", "mute_client",
+    "unmute_client", "transfer_admin", "open_document", "close_document", "document_info", "document_closed",
+    "text_chunk", "doc_hash", "hash_query", "block_request", "hash_ranges", "block_text",
+    "user_joined",
+};
+
+template <size_t N>
+QHash<QString, qint64> buildIndex(const char *const (&names)[N])
+{
+    QHash<QString, qint64> index;
+    for (size_t i = 0; i < N; ++i) {
+        index.insert(QString::fromLatin1(names[i]), qint64(i));
+    }
+    return index;
+}
+
+const QHash<QString, qint64>& fieldIndex()
+{
+    static const QHash<QString, qint64> index = buildIndex(kFieldNames);
+    return index;
+}
+
+const QHash<QString, qint64>& typeIndex()
+{
+    static const QHash<QString, qint64> index = buildIndex(kTypeNames);
+    return index;
+}
+
+// поля, в которых лежит client_id и которые стоит заменять номером
+bool isClientIdField(const QString& key)
+{
+    return key == QLatin1String("client_id") || key == QLatin1String("creator_client_id")
+           || key == QLatin1String("target_client_id") || key == QLatin1String("new_admin_id");
+}
+
+} // namespace
+
+void CollabCodec::reset()
+{
+    m_format = Format::Json;
+    m_sentIds.clear();
+    m_receivedIds.clear();
+}
+
+QByteArray CollabCodec::encode(const QJsonObject& message)
+{
+    return QCborValue(encodeObject(message)).toCbor();
+}
+
+QJsonObject CollabCodec::decode(const QByteArray& data, bool *ok)
+{
+    QCborParserError error;
+    const QCborValue root = QCborValue::fromCbor(data, &error);
+    const bool valid = error.error == QCborError::NoError && root.isMap();
+    if (ok) {
+        *ok = valid;
+    }
+    if (!valid) {
+        return QJsonObject();
+    }
+    return decodeObject(root.toMap());
+}
+
+QCborMap CollabCodec::encodeObject(const QJsonObject& object)
+{
+    QCborMap map;
+    for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+        const qint64 fieldNumber = fieldIndex().value(it.key(), -1);
+        const QCborValue encoded = encodeValue(it.value(), it.key());
+        if (fieldNumber >= 0) {
+            map.insert(fieldNumber, encoded);
+        } else {
+            map.insert(it.key(), encoded); // неизвестное поле уходит с текстовым ключом
+        }
+    }
+    return map;
+}
+
+QCborValue CollabCodec::encodeValue(const QJsonValue& value, const QString& key)
+{
+    switch (value.type()) {
+    case QJsonValue::String: {
+        const QString text = value.toString();
+        if (key == QLatin1String("type")) {
+            const qint64 typeNumber = typeIndex().value(text, -1);
+            if (typeNumber >= 0) {
+                return QCborValue(typeNumber);
+            }
+        } else if (isClientIdField(key)) {
+            auto it = m_sentIds.constFind(text);
+            if (it != m_sentIds.constEnd()) {
+                return QCborValue(it.value());
+            }
+            // первая встреча: отправляем строку, обе стороны запоминают ее под следующим номером
+            m_sentIds.insert(text, m_sentIds.size());
+        }
+        return QCborValue(text);
+    }
+    case QJsonValue::Double: {
+        const double number = value.toDouble();
+        // позиции, ревизии и счетчики целые, в CBOR они занимают 1-5 байт вместо 9
+        if (std::trunc(number) == number && qAbs(number) < 9.0e15) {
+            return QCborValue(qint64(number));
+        }
+        return QCborValue(number);
+    }
+    case QJsonValue::Bool:
+        return QCborValue(value.toBool());
+    case QJsonValue::Array: {
+        QCborArray array;
+        for (const QJsonValue& item : value.toArray()) {
+            array.append(encodeValue(item, QString()));
+        }
+        return array;
+    }
+    case QJsonValue::Object:
+        return encodeObject(value.toObject());
+    case QJsonValue::Null:
+        return QCborValue(nullptr);
+    default:
+        return QCborValue();
+    }
+}
+
+QJsonObject CollabCodec::decodeObject(const QCborMap& map)
+{
+    QJsonObject object;
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+        QString key;
+        if (it.key().isInteger()) {
+            const qint64 fieldNumber = it.key().toInteger();
+            if (fieldNumber < 0 || fieldNumber >= qint64(std::size(kFieldNames))) {
+                continue; // поле из более новой версии протокола, пропускаем
+            }
+            key = QString::fromLatin1(kFieldNames[fieldNumber]);
+        } else {
+            key = it.key().toString();
+        }
+        object.insert(key, decodeValue(it.value(), key));
+    }
+    return object;
+}
+
+QJsonValue CollabCodec::decodeValue(const QCborValue& value, const QString& key)
+{
+    if (value.isInteger()) {
+        const qint64 number = value.toInteger();
+        if (key == QLatin1String("type")) {
+            if (number >= 0 && number < qint64(std::size(kTypeNames))) {
+                return QString::fromLatin1(kTypeNames[number]);
+            }
+            return QString();
+        }
+        if (isClientIdField(key)) {
+            return m_receivedIds.value(number);
+        }
+        return QJsonValue(number);
+    }
+    if (value.isString()) {
+        const QString text = value.toString();
+        if (isClientIdField(key)) {
+            m_receivedIds.append(text); // новый client_id, дальше он придет номером
+        }
+        return text;
+    }
+    if (value.isMap()) {
+        return decodeObject(value.toMap());
+    }
+    if (value.isArray()) {
+        QJsonArray array;
+        const QCborArray cborArray = value.toArray();
+        for (const QCborValue& item : cborArray) {
+            array.append(decodeValue(item, QString()));
+        }
+        return array;
+    }
+    if (value.isBool()) {
+        return value.toBool();
+    }
+    if (value.isDouble()) {
+        return value.toDouble();
+    }
+    if (value.isNull()) {
+        return QJsonValue(QJsonValue::Null);
+    }
+    return QJsonValue();
+}
+
+QList<QJsonObject> CollabChunker::split(const QJsonObject& message, int maxFrameBytes)
+{
+    const int budget = qMax(MinFrameBytes, maxFrameBytes) - HeaderReserveBytes;
+    for (const QLatin1String field : {QLatin1String("text"), QLatin1String("text_compressed")}) {
+        const QJsonValue value = message.value(field);
+        if (!value.isString()) continue;
+        const QString text = value.toString();
+        if (CollabOp::wireLength(text) <= budget) continue;
+
+        QJsonObject head = message;
+        head.remove(field);
+        head["chunk_field"] = field;
+        QList<QJsonObject> frames{head};
+        for (int offset = 0; offset < text.length();) {
+            const int length = CollabOp::fitWireLength(QStringView(text).mid(offset), budget);
+            frames.append(QJsonObject{{"type", "text_chunk"}, {"data", text.mid(offset, length)}});
+            offset += length;
+        }
+        frames.first()["chunks"] = int(frames.size() - 1);
+        return frames;
+    }
+    return {message};
+}
+
+bool CollabChunker::accept(QJsonObject& message)
+{
+    if (message.value(QLatin1String("type")).toString() == QLatin1String("text_chunk")) {
+        if (m_expected <= 0) {
+            qWarning() << "Часть сообщения без начала, пропущена";
+            return false;
+        }
+        m_parts.append(message.value(QLatin1String("data")).toString());
+        if (m_parts.size() < m_expected) {
+            return false;
+        }
+        message = m_head;
+        message[m_field] = m_parts.join(QString());
+        reset();
+        return true;
+    }
+
+    if (message.contains(QLatin1String("chunks"))) {
+        if (m_expected > 0) {
+            qWarning() << "Недособранное сообщение" << m_head.value(QLatin1String("type")).toString() << "выброшено";
+        }
+        m_expected = message.value(QLatin1String("chunks")).toInt();
+        m_field = message.value(QLatin1String("chunk_field")).toString();
+        message.remove(QLatin1String("chunks"));
+        message.remove(QLatin1String("chunk_field"));
+        if (m_expected <= 0 || m_field.isEmpty()) {
+            reset();
+            return true; // нечего ждать, поле просто пустое
+        }
+        m_head = message;
+        m_parts.clear();
+        m_parts.reserve(m_expected);
+        return false;
+    }
+    return true;
+}
+
+void CollabChunker::reset()
+{
+    m_head = QJsonObject();
+    m_field.clear();
+    m_expected = 0;
+    m_parts.clear();
+}
@@ -0,0 +1,74 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef COLLABPROTOCOL_H
+#define COLLABPROTOCOL_H
+
+#include <QByteArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QHash>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// кодек сообщений совместной работы для одного соединения
+// JSON - текстовые кадры, как раньше; CBOR - бинарные кадры, где имена полей и типы сообщений
+// заменены числами, а client_id передается строкой только в первый раз, дальше - номером
+// таблицы номеров у каждой стороны свои и живут ровно одно соединение (WebSocket доставляет кадры по порядку)
+class CollabCodec
+{
+public:
+    enum class Format { Json, Cbor };
+
+    static const QString CborProtocolName; // имя в полях protocols/protocol при согласовании
+    static const QString JsonProtocolName;
+
+    void reset(); // новое соединение: снова JSON, таблицы номеров пустые
+    void setFormat(Format format) { m_format = format; }
+    Format format() const { return m_format; }
+    bool isBinary() const { return m_format == Format::Cbor; }
+
+    QByteArray encode(const QJsonObject& message); // меняет таблицу отправленных client_id
+    QJsonObject decode(const QByteArray& data, bool *ok = nullptr); // меняет таблицу полученных client_id
+
+private:
+    QCborValue encodeValue(const QJsonValue& value, const QString& key);
+    QJsonValue decodeValue(const QCborValue& value, const QString& key);
+    QCborMap encodeObject(const QJsonObject& object);
+    QJsonObject decodeObject(const QCborMap& map);
+
+    Format m_format = Format::Json;
+    QHash<QString, qint64> m_sentIds; // client_id -> номер, уже отправленные
+    QList<QString> m_receivedIds; // номер -> client_id, уже полученные
+};
+
+// предел размера кадра: строковое поле (text, text_compressed), которое в него не влезает,
+// уходит частями - сначала само сообщение без поля с chunks/chunk_field, следом chunks кадров text_chunk
+// части идут подряд по тому же соединению, поэтому сборке не нужны номера и идентификаторы
+class CollabChunker
+{
+public:
+    static constexpr int DefaultMaxFrameBytes = 256 * 1024;
+    static constexpr int MinFrameBytes = 4 * 1024;
+    static constexpr int HeaderReserveBytes = 1024; // type, client_id, revision, path и прочее вокруг строки
+
+    // сообщения, которые надо отправить вместо message; обычно это один message без изменений
+    static QList<QJsonObject> split(const QJsonObject& message, int maxFrameBytes);
+
+    // принятое сообщение; false - это часть, целиком сообщение еще не собрано
+    // true - в message готовое сообщение (пришло целиком или собрано из частей)
+    bool accept(QJsonObject& message);
+    void reset(); // новое соединение: недособранное сообщение выбрасывается
+
+private:
+    QJsonObject m_head;
+    QString m_field;
+    int m_expected = 0;
+    QStringList m_parts;
+};
+
+#endif // COLLABPROTOCOL_H
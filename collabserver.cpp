@@ -0,0 +1,954 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "collabserver.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QUuid>
+#include <QWebSocket>
+#include <iterator>
+#include <utility>
+
+namespace {
+
+const char *const kColors[] = {
+    "#e6194b", "#3cb44b", "#4363d8", "#f58231", "#911eb4", "#46f0f0",
+    "#f032e6", "#bcf60c", "#008080", "#9a6324", "#800000", "#000075",
+};
+
+qint64 nowSecs()
+{
+    return QDateTime::currentSecsSinceEpoch();
+}
+
+QJsonObject opsMessage(const QList<CollabOp>& ops)
+{
+    // одна операция - обычный insert/delete, иначе batch; пустая пачка тоже рассылается, чтобы ревизии шли подряд
+    if (ops.size() == 1) {
+        return ops.first().toJson();
+    }
+    QJsonArray array;
+    for (const CollabOp& op : ops) {
+        array.append(op.toJson());
+    }
+    return QJsonObject{{"type", "batch"}, {"ops", array}};
+}
+
+// path пишется только для именованных документов: для общего буфера сообщение не отличается от прежнего
+void setPath(QJsonObject& message, const QString& path)
+{
+    if (!path.isEmpty()) {
+        message["path"] = path;
+    }
+}
+
+// начало строки line в тексте; за последней строкой - конец текста
+qsizetype lineOffset(const QString& text, int line)
+{
+    qsizetype offset = 0;
+    for (int i = 0; i < line; ++i) {
+        const qsizetype next = text.indexOf(QLatin1Char('\n'), offset);
+        if (next < 0) return text.size();
+        offset = next + 1;
+    }
+    return offset;
+}
+
+constexpr int kMaxHashQueryRanges = 64; // больше частей в одном hash_query не разбираем
+
+} // namespace
+
+CollabServer::CollabServer(QObject *parent)
+    : QObject(parent)
+    , m_server(QStringLiteral("BAM_IDE collab server"), QWebSocketServer::NonSecureMode)
+{
+    connect(&m_server, &QWebSocketServer::newConnection, this, &CollabServer::onNewConnection);
+    connect(&m_housekeeping, &QTimer::timeout, this, &CollabServer::onHousekeeping);
+    m_housekeeping.start(1000);
+}
+
+CollabServer::~CollabServer()
+{
+    saveStore();
+    for (Client *client : std::as_const(m_clients)) {
+        client->socket->disconnect(this);
+        client->socket->abort();
+        delete client->socket;
+    }
+    qDeleteAll(m_clients);
+    qDeleteAll(m_sessions);
+}
+
+bool CollabServer::listen(const QHostAddress& address, quint16 port)
+{
+    return m_server.listen(address, port);
+}
+
+void CollabServer::setStorePath(const QString& path)
+{
+    m_storePath = path;
+    loadStore();
+}
+
+// имена типов один раз переводятся в обработчики, дальше - один поиск в хеше на сообщение
+const QHash<QString, CollabServer::Handler>& CollabServer::handlers()
+{
+    static const QHash<QString, Handler> table = {
+        {"create_session", &CollabServer::handleCreateSession},
+        {"join_session", &CollabServer::handleJoinSession},
+        {"leave_session", &CollabServer::handleLeaveSession},
+        {"insert", &CollabServer::handleOps},
+        {"delete", &CollabServer::handleOps},
+        {"batch", &CollabServer::handleOps},
+        {"file_content_update", &CollabServer::handleFileContentUpdate},
+        {"cursor_position_update", &CollabServer::handleCursorPositionUpdate},
+        {"chat_message", &CollabServer::handleChatMessage},
+        {"mute_client", &CollabServer::handleMuteClient},
+        {"unmute_client", &CollabServer::handleUnmuteClient},
+        {"transfer_admin", &CollabServer::handleTransferAdmin},
+        {"save_session", &CollabServer::handleSaveSession},
+        {"open_document", &CollabServer::handleOpenDocument},
+        {"close_document", &CollabServer::handleCloseDocument},
+        {"doc_hash", &CollabServer::handleDocHash},
+        {"hash_query", &CollabServer::handleHashQuery},
+        {"block_request", &CollabServer::handleBlockRequest},
+    };
+    return table;
+}
+
+void CollabServer::onNewConnection()
+{
+    while (QWebSocket *socket = m_server.nextPendingConnection()) {
+        Client *client = new Client;
+        client->socket = socket;
+        m_clients.insert(socket, client);
+        connect(socket, &QWebSocket::textMessageReceived, this, [this, socket](const QString& message) {
+            onTextMessage(socket, message);
+        });
+        connect(socket, &QWebSocket::binaryMessageReceived, this, [this, socket](const QByteArray& message) {
+            onBinaryMessage(socket, message);
+        });
+        connect(socket, &QWebSocket::disconnected, this, [this, socket]() { onSocketDisconnected(socket); });
+    }
+}
+
+void CollabServer::onTextMessage(QWebSocket *socket, const QString& message)
+{
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(message.toUtf8(), &error);
+    if (error.error != QJsonParseError::NoError || !document.isObject()) {
+        qWarning() << "Неразборчивое сообщение от" << socket->peerAddress().toString() << error.errorString();
+        return;
+    }
+    dispatch(socket, document.object());
+}
+
+void CollabServer::onBinaryMessage(QWebSocket *socket, const QByteArray& message)
+{
+    Client *client = m_clients.value(socket);
+    if (!client) return;
+    bool ok = false;
+    const QJsonObject decoded = client->codec.decode(message, &ok);
+    if (!ok) {
+        qWarning() << "Неразборчивый бинарный кадр от" << client->clientId << "байт:" << message.size();
+        return;
+    }
+    dispatch(socket, decoded);
+}
+
+void CollabServer::dispatch(QWebSocket *socket, const QJsonObject& frame)
+{
+    Client *client = m_clients.value(socket);
+    if (!client) return;
+    QJsonObject message = frame;
+    if (!client->chunker.accept(message)) {
+        return; // часть длинного сообщения, обработаем целиком после последней
+    }
+    const QString type = message.value(QLatin1String("type")).toString();
+    const Handler handler = handlers().value(type, nullptr);
+    if (!handler) {
+        qWarning() << "Неизвестный тип сообщения:" << type;
+        return;
+    }
+    // до входа в сессию принимаются только create_session/join_session
+    if (client->clientId.isEmpty() && handler != &CollabServer::handleCreateSession
+        && handler != &CollabServer::handleJoinSession) {
+        return;
+    }
+    (this->*handler)(*client, message);
+}
+
+void CollabServer::onSocketDisconnected(QWebSocket *socket)
+{
+    Client *client = m_clients.take(socket);
+    if (client) {
+        leaveSession(*client);
+        if (m_socketsById.value(client->clientId) == socket) {
+            m_socketsById.remove(client->clientId);
+        }
+        delete client;
+    }
+    socket->deleteLater();
+}
+
+void CollabServer::adoptIdentity(Client& client, const QJsonObject& request)
+{
+    const QString clientId = request.value(QLatin1String("client_id")).toString();
+    if (client.clientId != clientId) {
+        // тот же клиент после обрыва, а старое соединение сервер еще не успел закрыть
+        // место в сессии и цвет переходят новому соединению, остальные участники выхода не видят
+        QWebSocket *previous = m_socketsById.value(clientId);
+        if (previous && previous != client.socket) {
+            Client *stale = m_clients.take(previous);
+            previous->disconnect(this);
+            previous->abort();
+            previous->deleteLater();
+            if (stale) {
+                if (client.sessionId.isEmpty()) {
+                    client.sessionId = stale->sessionId;
+                    client.documents = stale->documents;
+                    client.color = stale->color;
+                }
+                delete stale;
+            }
+        }
+        if (!client.clientId.isEmpty()) {
+            m_socketsById.remove(client.clientId);
+        }
+        client.clientId = clientId;
+        m_socketsById.insert(clientId, client.socket);
+    }
+    client.username = request.value(QLatin1String("username")).toString();
+    client.compressSnapshots = request.value(QLatin1String("snapshot_compression")).toString() == QLatin1String("zlib");
+}
+
+CollabServer::Session *CollabServer::sessionOf(const Client& client)
+{
+    return client.sessionId.isEmpty() ? nullptr : m_sessions.value(client.sessionId);
+}
+
+QByteArray CollabServer::hashPassword(const QString& sessionId, const QString& password)
+{
+    return QCryptographicHash::hash((sessionId + QLatin1Char(':') + password).toUtf8(), QCryptographicHash::Sha256);
+}
+
+void CollabServer::handleCreateSession(Client& client, const QJsonObject& message)
+{
+    const QString password = message.value(QLatin1String("password")).toString();
+    if (password.length() < 4) {
+        sendError(client, QStringLiteral("Пароль должен содержать минимум 4 символа"));
+        return;
+    }
+    adoptIdentity(client, message);
+    leaveSession(client);
+
+    Session *session = new Session;
+    session->id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    session->passwordHash = hashPassword(session->id, password);
+    session->adminId = client.clientId;
+    const int days = message.value(QLatin1String("days")).toInt();
+    if (days > 0) {
+        session->expiresAt = nowSecs() + qint64(days) * 86400;
+    }
+    m_sessions.insert(session->id, session);
+    qInfo() << "Создана сессия" << session->id << "клиентом" << client.clientId;
+    enterSession(client, *session, message);
+}
+
+void CollabServer::handleJoinSession(Client& client, const QJsonObject& message)
+{
+    const QString sessionId = message.value(QLatin1String("session_id")).toString();
+    Session *session = m_sessions.value(sessionId);
+    if (!session) {
+        sendError(client, QStringLiteral("Сессия не найдена"), sessionId);
+        return;
+    }
+    if (session->passwordHash != hashPassword(sessionId, message.value(QLatin1String("password")).toString())) {
+        sendError(client, QStringLiteral("Неверный пароль"), sessionId);
+        return;
+    }
+    adoptIdentity(client, message);
+    if (client.sessionId != sessionId) {
+        leaveSession(client);
+    }
+    enterSession(client, *session, message);
+}
+
+void CollabServer::enterSession(Client& client, Session& session, const QJsonObject& request)
+{
+    client.sessionId = session.id;
+    client.userDeltas = request.value(QLatin1String("features")).toArray().contains(QLatin1String("user_deltas"));
+    if (!session.members.contains(client.clientId)) {
+        session.members.append(client.clientId);
+    }
+    if (client.color.isEmpty()) {
+        client.color = QString::fromLatin1(kColors[session.colorCounter++ % int(std::size(kColors))]);
+    }
+
+    // вход подписывает на один документ - тот, что открыт у клиента сейчас; без path - общий буфер сессии
+    const QString path = request.value(QLatin1String("path")).toString();
+    const QSet<QString> previous = client.documents;
+    for (const QString& open : previous) {
+        if (open != path) {
+            unsubscribe(client, session, open, true);
+        }
+    }
+    bool created = false;
+    Document& document = documentFor(session, path, request.value(QLatin1String("text")).toString(), &created);
+    subscribe(client, document, path);
+
+    QJsonObject info{
+        {"type", "session_info"},
+        {"session_id", session.id},
+        {"creator_client_id", session.adminId},
+        {"features", QJsonArray{"batch", "documents", "doc_hash", "user_deltas"}},
+    };
+    setPath(info, path);
+    writeDocumentState(info, client, document, request.value(QLatin1String("since_revision")).toInt(-1));
+    if (created && request.value(QLatin1String("text_length")).toInt() > 0) {
+        info["seed"] = true; // текст больше кадра: документ создан пустым, клиент зальет его операциями
+    }
+
+    const QJsonArray protocols = request.value(QLatin1String("protocols")).toArray();
+    const bool binary = protocols.contains(CollabCodec::CborProtocolName);
+    if (binary) {
+        info["protocol"] = CollabCodec::CborProtocolName;
+    }
+    send(client, info); // на новом соединении - текстом, формат переключается после него
+
+    if (binary) {
+        client.codec.setFormat(CollabCodec::Format::Cbor);
+    }
+
+    notifyUserJoined(session, client);
+    // новичку - кто сейчас заглушен, включая его самого после переподключения
+    for (auto it = session.muteEndTimes.constBegin(); it != session.muteEndTimes.constEnd(); ++it) {
+        QJsonObject status{{"type", "muted_status_update"}, {"client_id", it.key()}, {"is_muted", true}};
+        if (it.value() >= 0) {
+            status["mute_end_time"] = it.value();
+        }
+        send(client, status);
+    }
+}
+
+void CollabServer::writeDocumentState(QJsonObject& out, const Client& client, const Document& document,
+                                      int sinceRevision) const
+{
+    out["revision"] = document.ot.revision();
+
+    // после обрыва клиент просит только то, что пропустил; если история не покрывает разрыв - полный текст
+    QList<OtServerDocument::Entry> missed;
+    bool caughtUp = false;
+    if (sinceRevision >= 0 && document.ot.entriesSince(sinceRevision, missed)) {
+        QJsonArray catchUp;
+        int revision = sinceRevision;
+        int bytes = 0;
+        for (const OtServerDocument::Entry& entry : std::as_const(missed)) {
+            QJsonArray ops;
+            for (const CollabOp& op : entry.ops) {
+                ops.append(op.toJson());
+                bytes += op.wireSize();
+            }
+            catchUp.append(QJsonObject{{"client_id", entry.clientId}, {"revision", ++revision}, {"ops", ops}});
+        }
+        // catch_up частями не делится; если пропущено больше кадра, дешевле прислать текст (он делится)
+        caughtUp = bytes <= m_maxFrameBytes - CollabChunker::HeaderReserveBytes;
+        if (caughtUp) {
+            out["catch_up"] = catchUp;
+        }
+    }
+    if (!caughtUp) {
+        const QByteArray utf8 = document.ot.text().toUtf8();
+        if (client.compressSnapshots && utf8.size() >= m_compressionThreshold) {
+            out["text_compressed"] = QString::fromLatin1(qCompress(utf8).toBase64());
+        } else {
+            out["text"] = document.ot.text();
+        }
+    }
+
+    QJsonObject cursors;
+    for (const QString& memberId : document.subscribers) {
+        const Client *member = m_clients.value(m_socketsById.value(memberId));
+        if (memberId == client.clientId || !member) continue;
+        const Cursor cursor = document.cursors.value(memberId);
+        QJsonObject cursorInfo{{"position", cursor.position}, {"username", member->username}, {"color", member->color}};
+        if (cursor.anchor >= 0) {
+            cursorInfo["anchor"] = cursor.anchor;
+        }
+        cursors.insert(memberId, cursorInfo);
+    }
+    out["cursors"] = cursors;
+}
+
+CollabServer::Document& CollabServer::documentFor(Session& session, const QString& path, const QString& initialText,
+                                                 bool *created)
+{
+    Document *document = session.documents.value(path);
+    if (created) {
+        *created = !document;
+    }
+    if (!document) {
+        document = new Document;
+        document->ot = OtServerDocument(initialText);
+        document->ot.setHistoryLimit(m_historyLimit);
+        session.documents.insert(path, document);
+        qInfo() << "Сессия" << session.id << "- новый документ" << path;
+    }
+    return *document;
+}
+
+CollabServer::Document *CollabServer::documentOf(Session& session, const QJsonObject& message)
+{
+    return session.documents.value(message.value(QLatin1String("path")).toString());
+}
+
+void CollabServer::subscribe(Client& client, Document& document, const QString& path)
+{
+    client.documents.insert(path);
+    if (!document.subscribers.contains(client.clientId)) {
+        document.subscribers.append(client.clientId);
+    }
+}
+
+void CollabServer::unsubscribe(Client& client, Session& session, const QString& path, bool notify)
+{
+    client.documents.remove(path);
+    Document *document = session.documents.value(path);
+    if (!document) return;
+    document->subscribers.removeAll(client.clientId);
+    document->cursors.remove(client.clientId);
+    // сам документ остается: его текст - общий для сессии, пока кто-нибудь не откроет файл снова
+    if (notify) {
+        QJsonObject closed{{"type", "document_closed"}, {"client_id", client.clientId}};
+        setPath(closed, path);
+        broadcast(*document, closed);
+    }
+}
+
+void CollabServer::handleOpenDocument(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    if (!session) return;
+    const QString path = message.value(QLatin1String("path")).toString();
+    bool created = false;
+    Document& document = documentFor(*session, path, message.value(QLatin1String("text")).toString(), &created);
+    subscribe(client, document, path);
+    QJsonObject info{{"type", "document_info"}};
+    setPath(info, path);
+    writeDocumentState(info, client, document, message.value(QLatin1String("since_revision")).toInt(-1));
+    if (created && message.value(QLatin1String("text_length")).toInt() > 0) {
+        info["seed"] = true;
+    }
+    send(client, info);
+}
+
+void CollabServer::handleCloseDocument(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    if (!session) return;
+    unsubscribe(client, *session, message.value(QLatin1String("path")).toString(), true);
+}
+
+void CollabServer::handleLeaveSession(Client& client, const QJsonObject& message)
+{
+    Q_UNUSED(message);
+    leaveSession(client);
+}
+
+void CollabServer::leaveSession(Client& client)
+{
+    Session *session = sessionOf(client);
+    client.sessionId.clear();
+    if (!session) return;
+
+    session->members.removeAll(client.clientId);
+    // остальные и так получат user_disconnected, document_closed не нужен
+    const QSet<QString> documents = std::exchange(client.documents, {});
+    for (const QString& path : documents) {
+        unsubscribe(client, *session, path, false);
+    }
+    broadcast(*session, QJsonObject{{"type", "user_disconnected"}, {"client_id", client.clientId}, {"username", client.username}});
+
+    if (session->members.isEmpty()) {
+        if (session->expiresAt > nowSecs()) {
+            saveStore(); // последний вышел - на диске должен остаться актуальный текст
+        } else {
+            qInfo() << "Сессия" << session->id << "закрыта";
+            m_sessions.remove(session->id);
+            delete session;
+        }
+        return;
+    }
+    if (session->adminId == client.clientId) {
+        session->adminId = session->members.first();
+        broadcast(*session, QJsonObject{{"type", "admin_changed"}, {"new_admin_id", session->adminId}});
+    }
+    broadcastUserList(*session);
+}
+
+void CollabServer::handleOps(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    if (!session) return;
+    // правки принимаются и в уже закрытом документе: после close_document клиент досылает то, что ждало ack
+    const QString path = message.value(QLatin1String("path")).toString();
+    Document *document = session->documents.value(path);
+    if (!document) {
+        qWarning() << "Правка несуществующего документа" << path << "от" << client.clientId;
+        return;
+    }
+
+    QList<CollabOp> ops;
+    const QJsonArray array = message.value(QLatin1String("type")).toString() == QLatin1String("batch")
+                                 ? message.value(QLatin1String("ops")).toArray()
+                                 : QJsonArray{message};
+    for (const QJsonValue& value : array) {
+        bool ok = false;
+        const CollabOp op = CollabOp::fromJson(value.toObject(), &ok);
+        if (!ok) {
+            sendSnapshot(client, *document, path);
+            return;
+        }
+        ops.append(op);
+    }
+
+    // правки заглушенного не принимаются, его документ возвращаем к серверному
+    if (isMuted(*session, client.clientId)) {
+        sendSnapshot(client, *document, path);
+        return;
+    }
+
+    // клиент без OT присылает позиции без ревизии - считаем их основанными на текущем тексте
+    const bool ot = message.contains(QLatin1String("revision"));
+    const int baseRevision = ot ? message.value(QLatin1String("revision")).toInt() : document->ot.revision();
+    if (!document->ot.receive(client.clientId, baseRevision, ops)) {
+        sendSnapshot(client, *document, path);
+        return;
+    }
+
+    const int revision = document->ot.revision();
+    if (ot) {
+        QJsonObject ack{{"type", "ack"}, {"revision", revision}};
+        setPath(ack, path);
+        send(client, ack);
+    }
+    QJsonObject out = opsMessage(ops);
+    out["client_id"] = client.clientId;
+    out["revision"] = revision;
+    setPath(out, path);
+    broadcast(*document, out, client.clientId);
+}
+
+void CollabServer::handleFileContentUpdate(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    if (!session || isMuted(*session, client.clientId)) return;
+    Document *document = documentOf(*session, message);
+    if (!document) return;
+    const QString text = message.value(QLatin1String("text")).toString();
+    document->ot.replaceText(client.clientId, text);
+    QJsonObject out{{"type", "file_content_update"}, {"text", text}, {"client_id", client.clientId},
+                    {"username", client.username}, {"revision", document->ot.revision()}};
+    setPath(out, message.value(QLatin1String("path")).toString());
+    broadcast(*document, out, client.clientId);
+}
+
+void CollabServer::sendSnapshot(Client& client, const Document& document, const QString& path)
+{
+    QJsonObject snapshot{{"type", "file_content_update"}, {"text", document.ot.text()}, {"revision", document.ot.revision()}};
+    setPath(snapshot, path);
+    send(client, snapshot);
+}
+
+const BlockHashTree& CollabServer::Document::lineHashes() const
+{
+    if (hashesRevision != ot.revision()) {
+        hashes.rebuild(BlockHashTree::hashLines(ot.text()));
+        hashesRevision = ot.revision();
+    }
+    return hashes;
+}
+
+const CollabServer::Document *CollabServer::hashedDocument(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    if (!session) return nullptr;
+    const Document *document = documentOf(*session, message);
+    if (!document || !document->subscribers.contains(client.clientId)) return nullptr;
+    // на другой ревизии тексты и не должны совпадать; клиент повторит сверку позже
+    if (message.value(QLatin1String("revision")).toInt(-1) != document->ot.revision()) return nullptr;
+    return document;
+}
+
+void CollabServer::sendHashRanges(Client& client, const Document& document, const QString& path,
+                                  const QList<QPair<int, int>>& ranges)
+{
+    const BlockHashTree& tree = document.lineHashes();
+    QJsonArray array;
+    for (const QPair<int, int>& range : ranges) {
+        const int first = qBound(0, range.first, tree.lineCount());
+        const int count = qBound(0, range.second, tree.lineCount() - first);
+        QJsonArray hashes;
+        for (const QPair<int, int>& part : BlockHashTree::children(first, count)) {
+            hashes.append(BlockHashTree::shortHash(tree.rangeHash(part.first, part.second)));
+        }
+        array.append(QJsonObject{{"first", first}, {"count", count}, {"hashes", hashes}});
+    }
+    QJsonObject out{{"type", "hash_ranges"}, {"revision", document.ot.revision()}, {"lines", tree.lineCount()},
+                    {"ranges", array}};
+    setPath(out, path);
+    send(client, out);
+}
+
+void CollabServer::handleDocHash(Client& client, const QJsonObject& message)
+{
+    const Document *document = hashedDocument(client, message);
+    if (!document) return;
+    const BlockHashTree& tree = document->lineHashes();
+    const quint64 hash = message.value(QLatin1String("hash")).toString().toULongLong(nullptr, 16);
+    // совпадение - молчание: в обычном случае сверка стоит одного сообщения
+    if (hash == tree.rootHash() && message.value(QLatin1String("lines")).toInt() == tree.lineCount()) return;
+    sendHashRanges(client, *document, message.value(QLatin1String("path")).toString(), {{0, tree.lineCount()}});
+}
+
+void CollabServer::handleHashQuery(Client& client, const QJsonObject& message)
+{
+    const Document *document = hashedDocument(client, message);
+    if (!document) return;
+    QList<QPair<int, int>> ranges;
+    for (const QJsonValue& value : message.value(QLatin1String("ranges")).toArray()) {
+        if (ranges.size() == kMaxHashQueryRanges) break;
+        const QJsonObject range = value.toObject();
+        ranges.append({range.value(QLatin1String("first")).toInt(), range.value(QLatin1String("count")).toInt()});
+    }
+    if (ranges.isEmpty()) return;
+    sendHashRanges(client, *document, message.value(QLatin1String("path")).toString(), ranges);
+}
+
+void CollabServer::handleBlockRequest(Client& client, const QJsonObject& message)
+{
+    const Document *document = hashedDocument(client, message);
+    if (!document) return;
+    const BlockHashTree& tree = document->lineHashes();
+    const QString& text = document->ot.text();
+    const int first = qBound(0, message.value(QLatin1String("first")).toInt(), tree.lineCount());
+    const int count = qBound(0, message.value(QLatin1String("count")).toInt(), tree.lineCount() - first);
+    // строки вместе с переводом строки после последней из них, кроме конца текста
+    const qsizetype start = lineOffset(text, first);
+    const qsizetype end = first + count >= tree.lineCount() ? text.size() : lineOffset(text, first + count);
+    QJsonObject out{{"type", "block_text"}, {"revision", document->ot.revision()}, {"first", first}, {"count", count},
+                    {"lines", tree.lineCount()}, {"text", text.mid(start, end - start)},
+                    {"hash", QString::number(tree.rootHash(), 16)}};
+    setPath(out, message.value(QLatin1String("path")).toString());
+    send(client, out);
+}
+
+void CollabServer::handleCursorPositionUpdate(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    if (!session) return;
+    Document *document = documentOf(*session, message);
+    if (!document || !document->subscribers.contains(client.clientId)) return;
+    Cursor& cursor = document->cursors[client.clientId];
+    cursor.position = message.value(QLatin1String("position")).toInt();
+    cursor.anchor = message.value(QLatin1String("anchor")).toInt(-1);
+
+    QJsonObject out{{"type", "cursor_position_update"}, {"client_id", client.clientId}, {"position", cursor.position},
+                    {"username", client.username}, {"color", client.color}};
+    if (cursor.anchor >= 0) {
+        out["anchor"] = cursor.anchor;
+    }
+    setPath(out, message.value(QLatin1String("path")).toString());
+    broadcast(*document, out, client.clientId);
+}
+
+void CollabServer::handleChatMessage(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    if (!session) return;
+    // отправитель показывает свое сообщение сам
+    broadcast(*session, QJsonObject{{"type", "chat_message"}, {"session_id", session->id}, {"client_id", client.clientId},
+                                    {"username", client.username},
+                                    {"text_message", message.value(QLatin1String("text_message")).toString()}},
+              client.clientId);
+}
+
+void CollabServer::handleMuteClient(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    const QString targetId = message.value(QLatin1String("target_client_id")).toString();
+    if (!session || !isAdmin(client, *session) || targetId == client.clientId || !session->members.contains(targetId)) {
+        return;
+    }
+    const int duration = qMax(0, message.value(QLatin1String("duration")).toInt());
+    setMuted(*session, targetId, true, duration == 0 ? -1 : nowSecs() + duration);
+    if (Client *target = m_clients.value(m_socketsById.value(targetId))) {
+        send(*target, QJsonObject{{"type", "mute_notification"}, {"duration", duration}});
+    }
+}
+
+void CollabServer::handleUnmuteClient(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    const QString targetId = message.value(QLatin1String("target_client_id")).toString();
+    if (!session || !isAdmin(client, *session) || !isMuted(*session, targetId)) {
+        return;
+    }
+    setMuted(*session, targetId, false, -1);
+}
+
+void CollabServer::setMuted(Session& session, const QString& clientId, bool muted, qint64 endTime)
+{
+    QJsonObject status{{"type", "muted_status_update"}, {"client_id", clientId}, {"is_muted", muted}};
+    if (muted) {
+        session.muteEndTimes.insert(clientId, endTime);
+        if (endTime >= 0) {
+            status["mute_end_time"] = endTime; // бессрочный мьют - без поля
+        }
+    } else {
+        session.muteEndTimes.remove(clientId);
+        status["mute_end_time"] = QJsonValue::Null;
+    }
+    broadcast(session, status);
+}
+
+void CollabServer::handleTransferAdmin(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    const QString newAdminId = message.value(QLatin1String("new_admin_id")).toString();
+    if (!session || !isAdmin(client, *session) || !session->members.contains(newAdminId)) {
+        return;
+    }
+    session->adminId = newAdminId;
+    broadcast(*session, QJsonObject{{"type", "admin_changed"}, {"new_admin_id", newAdminId}});
+    broadcastUserList(*session);
+}
+
+void CollabServer::handleSaveSession(Client& client, const QJsonObject& message)
+{
+    Session *session = sessionOf(client);
+    const int days = message.value(QLatin1String("days")).toInt();
+    if (!session || !isAdmin(client, *session) || days <= 0) {
+        send(client, QJsonObject{{"type", "error"}, {"message", "Не удалось сохранить сессию"}, {"days", -1}});
+        return;
+    }
+    session->expiresAt = nowSecs() + qint64(days) * 86400;
+    saveStore();
+    send(client, QJsonObject{{"type", "session_saved"}, {"days", days}});
+}
+
+void CollabServer::onHousekeeping()
+{
+    const qint64 now = nowSecs();
+    QList<QString> expired;
+    for (Session *session : std::as_const(m_sessions)) {
+        QList<QString> ended;
+        for (auto it = session->muteEndTimes.constBegin(); it != session->muteEndTimes.constEnd(); ++it) {
+            if (it.value() >= 0 && it.value() <= now) {
+                ended.append(it.key());
+            }
+        }
+        for (const QString& clientId : std::as_const(ended)) {
+            setMuted(*session, clientId, false, -1);
+        }
+        if (session->members.isEmpty() && session->expiresAt <= now) {
+            expired.append(session->id);
+        }
+    }
+    for (const QString& sessionId : std::as_const(expired)) {
+        qInfo() << "Срок сохраненной сессии истек:" << sessionId;
+        delete m_sessions.take(sessionId);
+    }
+    if (!expired.isEmpty()) {
+        saveStore();
+    }
+}
+
+void CollabServer::send(Client& client, const QJsonObject& message)
+{
+    const QList<QJsonObject> frames = CollabChunker::split(message, m_maxFrameBytes);
+    for (const QJsonObject& frame : frames) {
+        if (client.codec.isBinary()) {
+            client.socket->sendBinaryMessage(client.codec.encode(frame));
+        } else {
+            client.socket->sendTextMessage(QString::fromUtf8(QJsonDocument(frame).toJson(QJsonDocument::Compact)));
+        }
+    }
+}
+
+void CollabServer::sendError(Client& client, const QString& text, const QString& sessionId)
+{
+    QJsonObject error{{"type", "error"}, {"message", text}};
+    if (!sessionId.isEmpty()) {
+        error["session_id"] = sessionId;
+    }
+    send(client, error);
+}
+
+void CollabServer::broadcast(const Session& session, const QJsonObject& message, const QString& exceptClientId)
+{
+    sendToAll(session.members, message, exceptClientId);
+}
+
+void CollabServer::broadcast(const Document& document, const QJsonObject& message, const QString& exceptClientId)
+{
+    sendToAll(document.subscribers, message, exceptClientId);
+}
+
+void CollabServer::sendToAll(const QList<QString>& clientIds, const QJsonObject& message, const QString& exceptClientId)
+{
+    // JSON кодируется один раз на рассылку; CBOR - на каждого, у каждого соединения свои номера client_id
+    const QList<QJsonObject> frames = CollabChunker::split(message, m_maxFrameBytes);
+    QStringList json;
+    for (const QString& memberId : clientIds) {
+        if (memberId == exceptClientId) continue;
+        Client *member = m_clients.value(m_socketsById.value(memberId));
+        if (!member) continue;
+        if (member->codec.isBinary()) {
+            for (const QJsonObject& frame : frames) {
+                member->socket->sendBinaryMessage(member->codec.encode(frame));
+            }
+        } else {
+            if (json.isEmpty()) {
+                for (const QJsonObject& frame : frames) {
+                    json.append(QString::fromUtf8(QJsonDocument(frame).toJson(QJsonDocument::Compact)));
+                }
+            }
+            for (const QString& text : std::as_const(json)) {
+                member->socket->sendTextMessage(text);
+            }
+        }
+    }
+}
+
+QJsonObject CollabServer::userEntry(const Session& session, const Client& member) const
+{
+    QJsonObject user{{"client_id", member.clientId}, {"username", member.username}, {"color", member.color},
+                     {"is_admin", member.clientId == session.adminId}};
+    const qint64 muteEnd = session.muteEndTimes.value(member.clientId, -1);
+    if (muteEnd >= 0) {
+        user["mute_end_time"] = muteEnd;
+    }
+    return user;
+}
+
+void CollabServer::sendUserList(const Session& session, Client& client)
+{
+    QJsonArray users;
+    for (const QString& memberId : session.members) {
+        if (const Client *member = m_clients.value(m_socketsById.value(memberId))) {
+            users.append(userEntry(session, *member));
+        }
+    }
+    send(client, QJsonObject{{"type", "user_list_update"}, {"users", users}});
+}
+
+// клиенты с user_deltas узнают о входе из user_joined, о выходе из user_disconnected, об админе из admin_changed;
+// полный список нужен только старым клиентам, которые перестраивают по нему участников
+void CollabServer::broadcastUserList(const Session& session, const QString& exceptClientId)
+{
+    QList<QString> legacy;
+    for (const QString& memberId : session.members) {
+        const Client *member = m_clients.value(m_socketsById.value(memberId));
+        if (member && !member->userDeltas && memberId != exceptClientId) {
+            legacy.append(memberId);
+        }
+    }
+    if (legacy.isEmpty()) return;
+
+    QJsonArray users;
+    for (const QString& memberId : session.members) {
+        if (const Client *member = m_clients.value(m_socketsById.value(memberId))) {
+            users.append(userEntry(session, *member));
+        }
+    }
+    sendToAll(legacy, QJsonObject{{"type", "user_list_update"}, {"users", users}}, QString());
+}
+
+// новичок получает весь список, остальные - одну запись; повторный вход с тем же client_id обновляет запись
+void CollabServer::notifyUserJoined(const Session& session, Client& joined)
+{
+    sendUserList(session, joined);
+    QList<QString> delta;
+    for (const QString& memberId : session.members) {
+        const Client *member = m_clients.value(m_socketsById.value(memberId));
+        if (member && member->userDeltas && memberId != joined.clientId) {
+            delta.append(memberId);
+        }
+    }
+    if (!delta.isEmpty()) {
+        QJsonObject message = userEntry(session, joined);
+        message["type"] = "user_joined";
+        sendToAll(delta, message, QString());
+    }
+    broadcastUserList(session, joined.clientId);
+}
+
+// сохраненные сессии: {"sessions": [{id, password_hash, admin_id, documents: [{path, text, revision}], expires_at}, ...]}
+// файл старого вида (text и revision прямо в сессии) читается как один общий буфер
+// история операций не сохраняется, после перезапуска клиенты получают полный текст
+void CollabServer::loadStore()
+{
+    if (m_storePath.isEmpty()) return;
+    QFile file(m_storePath);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    const QJsonArray sessions = QJsonDocument::fromJson(file.readAll()).object().value(QLatin1String("sessions")).toArray();
+    const qint64 now = nowSecs();
+    for (const QJsonValue& value : sessions) {
+        const QJsonObject stored = value.toObject();
+        const qint64 expiresAt = stored.value(QLatin1String("expires_at")).toInteger();
+        const QString id = stored.value(QLatin1String("id")).toString();
+        if (expiresAt <= now || id.isEmpty() || m_sessions.contains(id)) continue;
+        Session *session = new Session;
+        session->id = id;
+        session->passwordHash = QByteArray::fromHex(stored.value(QLatin1String("password_hash")).toString().toLatin1());
+        session->adminId = stored.value(QLatin1String("admin_id")).toString();
+        const QJsonArray documents = stored.contains(QLatin1String("documents"))
+                                         ? stored.value(QLatin1String("documents")).toArray()
+                                         : QJsonArray{stored};
+        for (const QJsonValue& documentValue : documents) {
+            const QJsonObject storedDocument = documentValue.toObject();
+            Document& document = documentFor(*session, storedDocument.value(QLatin1String("path")).toString(), QString());
+            document.ot = OtServerDocument(storedDocument.value(QLatin1String("text")).toString(),
+                                           storedDocument.value(QLatin1String("revision")).toInt());
+            document.ot.setHistoryLimit(m_historyLimit);
+        }
+        session->expiresAt = expiresAt;
+        m_sessions.insert(id, session);
+    }
+    qInfo() << "Загружено сохраненных сессий:" << m_sessions.size();
+}
+
+void CollabServer::saveStore() const
+{
+    if (m_storePath.isEmpty()) return;
+    QJsonArray sessions;
+    const qint64 now = nowSecs();
+    for (const Session *session : m_sessions) {
+        if (session->expiresAt <= now) continue;
+        QJsonArray documents;
+        for (auto it = session->documents.constBegin(); it != session->documents.constEnd(); ++it) {
+            documents.append(QJsonObject{{"path", it.key()}, {"text", it.value()->ot.text()}, {"revision", it.value()->ot.revision()}});
+        }
+        sessions.append(QJsonObject{
+            {"id", session->id},
+            {"password_hash", QString::fromLatin1(session->passwordHash.toHex())},
+            {"admin_id", session->adminId},
+            {"documents", documents},
+            {"expires_at", session->expiresAt},
+        });
+    }
+    QSaveFile file(m_storePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Не удалось записать сохраненные сессии:" << m_storePath << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(QJsonObject{{"sessions", sessions}}).toJson(QJsonDocument::Compact));
+    file.commit();
+}
@@ -0,0 +1,173 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef COLLABSERVER_H
+#define COLLABSERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+#include <QWebSocketServer>
+#include "blockhashtree.h"
+#include "collabprotocol.h"
+#include "otengine.h"
+
+class QWebSocket;
+
+// сервер совместной работы без GUI: тот же протокол, что говорит клиент (Doc.md, 3.3.1-3.3.2)
+// все сессии и соединения живут в одном потоке и одном цикле событий
+// нужен для проверок и нагрузочных прогонов без боевой инфраструктуры
+class CollabServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CollabServer(QObject *parent = nullptr);
+    ~CollabServer() override;
+
+    bool listen(const QHostAddress& address, quint16 port);
+    quint16 port() const { return m_server.serverPort(); }
+    QString errorString() const { return m_server.errorString(); }
+
+    void setHistoryLimit(int limit) { m_historyLimit = qMax(1, limit); } // операций на сессию для догоняния и OT
+    void setCompressionThreshold(int bytes) { m_compressionThreshold = bytes; } // снимки меньше уходят без сжатия
+    // предел исходящего кадра: длинный текст снимка уходит частями (CollabChunker)
+    void setMaxFrameBytes(int bytes) { m_maxFrameBytes = qMax(int(CollabChunker::MinFrameBytes), bytes); }
+    // файл сохраненных сессий (save_session), читается сразу; пустой путь - только в памяти
+    void setStorePath(const QString& path);
+
+    int sessionCount() const { return m_sessions.size(); }
+    int clientCount() const { return m_clients.size(); }
+
+private:
+    struct Client
+    {
+        QWebSocket *socket = nullptr;
+        QString clientId; // пусто до create_session/join_session
+        QString username;
+        QString color;
+        QString sessionId;
+        QSet<QString> documents; // открытые документы (подписки) в текущей сессии
+        bool compressSnapshots = false; // snapshot_compression: "zlib"
+        bool userDeltas = false; // features: "user_deltas" - понимает user_joined вместо полного списка
+        CollabCodec codec; // на соединение, как и у клиента
+        CollabChunker chunker; // сборка сообщений, пришедших частями
+    };
+
+    struct Cursor
+    {
+        int position = 0;
+        int anchor = -1;
+    };
+
+    // один файл сессии: свой поток операций, своя ревизия и свои подписчики
+    struct Document
+    {
+        OtServerDocument ot;
+        QList<QString> subscribers; // client_id тех, у кого документ открыт
+        QHash<QString, Cursor> cursors;
+        // хеши строк для сверки с клиентами (doc_hash); пересчитываются лениво, только на проверяемой ревизии
+        mutable BlockHashTree hashes;
+        mutable int hashesRevision = -1;
+        const BlockHashTree& lineHashes() const;
+    };
+
+    struct Session
+    {
+        Session() = default;
+        ~Session() { qDeleteAll(documents); }
+        Q_DISABLE_COPY(Session)
+
+        QString id;
+        QByteArray passwordHash;
+        QString adminId;
+        // путь относительно корня проекта -> документ; "" - общий буфер сессии (клиенты без path)
+        QHash<QString, Document*> documents;
+        QList<QString> members; // client_id в порядке входа
+        QHash<QString, qint64> muteEndTimes; // client_id -> конец мьюта (секунды эпохи), -1 - бессрочно
+        int colorCounter = 0;
+        qint64 expiresAt = 0; // 0 - не сохранена и удаляется, когда уходит последний участник
+    };
+
+    using Handler = void (CollabServer::*)(Client& client, const QJsonObject& message);
+    static const QHash<QString, Handler>& handlers();
+
+    void onNewConnection();
+    void onTextMessage(QWebSocket *socket, const QString& message);
+    void onBinaryMessage(QWebSocket *socket, const QByteArray& message);
+    void onSocketDisconnected(QWebSocket *socket);
+    void dispatch(QWebSocket *socket, const QJsonObject& frame);
+    void onHousekeeping(); // раз в секунду: конец мьютов и срок сохраненных сессий
+
+    void handleCreateSession(Client& client, const QJsonObject& message);
+    void handleJoinSession(Client& client, const QJsonObject& message);
+    void handleLeaveSession(Client& client, const QJsonObject& message);
+    void handleOps(Client& client, const QJsonObject& message);
+    void handleFileContentUpdate(Client& client, const QJsonObject& message);
+    void handleCursorPositionUpdate(Client& client, const QJsonObject& message);
+    void handleChatMessage(Client& client, const QJsonObject& message);
+    void handleMuteClient(Client& client, const QJsonObject& message);
+    void handleUnmuteClient(Client& client, const QJsonObject& message);
+    void handleTransferAdmin(Client& client, const QJsonObject& message);
+    void handleSaveSession(Client& client, const QJsonObject& message);
+    void handleOpenDocument(Client& client, const QJsonObject& message);
+    void handleCloseDocument(Client& client, const QJsonObject& message);
+    void handleDocHash(Client& client, const QJsonObject& message);
+    void handleHashQuery(Client& client, const QJsonObject& message);
+    void handleBlockRequest(Client& client, const QJsonObject& message);
+
+    // общая часть create/join: привязка соединения к сессии и session_info
+    void enterSession(Client& client, Session& session, const QJsonObject& request);
+    void leaveSession(Client& client);
+    // документ по пути; если его еще нет - создается с текстом первого открывшего (created = true)
+    Document& documentFor(Session& session, const QString& path, const QString& initialText, bool *created = nullptr);
+    Document *documentOf(Session& session, const QJsonObject& message); // по полю path, nullptr - такого нет
+    void subscribe(Client& client, Document& document, const QString& path);
+    void unsubscribe(Client& client, Session& session, const QString& path, bool notify);
+    // revision и текст (catch_up, text или text_compressed) и курсоры других подписчиков
+    void writeDocumentState(QJsonObject& out, const Client& client, const Document& document, int sinceRevision) const;
+    void adoptIdentity(Client& client, const QJsonObject& request); // client_id, username; старое соединение с тем же id закрывается
+    Session *sessionOf(const Client& client);
+    bool isAdmin(const Client& client, const Session& session) const { return session.adminId == client.clientId; }
+    bool isMuted(const Session& session, const QString& clientId) const { return session.muteEndTimes.contains(clientId); }
+    void setMuted(Session& session, const QString& clientId, bool muted, qint64 endTime);
+    void sendSnapshot(Client& client, const Document& document, const QString& path); // полная синхронизация после отвергнутых правок
+    // открытый клиентом документ из сообщения сверки, только если его ревизия совпадает с ревизией сервера
+    const Document *hashedDocument(Client& client, const QJsonObject& message);
+    void sendHashRanges(Client& client, const Document& document, const QString& path, const QList<QPair<int, int>>& ranges);
+
+    void send(Client& client, const QJsonObject& message);
+    void sendError(Client& client, const QString& text, const QString& sessionId = QString());
+    void broadcast(const Session& session, const QJsonObject& message, const QString& exceptClientId = QString());
+    // только подписчикам документа: правки и курсоры не уходят тем, у кого файл не открыт
+    void broadcast(const Document& document, const QJsonObject& message, const QString& exceptClientId = QString());
+    void sendToAll(const QList<QString>& clientIds, const QJsonObject& message, const QString& exceptClientId);
+    QJsonObject userEntry(const Session& session, const Client& member) const; // участник в user_list_update/user_joined
+    void sendUserList(const Session& session, Client& client); // полный список одному клиенту
+    void broadcastUserList(const Session& session, const QString& exceptClientId = QString()); // полный список клиентам без user_deltas
+    void notifyUserJoined(const Session& session, Client& joined);
+
+    static QByteArray hashPassword(const QString& sessionId, const QString& password);
+    void loadStore();
+    void saveStore() const;
+
+    QWebSocketServer m_server;
+    // по указателю: ссылки на клиента и сессию живут дольше вставок и удалений в соседних записях
+    QHash<QWebSocket*, Client*> m_clients;
+    QHash<QString, QWebSocket*> m_socketsById; // client_id -> соединение
+    QHash<QString, Session*> m_sessions;
+    QTimer m_housekeeping;
+    QString m_storePath;
+    int m_historyLimit = 1000;
+    int m_compressionThreshold = 4096;
+    int m_maxFrameBytes = CollabChunker::DefaultMaxFrameBytes;
+};
+
+#endif // COLLABSERVER_H
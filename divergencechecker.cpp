@@ -0,0 +1,233 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "divergencechecker.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <QTextBlock>
+#include <QTextBlockUserData>
+#include <QTextDocument>
+
+namespace {
+
+// хеш строки живет в самом блоке: блок удаляется вместе с ним, а сдвиг строк не требует пересчета
+class BlockHashData : public QTextBlockUserData
+{
+public:
+    int revision = -1; // QTextBlock::revision() на момент подсчета
+    int length = -1;
+    quint64 hash = 0;
+};
+
+} // namespace
+
+DivergenceChecker::DivergenceChecker(QTextDocument *document, QObject *parent)
+    : QObject(parent)
+    , m_document(document)
+{
+}
+
+void DivergenceChecker::check(const QString& path, int revision)
+{
+    if (!m_sender || m_unrepairable.contains(path)) return;
+    cancel();
+    syncHashes();
+    m_active = true;
+    m_path = path;
+    m_revision = revision;
+    ++m_checks;
+    QJsonObject out = message("doc_hash");
+    out["lines"] = m_tree.lineCount();
+    out["hash"] = QString::number(m_tree.rootHash(), 16);
+    m_sender(out);
+}
+
+void DivergenceChecker::cancel()
+{
+    m_active = false;
+    m_differing.clear();
+    m_fullRequested = false;
+}
+
+void DivergenceChecker::handleRanges(const HashRangesMessage& ranges)
+{
+    if (!m_active || ranges.path != m_path || ranges.revision != m_revision) return;
+    syncHashes();
+    m_serverLines = ranges.lines;
+    const int shift = m_tree.lineCount() - m_serverLines;
+
+    QList<QPair<int, int>> deeper;
+    for (const HashRange& range : ranges.ranges) {
+        const QList<QPair<int, int>> parts = BlockHashTree::children(range.first, range.count);
+        if (parts.size() != range.hashes.size()) {
+            requestBlock(0, m_serverLines); // другое разбиение - значит, и сравнивать нечего
+            return;
+        }
+        for (int i = 0; i < parts.size(); ++i) {
+            if (matches(parts.at(i).first, parts.at(i).second, range.hashes.at(i), shift)) continue;
+            if (parts.at(i).second == 1) {
+                m_differing.append(parts.at(i));
+            } else {
+                deeper.append(parts.at(i));
+            }
+        }
+    }
+
+    if (deeper.isEmpty() || deeper.size() > MaxQueryRanges) {
+        // дальше спускаться некуда или расхождение не точечное: чиним общий охват различающихся строк
+        const QList<QPair<int, int>> all = m_differing + deeper;
+        if (all.isEmpty()) {
+            // корень разный, а части совпали (например, лишние строки в конце у нас) - берем документ целиком
+            requestBlock(0, m_serverLines);
+            return;
+        }
+        int first = all.first().first;
+        int end = first;
+        for (const QPair<int, int>& part : all) {
+            first = qMin(first, part.first);
+            end = qMax(end, part.first + part.second);
+        }
+        requestBlock(first, end - first);
+        return;
+    }
+
+    QJsonArray query;
+    for (const QPair<int, int>& part : std::as_const(deeper)) {
+        query.append(QJsonObject{{"first", part.first}, {"count", part.second}});
+    }
+    QJsonObject out = message("hash_query");
+    out["ranges"] = query;
+    m_sender(out);
+}
+
+bool DivergenceChecker::repairOps(const BlockTextMessage& block, QList<CollabOp>& ops)
+{
+    if (!m_active || block.path != m_path || block.revision != m_revision) return false;
+    syncHashes();
+    m_serverLines = block.lines;
+    const int clientLines = m_tree.lineCount();
+    // строки выше диапазона совпадают один в один, ниже - со сдвигом на разницу в числе строк
+    const int shift = clientLines - block.lines;
+    const int first = qBound(0, block.first, block.lines);
+    const int serverEnd = qBound(first, block.first + block.count, block.lines);
+    const int clientEnd = serverEnd + shift;
+    if (clientEnd < first || clientEnd > clientLines) {
+        if (!m_fullRequested) {
+            requestBlock(0, block.lines);
+        } else {
+            cancel();
+        }
+        return false;
+    }
+
+    const int documentEnd = m_document->characterCount() - 1;
+    const auto lineStart = [this, clientLines, documentEnd](int line) {
+        return line < clientLines ? m_document->findBlockByNumber(line).position() : documentEnd;
+    };
+    const int start = lineStart(first);
+    const int end = lineStart(clientEnd);
+    QString text = block.text;
+    if (first >= clientLines && first > 0) {
+        text.prepend(QLatin1Char('\n')); // строки дописываются после нашей последней, у которой нет перевода строки
+    }
+
+    ops.clear();
+    if (end > start) {
+        ops.append(CollabOp::makeDelete(start, end - start));
+    }
+    if (!text.isEmpty()) {
+        ops.append(CollabOp::makeInsert(start, text));
+    }
+    m_expectedHash = block.hash;
+    m_lastRepairLines = serverEnd - first;
+    return true;
+}
+
+void DivergenceChecker::repairApplied()
+{
+    syncHashes();
+    if (m_tree.rootHash() == m_expectedHash) {
+        ++m_repairs;
+        qDebug() << "Документ" << m_path << "сверен с сервером, заменено строк:" << m_lastRepairLines;
+        cancel();
+        return;
+    }
+    if (!m_fullRequested) {
+        qWarning() << "Починка строк не сошлась с сервером, запрашиваем документ целиком";
+        requestBlock(0, m_serverLines);
+        return;
+    }
+    // даже полный текст дает другой хеш: текст не переживает вставку в редактор (например, \r) - не зацикливаемся
+    qWarning() << "Документ" << m_path << "не удается сверить с сервером, сверка для него отключена";
+    m_unrepairable.insert(m_path);
+    cancel();
+}
+
+bool DivergenceChecker::matches(int first, int count, int hash, int lineShift) const
+{
+    const int lines = m_tree.lineCount();
+    if (first + count <= lines && BlockHashTree::shortHash(m_tree.rangeHash(first, count)) == hash) {
+        return true;
+    }
+    // строки, вставленные или удаленные выше, сдвигают совпадающий хвост документа на lineShift
+    return lineShift != 0 && first + lineShift >= 0 && first + lineShift + count <= lines
+           && BlockHashTree::shortHash(m_tree.rangeHash(first + lineShift, count)) == hash;
+}
+
+void DivergenceChecker::requestBlock(int first, int count)
+{
+    if (first == 0 && count >= m_serverLines) {
+        m_fullRequested = true;
+    }
+    QJsonObject out = message("block_request");
+    out["first"] = first;
+    out["count"] = count;
+    m_sender(out);
+}
+
+QJsonObject DivergenceChecker::message(const char *type) const
+{
+    QJsonObject out{{"type", QLatin1String(type)}, {"revision", m_revision}};
+    if (!m_path.isEmpty()) {
+        out["path"] = m_path;
+    }
+    return out;
+}
+
+void DivergenceChecker::syncHashes()
+{
+    if (m_syncedRevision == m_document->revision() && m_tree.lineCount() == m_document->blockCount()) return;
+
+    // текст хешируется только у блоков, изменившихся с прошлого раза; остальные берут хеш из своих данных
+    const bool sameShape = m_lineHashes.size() == m_document->blockCount();
+    QList<quint64> hashes;
+    if (!sameShape) {
+        hashes.reserve(m_document->blockCount());
+    }
+    int index = 0;
+    for (QTextBlock block = m_document->begin(); block.isValid(); block = block.next(), ++index) {
+        auto *data = static_cast<BlockHashData *>(block.userData());
+        if (!data) {
+            data = new BlockHashData;
+            block.setUserData(data); // документ владеет данными блока
+        }
+        if (data->revision != block.revision() || data->length != block.length()) {
+            data->revision = block.revision();
+            data->length = block.length();
+            data->hash = BlockHashTree::lineHash(block.text());
+        }
+        if (!sameShape) {
+            hashes.append(data->hash);
+        } else if (m_lineHashes.at(index) != data->hash) {
+            // поменялась сама строка или на ее место сдвинулась другая
+            m_lineHashes[index] = data->hash;
+            m_tree.setLine(index, data->hash);
+        }
+    }
+    if (!sameShape) {
+        m_lineHashes = hashes;
+        m_tree.rebuild(m_lineHashes);
+    }
+    m_syncedRevision = m_document->revision();
+}
@@ -0,0 +1,81 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DIVERGENCECHECKER_H
+#define DIVERGENCECHECKER_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <functional>
+#include "blockhashtree.h"
+#include "collabmessages.h"
+
+class QTextDocument;
+
+// сверка общего документа с сервером по хешам строк
+// хеши строк хранятся в самих блоках QTextDocument и пересчитываются только для изменившихся блоков;
+// корень уходит на сервер (doc_hash), при несовпадении сервер присылает хеши частей, и клиент спускается
+// только в различающиеся части (hash_query), пока не останутся отдельные строки; затем запрашивает
+// текст только этих строк (block_request) и заменяет их без отправки операций
+// сравнивать можно только одну и ту же ревизию без своих неподтвержденных правок - это проверяет вызывающий
+class DivergenceChecker : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Sender = std::function<void(const QJsonObject& message)>;
+
+    explicit DivergenceChecker(QTextDocument *document, QObject *parent = nullptr);
+
+    void setSender(Sender sender) { m_sender = std::move(sender); }
+
+    // новая сверка документа path на ревизии revision; незаконченная прошлая забывается
+    void check(const QString& path, int revision);
+    void cancel();
+    bool isActive() const { return m_active; }
+
+    // ответы сервера; ответ на уже забытую сверку (другая ревизия или документ) игнорируется
+    void handleRanges(const HashRangesMessage& message);
+    // операции (возможно, пустые), приводящие строки документа к серверным; применяет вызывающий, без отправки
+    // на сервер, и затем зовет repairApplied; false - применять нечего (ответ устарел или запрошен документ целиком)
+    bool repairOps(const BlockTextMessage& message, QList<CollabOp>& ops);
+    void repairApplied(); // после применения repairOps: сверка корня, при несовпадении - запрос документа целиком
+
+    int checkCount() const { return m_checks; }
+    int repairCount() const { return m_repairs; }
+    int lastRepairLines() const { return m_lastRepairLines; }
+
+    static constexpr int MaxQueryRanges = 8; // больше различающихся частей - чиним их общий охват целиком
+
+private:
+    void syncHashes(); // хеши изменившихся блоков и дерево над ними
+    bool matches(int first, int count, int hash, int lineShift) const;
+    void requestBlock(int first, int count);
+    QJsonObject message(const char *type) const; // type, path и revision текущей сверки
+
+    QTextDocument *m_document;
+    Sender m_sender;
+    BlockHashTree m_tree;
+    QList<quint64> m_lineHashes; // хеш строки по номеру блока, как в листьях m_tree
+    int m_syncedRevision = -1; // QTextDocument::revision(), на которой посчитано дерево
+
+    bool m_active = false;
+    QString m_path;
+    int m_revision = -1;
+    int m_serverLines = 0;
+    QList<QPair<int, int>> m_differing; // различающиеся строки (first, count) в нумерации сервера
+    bool m_fullRequested = false; // уже просили документ целиком, дальше не повторяем
+    quint64 m_expectedHash = 0;
+    QSet<QString> m_unrepairable; // документы, которые не сошлись даже после замены целиком
+
+    int m_checks = 0;
+    int m_repairs = 0;
+    int m_lastRepairLines = 0;
+};
+
+#endif // DIVERGENCECHECKER_H
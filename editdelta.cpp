@@ -0,0 +1,131 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "editdelta.h"
+#include <QTextDocument>
+#include <QTextBlock>
+
+EditDelta EditDelta::capture(const QTextDocument *doc, int position, int charsRemoved, int charsAdded, int cursorPosition,
+                             const EditPreimage *preimage)
+{
+    EditDelta delta;
+    delta.position = position;
+    delta.charsRemoved = charsRemoved;
+    delta.charsAdded = charsAdded;
+    delta.cursorPosition = cursorPosition;
+
+    if (!doc) {
+        return delta;
+    }
+
+    if (charsAdded > 0) {
+        delta.insertedText = textRange(doc, position, charsAdded);
+    }
+    if (charsRemoved <= 0) {
+        delta.removedTextKnown = true;
+    } else if (preimage) {
+        delta.removedTextKnown = preimage->removedText(doc, position, charsRemoved, charsAdded, &delta.removedText);
+    }
+
+    // characterAt работает по дереву фрагментов документа, без сборки всего текста
+    // на границе блоков вернет QChar::ParagraphSeparator, для триггеров это просто "не буква"
+    if (cursorPosition > 0) {
+        delta.charBeforeCursor = doc->characterAt(cursorPosition - 1);
+    }
+    if (cursorPosition > 1) {
+        delta.secondCharBeforeCursor = doc->characterAt(cursorPosition - 2);
+    }
+    return delta;
+}
+
+QString EditDelta::textRange(const QTextDocument *doc, int position, int length)
+{
+    QString result;
+    if (!doc || length <= 0 || position < 0) {
+        return result;
+    }
+    result.reserve(length);
+
+    QTextBlock block = doc->findBlock(position);
+    int offset = position - block.position(); // смещение внутри первого блока
+    int remaining = length;
+
+    // идем только по блокам, которые задело изменение
+    while (block.isValid() && remaining > 0) {
+        const QString blockText = block.text();
+        int take = qMin(remaining, int(blockText.length()) - offset);
+        if (take > 0) {
+            result.append(blockText.constData() + offset, take);
+            remaining -= take;
+        }
+        if (remaining > 0) {
+            result.append(QLatin1Char('\n')); // разделитель блоков тоже занимает одну позицию
+            --remaining;
+        }
+        block = block.next();
+        offset = 0;
+    }
+
+    // toPlainText() заменяет неразрывный пробел на обычный, делаем так же, чтобы текст у всех совпадал
+    result.replace(QChar::Nbsp, QLatin1Char(' '));
+    return result;
+}
+
+void EditPreimage::capture(const QTextDocument *doc, int from, int to)
+{
+    if (!doc || from < 0 || to < from || to - from > MaxChars) {
+        clear();
+        return;
+    }
+    const int length = doc->characterCount() - 1;
+    QTextBlock first = doc->findBlock(from);
+    QTextBlock last = doc->findBlock(qMin(to, length));
+    if (!first.isValid() || !last.isValid()) {
+        clear();
+        return;
+    }
+    if (first.previous().isValid()) first = first.previous();
+    if (last.next().isValid()) last = last.next();
+
+    const int start = first.position();
+    const int end = qMin(last.position() + last.length(), length); // с разделителем последнего блока, если он не последний в документе
+    if (end - start > MaxChars) {
+        clear();
+        return;
+    }
+    m_start = start;
+    m_documentLength = length;
+    m_text = EditDelta::textRange(doc, start, end - start);
+}
+
+void EditPreimage::clear()
+{
+    m_start = -1;
+    m_documentLength = -1;
+    m_text.clear();
+}
+
+bool EditPreimage::removedText(const QTextDocument *doc, int position, int charsRemoved, int charsAdded, QString *removed) const
+{
+    if (!doc || m_start < 0 || position < m_start || charsRemoved < 0) {
+        return false;
+    }
+    // длина до правки должна совпасть с той, что была при снятии окна, иначе были изменения мимо него
+    if (doc->characterCount() - 1 - charsAdded + charsRemoved != m_documentLength) {
+        return false;
+    }
+    const int offset = position - m_start;
+    if (offset + charsRemoved > m_text.size()) {
+        return false;
+    }
+    // окно вокруг правки должно совпасть с документом: правки с заглушенными сигналами (чужие, снимки) мимо окна не прошли
+    const QString current = EditDelta::textRange(doc, m_start, int(m_text.size()) - charsRemoved + charsAdded);
+    if (current.size() != m_text.size() - charsRemoved + charsAdded
+        || QStringView(current).left(offset) != QStringView(m_text).left(offset)
+        || QStringView(current).mid(offset + charsAdded) != QStringView(m_text).mid(offset + charsRemoved)) {
+        return false;
+    }
+    *removed = m_text.mid(offset, charsRemoved);
+    return true;
+}
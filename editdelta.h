@@ -0,0 +1,61 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef EDITDELTA_H
+#define EDITDELTA_H
+
+#include <QString>
+#include <QChar>
+
+class QTextDocument;
+class EditPreimage;
+
+// снимок одного изменения документа (сигнал contentsChange), читает только затронутые блоки,
+// а не весь документ, поэтому стоимость не зависит от размера файла
+// один снимок используется и для операции в сокет, и для LSP, и для триггеров автодополнения
+struct EditDelta
+{
+    int position = 0; // позиция начала изменения
+    int charsRemoved = 0; // сколько символов удалено
+    int charsAdded = 0; // сколько символов вставлено
+    QString insertedText; // вставленный текст, разделители блоков заменены на \n как в toPlainText()
+    int cursorPosition = -1; // позиция курсора редактора после изменения
+    QChar charBeforeCursor; // символ прямо перед курсором (для триггеров автодополнения)
+    QChar secondCharBeforeCursor; // символ перед ним (для :: и ->)
+    // удаленный текст из окна EditPreimage, снятого до правки: по нему LSP считает конец диапазона
+    QString removedText;
+    bool removedTextKnown = false; // при charsRemoved == 0 всегда true
+
+    bool isEmpty() const { return charsAdded <= 0 && charsRemoved <= 0; }
+    bool hasInsert() const { return charsAdded > 0; }
+    bool hasDelete() const { return charsRemoved > 0; }
+
+    // собирает снимок сразу после изменения документа; preimage - окно текста до изменения, если оно есть
+    static EditDelta capture(const QTextDocument *doc, int position, int charsRemoved, int charsAdded, int cursorPosition,
+                             const EditPreimage *preimage = nullptr);
+    // текст диапазона [position, position + length) без копирования всего документа
+    static QString textRange(const QTextDocument *doc, int position, int length);
+};
+
+// несколько блоков текста вокруг курсора, снятые до правки: после contentsChange удаленного куска в документе уже нет
+// окно снимается заново при каждом движении курсора и после каждой правки, стоит O(длины строк), а не документа
+class EditPreimage
+{
+public:
+    // блоки с from по to и еще по одному до и после; слишком длинное выделение не снимается
+    void capture(const QTextDocument *doc, int from, int to);
+    void clear();
+    // кусок [position, position + charsRemoved) текста до правки, если он целиком в окне
+    // doc - уже после правки: по длине и по тексту окна вокруг правки видно, что между снятием окна и правкой документ не менялся
+    bool removedText(const QTextDocument *doc, int position, int charsRemoved, int charsAdded, QString *removed) const;
+
+    static constexpr int MaxChars = 64 * 1024;
+
+private:
+    int m_start = -1; // позиция начала окна, -1 - окна нет
+    int m_documentLength = -1;
+    QString m_text;
+};
+
+#endif // EDITDELTA_H
@@ -0,0 +1,354 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "codeplaintextedit.h"
+#include "editdelta.h"
+#include "remotecursoroverlay.h"
+#include "remoteparticipantstore.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPlainTextDocumentLayout>
+#include <QRandomGenerator>
+#include <QScrollBar>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <algorithm>
+
+namespace {
+
+// резидентная память процесса в КБ, -1 - платформа не дает ее прочитать
+qint64 residentKb()
+{
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) return -1;
+    const QList<QByteArray> lines = status.readAll().split('\n');
+    for (const QByteArray& line : lines) {
+        if (line.startsWith("VmRSS:")) {
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+    return -1;
+}
+
+// bam_editorbench --mode presence: поток обновлений курсора через RemoteParticipantStore,
+// число записей и память должны зависеть от числа участников, а не от числа обновлений
+QJsonObject runPresence(qint64 updates, int participants, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QStringList ids;
+    for (int i = 0; i < participants; ++i) {
+        ids.append(QStringLiteral("participant-%1").arg(i));
+    }
+    const QColor color(Qt::darkCyan);
+    RemoteParticipantStore store;
+
+    QJsonArray samples;
+    int maxEntries = 0;
+    const qint64 sampleEvery = qMax<qint64>(1, updates / 10);
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 i = 0; i < updates; ++i) {
+        const int position = random.bounded(100000);
+        // имя и цвет приходят только с первым обновлением участника, как в cursor_position_update
+        const QString& id = ids.at(random.bounded(participants));
+        const bool known = store.contains(id);
+        store.updatePresence(id, position, random.bounded(8) == 0 ? position + random.bounded(1, 40) : position,
+                             known ? QString() : id, known ? QColor() : color, i);
+        if (random.bounded(16) == 0) {
+            store.adjustForEdit(random.bounded(100000), random.bounded(3), random.bounded(3)); // правки между обновлениями
+        }
+        maxEntries = qMax(maxEntries, store.size());
+        if ((i + 1) % sampleEvery == 0) {
+            samples.append(QJsonObject{{"updates", i + 1}, {"entries", store.size()}, {"rss_kb", residentKb()}});
+        }
+    }
+    const qint64 elapsedNs = timer.nsecsElapsed();
+
+    const qint64 firstRss = samples.isEmpty() ? -1 : samples.first().toObject()["rss_kb"].toInteger();
+    const qint64 lastRss = samples.isEmpty() ? -1 : samples.last().toObject()["rss_kb"].toInteger();
+    const bool flat = maxEntries <= participants;
+    qInfo().noquote() << QStringLiteral("presence: %1 обновлений по %2 участникам, записей максимум %3, RSS %4 -> %5 КБ, %6 нс на обновление")
+                             .arg(updates).arg(participants).arg(maxEntries).arg(firstRss).arg(lastRss)
+                             .arg(double(elapsedNs) / updates, 0, 'f', 0);
+    return QJsonObject{
+        {"mode", "presence"},
+        {"updates", updates},
+        {"participants", participants},
+        {"max_entries", maxEntries},
+        {"final_entries", store.size()},
+        {"rss_growth_kb", firstRss >= 0 && lastRss >= 0 ? lastRss - firstRss : -1}, // от первого замера (10% обновлений) до конца
+        {"ns_per_update", double(elapsedNs) / updates},
+        {"samples", samples},
+        {"flat", flat},
+    };
+}
+
+// перцентили по методу ближайшего ранга, в микросекундах
+QJsonObject latencySummaryUs(QList<qint64> samplesNs)
+{
+    std::sort(samplesNs.begin(), samplesNs.end());
+    const auto percentile = [&samplesNs](double p) {
+        if (samplesNs.isEmpty()) return 0.0;
+        const qsizetype rank = qBound<qsizetype>(0, qsizetype(p * samplesNs.size() + 0.5) - 1, samplesNs.size() - 1);
+        return samplesNs.at(rank) / 1e3;
+    };
+    return QJsonObject{
+        {"count", qint64(samplesNs.size())},
+        {"p50", percentile(0.50)},
+        {"p90", percentile(0.90)},
+        {"p99", percentile(0.99)},
+        {"max", samplesNs.isEmpty() ? 0.0 : samplesNs.last() / 1e3},
+    };
+}
+
+// bam_editorbench --mode capture: снимок одного нажатия (EditDelta::capture с окном EditPreimage) на документах разной длины;
+// для сравнения - toPlainText(), которым раньше собирался каждый снимок
+QJsonObject runCapture(const QList<int>& lineCounts, int keystrokes, quint32 seed)
+{
+    QJsonArray documents;
+    QList<double> captureP50;
+    for (const int lineCount : lineCounts) {
+        QString text;
+        for (int line = 0; line < lineCount; ++line) {
+            text += QStringLiteral("    int value_%1 = compute(value_%2, \"item %1\"); // строка %1\n").arg(line).arg(qMax(0, line - 1));
+        }
+        // документ с той же раскладкой, что у QPlainTextEdit редактора
+        QTextDocument document;
+        document.setDocumentLayout(new QPlainTextDocumentLayout(&document));
+        document.setPlainText(text);
+
+        QRandomGenerator random(seed);
+        QList<qint64> captureNs;
+        QList<qint64> fullTextNs;
+        captureNs.reserve(keystrokes);
+        QElapsedTimer timer;
+        EditPreimage preimage;
+        qint64 deletes = 0;
+        qint64 removedKnown = 0;
+        qint64 checksum = 0;
+        for (int i = 0; i < keystrokes; ++i) {
+            // нажатие: символ или Backspace в случайном месте, затем снимок, как в onContentsChange
+            const int length = document.characterCount() - 1;
+            QTextCursor cursor(&document);
+            int position = 0;
+            int removed = 0;
+            int added = 0;
+            if (length > 0 && random.bounded(4) == 0) {
+                position = random.bounded(length);
+                preimage.capture(&document, position + 1, position + 1); // курсор встал за удаляемым символом
+                cursor.setPosition(position);
+                cursor.setPosition(position + 1, QTextCursor::KeepAnchor);
+                cursor.removeSelectedText();
+                removed = 1;
+            } else {
+                position = random.bounded(length + 1);
+                preimage.capture(&document, position, position);
+                cursor.setPosition(position);
+                cursor.insertText(QStringLiteral("x"));
+                added = 1;
+            }
+            // снимок и окно для следующей правки - вся работа onContentsChange до отправки
+            timer.start();
+            const EditDelta delta = EditDelta::capture(&document, position, removed, added, position + added, &preimage);
+            preimage.capture(&document, position, position + added);
+            captureNs.append(timer.nsecsElapsed());
+            checksum += delta.insertedText.size() + delta.charBeforeCursor.unicode();
+            if (removed > 0) {
+                ++deletes;
+                removedKnown += delta.removedTextKnown ? 1 : 0;
+            }
+
+            if (i % 20 == 0) {
+                timer.restart();
+                checksum += document.toPlainText().size();
+                fullTextNs.append(timer.nsecsElapsed());
+            }
+        }
+        Q_UNUSED(checksum);
+
+        const QJsonObject capture = latencySummaryUs(captureNs);
+        const QJsonObject fullText = latencySummaryUs(fullTextNs);
+        captureP50.append(capture["p50"].toDouble());
+        qInfo().noquote() << QStringLiteral("capture: %1 строк, EditDelta p50 %2 мкс p99 %3 мкс; toPlainText p50 %4 мкс")
+                                 .arg(lineCount).arg(capture["p50"].toDouble(), 0, 'f', 2).arg(capture["p99"].toDouble(), 0, 'f', 2)
+                                 .arg(fullText["p50"].toDouble(), 0, 'f', 1);
+        documents.append(QJsonObject{
+            {"lines", lineCount},
+            {"characters", document.characterCount() - 1},
+            {"capture_us", capture},
+            {"removed_text_known", deletes > 0 ? double(removedKnown) / deletes : 1.0}, // доля удалений, где LSP получит диапазон
+            {"to_plain_text_us", fullText}, // каждое 20-е нажатие
+        });
+    }
+    return QJsonObject{
+        {"mode", "capture"},
+        {"keystrokes", keystrokes},
+        {"documents", documents},
+        // p50 на самом длинном документе к p50 на самом коротком; около 1 - стоимость не зависит от длины
+        {"capture_p50_ratio", captureP50.size() > 1 && captureP50.first() > 0 ? captureP50.last() / captureP50.first() : 1.0},
+    };
+}
+
+// bam_editorbench --mode overlay: кадр RemoteCursorOverlay, когда все курсоры участников на экране;
+// между кадрами часть курсоров двигается и редактор прокручивается, как во время живой сессии
+QJsonObject runOverlay(int cursors, int frames, quint32 seed)
+{
+    CodePlainTextEdit editor;
+    editor.resize(1280, 900);
+    QString text;
+    for (int line = 0; line < 5000; ++line) {
+        text += QStringLiteral("    int value_%1 = compute(value_%2, \"item %1\"); // строка %1\n").arg(line).arg(qMax(0, line - 1));
+    }
+    editor.setPlainText(text);
+    RemoteParticipantStore store;
+    RemoteCursorOverlay overlay(&editor, &store);
+    editor.show();
+    QCoreApplication::processEvents(); // раскладка и геометрия слоя
+
+    // позиции в пределах видимых строк, иначе paintEvent их просто пропустит
+    QTextBlock block = editor.firstVisibleTextBlock();
+    const int firstVisible = block.position();
+    int lastVisible = firstVisible;
+    while (block.isValid() && editor.visibleBlockRect(block).bottom() <= editor.viewport()->height()) {
+        lastVisible = block.position() + block.length() - 1;
+        block = block.next();
+    }
+    QRandomGenerator random(seed);
+    const auto visiblePosition = [&]() {
+        const int top = editor.firstVisibleTextBlock().position();
+        return top + random.bounded(qMax(1, lastVisible - firstVisible));
+    };
+    for (int i = 0; i < cursors; ++i) {
+        const QString id = QStringLiteral("participant-%1").arg(i);
+        store.updatePresence(id, visiblePosition(), -1, QStringLiteral("user%1").arg(i),
+                             QColor::fromHsv((i * 37) % 360, 200, 220), 0);
+    }
+
+    QImage target(editor.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+    QElapsedTimer timer;
+    const auto paintFrame = [&]() {
+        target.fill(Qt::transparent);
+        timer.start();
+        overlay.render(&target, QPoint(), QRegion(), QWidget::RenderFlags());
+        return timer.nsecsElapsed();
+    };
+
+    // холодный кадр: геометрия всех курсоров считается заново, как после правки или смены ширины
+    QList<qint64> coldNs;
+    QList<qint64> frameNs;
+    frameNs.reserve(frames);
+    QScrollBar *scrollBar = editor.verticalScrollBar();
+    for (int frame = 0; frame < frames; ++frame) {
+        if (frame % 10 == 0) {
+            overlay.invalidateLayout();
+            coldNs.append(paintFrame());
+            continue;
+        }
+        if (frame % 10 == 5) {
+            // прокрутка на строку и обратно: курсоры остаются на экране, кэш геометрии действует
+            scrollBar->setValue(scrollBar->value() == 0 ? 1 : 0);
+        }
+        for (int i = 0; i < cursors / 10; ++i) {
+            store.updatePresence(QStringLiteral("participant-%1").arg(random.bounded(cursors)), visiblePosition(), -1,
+                                 QString(), QColor(), frame);
+        }
+        frameNs.append(paintFrame());
+    }
+
+    const QJsonObject warm = latencySummaryUs(frameNs);
+    const QJsonObject cold = latencySummaryUs(coldNs);
+    const double budgetUs = 1e6 / 60;
+    const bool withinBudget = warm["p99"].toDouble() < budgetUs && cold["p99"].toDouble() < budgetUs;
+    qInfo().noquote() << QStringLiteral("overlay: %1 курсоров, кадр p50 %2 мкс p99 %3 мкс, холодный p99 %4 мкс")
+                             .arg(cursors).arg(warm["p50"].toDouble(), 0, 'f', 0).arg(warm["p99"].toDouble(), 0, 'f', 0)
+                             .arg(cold["p99"].toDouble(), 0, 'f', 0);
+    return QJsonObject{
+        {"mode", "overlay"},
+        {"cursors", cursors},
+        {"viewport", QJsonObject{{"width", editor.viewport()->width()}, {"height", editor.viewport()->height()}}},
+        {"frame_us", warm}, // 10% курсоров сдвинулись, изредка прокрутка
+        {"cold_frame_us", cold}, // после invalidateLayout
+        {"within_budget", withinBudget}, // p99 обоих видов кадров меньше 1/60 с
+    };
+}
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QFile out;
+    const bool toStdout = path.isEmpty() || path == QLatin1String("-");
+    if (toStdout) {
+        if (!out.open(stdout, QIODevice::WriteOnly)) return false;
+    } else {
+        out.setFileName(path);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical() << "Не удалось записать" << path << out.errorString();
+            return false;
+        }
+    }
+    return out.write(data) == data.size();
+}
+
+} // namespace
+
+// замеры редактора без окна: bam_editorbench --mode presence [--updates 1000000] [--participants 50] [--seed 1] [--output report.json]
+// bam_editorbench --mode capture [--lines 1000,20000] [--keystrokes 20000]
+// bam_editorbench --mode overlay [--cursors 100] [--frames 2000]
+int main(int argc, char *argv[])
+{
+    // документам нужны шрифты, но не экран
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bam_editorbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("BAM_IDE editor-side micro benchmarks");
+    parser.addHelpOption();
+    QCommandLineOption modeOption("mode", "Замер: presence, capture или overlay.", "mode", "presence");
+    QCommandLineOption updatesOption("updates", "presence: сколько обновлений курсора.", "count", "1000000");
+    QCommandLineOption participantsOption("participants", "presence: сколько разных участников.", "count", "50");
+    QCommandLineOption linesOption("lines", "capture: длины документов в строках через запятую.", "list", "1000,20000");
+    QCommandLineOption keystrokesOption("keystrokes", "capture: сколько нажатий на каждый документ.", "count", "20000");
+    QCommandLineOption cursorsOption("cursors", "overlay: сколько курсоров участников на экране.", "count", "100");
+    QCommandLineOption framesOption("frames", "overlay: сколько кадров отрисовать.", "count", "2000");
+    QCommandLineOption seedOption("seed", "Зерно генератора.", "seed", "1");
+    QCommandLineOption outputOption("output", "Файл отчета JSON, по умолчанию stdout.", "file");
+    parser.addOptions({modeOption, updatesOption, participantsOption, linesOption, keystrokesOption, cursorsOption, framesOption, seedOption, outputOption});
+    parser.process(app);
+
+    const QString mode = parser.value(modeOption);
+    const quint32 seed = parser.value(seedOption).toUInt();
+    QJsonObject report;
+    bool passed = true;
+    if (mode == QLatin1String("presence")) {
+        const int participants = qMax(1, parser.value(participantsOption).toInt());
+        report = runPresence(qMax<qint64>(1, parser.value(updatesOption).toLongLong()), participants, seed);
+        passed = report["flat"].toBool();
+    } else if (mode == QLatin1String("capture")) {
+        QList<int> lineCounts;
+        const QStringList values = parser.value(linesOption).split(QLatin1Char(','), Qt::SkipEmptyParts);
+        for (const QString& value : values) {
+            lineCounts.append(qMax(1, value.trimmed().toInt()));
+        }
+        std::sort(lineCounts.begin(), lineCounts.end());
+        report = runCapture(lineCounts, qMax(1, parser.value(keystrokesOption).toInt()), seed);
+    } else if (mode == QLatin1String("overlay")) {
+        report = runOverlay(qMax(1, parser.value(cursorsOption).toInt()), qMax(1, parser.value(framesOption).toInt()), seed);
+        passed = report["within_budget"].toBool();
+    } else {
+        qCritical() << "Неизвестный --mode" << mode;
+        return 1;
+    }
+    const bool ok = writeFile(parser.value(outputOption), QJsonDocument(report).toJson(QJsonDocument::Indented));
+    return ok && passed ? 0 : 1;
+}
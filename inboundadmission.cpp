@@ -0,0 +1,152 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "inboundadmission.h"
+#include <utility>
+
+namespace {
+
+constexpr qint64 kCapQuietNs = 1000000000; // перегрузка держится секунду после последнего превышения
+// корзина вмещает секунду потока: за секунду простоя она снова полная и ничем не отличается от новой
+constexpr qint64 kBucketIdleNs = 1000000000;
+
+} // namespace
+
+InboundAdmission::Priority InboundAdmission::priorityOf(ServerMessageType type)
+{
+    switch (type) {
+    case ServerMessageType::CursorPositionUpdate:
+        return Priority::Presence;
+    case ServerMessageType::ChatMessage:
+        return Priority::Chat;
+    default:
+        return Priority::Document;
+    }
+}
+
+void InboundAdmission::setSenderRate(int perSecond)
+{
+    m_senderRate = qMax(0, perSecond);
+    m_buckets.clear();
+}
+
+void InboundAdmission::setHighWatermark(int depth)
+{
+    m_highWatermark = qMax(1, depth);
+}
+
+InboundAdmission::Decision InboundAdmission::admit(const InboundMessage& message, int depth, qint64 nowNs)
+{
+    const Priority priority = priorityOf(message.type);
+    if (priority == Priority::Document) {
+        // ушедший участник не должен вернуться в редактор придержанным курсором, его корзина больше не нужна
+        if (message.type == ServerMessageType::UserDisconnected) {
+            forgetSender(message.as<UserDisconnectedMessage>().clientId);
+        } else if (message.type == ServerMessageType::DocumentClosed) {
+            forgetSender(message.as<DocumentClosedMessage>().clientId);
+        }
+        updateDegraded(depth, nowNs);
+        return Decision::Deliver;
+    }
+
+    QString senderId;
+    if (priority == Priority::Presence) {
+        senderId = message.as<CursorMessage>().clientId;
+    } else {
+        const ChatTextMessage& chat = message.as<ChatTextMessage>();
+        senderId = chat.senderId.isEmpty() ? chat.username : chat.senderId; // старый сервер client_id не присылает
+    }
+    const bool withinRate = takeToken(senderId, nowNs);
+    updateDegraded(depth, nowNs);
+
+    if (priority == Priority::Chat) {
+        if (withinRate) return Decision::Deliver;
+        ++m_dropped;
+        return Decision::Drop;
+    }
+    if (withinRate && !m_degraded && !m_held.contains(senderId)) {
+        return Decision::Deliver;
+    }
+    // положение курсора важно только последнее: придержанное заменяется новым
+    auto it = m_held.find(senderId);
+    if (it != m_held.end()) {
+        *it = message;
+        ++m_coalesced;
+    } else {
+        m_held.insert(senderId, message);
+        m_heldOrder.append(senderId);
+    }
+    return Decision::Hold;
+}
+
+QList<InboundMessage> InboundAdmission::takeHeld(int depth, qint64 nowNs)
+{
+    updateDegraded(depth, nowNs);
+    QList<InboundMessage> held;
+    held.reserve(m_heldOrder.size());
+    for (const QString& senderId : std::as_const(m_heldOrder)) {
+        held.append(m_held.value(senderId));
+    }
+    m_held.clear();
+    m_heldOrder.clear();
+    return held;
+}
+
+void InboundAdmission::forgetSender(const QString& clientId)
+{
+    if (m_held.remove(clientId) > 0) {
+        m_heldOrder.removeOne(clientId);
+    }
+    m_buckets.remove(clientId);
+}
+
+void InboundAdmission::reset()
+{
+    m_buckets.clear();
+    m_lastExpireNs = 0;
+    m_held.clear();
+    m_heldOrder.clear();
+    m_lastCapNs = -1;
+    m_degraded = false;
+}
+
+// корзина маркеров: пополняется со скоростью m_senderRate, вмещает секунду такого потока
+bool InboundAdmission::takeToken(const QString& senderId, qint64 nowNs)
+{
+    if (m_senderRate == 0) return true;
+    expireIdleBuckets(nowNs);
+    auto it = m_buckets.find(senderId);
+    if (it == m_buckets.end()) {
+        it = m_buckets.insert(senderId, Bucket{double(m_senderRate), nowNs});
+    }
+    it->tokens = qMin(double(m_senderRate), it->tokens + (nowNs - it->updatedNs) * 1e-9 * m_senderRate);
+    it->updatedNs = nowNs;
+    if (it->tokens < 1.0) {
+        m_lastCapNs = nowNs;
+        return false;
+    }
+    it->tokens -= 1.0;
+    return true;
+}
+
+// не чаще раза в kBucketIdleNs: таблица не растет от отправителей, которые ушли без user_disconnected
+// (чат старого сервера по имени, смена имени, потерянные сообщения)
+void InboundAdmission::expireIdleBuckets(qint64 nowNs)
+{
+    if (nowNs - m_lastExpireNs < kBucketIdleNs) return;
+    m_lastExpireNs = nowNs;
+    for (auto it = m_buckets.begin(); it != m_buckets.end();) {
+        it = nowNs - it->updatedNs >= kBucketIdleNs ? m_buckets.erase(it) : std::next(it);
+    }
+}
+
+void InboundAdmission::updateDegraded(int depth, qint64 nowNs)
+{
+    const bool capped = m_lastCapNs >= 0 && nowNs - m_lastCapNs < kCapQuietNs;
+    if (depth >= m_highWatermark || capped) {
+        m_degraded = true;
+    } else if (depth <= m_highWatermark / 10) {
+        m_degraded = false;
+    }
+}
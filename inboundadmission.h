@@ -0,0 +1,80 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef INBOUNDADMISSION_H
+#define INBOUNDADMISSION_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include "collabmessages.h"
+
+// допуск входящих сообщений к потоку GUI под нагрузкой (Doc.md 3.3.1.8), живет в сетевом потоке
+// правки документа и служебные сообщения проходят всегда; курсоры придерживаются по одному на участника
+// (новое положение заменяет старое), чат сверх предела отправителя отбрасывается
+// перегрузка - очередь к потоку GUI длиннее верхней отметки или кто-то из отправителей превышает предел;
+// она снимается, когда очередь опустилась ниже нижней отметки и превышений не было секунду
+class InboundAdmission
+{
+public:
+    enum class Priority
+    {
+        Document, // правки, ack, снимки, участники, ошибки - терять нельзя
+        Presence, // cursor_position_update - важно только последнее
+        Chat, // chat_message - можно отбросить
+    };
+
+    enum class Decision
+    {
+        Deliver,
+        Hold, // придержан до flushHeld(), более новое положение того же участника его заменит
+        Drop,
+    };
+
+    static Priority priorityOf(ServerMessageType type);
+
+    // senderRate - сообщений в секунду от одного отправителя (курсоры и чат), 0 - без предела
+    void setSenderRate(int perSecond);
+    void setHighWatermark(int depth);
+    int highWatermark() const { return m_highWatermark; }
+
+    // depth - сколько сообщений уже ждет поток GUI
+    Decision admit(const InboundMessage& message, int depth, qint64 nowNs);
+    // придержанные курсоры в порядке прихода; depth и nowNs пересчитывают перегрузку
+    QList<InboundMessage> takeHeld(int depth, qint64 nowNs);
+    bool hasHeld() const { return !m_held.isEmpty(); }
+    bool isDegraded() const { return m_degraded; }
+    void reset(); // новое соединение
+
+    qint64 coalescedCount() const { return m_coalesced; }
+    qint64 droppedCount() const { return m_dropped; }
+
+    static constexpr int DefaultSenderRate = 100;
+    static constexpr int DefaultHighWatermark = 2000;
+
+private:
+    struct Bucket
+    {
+        double tokens = 0;
+        qint64 updatedNs = 0;
+    };
+
+    bool takeToken(const QString& senderId, qint64 nowNs); // false - отправитель превысил предел
+    void expireIdleBuckets(qint64 nowNs);
+    void forgetSender(const QString& clientId); // придержанный курсор и корзина ушедшего участника
+    void updateDegraded(int depth, qint64 nowNs);
+
+    int m_senderRate = DefaultSenderRate;
+    int m_highWatermark = DefaultHighWatermark;
+    QHash<QString, Bucket> m_buckets; // по client_id отправителя, простаивающие выбрасываются
+    qint64 m_lastExpireNs = 0;
+    QHash<QString, InboundMessage> m_held; // client_id -> последнее положение курсора
+    QList<QString> m_heldOrder;
+    qint64 m_lastCapNs = -1; // когда последний раз сработал предел отправителя
+    bool m_degraded = false;
+    qint64 m_coalesced = 0;
+    qint64 m_dropped = 0;
+};
+
+#endif // INBOUNDADMISSION_H
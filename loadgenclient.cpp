@@ -0,0 +1,368 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "loadgenclient.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QUuid>
+#include <QtMath>
+
+namespace {
+
+const char kLetters[] = "abcdefghijklmnopqrstuvwxyz";
+
+QString randomWord(QRandomGenerator& random, int minLength, int maxLength)
+{
+    QString word;
+    const int length = random.bounded(minLength, maxLength + 1);
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.append(QLatin1Char(kLetters[random.bounded(26)]));
+    }
+    return word;
+}
+
+// сдвиг своей позиции курсора под уже примененные чужие операции
+int shiftCursor(int cursor, const QList<CollabOp>& ops)
+{
+    for (const CollabOp& op : ops) {
+        if (op.type == CollabOp::Insert) {
+            if (op.position <= cursor) {
+                cursor += op.length();
+            }
+        } else if (op.position < cursor) {
+            cursor -= qMin(op.count, cursor - op.position);
+        }
+    }
+    return cursor;
+}
+
+} // namespace
+
+LoadGenClient::LoadGenClient(int index, const LoadOptions& options, LoadStats *stats, quint32 seed, QObject *parent)
+    : QObject(parent)
+    , m_index(index)
+    , m_options(options)
+    , m_stats(stats)
+    , m_random(seed)
+    , m_clientId(QUuid::createUuid().toString(QUuid::WithoutBraces))
+{
+    m_ot.setClientId(m_clientId);
+    m_actionTimer.setSingleShot(true);
+    m_keyTimer.setSingleShot(true);
+    connect(&m_actionTimer, &QTimer::timeout, this, &LoadGenClient::performAction);
+    connect(&m_keyTimer, &QTimer::timeout, this, &LoadGenClient::typeNextKey);
+    m_floodTimer.setInterval(10);
+    connect(&m_floodTimer, &QTimer::timeout, this, &LoadGenClient::floodTick);
+
+    connect(&m_socket, &QWebSocket::connected, this, &LoadGenClient::onConnected);
+    connect(&m_socket, &QWebSocket::textMessageReceived, this, &LoadGenClient::onTextMessage);
+    connect(&m_socket, &QWebSocket::binaryMessageReceived, this, &LoadGenClient::onBinaryMessage);
+    connect(&m_socket, &QWebSocket::errorOccurred, this, [this](QAbstractSocket::SocketError) {
+        ++m_stats->errors;
+        if (!m_joined) {
+            emit failed(m_socket.errorString());
+        }
+    });
+    connect(&m_socket, &QWebSocket::disconnected, this, [this]() {
+        if (m_typing) {
+            ++m_stats->errors;
+            stopTyping();
+            emit failed(QStringLiteral("соединение закрыто сервером"));
+        }
+    });
+}
+
+void LoadGenClient::start(const QString& sessionId, const QString& password)
+{
+    m_sessionId = sessionId;
+    m_password = password;
+    m_codec.reset();
+    m_chunker.reset();
+    m_socket.open(m_options.url);
+}
+
+void LoadGenClient::onConnected()
+{
+    // то же приветствие, что отправляет MainWindowCodeEditor::sendJoinRequest
+    QJsonObject message;
+    if (m_sessionId == "NEW") {
+        message["type"] = "create_session";
+        message["days"] = 0;
+    } else {
+        message["type"] = "join_session";
+        message["session_id"] = m_sessionId;
+    }
+    message["password"] = m_password;
+    message["snapshot_compression"] = "zlib";
+    message["username"] = QStringLiteral("bot-%1").arg(m_index);
+    message["client_id"] = m_clientId;
+    message["protocols"] = m_options.cbor ? QJsonArray{CollabCodec::CborProtocolName, CollabCodec::JsonProtocolName}
+                                          : QJsonArray{CollabCodec::JsonProtocolName};
+    message["features"] = QJsonArray{"user_deltas"}; // как у редактора: вход остальных - одной записью
+    send(message);
+}
+
+void LoadGenClient::close()
+{
+    stopTyping();
+    m_typing = false;
+    m_socket.close();
+}
+
+void LoadGenClient::onTextMessage(const QString& message)
+{
+    ++m_stats->messagesReceived;
+    const QByteArray utf8 = message.toUtf8();
+    m_stats->bytesReceived += utf8.size();
+    handleMessage(QJsonDocument::fromJson(utf8).object());
+}
+
+void LoadGenClient::onBinaryMessage(const QByteArray& message)
+{
+    ++m_stats->messagesReceived;
+    m_stats->bytesReceived += message.size();
+    bool ok = false;
+    const QJsonObject decoded = m_codec.decode(message, &ok);
+    if (!ok) {
+        ++m_stats->errors;
+        return;
+    }
+    handleMessage(decoded);
+}
+
+void LoadGenClient::handleMessage(const QJsonObject& frame)
+{
+    QJsonObject message = frame;
+    if (!m_chunker.accept(message)) {
+        return; // часть большого снимка, разбираем после последней
+    }
+    const QString type = message.value(QLatin1String("type")).toString();
+
+    if (type == QLatin1String("insert") || type == QLatin1String("delete") || type == QLatin1String("batch")) {
+        const int revision = message.value(QLatin1String("revision")).toInt(-1);
+        m_stats->receivedAtNs.append({revision, m_stats->clock.nsecsElapsed()});
+        QList<CollabOp> ops;
+        const QJsonArray array = type == QLatin1String("batch") ? message.value(QLatin1String("ops")).toArray()
+                                                                : QJsonArray{message};
+        for (const QJsonValue& value : array) {
+            bool ok = false;
+            const CollabOp op = CollabOp::fromJson(value.toObject(), &ok);
+            if (ok) {
+                ops.append(op);
+            }
+        }
+        applyRemote(m_ot.applyRemote(ops, message.value(QLatin1String("client_id")).toString(), revision));
+    } else if (type == QLatin1String("ack")) {
+        const int revision = message.value(QLatin1String("revision")).toInt();
+        const qint64 now = m_stats->clock.nsecsElapsed();
+        m_stats->ackLatencyNs.append(now - m_outstandingSentNs);
+        m_stats->sentAtNs.insert(revision, m_outstandingSentNs);
+        const QList<CollabOp> toSend = m_ot.serverAck(revision);
+        if (!toSend.isEmpty()) {
+            sendOps(toSend);
+        }
+    } else if (type == QLatin1String("file_content_update")) {
+        // пачку отвергли (или кто-то заменил весь текст) - берем серверный снимок
+        ++m_stats->resyncs;
+        m_text = message.value(QLatin1String("text")).toString();
+        m_cursor = qMin(m_cursor, int(m_text.length()));
+        m_ot.reset(message.value(QLatin1String("revision")).toInt());
+    } else if (type == QLatin1String("session_info")) {
+        m_sessionId = message.value(QLatin1String("session_id")).toString();
+        if (message.contains(QLatin1String("text_compressed"))) {
+            const QByteArray compressed =
+                QByteArray::fromBase64(message.value(QLatin1String("text_compressed")).toString().toLatin1());
+            m_text = QString::fromUtf8(qUncompress(compressed));
+        } else {
+            m_text = message.value(QLatin1String("text")).toString();
+        }
+        m_cursor = int(m_text.length());
+        m_ot.reset(message.value(QLatin1String("revision")).toInt());
+        if (message.value(QLatin1String("protocol")).toString() == CollabCodec::CborProtocolName) {
+            m_codec.setFormat(CollabCodec::Format::Cbor);
+        }
+        if (!m_joined) {
+            m_joined = true;
+            emit joined(m_sessionId);
+        }
+    } else if (type == QLatin1String("error")) {
+        ++m_stats->errors;
+        if (!m_joined) {
+            emit failed(message.value(QLatin1String("message")).toString());
+        }
+    }
+    // курсоры, чат, список участников генератору не нужны, они только учитываются в трафике
+}
+
+void LoadGenClient::applyRemote(const QList<CollabOp>& ops)
+{
+    OtTransform::applyToText(m_text, ops);
+    m_cursor = qBound(0, shiftCursor(m_cursor, ops), int(m_text.length()));
+}
+
+void LoadGenClient::startTyping()
+{
+    if (!m_joined) return;
+    m_typing = true;
+    scheduleNextAction();
+    if (m_options.floodPerSecond > 0) {
+        m_floodDue = 0;
+        m_floodClock.start();
+        m_floodTimer.start();
+    }
+}
+
+void LoadGenClient::stopTyping()
+{
+    m_actionTimer.stop();
+    m_keyTimer.stop();
+    m_floodTimer.stop();
+    if (m_typing && !m_pendingKeys.isEmpty()) {
+        applyLocal(CollabOp::makeInsert(m_cursor, m_pendingKeys));
+    }
+    m_pendingKeys.clear();
+    m_typing = false;
+}
+
+void LoadGenClient::scheduleNextAction()
+{
+    if (!m_typing || m_options.actionsPerSecond <= 0) return;
+    // пуассоновский поток: экспоненциальные паузы со средним 1/rate
+    const double pause = -qLn(1.0 - m_random.generateDouble()) / m_options.actionsPerSecond;
+    m_actionTimer.start(qBound(1, int(pause * 1000.0), 60000));
+}
+
+void LoadGenClient::performAction()
+{
+    if (!m_typing) return;
+    if (!m_pendingKeys.isEmpty()) {
+        // еще печатаем прошлое слово
+        scheduleNextAction();
+        return;
+    }
+
+    const int total = m_options.typingWeight + m_options.pasteWeight + m_options.deleteWeight + m_options.jumpWeight;
+    int roll = m_random.bounded(qMax(1, total));
+    if ((roll -= m_options.typingWeight) < 0) {
+        // слово по одной букве, как с клавиатуры; иногда с переводом строки
+        m_pendingKeys = randomWord(m_random, 2, 10) + (m_random.bounded(8) == 0 ? QStringLiteral("\n") : QStringLiteral(" "));
+        typeNextKey();
+    } else if ((roll -= m_options.pasteWeight) < 0) {
+        // вставка из буфера: несколько строк одним insert
+        QString paste;
+        const int lines = m_random.bounded(1, 20);
+        for (int line = 0; line < lines; ++line) {
+            const int words = m_random.bounded(1, 8);
+            for (int word = 0; word < words; ++word) {
+                paste += randomWord(m_random, 1, 12) + QLatin1Char(' ');
+            }
+            paste += QLatin1Char('\n');
+        }
+        applyLocal(CollabOp::makeInsert(m_cursor, paste));
+    } else if ((roll -= m_options.deleteWeight) < 0) {
+        if (m_random.bounded(5) == 0) {
+            // удаление выделенного куска после курсора
+            const int count = qMin(m_random.bounded(1, 200), int(m_text.length()) - m_cursor);
+            if (count > 0) {
+                applyLocal(CollabOp::makeDelete(m_cursor, count));
+            }
+        } else {
+            // серия backspace
+            const int count = qMin(m_random.bounded(1, 9), m_cursor);
+            if (count > 0) {
+                applyLocal(CollabOp::makeDelete(m_cursor - count, count));
+            }
+        }
+    } else {
+        m_cursor = m_random.bounded(int(m_text.length()) + 1);
+    }
+
+    if (m_socket.isValid()) {
+        send(QJsonObject{{"type", "cursor_position_update"}, {"position", m_cursor}, {"client_id", m_clientId}});
+    }
+    scheduleNextAction();
+}
+
+void LoadGenClient::typeNextKey()
+{
+    if (m_pendingKeys.isEmpty()) return;
+    const QString key = m_pendingKeys.left(1);
+    m_pendingKeys.remove(0, 1);
+    applyLocal(CollabOp::makeInsert(m_cursor, key));
+    if (!m_pendingKeys.isEmpty()) {
+        // разброс темпа набора +-50%
+        const int interval = m_options.keyIntervalMs;
+        m_keyTimer.start(qMax(1, interval / 2 + m_random.bounded(qMax(1, interval))));
+    }
+}
+
+// таймер тикает грубо, поэтому число сообщений считается по прошедшему времени, а не по тикам
+void LoadGenClient::floodTick()
+{
+    if (!m_socket.isValid()) return;
+    const double due = m_floodClock.nsecsElapsed() * 1e-9 * m_options.floodPerSecond;
+    const int count = int(due - m_floodDue);
+    m_floodDue += count;
+    for (int i = 0; i < count; ++i) {
+        if (int(m_random.bounded(100)) < m_options.floodChatPercent) {
+            send(QJsonObject{{"type", "chat_message"}, {"client_id", m_clientId}, {"session_id", m_sessionId},
+                             {"username", QStringLiteral("bot-%1").arg(m_index)},
+                             {"text_message", randomWord(m_random, 3, 20)}});
+        } else {
+            send(QJsonObject{{"type", "cursor_position_update"}, {"client_id", m_clientId},
+                             {"position", int(m_random.bounded(int(m_text.length()) + 1))}});
+        }
+    }
+    m_stats->floodSent += count;
+}
+
+void LoadGenClient::applyLocal(const CollabOp& op)
+{
+    if (op.isNoop()) return;
+    OtTransform::applyToText(m_text, {op});
+    m_cursor = op.type == CollabOp::Insert ? op.position + op.length() : op.position;
+    ++m_stats->opsGenerated;
+    const QList<CollabOp> toSend = m_ot.applyLocal({op});
+    if (!toSend.isEmpty()) {
+        sendOps(toSend);
+    }
+}
+
+void LoadGenClient::sendOps(const QList<CollabOp>& ops)
+{
+    QJsonObject message;
+    if (ops.size() > 1) {
+        QJsonArray array;
+        for (const CollabOp& op : ops) {
+            array.append(op.toJson());
+        }
+        message["type"] = "batch";
+        message["ops"] = array;
+    } else {
+        message = ops.first().toJson();
+    }
+    message["client_id"] = m_clientId;
+    message["revision"] = m_ot.revision();
+    m_outstandingSentNs = m_stats->clock.nsecsElapsed();
+    send(message);
+}
+
+void LoadGenClient::send(const QJsonObject& frame)
+{
+    QJsonObject message = frame;
+    if (!m_options.path.isEmpty()) {
+        message["path"] = m_options.path; // вход, правки и курсоры - в этот документ
+    }
+    const QByteArray data = m_codec.isBinary() ? m_codec.encode(message)
+                                               : QJsonDocument(message).toJson(QJsonDocument::Compact);
+    ++m_stats->messagesSent;
+    m_stats->bytesSent += data.size();
+    if (m_codec.isBinary()) {
+        m_socket.sendBinaryMessage(data);
+    } else {
+        m_socket.sendTextMessage(QString::fromUtf8(data));
+    }
+}
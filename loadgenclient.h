@@ -0,0 +1,120 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef LOADGENCLIENT_H
+#define LOADGENCLIENT_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QUrl>
+#include <QWebSocket>
+#include "collabop.h"
+#include "collabprotocol.h"
+#include "otengine.h"
+
+// параметры нагрузки, общие для всех имитируемых клиентов
+struct LoadOptions
+{
+    QUrl url;
+    QString path; // документ сессии (путь файла в проекте), пусто - общий буфер
+    bool cbor = true; // предлагать bam-cbor-1, иначе только JSON
+    double actionsPerSecond = 1.0; // действий на клиента в секунду (слово, вставка, удаление, прыжок курсора)
+    int keyIntervalMs = 60; // пауза между нажатиями внутри слова
+    // веса действий
+    int typingWeight = 70;
+    int pasteWeight = 5;
+    int deleteWeight = 15;
+    int jumpWeight = 10;
+    // поток курсоров и чата сверх сценария, сообщений на клиента в секунду (проверка защиты от потока), 0 - нет
+    double floodPerSecond = 0;
+    int floodChatPercent = 10; // доля чата в этом потоке
+};
+
+// общие счетчики прогона; все клиенты живут в одном потоке, поэтому без синхронизации
+struct LoadStats
+{
+    QElapsedTimer clock; // общий для всех отметок времени
+    qint64 messagesSent = 0;
+    qint64 messagesReceived = 0;
+    qint64 bytesSent = 0;
+    qint64 bytesReceived = 0;
+    qint64 opsGenerated = 0;
+    qint64 floodSent = 0; // курсоров и чата из --flood
+    qint64 resyncs = 0; // сервер отверг пачку и прислал полный текст
+    qint64 errors = 0;
+    QList<qint64> ackLatencyNs; // отправка пачки -> ack автору
+    QHash<int, qint64> sentAtNs; // ревизия -> когда автор отправил эту пачку
+    QList<QPair<int, qint64>> receivedAtNs; // (ревизия, когда ее получил другой клиент)
+};
+
+// один имитируемый участник: говорит тем же протоколом, что MainWindowCodeEditor,
+// ведет свою копию документа через OtClient и набирает текст по случайному сценарию
+class LoadGenClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    LoadGenClient(int index, const LoadOptions& options, LoadStats *stats, quint32 seed, QObject *parent = nullptr);
+
+    // sessionId "NEW" - создать сессию; password - пароль сессии
+    void start(const QString& sessionId, const QString& password);
+    void startTyping();
+    void stopTyping(); // недонабранное слово дописывается сразу
+    void close();
+
+    bool isJoined() const { return m_joined; }
+    bool isSettled() const { return m_joined && !m_ot.isAwaitingAck() && m_pendingKeys.isEmpty(); }
+    const QString& text() const { return m_text; }
+    int revision() const { return m_ot.revision(); }
+    const QString& clientId() const { return m_clientId; }
+
+signals:
+    void joined(const QString& sessionId);
+    void failed(const QString& reason);
+
+private:
+    void onConnected();
+    void onTextMessage(const QString& message);
+    void onBinaryMessage(const QByteArray& message);
+    void handleMessage(const QJsonObject& frame);
+    void applyRemote(const QList<CollabOp>& ops);
+
+    void scheduleNextAction();
+    void performAction();
+    void typeNextKey();
+    void floodTick();
+    void applyLocal(const CollabOp& op);
+    void sendOps(const QList<CollabOp>& ops);
+    void send(const QJsonObject& message);
+
+    int m_index;
+    LoadOptions m_options;
+    LoadStats *m_stats;
+    QRandomGenerator m_random;
+    QWebSocket m_socket;
+    CollabCodec m_codec;
+    CollabChunker m_chunker;
+    OtClient m_ot;
+    QString m_clientId;
+    QString m_sessionId;
+    QString m_password;
+    bool m_joined = false;
+    bool m_typing = false;
+    QString m_text; // своя копия документа
+    int m_cursor = 0;
+    QString m_pendingKeys; // слово, которое набирается по одной букве
+    qint64 m_outstandingSentNs = 0; // когда ушла пачка, ждущая ack
+    QTimer m_actionTimer;
+    QTimer m_keyTimer;
+    QTimer m_floodTimer;
+    QElapsedTimer m_floodClock;
+    double m_floodDue = 0; // сколько сообщений потока уже положено отправить
+};
+
+#endif // LOADGENCLIENT_H
@@ -0,0 +1,366 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "loadgenclient.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QTimer>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace {
+
+// перцентили по методу ближайшего ранга, в миллисекундах
+QJsonObject latencySummary(QList<qint64> samplesNs)
+{
+    std::sort(samplesNs.begin(), samplesNs.end());
+    const auto percentile = [&samplesNs](double p) {
+        if (samplesNs.isEmpty()) return 0.0;
+        const qsizetype rank = qBound<qsizetype>(0, qsizetype(p * samplesNs.size() + 0.5) - 1, samplesNs.size() - 1);
+        return samplesNs.at(rank) / 1e6;
+    };
+    return QJsonObject{
+        {"count", qint64(samplesNs.size())},
+        {"p50", percentile(0.50)},
+        {"p90", percentile(0.90)},
+        {"p99", percentile(0.99)},
+        {"max", samplesNs.isEmpty() ? 0.0 : samplesNs.last() / 1e6},
+    };
+}
+
+// прогон: подключение, набор в течение duration, ожидание тишины, отчет
+class LoadRun : public QObject
+{
+public:
+    LoadRun(const LoadOptions& options, int clientCount, quint32 seed, QObject *parent = nullptr)
+        : QObject(parent)
+        , m_options(options)
+    {
+        m_stats.clock.start();
+        for (int i = 0; i < clientCount; ++i) {
+            auto *client = new LoadGenClient(i, options, &m_stats, seed + quint32(i), this);
+            connect(client, &LoadGenClient::joined, this, [this, i](const QString& id) { onClientJoined(i, id); });
+            connect(client, &LoadGenClient::failed, this, [this, i](const QString& reason) { onClientFailed(i, reason); });
+            m_clients.push_back(client);
+        }
+        m_settleTimer.setInterval(100);
+        connect(&m_settleTimer, &QTimer::timeout, this, [this]() { checkSettled(); });
+    }
+
+    QString sessionId;
+    QString password;
+    int rampMs = 20;
+    int durationMs = 30000;
+    int connectTimeoutMs = 30000;
+    int settleTimeoutMs = 10000;
+    QString outputPath;
+
+    void start()
+    {
+        // без --session первый клиент создает сессию, остальные входят в нее после него
+        if (sessionId.isEmpty()) {
+            m_creating = true;
+            m_clients.front()->start(QStringLiteral("NEW"), password);
+        } else {
+            connectRest(sessionId, 0);
+        }
+        QTimer::singleShot(connectTimeoutMs, this, [this]() {
+            if (!m_typingStarted) {
+                qWarning() << "Подключились не все клиенты за" << connectTimeoutMs << "мс, стартуем с" << m_joinedCount;
+                startTyping();
+            }
+        });
+    }
+
+private:
+    void connectRest(const QString& id, int from)
+    {
+        for (int i = from; i < int(m_clients.size()); ++i) {
+            LoadGenClient *client = m_clients[size_t(i)];
+            QTimer::singleShot((i - from) * rampMs, client, [client, id, this]() { client->start(id, password); });
+        }
+    }
+
+    void onClientJoined(int index, const QString& id)
+    {
+        ++m_joinedCount;
+        if (index == 0 && m_creating) {
+            m_creating = false;
+            sessionId = id;
+            connectRest(id, 1);
+        }
+        maybeStartTyping();
+    }
+
+    void onClientFailed(int index, const QString& reason)
+    {
+        qWarning() << "Клиент" << index << ":" << reason;
+        // обрыв во время набора уже учтен в errors, повторная ошибка того же клиента не считается
+        if (m_typingStarted || m_failed.contains(index)) return;
+        if (index == 0 && m_creating) {
+            qCritical() << "Не удалось создать сессию";
+            QCoreApplication::exit(1);
+            return;
+        }
+        m_failed.insert(index);
+        maybeStartTyping();
+    }
+
+    void maybeStartTyping()
+    {
+        if (m_joinedCount + int(m_failed.size()) == int(m_clients.size())) {
+            startTyping();
+        }
+    }
+
+    void startTyping()
+    {
+        if (m_typingStarted) return;
+        m_typingStarted = true;
+        if (m_joinedCount == 0) {
+            qCritical() << "Ни один клиент не подключился";
+            QCoreApplication::exit(1);
+            return;
+        }
+        qInfo() << "Клиентов в сессии:" << m_joinedCount << "из" << m_clients.size() << "- набор" << durationMs << "мс";
+        m_startNs = m_stats.clock.nsecsElapsed();
+        m_startCounters = {m_stats.messagesSent, m_stats.messagesReceived, m_stats.bytesSent, m_stats.bytesReceived};
+        for (LoadGenClient *client : m_clients) {
+            client->startTyping();
+        }
+        QTimer::singleShot(durationMs, this, [this]() { stopTyping(); });
+    }
+
+    void stopTyping()
+    {
+        for (LoadGenClient *client : m_clients) {
+            client->stopTyping();
+        }
+        m_stopNs = m_stats.clock.nsecsElapsed();
+        m_settleTimer.start();
+    }
+
+    // тишина: у всех нет неподтвержденных пачек и все дошли до одной ревизии
+    void checkSettled()
+    {
+        bool settled = true;
+        int revision = -1;
+        for (const LoadGenClient *client : m_clients) {
+            if (!client->isJoined()) continue;
+            if (!client->isSettled() || (revision >= 0 && client->revision() != revision)) {
+                settled = false;
+                break;
+            }
+            revision = client->revision();
+        }
+        const bool timedOut = (m_stats.clock.nsecsElapsed() - m_stopNs) / 1000000 > settleTimeoutMs;
+        if (!settled && !timedOut) return;
+        m_settleTimer.stop();
+        finish(settled);
+    }
+
+    void finish(bool settled)
+    {
+        const qint64 endNs = m_stats.clock.nsecsElapsed();
+        const double seconds = qMax<qint64>(1, endNs - m_startNs) / 1e9;
+
+        // сквозная задержка: автор отправил пачку -> другой клиент получил ее ревизию
+        QList<qint64> endToEnd;
+        endToEnd.reserve(m_stats.receivedAtNs.size());
+        for (const auto& received : std::as_const(m_stats.receivedAtNs)) {
+            const auto sent = m_stats.sentAtNs.constFind(received.first);
+            if (sent != m_stats.sentAtNs.constEnd() && received.second >= *sent) {
+                endToEnd.append(received.second - *sent);
+            }
+        }
+
+        // расхождение: сравниваем документы по хешу с самым частым вариантом
+        QHash<QByteArray, int> variants;
+        QByteArray majority;
+        int maxRevision = -1;
+        int documentLength = 0;
+        for (const LoadGenClient *client : m_clients) {
+            if (!client->isJoined()) continue;
+            const QByteArray hash = QCryptographicHash::hash(client->text().toUtf8(), QCryptographicHash::Sha1);
+            const int count = ++variants[hash];
+            if (majority.isEmpty() || count > variants.value(majority)) {
+                majority = hash;
+                documentLength = int(client->text().length());
+            }
+            maxRevision = qMax(maxRevision, client->revision());
+        }
+        const int divergent = m_joinedCount - variants.value(majority);
+
+        const qint64 messagesSent = m_stats.messagesSent - m_startCounters[0];
+        const qint64 messagesReceived = m_stats.messagesReceived - m_startCounters[1];
+        const qint64 bytesSent = m_stats.bytesSent - m_startCounters[2];
+        const qint64 bytesReceived = m_stats.bytesReceived - m_startCounters[3];
+
+        const QJsonObject report{
+            {"config", QJsonObject{
+                {"url", m_options.url.toString()},
+                {"clients", int(m_clients.size())},
+                {"duration_ms", durationMs},
+                {"actions_per_second", m_options.actionsPerSecond},
+                {"key_interval_ms", m_options.keyIntervalMs},
+                {"mix", QJsonObject{{"typing", m_options.typingWeight}, {"paste", m_options.pasteWeight},
+                                    {"delete", m_options.deleteWeight}, {"jump", m_options.jumpWeight}}},
+                {"protocol", m_options.cbor ? CollabCodec::CborProtocolName : CollabCodec::JsonProtocolName},
+                {"path", m_options.path},
+                {"flood_per_second", m_options.floodPerSecond * int(m_clients.size())},
+            }},
+            {"session_id", sessionId},
+            {"joined_clients", m_joinedCount},
+            {"elapsed_s", seconds},
+            {"ops_generated", m_stats.opsGenerated},
+            {"flood_sent", m_stats.floodSent},
+            {"messages_sent", messagesSent},
+            {"messages_received", messagesReceived},
+            {"bytes_sent", bytesSent},
+            {"bytes_received", bytesReceived},
+            {"messages_per_s", QJsonObject{{"sent", messagesSent / seconds}, {"received", messagesReceived / seconds}}},
+            {"bytes_per_s", QJsonObject{{"sent", bytesSent / seconds}, {"received", bytesReceived / seconds}}},
+            {"ack_latency_ms", latencySummary(m_stats.ackLatencyNs)},
+            {"end_to_end_latency_ms", latencySummary(endToEnd)},
+            {"resyncs", m_stats.resyncs},
+            {"errors", m_stats.errors},
+            {"settled", settled},
+            {"final_revision", maxRevision},
+            {"document_length", documentLength},
+            {"distinct_documents", int(variants.size())},
+            {"divergent_clients", divergent},
+        };
+
+        const QJsonObject e2e = report["end_to_end_latency_ms"].toObject();
+        qInfo().noquote() << QStringLiteral("операций %1, сообщений/с %2 отправлено / %3 получено, байт/с %4 / %5")
+                                 .arg(m_stats.opsGenerated)
+                                 .arg(messagesSent / seconds, 0, 'f', 1)
+                                 .arg(messagesReceived / seconds, 0, 'f', 1)
+                                 .arg(bytesSent / seconds, 0, 'f', 0)
+                                 .arg(bytesReceived / seconds, 0, 'f', 0);
+        qInfo().noquote() << QStringLiteral("задержка до других клиентов, мс: p50 %1, p90 %2, p99 %3, max %4")
+                                 .arg(e2e["p50"].toDouble(), 0, 'f', 2)
+                                 .arg(e2e["p90"].toDouble(), 0, 'f', 2)
+                                 .arg(e2e["p99"].toDouble(), 0, 'f', 2)
+                                 .arg(e2e["max"].toDouble(), 0, 'f', 2);
+        qInfo().noquote() << QStringLiteral("ревизия %1, вариантов документа %2, разошлись %3, тишина %4")
+                                 .arg(maxRevision)
+                                 .arg(variants.size())
+                                 .arg(divergent)
+                                 .arg(settled ? QStringLiteral("да") : QStringLiteral("нет"));
+
+        const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+        if (outputPath.isEmpty() || outputPath == QLatin1String("-")) {
+            QFile out;
+            if (out.open(stdout, QIODevice::WriteOnly)) {
+                out.write(json);
+            }
+        } else {
+            QFile out(outputPath);
+            if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(json) != json.size()) {
+                qCritical() << "Не удалось записать отчет" << outputPath << out.errorString();
+            }
+        }
+
+        for (LoadGenClient *client : m_clients) {
+            client->close();
+        }
+        // 2 - документы разошлись или не дождались тишины, удобно для проверок в CI
+        QCoreApplication::exit(settled && divergent == 0 ? 0 : 2);
+    }
+
+    LoadOptions m_options;
+    LoadStats m_stats;
+    std::vector<LoadGenClient*> m_clients;
+    QTimer m_settleTimer;
+    int m_joinedCount = 0;
+    QSet<int> m_failed; // не подключились
+    bool m_creating = false; // первый клиент создает сессию
+    bool m_typingStarted = false;
+    qint64 m_startNs = 0;
+    qint64 m_stopNs = 0;
+    std::array<qint64, 4> m_startCounters{};
+};
+
+} // namespace
+
+// нагрузочный генератор: bam_loadgen --url ws://127.0.0.1:8080 --clients 50 --duration 60 --output report.json
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bam_loadgen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("BAM_IDE collaboration load generator");
+    parser.addHelpOption();
+    QCommandLineOption urlOption("url", "Адрес сервера.", "url", "ws://127.0.0.1:8080");
+    QCommandLineOption clientsOption("clients", "Сколько клиентов имитировать.", "count", "10");
+    QCommandLineOption durationOption("duration", "Сколько секунд набирать текст.", "seconds", "30");
+    QCommandLineOption rateOption("rate", "Действий (слово, вставка, удаление, прыжок) на клиента в секунду.", "rate", "1");
+    QCommandLineOption keyIntervalOption("key-interval", "Пауза между нажатиями внутри слова, мс.", "ms", "60");
+    QCommandLineOption mixOption("mix", "Веса действий: набор,вставка,удаление,прыжок.", "weights", "70,5,15,10");
+    QCommandLineOption sessionOption("session", "Войти в существующую сессию вместо создания новой.", "id");
+    QCommandLineOption passwordOption("password", "Пароль сессии.", "password", "loadgen");
+    QCommandLineOption jsonOption("json-protocol", "Говорить только JSON, не предлагать bam-cbor-1.");
+    QCommandLineOption seedOption("seed", "Зерно случайных сценариев.", "seed", "1");
+    QCommandLineOption rampOption("ramp", "Пауза между подключениями клиентов, мс.", "ms", "20");
+    QCommandLineOption settleOption("settle-timeout", "Сколько секунд ждать схождения после набора.", "seconds", "10");
+    QCommandLineOption outputOption("output", "Файл отчета JSON, по умолчанию stdout.", "file");
+    QCommandLineOption pathOption("path", "Документ сессии (путь файла относительно корня проекта), по умолчанию общий буфер.", "path");
+    QCommandLineOption floodOption("flood", "Курсоров и сообщений чата в секунду на всех клиентов сверх сценария.", "rate", "0");
+    QCommandLineOption floodChatOption("flood-chat", "Доля чата в --flood, процентов.", "percent", "10");
+    parser.addOptions({urlOption, clientsOption, durationOption, rateOption, keyIntervalOption, mixOption, sessionOption,
+                       passwordOption, jsonOption, seedOption, rampOption, settleOption, outputOption, pathOption,
+                       floodOption, floodChatOption});
+    parser.process(app);
+
+    LoadOptions options;
+    options.url = QUrl(parser.value(urlOption));
+    options.cbor = !parser.isSet(jsonOption);
+    options.path = parser.value(pathOption);
+    options.actionsPerSecond = parser.value(rateOption).toDouble();
+    options.keyIntervalMs = qMax(1, parser.value(keyIntervalOption).toInt());
+    const QStringList mix = parser.value(mixOption).split(QLatin1Char(','));
+    if (mix.size() != 4) {
+        qCritical() << "--mix ждет четыре веса через запятую";
+        return 1;
+    }
+    options.typingWeight = qMax(0, mix[0].toInt());
+    options.pasteWeight = qMax(0, mix[1].toInt());
+    options.deleteWeight = qMax(0, mix[2].toInt());
+    options.jumpWeight = qMax(0, mix[3].toInt());
+
+    const QString scheme = options.url.scheme();
+    if (!options.url.isValid() || (scheme != QLatin1String("ws") && scheme != QLatin1String("wss"))) {
+        qCritical() << "Адрес сервера должен начинаться с ws:// или wss://";
+        return 1;
+    }
+    const int clients = parser.value(clientsOption).toInt();
+    if (clients < 1) {
+        qCritical() << "--clients должно быть не меньше 1";
+        return 1;
+    }
+
+    options.floodPerSecond = qMax(0.0, parser.value(floodOption).toDouble()) / clients;
+    options.floodChatPercent = qBound(0, parser.value(floodChatOption).toInt(), 100);
+
+    LoadRun run(options, clients, parser.value(seedOption).toUInt());
+    run.sessionId = parser.value(sessionOption);
+    run.password = parser.value(passwordOption);
+    run.rampMs = qMax(0, parser.value(rampOption).toInt());
+    run.durationMs = qMax(1, parser.value(durationOption).toInt()) * 1000;
+    run.settleTimeoutMs = qMax(1, parser.value(settleOption).toInt()) * 1000;
+    run.outputPath = parser.value(outputOption);
+    QTimer::singleShot(0, &run, [&run]() { run.start(); });
+    return app.exec();
+}
@@ -0,0 +1,359 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "lspframereader.h"
+#include "lspmanager.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QUrl>
+#include <algorithm>
+
+namespace {
+
+// перцентили по методу ближайшего ранга, в миллисекундах (как в отчете bam_loadgen)
+QJsonObject latencySummary(QList<qint64> samplesNs)
+{
+    std::sort(samplesNs.begin(), samplesNs.end());
+    const auto percentile = [&samplesNs](double p) {
+        if (samplesNs.isEmpty()) return 0.0;
+        const qsizetype rank = qBound<qsizetype>(0, qsizetype(p * samplesNs.size() + 0.5) - 1, samplesNs.size() - 1);
+        return samplesNs.at(rank) / 1e6;
+    };
+    return QJsonObject{
+        {"count", qint64(samplesNs.size())},
+        {"p50", percentile(0.50)},
+        {"p90", percentile(0.90)},
+        {"p99", percentile(0.99)},
+        {"max", samplesNs.isEmpty() ? 0.0 : samplesNs.last() / 1e6},
+    };
+}
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QFile out;
+    const bool toStdout = path.isEmpty() || path == QLatin1String("-");
+    if (toStdout) {
+        if (!out.open(stdout, QIODevice::WriteOnly)) return false;
+    } else {
+        out.setFileName(path);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical() << "Не удалось записать" << path << out.errorString();
+            return false;
+        }
+    }
+    return out.write(data) == data.size();
+}
+
+// синтетический поток stdout сервера: сообщения от 60 байт до сотен КБ, как уведомления, подсказки и диагностика
+QByteArray makeFramingStream(qsizetype totalBytes, QRandomGenerator& random, qint64& messages, qint64& bodyBytes)
+{
+    QByteArray stream;
+    stream.reserve(totalBytes + 512 * 1024);
+    while (stream.size() < totalBytes) {
+        const int roll = random.bounded(100);
+        const int padding = roll < 70 ? random.bounded(64, 1024) // мелкие уведомления и hover
+                          : roll < 97 ? random.bounded(1024, 32 * 1024) // списки автодополнения
+                                      : random.bounded(32 * 1024, 512 * 1024); // диагностика большого файла
+        const QByteArray body = "{\"jsonrpc\":\"2.0\",\"method\":\"$/bench\",\"params\":{\"pad\":\""
+                              + QByteArray(padding, 'x') + "\"}}";
+        stream.append("Content-Length: ").append(QByteArray::number(body.size())).append("\r\n");
+        if (roll % 5 == 0) {
+            stream.append("Content-Type: application/vscode-jsonrpc; charset=utf-8\r\n");
+        }
+        stream.append("\r\n").append(body);
+        ++messages;
+        bodyBytes += body.size();
+    }
+    return stream;
+}
+
+// разбор до LspFrameReader: left, split('\n') и mid на каждое сообщение, для сравнения
+qint64 legacyFraming(QByteArray& buffer, const QByteArray& data, qint64& checksum)
+{
+    qint64 messages = 0;
+    buffer.append(data);
+    while (true) {
+        const int headerEndIndex = buffer.indexOf("\r\n\r\n");
+        if (headerEndIndex == -1) break;
+        const QByteArray headerPart = buffer.left(headerEndIndex);
+        int contentLength = -1;
+        const QList<QByteArray> headers = headerPart.split('\n');
+        for (const QByteArray& headerLine : headers) {
+            if (headerLine.startsWith("Content-Length:")) {
+                contentLength = headerLine.mid(15).trimmed().toInt();
+                break;
+            }
+        }
+        if (contentLength <= 0) {
+            buffer = buffer.mid(headerEndIndex + 4);
+            continue;
+        }
+        const int totalMessageLength = headerEndIndex + 4 + contentLength;
+        if (buffer.size() < totalMessageLength) break;
+        const QByteArray jsonContent = buffer.mid(headerEndIndex + 4, contentLength);
+        buffer = buffer.mid(totalMessageLength);
+        checksum += jsonContent.size() + jsonContent.back();
+        ++messages;
+    }
+    return messages;
+}
+
+QJsonObject framingResult(qint64 elapsedNs, qint64 streamBytes, qint64 messages, qint64 checksum)
+{
+    return QJsonObject{
+        {"ms", elapsedNs / 1e6},
+        {"mb_per_s", elapsedNs > 0 ? streamBytes / (1024.0 * 1024.0) / (elapsedNs / 1e9) : 0.0},
+        {"messages", messages},
+        {"checksum", checksum},
+    };
+}
+
+// bam_lspbench --framing: только выделение сообщений из потока, без сервера и без разбора JSON
+int runFramingBench(qsizetype streamBytes, qsizetype chunkMin, qsizetype chunkMax, quint32 seed, const QString& output)
+{
+    QRandomGenerator random(seed);
+    qint64 expectedMessages = 0;
+    qint64 expectedBodyBytes = 0;
+    const QByteArray stream = makeFramingStream(streamBytes, random, expectedMessages, expectedBodyBytes);
+
+    // куски одинаковые для обоих вариантов, как если бы их отдавал QProcess
+    QList<qsizetype> chunks;
+    for (qsizetype offset = 0; offset < stream.size();) {
+        const qsizetype size = qMin<qsizetype>(stream.size() - offset, chunkMin + random.bounded(quint64(chunkMax - chunkMin + 1)));
+        chunks.append(size);
+        offset += size;
+    }
+
+    QElapsedTimer timer;
+    LspFrameReader reader;
+    qint64 readerChecksum = 0;
+    timer.start();
+    qsizetype offset = 0;
+    for (const qsizetype size : std::as_const(chunks)) {
+        reader.append(QByteArrayView(stream.constData() + offset, size));
+        offset += size;
+        QByteArrayView body;
+        while (reader.next(body)) {
+            readerChecksum += body.size() + body.back();
+        }
+    }
+    const qint64 readerNs = timer.nsecsElapsed();
+
+    QByteArray legacyBuffer;
+    qint64 legacyMessages = 0;
+    qint64 legacyChecksum = 0;
+    timer.restart();
+    offset = 0;
+    for (const qsizetype size : std::as_const(chunks)) {
+        // до LspFrameReader каждый кусок приходил отдельным QByteArray из readAllStandardOutput
+        legacyMessages += legacyFraming(legacyBuffer, stream.mid(offset, size), legacyChecksum);
+        offset += size;
+    }
+    const qint64 legacyNs = timer.nsecsElapsed();
+
+    const bool consistent = reader.messages() == expectedMessages && legacyMessages == expectedMessages
+                         && readerChecksum == legacyChecksum && reader.bufferedBytes() == 0;
+    const QJsonObject report{
+        {"mode", "framing"},
+        {"stream_bytes", qint64(stream.size())},
+        {"messages", expectedMessages},
+        {"body_bytes", expectedBodyBytes},
+        {"chunks", qint64(chunks.size())},
+        {"chunk_bytes", QJsonObject{{"min", qint64(chunkMin)}, {"max", qint64(chunkMax)}}},
+        {"seed", qint64(seed)},
+        {"reader", framingResult(readerNs, stream.size(), reader.messages(), readerChecksum)},
+        {"reader_bytes_moved", reader.bytesMoved()},
+        {"legacy", framingResult(legacyNs, stream.size(), legacyMessages, legacyChecksum)},
+        {"speedup", readerNs > 0 ? double(legacyNs) / readerNs : 0.0},
+        {"consistent", consistent},
+    };
+    qInfo().noquote() << QStringLiteral("framing: %1 МБ, сообщений %2, кусков %3: LspFrameReader %4 мс, раньше %5 мс, сдвинуто %6 КБ")
+                             .arg(stream.size() / (1024.0 * 1024.0), 0, 'f', 1).arg(expectedMessages).arg(chunks.size())
+                             .arg(readerNs / 1e6, 0, 'f', 1).arg(legacyNs / 1e6, 0, 'f', 1).arg(reader.bytesMoved() / 1024);
+    if (!consistent) {
+        qCritical() << "Разбор потока разошелся: ожидалось сообщений" << expectedMessages
+                    << "LspFrameReader" << reader.messages() << "раньше" << legacyMessages;
+    }
+    const bool ok = writeFile(output, QJsonDocument(report).toJson(QJsonDocument::Indented));
+    return ok && consistent ? 0 : 1;
+}
+
+} // namespace
+
+// задержки ответов LSP-сервера: bam_lspbench file.cpp [--server clangd] [--kind completion|hover]
+// [--line N --character N] [--requests 50] [--output report.json]
+// выделение сообщений из потока без сервера: bam_lspbench --framing [--stream-mb 64] [--chunk-min 1] [--chunk-max 65536] [--seed 1]
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bam_lspbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("BAM_IDE LSP reply latency benchmark");
+    parser.addHelpOption();
+    parser.addPositionalArgument("file", "Файл, который открывается на сервере (не нужен с --framing).");
+    QCommandLineOption serverOption("server", "Исполняемый файл LSP-сервера.", "path", "clangd");
+    QCommandLineOption kindOption("kind", "Запрос: completion или hover.", "kind", "completion");
+    QCommandLineOption lineOption("line", "Строка запроса с нуля, по умолчанию последняя.", "line");
+    QCommandLineOption characterOption("character", "Символ в строке, по умолчанию конец строки.", "character");
+    QCommandLineOption requestsOption("requests", "Сколько запросов отправить подряд.", "count", "50");
+    QCommandLineOption warmupOption("warmup", "Сколько ждать первой диагностики файла, мс.", "ms", "30000");
+    QCommandLineOption timeoutOption("timeout", "Предел всего прогона, с.", "seconds", "300");
+    QCommandLineOption outputOption("output", "Файл отчета JSON, по умолчанию stdout.", "file");
+    QCommandLineOption framingOption("framing", "Мерить только выделение сообщений из синтетического потока stdout.");
+    QCommandLineOption streamOption("stream-mb", "Размер синтетического потока, МБ.", "mb", "64");
+    QCommandLineOption chunkMinOption("chunk-min", "Наименьший кусок чтения, байт.", "bytes", "1");
+    QCommandLineOption chunkMaxOption("chunk-max", "Наибольший кусок чтения, байт.", "bytes", "65536");
+    QCommandLineOption seedOption("seed", "Зерно генератора потока и кусков.", "seed", "1");
+    parser.addOptions({serverOption, kindOption, lineOption, characterOption, requestsOption, warmupOption, timeoutOption, outputOption,
+                       framingOption, streamOption, chunkMinOption, chunkMaxOption, seedOption});
+    parser.process(app);
+
+    if (parser.isSet(framingOption)) {
+        const qsizetype chunkMin = qMax<qsizetype>(1, parser.value(chunkMinOption).toLongLong());
+        const qsizetype chunkMax = qMax(chunkMin, qsizetype(parser.value(chunkMaxOption).toLongLong()));
+        const qsizetype streamBytes = qMax<qsizetype>(1, parser.value(streamOption).toLongLong()) * 1024 * 1024;
+        return runFramingBench(streamBytes, chunkMin, chunkMax, parser.value(seedOption).toUInt(), parser.value(outputOption));
+    }
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != 1) {
+        parser.showHelp(1);
+    }
+    const QString kind = parser.value(kindOption);
+    if (kind != QLatin1String("completion") && kind != QLatin1String("hover")) {
+        qCritical() << "--kind ждет completion или hover";
+        return 1;
+    }
+    const int requestCount = qMax(1, parser.value(requestsOption).toInt());
+
+    const QFileInfo fileInfo(arguments.first());
+    QFile file(fileInfo.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "Не удалось открыть" << file.fileName() << file.errorString();
+        return 1;
+    }
+    const QString text = QString::fromUtf8(file.readAll());
+    const QString fileUri = QUrl::fromLocalFile(fileInfo.absoluteFilePath()).toString();
+    const QStringList lines = text.split(QLatin1Char('\n'));
+    const int line = parser.isSet(lineOption) ? parser.value(lineOption).toInt() : int(lines.size()) - 1;
+    const int character = parser.isSet(characterOption) ? parser.value(characterOption).toInt()
+                                                          : int(lines.value(line).size());
+
+    LspManager manager(parser.value(serverOption));
+    manager.setRequestTimeout(parser.value(timeoutOption).toInt() * 1000); // прогон ограничен своим таймаутом
+    QElapsedTimer clock;
+    clock.start();
+    qint64 sentNs = 0;
+    int sent = 0;
+    int lastResultSize = 0;
+    bool measuring = false;
+    QList<qint64> roundTripNs;
+    QList<qint64> guiNs;
+    QList<qint64> decodeNs;
+    QList<qint64> diagnosticsGuiNs;
+    QList<qint64> diagnosticsDecodeNs;
+
+    const auto finish = [&](int code) {
+        const LspRequestStats requestStats = manager.requestStats();
+        const QJsonObject report{
+            {"server", manager.executablePath()},
+            {"file", fileInfo.absoluteFilePath()},
+            {"kind", kind},
+            {"position", QJsonObject{{"line", line}, {"character", character}}},
+            {"requests", sent},
+            {"last_result_size", lastResultSize},
+            {"round_trip_ms", latencySummary(roundTripNs)},
+            {"gui_ms", latencySummary(guiNs)}, // поток GUI на ответ
+            {"decode_ms", latencySummary(decodeNs)}, // разбор в потоке транспорта
+            {"diagnostics", QJsonObject{{"gui_ms", latencySummary(diagnosticsGuiNs)}, {"decode_ms", latencySummary(diagnosticsDecodeNs)}}},
+            {"request_stats", QJsonObject{
+                {"sent", requestStats.sent},
+                {"answered", requestStats.answered},
+                {"superseded", requestStats.superseded},
+                {"stale", requestStats.stale},
+                {"timed_out", requestStats.timedOut},
+                {"failed", requestStats.failed},
+                {"dropped_before_decode", requestStats.droppedBeforeDecode},
+            }},
+        };
+        const QJsonObject gui = report["gui_ms"].toObject();
+        const QJsonObject decode = report["decode_ms"].toObject();
+        qInfo().noquote() << QStringLiteral("%1: ответов %2, поток GUI p99 %3 мс (макс %4), разбор p99 %5 мс, туда-обратно p99 %6 мс")
+                                 .arg(kind).arg(gui["count"].toInteger())
+                                 .arg(gui["p99"].toDouble(), 0, 'f', 3).arg(gui["max"].toDouble(), 0, 'f', 3)
+                                 .arg(decode["p99"].toDouble(), 0, 'f', 3)
+                                 .arg(report["round_trip_ms"]["p99"].toDouble(), 0, 'f', 2);
+        const bool ok = writeFile(parser.value(outputOption), QJsonDocument(report).toJson(QJsonDocument::Indented));
+        manager.stopServer();
+        QCoreApplication::exit(ok ? code : 1);
+    };
+
+    const auto sendNext = [&]() {
+        if (sent >= requestCount) {
+            finish(0);
+            return;
+        }
+        ++sent;
+        sentNs = clock.nsecsElapsed();
+        if (kind == QLatin1String("completion")) {
+            manager.requestCompletion(fileUri, line, character, 1);
+        } else {
+            manager.requestHover(fileUri, line, character);
+        }
+    };
+    const auto startMeasuring = [&]() {
+        if (measuring) return;
+        measuring = true;
+        QTimer::singleShot(0, &app, sendNext);
+    };
+
+    QObject::connect(&manager, &LspManager::serverReady, &app, [&]() {
+        manager.notifyDidOpen(fileUri, text, 1);
+        // без диагностики к сроку меряем как есть: сервер может не присылать ее для чистого файла
+        QTimer::singleShot(parser.value(warmupOption).toInt(), &app, startMeasuring);
+    });
+    QObject::connect(&manager, &LspManager::replyHandled, &app, [&](const QString& method, qint64 gui, qint64 decode) {
+        if (method == QLatin1String("textDocument/publishDiagnostics")) {
+            diagnosticsGuiNs.append(gui);
+            diagnosticsDecodeNs.append(decode);
+            startMeasuring(); // файл разобран, ответы пойдут по готовому AST
+            return;
+        }
+        if (!measuring) return;
+        roundTripNs.append(clock.nsecsElapsed() - sentNs);
+        guiNs.append(gui);
+        decodeNs.append(decode);
+        QTimer::singleShot(0, &app, sendNext); // следующий запрос после возврата из обработчика ответа
+    });
+    QObject::connect(&manager, &LspManager::completionReceived, &app, [&](const QList<LspCompletionItem>& items) {
+        lastResultSize = int(items.size());
+    });
+    QObject::connect(&manager, &LspManager::hoverReceived, &app, [&](const LspHoverInfo& info) {
+        lastResultSize = int(info.contents.size());
+    });
+    QObject::connect(&manager, &LspManager::serverError, &app, [&](const QString& message) {
+        qCritical().noquote() << message;
+        QCoreApplication::exit(1);
+    });
+
+    if (!manager.startServer(QStringLiteral("cpp"), fileInfo.absolutePath())) {
+        return 1;
+    }
+    // ответ с ошибкой не приходит в replyHandled, поэтому прогон не может ждать вечно
+    QTimer::singleShot(parser.value(timeoutOption).toInt() * 1000, &app, [&]() {
+        qWarning() << "Прогон не уложился в" << parser.value(timeoutOption) << "с, отчет по уже полученным ответам";
+        finish(1);
+    });
+    return app.exec();
+}
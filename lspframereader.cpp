@@ -0,0 +1,120 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "lspframereader.h"
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+constexpr char kContentLength[] = "Content-Length:";
+constexpr qsizetype kContentLengthSize = sizeof(kContentLength) - 1;
+constexpr qsizetype kMaxBodyLength = qsizetype(1) << 30; // больше - точно мусор, а не ответ сервера
+
+// значение Content-Length из заголовка [begin, end) или -1; имя поля без учета регистра, как в HTTP
+qsizetype parseContentLength(const char *begin, const char *end)
+{
+    const char *line = begin;
+    while (line < end) {
+        const char *lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!lineEnd) lineEnd = end;
+        if (lineEnd - line > kContentLengthSize && qstrnicmp(line, kContentLength, kContentLengthSize) == 0) {
+            const char *p = line + kContentLengthSize;
+            while (p < lineEnd && (*p == ' ' || *p == '\t')) ++p;
+            qsizetype value = 0;
+            bool hasDigits = false;
+            while (p < lineEnd && *p >= '0' && *p <= '9') {
+                value = value * 10 + (*p - '0');
+                if (value > kMaxBodyLength) return -1;
+                hasDigits = true;
+                ++p;
+            }
+            while (p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+            return hasDigits && p == lineEnd ? value : -1;
+        }
+        line = lineEnd + 1;
+    }
+    return -1;
+}
+
+} // namespace
+
+char *LspFrameReader::prepareWrite(qsizetype maxBytes)
+{
+    compact();
+    const qsizetype oldSize = m_data.size();
+    const qsizetype needed = oldSize + maxBytes;
+    if (needed > m_data.capacity()) {
+        m_data.reserve(qMax(needed, m_data.capacity() * 2)); // рост вдвое, чтобы большое сообщение не переезжало на каждом куске
+    }
+    m_data.resize(needed);
+    m_pendingWrite = maxBytes;
+    return m_data.data() + oldSize;
+}
+
+void LspFrameReader::commitWrite(qsizetype written)
+{
+    m_data.resize(m_data.size() - m_pendingWrite + qBound<qsizetype>(0, written, m_pendingWrite));
+    m_pendingWrite = 0;
+}
+
+void LspFrameReader::append(QByteArrayView data)
+{
+    if (data.isEmpty()) return;
+    std::memcpy(prepareWrite(data.size()), data.data(), data.size());
+    commitWrite(data.size());
+}
+
+bool LspFrameReader::next(QByteArrayView& body)
+{
+    while (true) {
+        if (m_bodyLength < 0) {
+            // конец заголовка ищем только в новых данных, с запасом на "\r\n\r\n", разрезанный между кусками
+            const qsizetype headerEnd = m_data.indexOf("\r\n\r\n", qMax(m_scanPos, m_readPos));
+            if (headerEnd < 0) {
+                m_scanPos = qMax(m_readPos, m_data.size() - 3);
+                return false;
+            }
+            const qsizetype length = parseContentLength(m_data.constData() + m_readPos, m_data.constData() + headerEnd);
+            m_readPos = headerEnd + 4;
+            m_scanPos = m_readPos;
+            if (length <= 0) {
+                // не знаем сколько байт читать для джсон и пропускаем битое соо до конца заголовка
+                qWarning() << "LSP < Неверный или отсутствующий Content-Length";
+                ++m_skippedHeaders;
+                continue;
+            }
+            m_bodyLength = length;
+        }
+
+        if (m_data.size() - m_readPos < m_bodyLength) {
+            return false; // ждем следующих данных, чтобы сообщение было полным
+        }
+        body = QByteArrayView(m_data.constData() + m_readPos, m_bodyLength);
+        m_readPos += m_bodyLength;
+        m_scanPos = m_readPos;
+        m_bodyLength = -1;
+        ++m_messages;
+        return true;
+    }
+}
+
+void LspFrameReader::clear()
+{
+    m_data.clear();
+    m_readPos = 0;
+    m_scanPos = 0;
+    m_bodyLength = -1;
+    m_pendingWrite = 0;
+}
+
+void LspFrameReader::compact()
+{
+    if (m_readPos == 0) return;
+    // остается только недочитанный хвост: обычно часть одного сообщения, а не весь прочитанный поток
+    m_bytesMoved += m_data.size() - m_readPos;
+    m_data.remove(0, m_readPos); // на месте, емкость буфера сохраняется
+    m_scanPos -= m_readPos;
+    m_readPos = 0;
+}
@@ -0,0 +1,49 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef LSPFRAMEREADER_H
+#define LSPFRAMEREADER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+// выделение сообщений JSON-RPC из потока stdout LSP-сервера по заголовкам Content-Length
+// один буфер с курсором чтения: прочитанное не вырезается после каждого сообщения, а сдвигается
+// в начало одним memmove только перед следующей записью, поэтому пачка из сотен сообщений в одном чтении
+// копируется один раз, а не по разу на каждое сообщение. заголовки разбираются на месте, без split и left
+class LspFrameReader
+{
+public:
+    // место под maxBytes байт в конце буфера, например для QIODevice::read(data, maxBytes);
+    // после записи обязательно commitWrite с числом реально записанных байт
+    char *prepareWrite(qsizetype maxBytes);
+    void commitWrite(qsizetype written);
+    void append(QByteArrayView data); // prepareWrite + копия + commitWrite
+
+    // следующее целое тело сообщения или false, если данных еще не хватает
+    // body смотрит прямо в буфер и действительно до следующего prepareWrite/append/clear
+    bool next(QByteArrayView& body);
+
+    void clear();
+    qsizetype bufferedBytes() const { return m_data.size() - m_readPos; } // еще не выданные байты
+
+    // счетчики для bam_lspbench --framing
+    qint64 messages() const { return m_messages; }
+    qint64 skippedHeaders() const { return m_skippedHeaders; } // заголовки без Content-Length
+    qint64 bytesMoved() const { return m_bytesMoved; } // сколько байт сдвинуто при уплотнении буфера
+
+private:
+    void compact();
+
+    QByteArray m_data; // размер - конец записанных данных, емкость не отдается между сообщениями
+    qsizetype m_readPos = 0; // начало первого невыданного сообщения
+    qsizetype m_scanPos = 0; // докуда уже искали конец заголовка, чтобы не искать заново по кускам
+    qsizetype m_bodyLength = -1; // длина тела текущего сообщения, если заголовок уже разобран
+    qsizetype m_pendingWrite = 0; // размер места, отданного prepareWrite
+    qint64 m_messages = 0;
+    qint64 m_skippedHeaders = 0;
+    qint64 m_bytesMoved = 0;
+};
+
+#endif // LSPFRAMEREADER_H
@@ -1,23 +1,45 @@
 #include "lspmanager.h"
 #include <QDebug>
-#include <QJsonParseError>
 #include <QUrl> // для работы с URI, чтобы преобразовать путь файла в формате file:///...
 #include <QFileInfo>
 #include <QCoreApplication> // чтобы получать ID нашего приложения для инициализации нужен
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QTextBlock>
+#include <utility>
 
 LspManager::LspManager(QString serverExecutablePath, QObject *parent)
     : QObject(parent)
     , m_serverExecutablePath(serverExecutablePath)
 {
-
+    // правки копятся, пока пользователь печатает, и уходят одним didChange после паузы
+    m_syncTimer = new QTimer(this);
+    m_syncTimer->setSingleShot(true);
+    m_syncTimer->setInterval(150);
+    connect(m_syncTimer, &QTimer::timeout, this, [this]() { flushPending(false); });
+    m_syncClock.start();
+
+    // зависшие запросы снимаются по таймауту, таймер работает, только пока есть ожидающие
+    m_requestTimer = new QTimer(this);
+    m_requestTimer->setInterval(1000);
+    connect(m_requestTimer, &QTimer::timeout, this, &LspManager::checkRequestTimeouts);
+
+    // процесс сервера, разбор JSON и сборка результатов - в потоке транспорта, сюда приходят готовые структуры
+    m_transport = new LspTransport(this);
+    connect(m_transport, &LspTransport::started, this, &LspManager::onServerProcessStarted);
+    connect(m_transport, &LspTransport::finished, this, &LspManager::onProcessFinished);
+    connect(m_transport, &LspTransport::errorOccurred, this, &LspManager::onProcessError);
+    connect(m_transport, &LspTransport::initializeReceived, this, &LspManager::handleInitializeResult);
+    connect(m_transport, &LspTransport::diagnosticsReceived, this, &LspManager::handlePublishDiagnostics);
+    connect(m_transport, &LspTransport::completionReceived, this, &LspManager::handleCompletionResult);
+    connect(m_transport, &LspTransport::hoverReceived, this, &LspManager::handleHoverResult);
+    connect(m_transport, &LspTransport::definitionReceived, this, &LspManager::handleDefinitionResult);
+    connect(m_transport, &LspTransport::requestFailed, this, &LspManager::handleRequestFailed);
 }
 
 LspManager::~LspManager()
 {
-    stopServer();
+    stopServer(); // транспорт дождется завершения процесса при удалении
 }
 
 // !!! инициализация и управление процессом !!!
@@ -26,7 +48,7 @@ LspManager::~LspManager()
 bool LspManager::startServer(const QString& languageId, const QString& projectRootPath, const QStringList& arguments)
 {
     // проверка а не запущен ли сервер
-    if (m_lspProcess && m_lspProcess->state() != QProcess::NotRunning) {
+    if (m_transport->isRunning()) {
         qWarning() << "LSP сервер уже запущен";
         return false; // запустить не удалось, так как уже запущен
     }
@@ -41,26 +63,8 @@ bool LspManager::startServer(const QString& languageId, const QString& projectRo
     m_rootUri = QUrl::fromLocalFile(projectRootPath).toString(); // конвектируем формат пути из "/home/user/project" в "file:///home/user/project", который требует ЛСП
 
     qInfo() << "Запускаем LSP сервер:" << m_serverExecutablePath << "для проекта" << m_rootUri << "с аргументами:" << arguments;
-
-    if (!m_lspProcess) {
-        m_lspProcess = new QProcess(this); // создаем объект, который будет управлять внешним процессом, удаляется вместе с родителем, то есть с LspManager
-
-        connect(m_lspProcess, &QProcess::started, this, &LspManager::onServerProcessStarted);
-        // настройках уведов, когда процесс напишет в stdout, то вызываем функцию
-        connect(m_lspProcess, &QProcess::readyReadStandardOutput, this, &LspManager::onReadyReadStandardOutput);
-        connect(m_lspProcess, &QProcess::readyReadStandardError, this, &LspManager::onReadyReadStandardError);
-        connect(m_lspProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &LspManager::onProcessFinished);
-        connect(m_lspProcess, &QProcess::errorOccurred, this, &LspManager::onProcessError); // ошибки при запуске или работе
-    }
-
-    m_lspProcess->setProgram(m_serverExecutablePath); // устанавливаем программу
-    if (!arguments.isEmpty()) {
-        m_lspProcess->setArguments(arguments);
-    } else {
-        m_lspProcess->setArguments({});
-    }
     // запускаем процесс и qt найдет m_serverExecutable с системных путях в PATH
-    m_lspProcess->start();
+    m_transport->start(m_serverExecutablePath, arguments);
 
     return true; // команда на запуск принята, просто принята
 }
@@ -69,6 +73,11 @@ void LspManager::onServerProcessStarted()
 {
     qInfo() << "Процесс LSP сервера запущен";
     m_isServerReady = false; // сервер запущен, но не готов к работе, соединение не установлено с клиентом
+    m_textDocumentSync = SyncFull; // до ответа на initialize считаем, что сервер понимает только полный текст
+    m_pendingSync.clear();
+    m_documentVersions.clear();
+    m_requests.clear();
+    m_requestTimer->stop();
 
     // !!! отправляем запрос с инициализацией, чтобы серверу сообщить, что подключился клиент !!!
     QJsonObject params;
@@ -82,7 +91,7 @@ void LspManager::onServerProcessStarted()
     capabilities["window"] = windowCap;
 
     QJsonObject textDocumentCap;
-    // синхра: сообщаем, что будем слать полный текст при изменении (SyncKind.Full)
+    // синхра: способ (полный текст или диапазоны) выбирает сервер в ответе на initialize, textDocumentSync
     textDocumentCap["synchronization"] = QJsonObject {
         {"dynamicRegistration", false}, // пока что нет поддержки динамической регистрации
         {"willSave", false}, // не уведомляем перед сохранением
@@ -121,46 +130,15 @@ void LspManager::onServerProcessStarted()
 
 void LspManager::stopServer()
 {
-    // проверяем что процесс есть и что он работает
-    if (m_lspProcess && m_lspProcess->state() != QProcess::NotRunning) {
-        qInfo() << "Останавливаем LSP сервер...";
-        m_isServerReady = false; // сервер больше не готов
-        m_pendingRequests.clear(); // очищаем незавершенные запросы
-
-        // !!! отправляем shutdown и exit !!!
-        // вежливо просим чтобы сервер завершил работу
-        QJsonObject shutdownMsg;
-        shutdownMsg["jsonrpc"] = "2.0";
-        shutdownMsg["id"] = ++m_requestId; // новый айдишник запроса
-        shutdownMsg["method"] = "shutdown";
-        sendMessage(shutdownMsg);
-        qDebug() << "LSP > Отправлен запрос на shutdown, ID:" << m_requestId; // -------------------TODO в идеале нужно дождаться ответа на это, преждем чем отправлть exit
-
-        // уведомление, чтобы сервер точно завершился
-        // QJsonObject exitMsg;
-        // exitMsg["jsonrpc"] = "2.0";
-        // exitMsg["method"] = "exit";
-        // sendMessage(exitMsg);
-        // qDebug() << "LSP ОТправлено уведомление exit";
-
-        // даем серверу немного времени, чтобы завершиться позже, так как асинхронный шаг
-        if (!m_lspProcess->waitForFinished(5000)) {
-            qWarning() << "LSP сервер не завершился сам, пытаемся терминировать";
-            // просим OC принудитеьно его остановить
-            m_lspProcess->terminate();
-            if (!m_lspProcess->waitForFinished(1000)) {
-                qWarning() << "LSP сервер не терминировался, убиваем";
-                // крайняя мера
-                m_lspProcess->kill();
-            }
-        } else {
-            qInfo() << "LSP сервер остановлен";
-        }
-    }
-    // освобождаем память
-    if (m_lspProcess) {
-        m_lspProcess = nullptr;
-    }
+    if (!m_transport->isRunning()) return;
+    qInfo() << "Останавливаем LSP сервер...";
+    m_isServerReady = false; // сервер больше не готов
+    m_pendingSync.clear(); // новый текст после остановки уже не нужен
+    m_syncTimer->stop();
+    m_requests.clear(); // ответов уже не будет
+    m_requestTimer->stop();
+    // shutdown, exit и ожидание процесса идут в потоке транспорта, интерфейс не ждет
+    m_transport->stop(++m_requestId);
 }
 
 // проверяем готов ли сервер
@@ -168,256 +146,59 @@ bool LspManager::isReady() const {
     return m_isServerReady;
 }
 
-// !!! авто обработчики событий от процесса !!!
-// когда сервер что то написал в stdout (прислал сообщение)
-void LspManager::onReadyReadStandardOutput()
-{
-    if (!m_lspProcess) return; // если процесса нет
-    // читаем ВСЕ данные от вывода сервера
-    QByteArray data = m_lspProcess->readAllStandardOutput();
-    // отправляем данные в функцию разбора сообщений
-    processIncomingData(data);
-}
-
-// вызывается когда сервер написал в stderr сообщения об ошибке
-void LspManager::onReadyReadStandardError()
-{
-    if (!m_lspProcess) return;
-    QByteArray errorData = m_lspProcess->readAllStandardError();
-    qWarning() << "LSP stderr:" << QString::fromUtf8(errorData);
-    // ------- TODO можно клиенту послуать сигнал serverError
-}
-
 // когда процесс сервера завершился
 void LspManager::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
-    qInfo() << "Процесс LSP завершен. КОд выхода:" << exitCode << "Статус:" << exitStatus;
+    Q_UNUSED(exitCode);
+    Q_UNUSED(exitStatus);
     m_isServerReady = false; // сервер больше не готов
-    if (m_lspProcess) {
-        m_lspProcess->deleteLater(); // в очередь событий Qt, безопаснее чем просто delete
-        m_lspProcess = nullptr;
-    }
     emit serverStopped(); // посылаем клиенту сигнал об остановке
 }
 
 // если произошла ошибка с самим процессом (например не найден файл анализатора (clangd))
-void LspManager::onProcessError(QProcess::ProcessError error)
+void LspManager::onProcessError(const QString& message)
 {
-    qCritical() << "Ошибка процесса LSP:" << error << m_lspProcess->errorString();
     m_isServerReady = false;
-    // посылаем клиенту сигнал с описание ошибки процесс
-    if (m_lspProcess) {
-        emit serverError("Ошибка процесса LSP:" + m_lspProcess->errorString());
-        m_lspProcess->deleteLater();
-        m_lspProcess = nullptr;
-    } else
-        emit serverError("Ошибка процесса LSP: Неизвестная ошибка (процесс не существует)");
+    emit serverError(message); // посылаем клиенту сигнал с описание ошибки процесс
 }
 
-// !!! отправка и прием сообщений (JSON-RPC) !!!
+// !!! отправка сообщений (JSON-RPC) !!!
 void LspManager::sendMessage(const QJsonObject& message)
 {
-    if (!m_lspProcess || m_lspProcess->state() != QProcess::Running) {
-        qWarning() << "Не могу отправить сообщение, процесс LSP не запущен";
-        return;
-    }
-
-    // конвектируем джсон-объект в массив байт (текст)
-    QJsonDocument doc(message);
-    QByteArray jsonContent = doc.toJson(QJsonDocument::Compact); // без лишних пробелов и переносов строк
-
-    // формирование обязательного заголовка
-    QByteArray header;
-    header.append("Content-Length: ").append(QString::number(jsonContent.size()).toUtf8()).append("\r\n\r\n"); // текст заговлока? размер джсон в байтах,  обязательные символы конца заголовка, перевод строки и возврат каретки x2
-    //header.append(QString::number(jsonContent.size())); //
-    //header.append("\r\n\r\n"); //
-
-    // отправляем сначала заголовок, а потом само сообщение джсон в стандартный ввод процесса (stding)
-    m_lspProcess->write(header);
-    m_lspProcess->write(jsonContent);
-
-    // сохраняем айди и метод для запросов
-    if (message.contains("id") && message.contains("method")) {
-        qint64 id = message["id"].toVariant().toLongLong();
-        QString method = message["method"].toString();
-        if (id > 0 && !method.isEmpty()) { // убедимся что запрос валидный
-            m_pendingRequests.insert(id, method);
-            qDebug() << "LSP > Запрос поставлен в очередь ожидания: ID" << id << "Метод:" << method;
-        }
-    }
+    // сериализация и запись в stdin сервера - в потоке транспорта
+    m_transport->send(message);
 }
 
-// обрабатывает входящие данные из буфера
-void LspManager::processIncomingData(const QByteArray& data)
+// время потока GUI на ответ: от прихода готовой структуры до возврата из слотов редактора
+void LspManager::recordReply(const QString& method, const QElapsedTimer& guiTimer, qint64 decodeNs)
 {
-    // доюавляем только что прочитанные данные в конец буфера
-    m_buffer.append(data);
-
-    // запускаем цикл чтобы попытаться извлечь из буфера одно или несколько полных сообщений
-    while (true) {
-        // индекс конца заголовка ищем ("\r\n\r\n")
-        int headerEndIndex = m_buffer.indexOf("\r\n\r\n");
-        //если не нашли, то пришел неполный заголовок или его вообще нет и нужно следующих данных от сервера
-        if (headerEndIndex == -1) {
-            qDebug() << "LSP < Неполный заголовок, ждем данных";
-            break;
-        }
-
-        // заголовок найден и извлекаем его часть до "\r\n\r\n"
-        QByteArray headerPart = m_buffer.left(headerEndIndex);
-        int contentLength = -1; // записываем длину джсон содержимого, ищем строку с Content-Length, там длина
-        QList<QByteArray> headers = headerPart.split('\n'); // построчно разделяем заголовок
-        for (const QByteArray& headerLine : headers) {
-            if (headerLine.startsWith("Content-Length:")) {
-                // длину нашли, извлекаем, убираем пробелы и конвектируем в инт
-                contentLength = headerLine.mid(15).trimmed().toInt();
-                break;
-            }
-        }
-
-        // проверяем нашли ли конкретную длину
-        if (contentLength <= 0) {
-            qWarning() << "LSP < Неверный или отсутствующий Content-Length"; // не знаем сколько байт читать для джсон и пытаемся пропустить это битое соо, удаляя данные до конца заголовка + 4 символа ("\r\n\r\n")
-            m_buffer = m_buffer.mid(headerEndIndex + 4);
-            continue; // чтобы искать следующий заголовок цикл продолжается
-        }
-
-        // знаем длину соо и проверяем, достаточно ли данных в буфере
-        int totalMessageLength = headerEndIndex + 4 + contentLength; // общая длина соо
-        if (m_buffer.size() < totalMessageLength) {
-            // данных в буфере недостаточно, ждем следующих данных чтобы сообщение было полным
-            qDebug() << "LSP < Неполное тело сообщения, ждем... Нужно" << totalMessageLength << "есть" << m_buffer.size();
-            break;
-        }
-
-        // данных наконец достаточно, извлекает тело сообщения из буфера, начинается сразу после заголовка и иметь определнную длину
-        QByteArray jsonContent = m_buffer.mid(headerEndIndex + 4, contentLength);
-        // удаляем обработанное соо из начала буфера (заголовок + тело) и ещё оставляем не разобранные данные
-        m_buffer = m_buffer.mid(totalMessageLength);
-
-        // цикл начинается снова чтобы проверить, а нет ли ещё полного соо в буфере
-        parseMessage(jsonContent);
-    }
-
-    qDebug() << "LSP < Закончил обработку куска данных, остаток в буфере:" << m_buffer.size();
+    const qint64 guiNs = guiTimer.nsecsElapsed();
+    ++m_replyStats.replies;
+    m_replyStats.totalGuiNs += guiNs;
+    m_replyStats.maxGuiNs = qMax(m_replyStats.maxGuiNs, guiNs);
+    m_replyStats.totalDecodeNs += decodeNs;
+    m_replyStats.maxDecodeNs = qMax(m_replyStats.maxDecodeNs, decodeNs);
+    emit replyHandled(method, guiNs, decodeNs);
 }
 
-// разбираем одно джсон соо
-void LspManager::parseMessage(const QByteArray& jsonContent)
-{
-    QJsonParseError parseError; // если джсон некорректный, то записываем инфо об ошибке
-    QJsonDocument doc = QJsonDocument::fromJson(jsonContent, &parseError);
-
-    // проверяем не было ли ошибок при разборе
-    if (parseError.error != QJsonParseError::NoError) {
-        qWarning() << "LSP < Ошибка разбора JSON:" << parseError.errorString() << "в тексте:" << QString::fromUtf8(jsonContent);
-        return; // не можем разобрать и выходим
-    }
-
-    // json является объектом {...}, а не массивом [...] или просто числом или строкой
-    if (!doc.isObject()) {
-        qWarning() << "LSP < Полученный JSON не является объектом:" << QString::fromUtf8(jsonContent);
-        return; // выходим. не тот формат
-    }
-
-    QJsonObject message = doc.object(); // для удобного доступа к полям преобразуем
-    // определяем тип соо на наличие полей "id", "result", "error", "method" and etc
-    if (message.contains("id") && message.contains("result") || message.contains("error")) {
-        // это ответ на наш вопрос
-        qint64 id = message["id"].toVariant().toLongLong();
-        if (!m_pendingRequests.contains(id)) {
-            qWarning() << "LSP < Получен ответ на неизвсетный или уже обработанный запрос ID:" << id;
-        }
-        QString method = m_pendingRequests.take(id); // полуаем метод и сразу удаляем из словаря
-        if (message.contains("result")) {
-            // поле результата может быть любым объектом, массивом или другим типом
-            QJsonValue resultValue = message["result"];
-
-            if (method == "initialize") {
-                handleInitializeResult(resultValue.toObject());
-            } else if (method == "textDocument/completion") {
-                // рез может быть массивом или объектом
-                if (resultValue.isObject()) {
-                    handleCompletionResult(resultValue.toObject());
-                } else if (resultValue.isArray()) {
-                    handleCompletionResult(QJsonObject{{ "items", resultValue }}); // обернем массив в объект для единообразия
-                } else if (resultValue.isNull()) {
-                    handleCompletionResult({});
-                } else {
-                    qWarning() << "LSP < неожиданный тип результата для completion: " << resultValue.type();
-                }
-            } else if (method == "textDocument/definition") {
-                // definition может вернуть просто Location, LOcation[] or Null
-                handleDefinitionResult(resultValue.toObject());
-            } else if (method == "textDocument/hover") {
-                handleHoverResult(resultValue.isObject() ? resultValue.toObject() : QJsonObject());
-            } else if (method == "shutdown") {
-                // сервер подтвердил готовность к завершению
-                qInfo() << "LSP < Получен ответ на shutdown";
-                QJsonObject exitMsg;
-                exitMsg["jsonrpc"] = "2.0";
-                exitMsg["method"] = "exit";
-                sendMessage(exitMsg);
-            }
-        } else {
-            QJsonObject errorObj = message["error"].toObject();
-            int code = errorObj["code"].toInt();
-            QString errorMsg = errorObj["message"].toString();
-            qWarning() << "LSP < Ошибка в ответе на запрос ID" << id << "Код:" << code << "Сообщение:" << errorMsg;
-            // ----------TODO посылать сигнали клиенту что бы показать ошибка
-        }
-    } else if (message.contains("method")) {
-        // уведомление или запрос от сервера Notification/Request
-        // уведомления не содеражт айди, а запросы от сервера к клиенту - содержат
-        QString method = message["method"].toString(); // имя метода, например textDocument/publishDiagnostics
-        QJsonObject params; // могу отсутствовать при некоторых уведомлениях
-        if (message.contains("params") && message["params"].isObject()) {
-            params = message["params"].toObject();
-        }
-        qDebug() << "LSP < Получено уведомление или запрос от сервера, метод" << method;
-
-        // обработчики в зависимости от метода
-        if (method == "textDocument/publishDiagnostics") {
-            // список ошибок и предупрждений
-            handlePublishDiagnostics(params);
-        } else if (method == "window/showMessage") {
-            // сервер просит нас показать пользователю какое-то соо
-            QJsonValue typeVal = params.value("type");
-            int msgType = typeVal.isDouble() ? typeVal.toInt(4) : 4; // 1: Error,  2: Wanr,  3: Info,  4: Log
-            QString text = params["message"].toString();
-            if (msgType == 1) {
-                qCritical() << "LSP Message (Error):" << text;
-            } else if (msgType == 2) {
-                qWarning() << "LSP Message (Warn):" << text;
-            } else if (msgType == 3) {
-                qInfo() << "LSP Message (Info):" << text;
-            } else {
-                qDebug() << "LSP Message (Log):" << text;
-            }
-            // ------------- TODO можно показать это соо в статус баре или диалогово мокне
-        } else if (method == "client/registerCapability") {
-            // сервер динамически просит включить какую-то функцию, пока что ИГНОР
-            qDebug() << "LSP < Получен client/registerCapability (игнорируется)";
-        } else if (method == "$/progress") {
-            // сервер сообщает о прогрессе долгой операции (например индексация), пока что ИГНОР
-            qDebug() << "LSP < получен $/progress (игнорируется)";
-        } else if (method == "window/logMessage") {
-            // похоже на showMessage но для логов.
-            qDebug() << "LSP Log:" << params["message"].toString();
-        }
-    } else {
-        // тип соо не определен
-        qWarning() << "LSP < Неизвесный тип сообщения:" << message;
-    }
-}
-
-// !!! обработчики ответов и уведомлений !!!
+// !!! обработчики ответов и уведомлений, уже разобранных транспортом !!!
 
 // когда сервер успешно ответил на запрос инициализации
-void LspManager::handleInitializeResult(const QJsonObject& result)
+void LspManager::handleInitializeResult(const QJsonObject& result, qint64 decodeNs)
 {
+    Q_UNUSED(decodeNs);
     qInfo() << "LSP < Получен ответ на Initialize";
     // ---------- TODO добавить вывод возможностей сервера, они содержатся в capabilities, чтобы в дальнейшем знать, какие запросы можно отправлять
+    // textDocumentSync бывает числом TextDocumentSyncKind или объектом с полем change
+    const QJsonValue sync = result["capabilities"].toObject()["textDocumentSync"];
+    if (sync.isObject()) {
+        m_textDocumentSync = sync.toObject()["change"].toInt(SyncNone);
+    } else if (sync.isDouble()) {
+        m_textDocumentSync = sync.toInt();
+    } else {
+        m_textDocumentSync = SyncNone;
+    }
+    qInfo() << "LSP < Синхронизация текста:" << (supportsIncrementalSync() ? "диапазонами" : "полным текстом");
     // отправляем уведомление 'initialized', чтобы сервер понял, что клиент получил иформацию и он готов к работе
     QJsonObject initializedParams;
     QJsonObject initializedMsg;
@@ -433,213 +214,60 @@ void LspManager::handleInitializeResult(const QJsonObject& result)
     emit serverReady(); // посылаем сигнал клиенту, что можно общаться
 }
 
-// когда сервер присылает уведомление 'textDocument/publishDiagnostics'
-void LspManager::handlePublishDiagnostics(const QJsonObject& params)
+// уведомление 'textDocument/publishDiagnostics'
+void LspManager::handlePublishDiagnostics(const QString& fileUri, const QList<LspDiagnostic>& diagnostics, qint64 decodeNs)
 {
-    // извлекаем URI к которому относится диагностика
-    QString fileUri = params["uri"].toString();
-    // ЛОГ: посмотрим на весь объект params, который пришел для этого URI
-    qDebug() << "[LSP_MANAGER_DEBUG] Raw JSON 'params' for publishDiagnostics URI" << fileUri << ":" << QJsonDocument(params).toJson(QJsonDocument::Compact);
-    // проврека что даигностикс - массив
-    QJsonValue diagnosticsValue = params.value("diagnostics");
-    // ЛОГ: проверим, является ли поле 'diagnostics' массивом
-    qDebug() << "[LSP_MANAGER_DEBUG] Is 'diagnostics' an array?" << diagnosticsValue.isArray();
-    if (!diagnosticsValue.isArray()) {
-        qWarning() << "LSP < Поле diagnostics не является массивом в publishDiagnostics";
-        return;
-    }
-
-    // извлекаем массив джсон-объекто, которые описывают диагностии
-    QJsonArray diagsArray = params["diagnostics"].toArray();
-    // создаем список наших структур LspDiagnostic для хранения результата
-    QList<LspDiagnostic> diagnosticsList;
-
-    // проходимя по каждому элементу массива диагностики от сервера
-    for (const QJsonValue& val : diagsArray) {
-        if (!val.isObject()) {
-            qWarning() << "[LSP_MANAGER_WARNING] Element in 'diagnostics' array is not an object:" << val;
-            continue; //пропуска не-объекты
-        }
-        QJsonObject diagObj = val.toObject();
-        qDebug() << "[LSP_MANAGER_DEBUG] Parsing diag object:" << QJsonDocument(diagObj).toJson(QJsonDocument::Compact);
-        // проверяем наличие вложенных объектов
-        QJsonValue rangeVal = diagObj.value("range");
-        if (!rangeVal.isObject()) {
-            qWarning() << "[LSP_MANAGER_WARNING] 'range' field is missing or not an object in diagnostic:" << QJsonDocument(diagObj).toJson(QJsonDocument::Compact);
-            continue;
-        }
-        QJsonObject range = rangeVal.toObject(); // где находится проблема
-        QJsonValue startVal = range.value("start");
-        QJsonValue endVal = range.value("end");
-        if (!startVal.isObject() || !endVal.isObject()) {
-            qWarning() << "[LSP_MANAGER_WARNING] 'start' or 'end' field is missing or not an object in range:" << QJsonDocument(range).toJson(QJsonDocument::Compact);
-            continue;
-        }
-        QJsonObject start = range["start"].toObject(); // начало диапозона
-        QJsonObject end = range["end"].toObject(); // конец диапозона
-
-        // создаем структуру LspDiagnostic и заполняем данными из джсон
-        LspDiagnostic diag;
-        diag.message = diagObj.value("message").toString(); // текст ошибки
-        QJsonValue severityVal = diagObj.value("severity");
-        diag.severity = severityVal.isDouble() ? severityVal.toInt(3) : 3; // серьезность может отсутствовать, по умолчанию Info (3)
-
-        QJsonValue startLineVal = start.value("line");
-        QJsonValue startCharVal = start.value("character");
-        QJsonValue endLineVal = end.value("line");
-        QJsonValue endCharVal = end.value("character");
-
-        if(!startLineVal.isDouble() || !startCharVal.isDouble() || !endLineVal.isDouble() || !endCharVal.isDouble()) {
-            qWarning() << "LSP < Некорректные координаты в диагностике";
-            continue;
-        }
-
-        diag.startLine = startLineVal.toInt(); // строка начала
-        diag.startChar = startCharVal.toInt(); // символ начала
-        diag.endLine = endLineVal.toInt(); // строка конца
-        diag.endChar = endCharVal.toInt(); // символ конца
-
-        // добавляем заполненную карточку
-        diagnosticsList.append(diag);
-    }
-
-    qDebug() << "LSP < получены диагностики для" << fileUri << ":" << diagnosticsList.size() << "шт";
+    QElapsedTimer guiTimer;
+    guiTimer.start();
+    qDebug() << "LSP < получены диагностики для" << fileUri << ":" << diagnostics.size() << "шт";
     // посылаем клиенту, передавая uri файла и список найденных проблем
-    emit diagnosticsReceived(fileUri, diagnosticsList);
-}
-
-// когда сервер отвечает на наш запрос автодополнения
-void LspManager::handleCompletionResult(const QJsonValue& resultValue) {
-    QList<LspCompletionItem> completionList;
-    QJsonArray itemsArray; // сюда массив подсказок из ответа сервера
-
-    // сервер может вернуть результаты в разных форматах:
-    // 1. Обхект, содержащий поле items (массив)
-    // 2. Просто массив подсказок
-    if (resultValue.isObject()) {
-        QJsonObject resultObj = resultValue.toObject();
-        // некоторые сервера созвращают CompletionList объхект
-        if (resultObj.contains("items") && resultObj["items"].isArray()) {
-            itemsArray = resultObj["items"].toArray();
-        } else if (!resultObj.isEmpty()) {
-            // возможно объект другой пришел
-            qWarning() << "LSP < Неожиданный тип ответа на completion (не объект, не массив, не null):" << resultValue.type();
-        }
-        // если объект, но не содержит items, itemsArray остается пустым
-    } else if (resultValue.isArray()) { // некоторые старые серверы могут возвращать просто массив
-        itemsArray = resultValue.toArray();
-    } else if (!resultValue.isNull()) { // может прийти просто пустой оюъект, если ещё нет подсказок
-        qWarning() << "LSP < Неожиданный тип ответа на completion (не объект, не массив, не null):" << resultValue.type();
-    }
-
-    // проходимся по каждому элементу массива подсказок от сервера
-    for (const QJsonValue& val : itemsArray) {
-        QJsonObject itemsObj = val.toObject();
-        LspCompletionItem item; // создаем структуру дял подсказки
-
-        // заполняем поля структуры из джсон-объкт подсказки
-        item.label = itemsObj["label"].toString(); // текст для списка
-        QJsonValue insertTextVal = itemsObj.value("insertText");
-        item.insertText = insertTextVal.isString() ? insertTextVal.toString() : item.label; // текст который фактически вставиться
-        item.detail = itemsObj.value("detail").toString(); // тип
-
-        // документация может быть строкой или объектом { kind: "markdown", value: "..." }
-        QJsonValue docVal = itemsObj["documentation"];
-        if (docVal.isString()) {
-            item.documentation = docVal.toString();
-        } else if (docVal.isObject()) {
-            item.documentation = docVal.toObject().value("value").toString();
-        }
-
-        item.kind = itemsObj.value("kind").toInt(); // тип (функция, класс)
+    emit diagnosticsReceived(fileUri, diagnostics);
+    recordReply("textDocument/publishDiagnostics", guiTimer, decodeNs);
+}
 
-        // добавляем готовую подсказку в наш список
-        completionList.append(item);
-    }
-    qDebug() << "LSP < Получено" << completionList.size() << "элементов автодопления";
+// ответ на наш запрос автодополнения
+void LspManager::handleCompletionResult(qint64 id, const QList<LspCompletionItem>& items, qint64 decodeNs)
+{
+    if (!acceptReply(id)) return;
+    QElapsedTimer guiTimer;
+    guiTimer.start();
+    qDebug() << "LSP < Получено" << items.size() << "элементов автодопления";
     // посылаем сигнал клиенту со списком готовых подсказок
-    emit completionReceived(completionList);
+    emit completionReceived(items);
+    recordReply("textDocument/completion", guiTimer, decodeNs);
 }
 
-// когда сервер отвечает на наш запрос со всплывашкой (hover)
-void LspManager::handleHoverResult(const QJsonObject& result)
+// ответ на наш запрос со всплывашкой (hover), пустой info - чтобы ui мог скрыть старую подсказку
+void LspManager::handleHoverResult(qint64 id, const LspHoverInfo& hoverInfo, qint64 decodeNs)
 {
-    LspHoverInfo info;
-
-    // ответ на запрос может быть пустым (null/{}), если сервер не наше инфу
-    if (result.isEmpty() || result.value("contents").isNull()) {
-        qDebug() << "LSP < Получен пустой ответ на hover";
-        emit hoverReceived(info); // чтобы ui мог скрыть старую подсказку
-        return;
-    }
-
-    QJsonValue contentsVal = result["contents"];
-    if (contentsVal.isString()) {
-        // когда просто строка
-        info.contents = contentsVal.toString();
-    } else if (contentsVal.isObject() && contentsVal.toObject().contains("value")) {
-        // объект MarkupContent (предпочтительный), содержит тип разметки и текст
-        info.contents = contentsVal.toObject()["value"].toString();
-    } else if (contentsVal.isArray()) {
-        // массив строк или объектов MarkedString (старый формат)
-        QStringList parts; // собираем все части в список строк
-        for (const QJsonValue& partVal : contentsVal.toArray()) {
-            if (partVal.isString()) {
-                parts << partVal.toString();
-            } else if (partVal.isObject() && partVal.toObject().contains("value")) { // может быть { language: 'cpp', value: 'int foo()' }
-                parts << partVal.toObject()["value"].toString();
-            }
-        }
-        // соединяем все части и разделяем их
-        info.contents = parts.join("\n---\n");
-    } else {
-        qWarning() << "LSP < Неизвестный формат поля contents в ответ на hover";
-        return; // не смогли разобрать и выходим
-    }
-
-    qDebug() << "LSP < Получена hover-информация";
-    // отправляем клиенту сигнал с готовой подсказкой
-    emit hoverReceived(info);
+    if (!acceptReply(id)) return;
+    QElapsedTimer guiTimer;
+    guiTimer.start();
+    emit hoverReceived(hoverInfo);
+    recordReply("textDocument/hover", guiTimer, decodeNs);
 }
 
-// когда сервер отвечает на переход к определению
-void LspManager::handleDefinitionResult(const QJsonObject& resultOrArray)
+// ответ на переход к определению
+void LspManager::handleDefinitionResult(qint64 id, const QList<LspDefinitionLocation>& locations, qint64 decodeNs)
 {
-    QList<LspDefinitionLocation> locations; // список мест определения
-
-    // парсинг одного объекта локации
-    auto parseLocation = [&](const QJsonObject& locObj) -> LspDefinitionLocation {
-        LspDefinitionLocation loc;
-        loc.fileUri = locObj["uri"].toString(); // путь к файлу
-        QJsonObject range = locObj["range"].toObject(); // диапозон в файле
-        // начало диапозона - строка и символ
-        loc.line = range["start"].toObject()["line"].toInt();
-        loc.character = range["start"].toObject()["character"].toInt();
-        return loc;
-    };
-
-    // провряем тип ответа от сервера
-    QJsonValue resultValue =  QJsonValue(resultOrArray);
-    if (resultValue.isNull()) {
-        // определение не найдено
-        qDebug() << "LSP < Получен null в ответе на definition";
-    } else if (resultValue.isArray()) {
-        // ответ на массив, может быть пустым {}
-        for (const QJsonValue& val : resultValue.toArray()) {
-            if (val.isObject()) { // каждый элемент должен быть объектом LOcation
-                locations.append(parseLocation(val.toObject())); // парсим и добавляем
-            }
-        }
-    } else if (resultValue.isObject()) {
-        // ответ - один объект Location (старый формат)
-        locations.append(parseLocation(resultValue.toObject()));
-    } else {
-        qWarning() << "LSP < Неизвсетный формат ответа на definition";
-    }
-
+    if (!acceptReply(id)) return;
+    QElapsedTimer guiTimer;
+    guiTimer.start();
     qDebug() << "LSP < Получено" << locations.size() << "мест определения";
     // посылаем клиенту список найденных мест (может быть пустым)
     emit definitionReceived(locations);
+    recordReply("textDocument/definition", guiTimer, decodeNs);
+}
+
+// ответ с ошибкой: запрос больше не ждет, иначе его снимет таймаут
+void LspManager::handleRequestFailed(qint64 id, int code, const QString& message)
+{
+    Q_UNUSED(code);
+    Q_UNUSED(message); // уже в логе транспорта
+    if (m_requests.remove(id)) {
+        ++m_requestStats.failed;
+        if (m_requests.isEmpty()) m_requestTimer->stop();
+    }
 }
 
 // !!! публичные методы для отправки запросов и уведомлений из MainWindow
@@ -655,6 +283,8 @@ void LspManager::notifyDidOpen(const QString& fileUri, const QString& text, int
     textDocument["text"] = text;
     QJsonObject params;
     params["textDocument"] = textDocument;
+    m_pendingSync.remove(fileUri); // все накопленное уже есть в этом тексте
+    m_documentVersions.insert(fileUri, version);
 
     // соо уведомление (без айди)
     QJsonObject message;
@@ -665,37 +295,147 @@ void LspManager::notifyDidOpen(const QString& fileUri, const QString& text, int
     qDebug() << "LSP > Отправлено didOpen для" << fileUri;
 }
 
-// уведомляем сервак, что файл был изменен
-void LspManager::notifyDidChange(const QString& fileUri, const QString& text, int version)
+// уведомляем сервак, что файл был изменен: весь текст заменен
+void LspManager::notifyDidChange(const QString& fileUri, const QString& text)
 {
     if (!m_isServerReady) return;
 
-    QJsonObject params;
-    QJsonObject textDocument;
-    textDocument["uri"] = fileUri;
-    textDocument["version"] = version;
-    params["textDocument"] = textDocument;
+    cancelRequestsAfterEdit(fileUri, -1, -1);
+    // полный текст перекрывает все, что накопилось раньше
+    PendingSync& pending = pendingFor(fileUri);
+    pending.full = true;
+    pending.text = text;
+    pending.fromDocument = false;
+    pending.changes = QJsonArray();
+}
+
+// одно изменение диапазоном: range в координатах текста ДО правки, text - что встало на его место
+void LspManager::notifyDidChange(const QString& fileUri, QTextDocument *doc, const EditDelta& delta)
+{
+    if (!m_isServerReady || !doc) return;
+
+    // начало: текст до position правка не трогала, поэтому строку и символ можно взять из документа после правки
+    const QTextBlock startBlock = doc->findBlock(delta.position);
+    const int startLine = startBlock.blockNumber();
+    const int startChar = delta.position - startBlock.position();
+    cancelRequestsAfterEdit(fileUri, startLine, startChar);
+
+    PendingSync& pending = pendingFor(fileUri);
+    if (pending.full && pending.fromDocument) {
+        return; // текст соберется из документа в момент отправки и уже включит эту правку
+    }
+    // конец диапазона считается по удаленному тексту из снимка; если снимок его не знает (правка вдали от курсора,
+    // Qt сообщил о всем документе сразу), безопаснее отправить текст целиком
+    if (!supportsIncrementalSync() || !delta.removedTextKnown) {
+        pending.full = true;
+        pending.text.clear();
+        pending.fromDocument = true;
+        pending.document = doc;
+        pending.changes = QJsonArray();
+        return;
+    }
+
+    // конец: по удаленному куску, в документе его уже нет; работа зависит только от длины правки
+    int endLine = startLine;
+    int endChar = startChar + delta.charsRemoved;
+    const qsizetype newlines = delta.removedText.count(QLatin1Char('\n'));
+    if (newlines > 0) {
+        endLine += int(newlines);
+        endChar = int(delta.removedText.size() - delta.removedText.lastIndexOf(QLatin1Char('\n')) - 1);
+    }
 
-    // сообщение об измнениях, отправляем ВЕСЬ новый текст файла целиком
-    // --------------TODO сделать диффиренцированное сохранения
-    QJsonArray changes; // массив изменений
+    // позиции LSP по умолчанию в UTF-16, как и индексы QString
+    QJsonObject range;
+    range["start"] = QJsonObject{{"line", startLine}, {"character", startChar}};
+    range["end"] = QJsonObject{{"line", endLine}, {"character", endChar}};
     QJsonObject changeEvent;
-    changeEvent["text"] = text;
-    changes.append(changeEvent);
-    params["contentChanges"] = changes; // добавляем массив изменений в параметры
+    changeEvent["range"] = range;
+    changeEvent["text"] = delta.insertedText;
+    // диапазоны применяются сервером по порядку, каждый к тексту после предыдущего
+    pending.changes.append(changeEvent);
+}
 
-    // собираем и отправляем уведомление
-    QJsonObject message;
-    message["jsonrpc"] = "2.0";
-    message["method"] = "textDocument/didChange";
-    message["params"] = params;
-    sendMessage(message);
+// запись накопленных изменений документа, каждая правка откладывает отправку еще на интервал таймера
+LspManager::PendingSync& LspManager::pendingFor(const QString& fileUri)
+{
+    PendingSync& pending = m_pendingSync[fileUri];
+    if (pending.edits++ == 0) {
+        pending.sinceMs = m_syncClock.elapsed();
+    }
+    ++m_syncStats.edits;
+    m_syncTimer->start();
+    return pending;
+}
+
+void LspManager::flushDocumentChanges()
+{
+    flushPending(false);
+}
+
+// отправляет накопленное: один didChange на документ с одной новой версией
+void LspManager::flushPending(bool beforeRequest)
+{
+    m_syncTimer->stop();
+    if (m_pendingSync.isEmpty()) return;
+    const QHash<QString, PendingSync> pendingSync = std::exchange(m_pendingSync, {});
+    if (!m_isServerReady) return;
+
+    const qint64 nowMs = m_syncClock.elapsed();
+    for (auto it = pendingSync.cbegin(); it != pendingSync.cend(); ++it) {
+        const QString& fileUri = it.key();
+        const PendingSync& pending = it.value();
+        QJsonArray changes;
+        if (pending.full) {
+            if (!pending.fromDocument) {
+                changes.append(QJsonObject{{"text", pending.text}});
+            } else if (pending.document) {
+                // сообщение об измнениях, отправляем ВЕСЬ новый текст файла целиком
+                changes.append(QJsonObject{{"text", pending.document->toPlainText()}});
+            }
+        }
+        for (const QJsonValue& change : pending.changes) {
+            changes.append(change);
+        }
+        if (changes.isEmpty()) continue; // документ уже удален
+
+        QJsonObject params;
+        params["textDocument"] = QJsonObject{{"uri", fileUri}, {"version", ++m_documentVersions[fileUri]}};
+        params["contentChanges"] = changes;
+
+        QJsonObject message;
+        message["jsonrpc"] = "2.0";
+        message["method"] = "textDocument/didChange";
+        message["params"] = params;
+        sendMessage(message);
+
+        const qint64 delayMs = nowMs - pending.sinceMs;
+        ++m_syncStats.flushes;
+        if (beforeRequest) ++m_syncStats.requestFlushes;
+        m_syncStats.totalDelayMs += delayMs;
+        m_syncStats.maxDelayMs = qMax(m_syncStats.maxDelayMs, delayMs);
+    }
+    emit documentSynced();
+}
+
+void LspManager::markDocumentStale(const QString& fileUri, QTextDocument *doc)
+{
+    if (!m_isServerReady || !doc || !m_documentVersions.contains(fileUri)) return; // сервер этот документ не открывал
+    // текст соберем в момент отправки, он включит и эти изменения, и все правки после них
+    PendingSync& pending = pendingFor(fileUri);
+    pending.full = true;
+    pending.text.clear();
+    pending.fromDocument = true;
+    pending.document = doc;
+    pending.changes = QJsonArray();
 }
 
 // уведомление что сервак закрыл
 void LspManager::notifyDidClose(const QString& fileUri)
 {
     if (!m_isServerReady) return;
+    m_pendingSync.remove(fileUri); // закрытому документу новый текст не нужен
+    cancelRequestsAfterEdit(fileUri, -1, -1);
+    m_documentVersions.remove(fileUri);
 
     QJsonObject params;
     QJsonObject textDocument;
@@ -714,64 +454,48 @@ void LspManager::notifyDidClose(const QString& fileUri)
 void LspManager::requestCompletion(const QString& fileUri, int line, int character, int triggerKind)
 {
     if (!m_isServerReady) return;
+    flushPending(true); // сервер должен ответить по тексту, который видит пользователь
 
     QJsonObject params;
-    QJsonObject textDocument;
-    textDocument["uri"] = fileUri;
-    params["textDocument"] = textDocument;
-    // позиция кусрора где запрошено автодопление (строка/символ)
-    QJsonObject position;
-    position["line"] = line;
-    position["character"] = character;
-    params["position"] = position;
     // контекста вызова (вручную или по символу)
     QJsonObject context;
     context["triggerKind"] = triggerKind;
     params["context"] = context;
-
-    QJsonObject message;
-    message["jsonrpc"] = "2.0";
-    message["id"] = ++m_requestId;
-    message["method"] = "textDocument/completion";
-    message["params"] = params;
-    sendMessage(message);
-    qDebug() << "LSP > Запрошено автодополнения для" << fileUri << "в" << line << ":" << character << "ID:" << m_requestId;
-    // -------- TODO дописать, чтобы принимался конкретный айдишник процесс для дальнейшего распознавания ответа
+    sendPositionRequest("textDocument/completion", fileUri, line, character, params);
 }
 
 // запрос всплывашки (подсказки-hover)
 void LspManager::requestHover(const QString& fileUri, int line, int character)
 {
     if (!m_isServerReady) return;
-
-    QJsonObject params;
-    QJsonObject textDocument;
-    textDocument["uri"] = fileUri;
-    params["textDocument"] = textDocument;
-    QJsonObject position;
-    position["line"] = line;
-    position["character"] = character;
-    params["position"] = position;
-
-    QJsonObject message;
-    message["jsonrpc"] = "2.0";
-    message["id"] = ++m_requestId;
-    message["method"] = "textDocument/hover";
-    message["params"] = params;
-    sendMessage(message);
-    qDebug() << "LSP > Запрошен hover для" << fileUri << "в" << line << ":" << character << "ID:" << m_requestId;
-    // --------- TODO сохранить ID и имя метода
+    flushPending(true); // сервер должен ответить по тексту, который видит пользователь
+    sendPositionRequest("textDocument/hover", fileUri, line, character, QJsonObject());
 }
 
 // запрос место определения символа
 void LspManager::requestDefinition(const QString& fileUri, int line, int character)
 {
     if (!m_isServerReady) return;
+    flushPending(true); // сервер должен ответить по тексту, который видит пользователь
+    sendPositionRequest("textDocument/definition", fileUri, line, character, QJsonObject());
+}
+
+void LspManager::sendPositionRequest(const QString& method, const QString& fileUri, int line, int character, QJsonObject params)
+{
+    // ответ на старый запрос того же вида уже не покажут: пусть сервер его не считает
+    QList<qint64> superseded;
+    for (auto it = m_requests.cbegin(); it != m_requests.cend(); ++it) {
+        if (it->method == method) superseded.append(it.key());
+    }
+    for (const qint64 id : std::as_const(superseded)) {
+        ++m_requestStats.superseded;
+        cancelRequest(id);
+    }
 
-    QJsonObject params;
     QJsonObject textDocument;
     textDocument["uri"] = fileUri;
     params["textDocument"] = textDocument;
+    // позиция кусрора где запрошено (строка/символ)
     QJsonObject position;
     position["line"] = line;
     position["character"] = character;
@@ -780,11 +504,97 @@ void LspManager::requestDefinition(const QString& fileUri, int line, int charact
     QJsonObject message;
     message["jsonrpc"] = "2.0";
     message["id"] = ++m_requestId;
-    message["method"] = "textDocument/definition";
+    message["method"] = method;
     message["params"] = params;
     sendMessage(message);
-    qDebug() << "LSP > Запрошен definition для" << fileUri << "в" << line << ":" << character << "ID:" << m_requestId;
-    // --------- TODO сохранить ID и имя метода
+    qDebug() << "LSP >" << method << "для" << fileUri << "в" << line << ":" << character << "ID:" << m_requestId;
+
+    PendingRequest request;
+    request.method = method;
+    request.fileUri = fileUri;
+    request.line = line;
+    request.character = character;
+    request.sentMs = m_syncClock.elapsed();
+    m_requests.insert(m_requestId, request);
+    ++m_requestStats.sent;
+    if (!m_requestTimer->isActive()) m_requestTimer->start();
+}
+
+void LspManager::cancelRequestsAfterEdit(const QString& fileUri, int line, int character)
+{
+    QList<qint64> stale;
+    for (auto it = m_requests.cbegin(); it != m_requests.cend(); ++it) {
+        if (it->fileUri != fileUri) continue;
+        // набор дальше по строке автодополнения: редактор отфильтрует пришедший список по введенному префиксу
+        const bool typingAhead = it->method == QLatin1String("textDocument/completion")
+                                 && line == it->line && character >= it->character;
+        if (!typingAhead) stale.append(it.key());
+    }
+    for (const qint64 id : std::as_const(stale)) {
+        ++m_requestStats.stale;
+        cancelRequest(id);
+    }
+}
+
+void LspManager::notifyCursorMoved(const QString& fileUri, int line, int character)
+{
+    QList<qint64> stale;
+    for (auto it = m_requests.cbegin(); it != m_requests.cend(); ++it) {
+        // курсор ушел со строки или левее места запроса: список покажется уже не там
+        if (it->method == QLatin1String("textDocument/completion")
+            && (it->fileUri != fileUri || line != it->line || character < it->character)) {
+            stale.append(it.key());
+        }
+    }
+    for (const qint64 id : std::as_const(stale)) {
+        ++m_requestStats.stale;
+        cancelRequest(id);
+    }
+}
+
+void LspManager::cancelRequest(qint64 id)
+{
+    m_requests.remove(id);
+    if (m_requests.isEmpty()) m_requestTimer->stop();
+    // $/cancelRequest и отброс ответа до разбора - в потоке транспорта
+    m_transport->cancel(id);
+}
+
+void LspManager::checkRequestTimeouts()
+{
+    const qint64 nowMs = m_syncClock.elapsed();
+    QList<qint64> expired;
+    for (auto it = m_requests.cbegin(); it != m_requests.cend(); ++it) {
+        if (nowMs - it->sentMs >= m_requestTimeoutMs) expired.append(it.key());
+    }
+    for (const qint64 id : std::as_const(expired)) {
+        qWarning() << "LSP < Нет ответа на" << m_requests.value(id).method << "ID:" << id << "за" << m_requestTimeoutMs << "мс, запрос отменен";
+        ++m_requestStats.timedOut;
+        cancelRequest(id);
+    }
+}
+
+bool LspManager::acceptReply(qint64 id)
+{
+    const auto it = m_requests.constFind(id);
+    if (it == m_requests.cend()) {
+        // запрос отменен, когда ответ уже был разобран и стоял в очереди к потоку GUI
+        return false;
+    }
+    const qint64 waitMs = m_syncClock.elapsed() - it->sentMs;
+    m_requests.erase(it);
+    if (m_requests.isEmpty()) m_requestTimer->stop();
+    ++m_requestStats.answered;
+    m_requestStats.totalWaitMs += waitMs;
+    m_requestStats.maxWaitMs = qMax(m_requestStats.maxWaitMs, waitMs);
+    return true;
+}
+
+LspRequestStats LspManager::requestStats() const
+{
+    LspRequestStats stats = m_requestStats;
+    stats.droppedBeforeDecode = m_transport->droppedReplies();
+    return stats;
 }
 
 // !!! конвектор позиций из QPlainTextEdit (одно число - номер символа) в LSP-формат (два числа - номер строки и номер символа в строке)
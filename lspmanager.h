@@ -2,40 +2,51 @@
 #define LSPMANAGER_H
 
 #include <QObject>
-#include <QProcess> // нужен для запуска и управления внешней программы, экспертами, такие как clangd
+#include <QProcess>
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QMap>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QHash>
 #include <QPoint>
 #include <QTextDocument>
 #include <QStringList>
-
-// !!! структуры ъранения данных !!!
-// описания ошибок или предупреждений в коде
-struct LspDiagnostic {
-    QString message; // сообещние об ошибке
-    int severity; // серьезность проблемы (1 - ошибка, 2- предупреждение!
-    int startLine, startChar, endLine, endChar; // где именно к оде (строке или символ начал и конца) находится проблема, координаты с нуля
-};
-
-// автодополнение
-struct LspCompletionItem {
-    QString label; // текст который пользователь увидит в списке подсказок, по типу calculateSum
-    QString insertText; // который фактически вставится calculateSum()
-    QString detail; // например тип переменной или возращаещей функции
-    QString documentation; // подробно описание, например за что отвечает функция
-    int kind; // тип элемента, функция, класс, переменная
+#include "editdelta.h"
+#include "lspmessages.h"
+#include "lsptransport.h"
+
+// счетчики отложенной синхронизации текста, видны в подсказке статуса LSP
+struct LspSyncStats {
+    qint64 edits = 0; // правок пришло из редактора
+    qint64 flushes = 0; // отправлено didChange
+    qint64 requestFlushes = 0; // из них досрочно, перед completion/hover/definition
+    qint64 totalDelayMs = 0; // сумма задержек от первой правки пачки до отправки
+    qint64 maxDelayMs = 0;
 };
 
-// информация во всплывашке
-struct LspHoverInfo {
-    QString contents; // текст который показать
+// время обработки ответов сервера: разбор в потоке транспорта и работа потока GUI (LspManager + слоты редактора)
+struct LspReplyStats {
+    qint64 replies = 0;
+    qint64 totalGuiNs = 0;
+    qint64 maxGuiNs = 0;
+    qint64 totalDecodeNs = 0;
+    qint64 maxDecodeNs = 0;
 };
 
-// место, где объявлена функция или переменная
-struct LspDefinitionLocation {
-    QString fileUri; // путь к файлы, где объявление, например "file:///home/user/project/myclass.h"
-    int line, character; // строка и символ в файле, где начинается объявление
+// запросы completion/hover/definition: сколько отменено, отброшено и не дождалось ответа
+struct LspRequestStats {
+    qint64 sent = 0;
+    qint64 answered = 0; // ответ дошел до редактора
+    qint64 superseded = 0; // отменены новым запросом того же вида
+    qint64 stale = 0; // отменены правкой документа или уходом курсора
+    qint64 timedOut = 0; // нет ответа за setRequestTimeout
+    qint64 failed = 0; // сервер ответил ошибкой
+    qint64 droppedBeforeDecode = 0; // ответы на отмененные запросы, которые транспорт отбросил до сборки структур
+    qint64 totalWaitMs = 0; // от отправки до ответа, по дошедшим ответам
+    qint64 maxWaitMs = 0;
 };
 
 class LspManager : public QObject
@@ -52,14 +63,35 @@ public:
     bool startServer(const QString& languageId, const QString& projectRootPath, const QStringList& arguments = QStringList());
     void stopServer();
     bool isReady() const; // проверка, готов ли сервер к общению, успешно ли прошла инициализация
+    bool supportsIncrementalSync() const { return m_textDocumentSync == SyncIncremental; } // сервер принимает правки диапазонами
+    // сколько ждать тишины после правки, прежде чем отправить накопленное одним didChange
+    void setSyncDelay(int ms) { m_syncTimer->setInterval(qMax(0, ms)); }
+    const LspSyncStats& syncStats() const { return m_syncStats; }
+    const LspReplyStats& replyStats() const { return m_replyStats; }
+    // сколько ждать ответа на completion/hover/definition, после этого запрос отменяется
+    void setRequestTimeout(int ms) { m_requestTimeoutMs = qMax(1, ms); }
+    LspRequestStats requestStats() const;
 
     // !!! метода для отправки соо серверу !!!
     // пользователь открыл файл и посылается данный сигнал серверу, ему передается путь файла, содермижоме и номер версии
     void notifyDidOpen(const QString& fileUri, const QString& text, int version = 1);
-    // текст в файле изменился, отправляется новая версия
-    void notifyDidChange(const QString& fileUri, const QString& text, int version);
+    // изменения не уходят сразу: копятся и отправляются одним didChange с одной новой версией
+    // после паузы в наборе (setSyncDelay) или перед запросом, которому нужен актуальный текст
+    // текст в файле заменен целиком
+    void notifyDidChange(const QString& fileUri, const QString& text);
+    // одно изменение из contentsChange сразу после правки doc: уходит диапазоном, если сервер поддерживает
+    // инкрементальную синхру и снимок знает удаленный текст, иначе - текстом целиком
+    void notifyDidChange(const QString& fileUri, QTextDocument *doc, const EditDelta& delta);
+    // отправить накопленные изменения сейчас
+    void flushDocumentChanges();
+    // документ менялся в обход notifyDidChange (чужие правки и снимки с заглушенными сигналами):
+    // полный текст doc уходит после той же паузы, что и обычные правки
+    void markDocumentStale(const QString& fileUri, QTextDocument *doc);
+    // курсор редактора встал в новую позицию (строка/символ LSP): автодополнение, запрошенное в другом месте, отменяется
+    void notifyCursorMoved(const QString& fileUri, int line, int character);
     // пользователь файл закрыл
     void notifyDidClose(const QString& fileUri);
+    // запросы ниже отменяют еще не отвеченный запрос того же вида ($/cancelRequest), ответ на отмененный запрос отбрасывается
     // пользователь с помощью сочетания клавиш запросил подсказки на данной позиции (строка/символ), targetKind - причина запроса (1 - вызвано вручную, 2 - ввод символа и тд)
     void requestCompletion(const QString& fileUri, int line, int character, int triggerKind = 1);
     // пользователь навел мышку на это место "что это такое?"
@@ -90,44 +122,85 @@ signals:
     void hoverReceived(const LspHoverInfo& hoverInfo);
     // список место где объявлен символ
     void definitionReceived(const QList<LspDefinitionLocation>& locations);
+    // отправлен очередной didChange, syncStats() обновились
+    void documentSynced();
+    // ответ обработан: guiNs - время в потоке GUI вместе со слотами получателей, decodeNs - разбор в потоке транспорта
+    void replyHandled(const QString& method, qint64 guiNs, qint64 decodeNs);
 
-    // функции автоматом будут вызываться от других обхектов от QProcess
+    // функции автоматом будут вызываться от LspTransport через очередь событий
 private slots:
-    // когда сервер написал в свой вывод (stdout), когда прислал ответ или уведомление
-    void onReadyReadStandardOutput();
-    // сервер в потом ошибок что то написал (stderr)
-    void onReadyReadStandardError();
     // сервак завершился сам или по команде
     void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
     // произошла ошибка при запуске или работе сервака
-    void onProcessError(QProcess::ProcessError error);
+    void onProcessError(const QString& message);
     void onServerProcessStarted();
 
+    // !!! обраотка конкретных уведов и ответов от сервера, уже разобранных в структуры !!!
+    void handleInitializeResult(const QJsonObject& result, qint64 decodeNs); // когда сервер ответил на запрос "initialize"
+    void handlePublishDiagnostics(const QString& fileUri, const QList<LspDiagnostic>& diagnostics, qint64 decodeNs); // список ошибок
+    void handleCompletionResult(qint64 id, const QList<LspCompletionItem>& items, qint64 decodeNs); // ответ на зпрос автодополнения
+    void handleHoverResult(qint64 id, const LspHoverInfo& hoverInfo, qint64 decodeNs); // ответ на hover-информацию
+    void handleDefinitionResult(qint64 id, const QList<LspDefinitionLocation>& locations, qint64 decodeNs); // ответ на переход к определению
+    void handleRequestFailed(qint64 id, int code, const QString& message); // сервер ответил ошибкой
+
     // внутренние детали сервака, скрытые от основнго приложения
 private:
-    QMap<qint64, QString> m_pendingRequests; // ID запроса - имя метода
-    QProcess *m_lspProcess = nullptr; // нулевой - процесс не запущен
+    LspTransport *m_transport = nullptr; // процесс сервера и JSON-RPC в отдельном потоке
     QString m_serverExecutablePath; // имя или полный путь к анализатору, например для cpp clangd "/usr/bin/clangd"
     QString m_languageId; // короткое имя языка, например cpp
     QString m_rootUri; // путь к корню проекта в формате URI, "file:///home/user/my_project", нужно для контекста
     bool m_isServerReady = false;
     qint64 m_requestId = 0; // счетки для айдишников, у каждого запроса свой айди, нужен для правильной идентификации и обработки ответов от сервака, потому что он присылает айдишник
-    QByteArray m_buffer; // буфер для данных с сервера, потому что данные могут приходить частями, поэтому надо их накапливать
+
+    // TextDocumentSyncKind из capabilities сервера
+    enum { SyncNone = 0, SyncFull = 1, SyncIncremental = 2 };
+    int m_textDocumentSync = SyncFull;
+
+    // изменения одного документа, которые еще не ушли серверу
+    struct PendingSync {
+        bool full = false; // первым идет полный текст
+        QString text; // полный текст, если он уже известен
+        bool fromDocument = false; // иначе текст берется из document в момент отправки и включает все правки после
+        QPointer<QTextDocument> document;
+        QJsonArray changes; // диапазоны после полного текста
+        int edits = 0;
+        qint64 sinceMs = 0; // когда пришла первая правка
+    };
+    QHash<QString, PendingSync> m_pendingSync;
+    QHash<QString, int> m_documentVersions; // последняя отправленная версия каждого документа
+    QTimer *m_syncTimer = nullptr;
+    QElapsedTimer m_syncClock;
+    LspSyncStats m_syncStats;
+    LspReplyStats m_replyStats;
+
+    // запрос completion/hover/definition, на который еще нет ответа
+    struct PendingRequest {
+        QString method;
+        QString fileUri;
+        int line = 0; // позиция запроса
+        int character = 0;
+        qint64 sentMs = 0; // по m_syncClock
+    };
+    QHash<qint64, PendingRequest> m_requests; // по ID запроса; единицы записей, по одной на вид
+    QTimer *m_requestTimer = nullptr; // проверка таймаутов, пока есть ожидающие запросы
+    int m_requestTimeoutMs = 10000;
+    LspRequestStats m_requestStats;
+
+    PendingSync& pendingFor(const QString& fileUri);
+    void flushPending(bool beforeRequest);
+    // отправка запроса по позиции: отменяет предыдущий того же вида и ставит новый в ожидание
+    void sendPositionRequest(const QString& method, const QString& fileUri, int line, int character, QJsonObject params);
+    // правка с началом в line/character (-1 - весь текст): ответы по старому тексту не нужны
+    // автодополнение переживает только набор дальше по той же строке, список фильтруется редактором по префиксу
+    void cancelRequestsAfterEdit(const QString& fileUri, int line, int character);
+    void cancelRequest(qint64 id);
+    void checkRequestTimeouts();
+    bool acceptReply(qint64 id); // false - запрос уже отменен, ответ опоздал
 
     // !!! внутренние вспомогательные методы !!!
     // отправка JSON на сервер
     void sendMessage(const QJsonObject& message);
-    // обработка куска данных от сервера
-    void processIncomingData(const QByteArray& data);
-    // разбор одного целого json и вызова соответствующего обработчика
-    void parseMessage(const QByteArray& jsonContent);
-
-    // !!! обраотка конкретных уведов и ответов от сервера !!!
-    void handleInitializeResult(const QJsonObject& result); // когда сервер ответил на запрос "initialize"
-    void handlePublishDiagnostics(const QJsonObject& params); // когда уведомление "publishDiagnostics", а именно список ошибок
-    void handleCompletionResult(const QJsonValue& result); // когда ответ на зпрос автодополнения
-    void handleHoverResult(const QJsonObject& result); // когда ответ на hover-информацию
-    void handleDefinitionResult(const QJsonObject& result); // кога ответ на запрос перехода к определению
+    void recordReply(const QString& method, const QElapsedTimer& guiTimer, qint64 decodeNs);
 };
 
 #endif
@@ -0,0 +1,42 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef LSPMESSAGES_H
+#define LSPMESSAGES_H
+
+#include <QList>
+#include <QString>
+
+// готовые результаты ответов LSP-сервера: собираются в потоке LspTransport,
+// в поток GUI приходят уже разобранными через сигналы в очереди событий
+
+// !!! структуры ъранения данных !!!
+// описания ошибок или предупреждений в коде
+struct LspDiagnostic {
+    QString message; // сообещние об ошибке
+    int severity; // серьезность проблемы (1 - ошибка, 2- предупреждение!
+    int startLine, startChar, endLine, endChar; // где именно к оде (строке или символ начал и конца) находится проблема, координаты с нуля
+};
+
+// автодополнение
+struct LspCompletionItem {
+    QString label; // текст который пользователь увидит в списке подсказок, по типу calculateSum
+    QString insertText; // который фактически вставится calculateSum()
+    QString detail; // например тип переменной или возращаещей функции
+    QString documentation; // подробно описание, например за что отвечает функция
+    int kind; // тип элемента, функция, класс, переменная
+};
+
+// информация во всплывашке
+struct LspHoverInfo {
+    QString contents; // текст который показать
+};
+
+// место, где объявлена функция или переменная
+struct LspDefinitionLocation {
+    QString fileUri; // путь к файлы, где объявление, например "file:///home/user/project/myclass.h"
+    int line, character; // строка и символ в файле, где начинается объявление
+};
+
+#endif // LSPMESSAGES_H
@@ -0,0 +1,516 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "lsptransport.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+
+LspTransport::LspTransport(QObject *parent)
+    : QObject(parent)
+{
+    m_thread.setObjectName("LspTransport");
+    m_worker = new LspTransportWorker(this);
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+
+    // сигналы из потока транспорта приходят в поток GUI через очередь событий
+    connect(m_worker, &LspTransportWorker::started, this, &LspTransport::started);
+    connect(m_worker, &LspTransportWorker::finished, this, &LspTransport::finished);
+    connect(m_worker, &LspTransportWorker::errorOccurred, this, &LspTransport::errorOccurred);
+    connect(m_worker, &LspTransportWorker::initializeReceived, this, &LspTransport::initializeReceived);
+    connect(m_worker, &LspTransportWorker::diagnosticsReceived, this, &LspTransport::diagnosticsReceived);
+    connect(m_worker, &LspTransportWorker::completionReceived, this, &LspTransport::completionReceived);
+    connect(m_worker, &LspTransportWorker::hoverReceived, this, &LspTransport::hoverReceived);
+    connect(m_worker, &LspTransportWorker::definitionReceived, this, &LspTransport::definitionReceived);
+    connect(m_worker, &LspTransportWorker::requestFailed, this, &LspTransport::requestFailed);
+    m_thread.start();
+}
+
+LspTransport::~LspTransport()
+{
+    LspTransportWorker *worker = m_worker;
+    // процесс сервера не должен пережить редактор; stop без запущенного процесса ничего не делает
+    QMetaObject::invokeMethod(worker, [worker]() { worker->stop(0); }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait(); // воркер с процессом удаляется при завершении потока
+}
+
+void LspTransport::start(const QString& program, const QStringList& arguments)
+{
+    const quint64 generation = ++m_lastGeneration;
+    m_runningGeneration.store(generation, std::memory_order_release);
+    LspTransportWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker, program, arguments, generation]() { worker->start(program, arguments, generation); }, Qt::QueuedConnection);
+}
+
+void LspTransport::stop(qint64 shutdownId)
+{
+    m_runningGeneration.store(0, std::memory_order_release);
+    LspTransportWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker, shutdownId]() { worker->stop(shutdownId); }, Qt::QueuedConnection);
+}
+
+void LspTransport::send(const QJsonObject& message)
+{
+    // порядок сообщений сохраняется: вызовы в один поток выполняются в порядке постановки
+    LspTransportWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker, message]() { worker->send(message); }, Qt::QueuedConnection);
+}
+
+void LspTransport::cancel(qint64 id)
+{
+    LspTransportWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker, id]() { worker->cancel(id); }, Qt::QueuedConnection);
+}
+
+LspTransportWorker::LspTransportWorker(LspTransport *transport)
+    : m_transport(transport)
+{
+}
+
+void LspTransportWorker::start(const QString& program, const QStringList& arguments, quint64 generation)
+{
+    if (m_process) {
+        qWarning() << "LSP сервер уже запущен";
+        return;
+    }
+    m_reader.clear();
+    m_pendingRequests.clear();
+    m_cancelledRequests.clear();
+    m_generation = generation;
+
+    // процесс создается в потоке транспорта, поэтому и его ввод-вывод идет здесь
+    m_process = new QProcess(this);
+    connect(m_process, &QProcess::started, this, &LspTransportWorker::started);
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &LspTransportWorker::onReadyReadStandardOutput);
+    connect(m_process, &QProcess::readyReadStandardError, this, &LspTransportWorker::onReadyReadStandardError);
+    connect(m_process, &QProcess::finished, this, &LspTransportWorker::onProcessFinished);
+    connect(m_process, &QProcess::errorOccurred, this, &LspTransportWorker::onProcessError);
+    m_process->setProgram(program);
+    m_process->setArguments(arguments);
+    m_process->start();
+}
+
+void LspTransportWorker::stop(qint64 shutdownId)
+{
+    if (!m_process || m_process->state() == QProcess::NotRunning) {
+        dropProcess();
+        return;
+    }
+    if (shutdownId > 0) {
+        // вежливо просим чтобы сервер завершил работу, на ответ уйдет exit (parseMessage)
+        QJsonObject shutdownMsg;
+        shutdownMsg["jsonrpc"] = "2.0";
+        shutdownMsg["id"] = shutdownId;
+        shutdownMsg["method"] = "shutdown";
+        send(shutdownMsg);
+        qDebug() << "LSP > Отправлен запрос на shutdown, ID:" << shutdownId;
+    }
+
+    // ожидание блокирует только поток транспорта; ответ на shutdown разбирается внутри waitForFinished
+    QProcess *process = m_process;
+    if (!process->waitForFinished(shutdownId > 0 ? 5000 : 0)) {
+        qWarning() << "LSP сервер не завершился сам, пытаемся терминировать";
+        // просим OC принудитеьно его остановить
+        process->terminate();
+        if (!process->waitForFinished(1000)) {
+            qWarning() << "LSP сервер не терминировался, убиваем";
+            // крайняя мера
+            process->kill();
+            process->waitForFinished(1000);
+        }
+    } else {
+        qInfo() << "LSP сервер остановлен";
+    }
+    dropProcess();
+}
+
+// !!! отправка и прием сообщений (JSON-RPC) !!!
+void LspTransportWorker::send(const QJsonObject& message)
+{
+    if (!m_process || m_process->state() != QProcess::Running) {
+        qWarning() << "Не могу отправить сообщение, процесс LSP не запущен";
+        return;
+    }
+
+    // конвектируем джсон-объект в массив байт (текст)
+    const QByteArray jsonContent = QJsonDocument(message).toJson(QJsonDocument::Compact); // без лишних пробелов и переносов строк
+
+    // формирование обязательного заголовка: размер джсон в байтах и обязательные символы конца заголовка
+    QByteArray header;
+    header.append("Content-Length: ").append(QByteArray::number(jsonContent.size())).append("\r\n\r\n");
+
+    // сохраняем айди и метод для запросов до записи, чтобы ответ точно нашел свой метод
+    if (message.contains("id") && message.contains("method")) {
+        qint64 id = message["id"].toVariant().toLongLong();
+        QString method = message["method"].toString();
+        if (id > 0 && !method.isEmpty()) { // убедимся что запрос валидный
+            m_pendingRequests.insert(id, method);
+            qDebug() << "LSP > Запрос поставлен в очередь ожидания: ID" << id << "Метод:" << method;
+        }
+    }
+
+    // отправляем сначала заголовок, а потом само сообщение джсон в стандартный ввод процесса (stdin)
+    m_process->write(header);
+    m_process->write(jsonContent);
+}
+
+void LspTransportWorker::cancel(qint64 id)
+{
+    // ответ уже разобран и ушел в поток GUI, там его и отбросят
+    if (!m_pendingRequests.remove(id)) return;
+    m_cancelledRequests.insert(id);
+
+    // сервер может бросить вычисление; ответ все равно придет, результатом или ошибкой RequestCancelled
+    QJsonObject cancelMsg;
+    cancelMsg["jsonrpc"] = "2.0";
+    cancelMsg["method"] = "$/cancelRequest";
+    cancelMsg["params"] = QJsonObject{{"id", id}};
+    send(cancelMsg);
+    qDebug() << "LSP > Отменен запрос ID:" << id;
+}
+
+// !!! авто обработчики событий от процесса !!!
+// когда сервер что то написал в stdout (прислал сообщение)
+void LspTransportWorker::onReadyReadStandardOutput()
+{
+    if (!m_process) return;
+    // читаем прямо в буфер разбора, без промежуточного QByteArray на каждое чтение
+    const qint64 available = m_process->bytesAvailable();
+    if (available > 0) {
+        char *data = m_reader.prepareWrite(available);
+        m_reader.commitWrite(m_process->read(data, available));
+    }
+    // в одном чтении может прийти сразу несколько сообщений, тела разбираются прямо из буфера
+    QByteArrayView body;
+    while (m_process && m_reader.next(body)) {
+        parseMessage(body);
+    }
+}
+
+// вызывается когда сервер написал в stderr сообщения об ошибке
+void LspTransportWorker::onReadyReadStandardError()
+{
+    if (!m_process) return;
+    qWarning() << "LSP stderr:" << QString::fromUtf8(m_process->readAllStandardError());
+}
+
+// когда процесс сервера завершился
+void LspTransportWorker::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    qInfo() << "Процесс LSP завершен. Код выхода:" << exitCode << "Статус:" << exitStatus;
+    dropProcess();
+    emit finished(exitCode, exitStatus);
+}
+
+// если произошла ошибка с самим процессом (например не найден файл анализатора (clangd))
+void LspTransportWorker::onProcessError(QProcess::ProcessError error)
+{
+    const QString errorString = m_process ? m_process->errorString() : QStringLiteral("процесс не существует");
+    qCritical() << "Ошибка процесса LSP:" << error << errorString;
+    dropProcess();
+    emit errorOccurred("Ошибка процесса LSP:" + errorString);
+}
+
+void LspTransportWorker::dropProcess()
+{
+    // если после этого процесса уже вызван новый start, его номер не трогаем
+    quint64 generation = m_generation;
+    m_transport->m_runningGeneration.compare_exchange_strong(generation, 0, std::memory_order_acq_rel);
+    if (!m_process) return;
+    m_process->disconnect(this); // после ошибки finished уже не нужен
+    m_process->deleteLater(); // в очередь событий Qt, безопаснее чем просто delete
+    m_process = nullptr;
+    m_reader.clear();
+    m_pendingRequests.clear();
+    m_cancelledRequests.clear();
+}
+
+// разбираем одно джсон соо и собираем результат
+void LspTransportWorker::parseMessage(QByteArrayView jsonContent)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QJsonParseError parseError; // если джсон некорректный, то записываем инфо об ошибке
+    // fromRawData не копирует тело: буфер не меняется, пока идет разбор
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromRawData(jsonContent.data(), jsonContent.size()), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        qWarning() << "LSP < Ошибка разбора JSON:" << parseError.errorString() << "в тексте:" << QString::fromUtf8(jsonContent.first(qMin<qsizetype>(200, jsonContent.size())));
+        return;
+    }
+    // json является объектом {...}, а не массивом [...] или просто числом или строкой
+    if (!doc.isObject()) {
+        qWarning() << "LSP < Полученный JSON не является объектом:" << QString::fromUtf8(jsonContent.first(qMin<qsizetype>(200, jsonContent.size())));
+        return;
+    }
+
+    const QJsonObject message = doc.object();
+    // определяем тип соо на наличие полей "id", "result", "error", "method"
+    if (message.contains("id") && (message.contains("result") || message.contains("error"))) {
+        // это ответ на наш вопрос
+        qint64 id = message["id"].toVariant().toLongLong();
+        if (m_cancelledRequests.remove(id)) {
+            // запрос отменен, пока сервер его считал: результат никому не нужен, структуры не собираем
+            m_transport->m_droppedReplies.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (!m_pendingRequests.contains(id)) {
+            qWarning() << "LSP < Получен ответ на неизвсетный или уже обработанный запрос ID:" << id;
+        }
+        QString method = m_pendingRequests.take(id); // полуаем метод и сразу удаляем из словаря
+        if (message.contains("result")) {
+            // поле результата может быть любым объектом, массивом или другим типом
+            const QJsonValue resultValue = message["result"];
+
+            if (method == "initialize") {
+                emit initializeReceived(resultValue.toObject(), timer.nsecsElapsed());
+            } else if (method == "textDocument/completion") {
+                const QList<LspCompletionItem> items = decodeCompletion(resultValue);
+                emit completionReceived(id, items, timer.nsecsElapsed());
+            } else if (method == "textDocument/definition") {
+                const QList<LspDefinitionLocation> locations = decodeDefinition(resultValue);
+                emit definitionReceived(id, locations, timer.nsecsElapsed());
+            } else if (method == "textDocument/hover") {
+                const LspHoverInfo info = decodeHover(resultValue);
+                emit hoverReceived(id, info, timer.nsecsElapsed());
+            } else if (method == "shutdown") {
+                // сервер подтвердил готовность к завершению
+                qInfo() << "LSP < Получен ответ на shutdown";
+                QJsonObject exitMsg;
+                exitMsg["jsonrpc"] = "2.0";
+                exitMsg["method"] = "exit";
+                send(exitMsg);
+            }
+        } else {
+            QJsonObject errorObj = message["error"].toObject();
+            int code = errorObj["code"].toInt();
+            QString errorMsg = errorObj["message"].toString();
+            qWarning() << "LSP < Ошибка в ответе на запрос ID" << id << method << "Код:" << code << "Сообщение:" << errorMsg;
+            emit requestFailed(id, code, errorMsg);
+        }
+    } else if (message.contains("method")) {
+        // уведомление или запрос от сервера Notification/Request
+        QString method = message["method"].toString(); // имя метода, например textDocument/publishDiagnostics
+        QJsonObject params; // могу отсутствовать при некоторых уведомлениях
+        if (message.contains("params") && message["params"].isObject()) {
+            params = message["params"].toObject();
+        }
+
+        if (method == "textDocument/publishDiagnostics") {
+            // список ошибок и предупрждений
+            const QString fileUri = params["uri"].toString();
+            const QList<LspDiagnostic> diagnostics = decodeDiagnostics(params);
+            emit diagnosticsReceived(fileUri, diagnostics, timer.nsecsElapsed());
+        } else if (method == "window/showMessage") {
+            // сервер просит нас показать пользователю какое-то соо
+            QJsonValue typeVal = params.value("type");
+            int msgType = typeVal.isDouble() ? typeVal.toInt(4) : 4; // 1: Error,  2: Wanr,  3: Info,  4: Log
+            QString text = params["message"].toString();
+            if (msgType == 1) {
+                qCritical() << "LSP Message (Error):" << text;
+            } else if (msgType == 2) {
+                qWarning() << "LSP Message (Warn):" << text;
+            } else if (msgType == 3) {
+                qInfo() << "LSP Message (Info):" << text;
+            } else {
+                qDebug() << "LSP Message (Log):" << text;
+            }
+        } else if (method == "client/registerCapability") {
+            // сервер динамически просит включить какую-то функцию, пока что ИГНОР
+            qDebug() << "LSP < Получен client/registerCapability (игнорируется)";
+        } else if (method == "$/progress") {
+            // сервер сообщает о прогрессе долгой операции (например индексация), пока что ИГНОР
+        } else if (method == "window/logMessage") {
+            // похоже на showMessage но для логов.
+            qDebug() << "LSP Log:" << params["message"].toString();
+        } else {
+            qDebug() << "LSP < Получено уведомление или запрос от сервера, метод" << method;
+        }
+    } else {
+        // тип соо не определен
+        qWarning() << "LSP < Неизвесный тип сообщения:" << QString::fromUtf8(jsonContent.first(qMin<qsizetype>(200, jsonContent.size())));
+    }
+}
+
+// !!! разбор результатов !!!
+
+// уведомление 'textDocument/publishDiagnostics'
+QList<LspDiagnostic> LspTransportWorker::decodeDiagnostics(const QJsonObject& params)
+{
+    QList<LspDiagnostic> diagnosticsList;
+    // проврека что даигностикс - массив
+    const QJsonValue diagnosticsValue = params.value("diagnostics");
+    if (!diagnosticsValue.isArray()) {
+        qWarning() << "LSP < Поле diagnostics не является массивом в publishDiagnostics";
+        return diagnosticsList;
+    }
+
+    const QJsonArray diagsArray = diagnosticsValue.toArray();
+    diagnosticsList.reserve(diagsArray.size());
+    // проходимя по каждому элементу массива диагностики от сервера
+    for (const QJsonValue& val : diagsArray) {
+        if (!val.isObject()) {
+            qWarning() << "LSP < Элемент diagnostics не является объектом:" << val;
+            continue; //пропуска не-объекты
+        }
+        const QJsonObject diagObj = val.toObject();
+        // проверяем наличие вложенных объектов
+        const QJsonValue rangeVal = diagObj.value("range");
+        if (!rangeVal.isObject()) {
+            qWarning() << "LSP < В диагностике нет range";
+            continue;
+        }
+        const QJsonObject range = rangeVal.toObject(); // где находится проблема
+        const QJsonValue startVal = range.value("start");
+        const QJsonValue endVal = range.value("end");
+        if (!startVal.isObject() || !endVal.isObject()) {
+            qWarning() << "LSP < В range диагностики нет start или end";
+            continue;
+        }
+        const QJsonObject start = startVal.toObject(); // начало диапозона
+        const QJsonObject end = endVal.toObject(); // конец диапозона
+
+        // создаем структуру LspDiagnostic и заполняем данными из джсон
+        LspDiagnostic diag;
+        diag.message = diagObj.value("message").toString(); // текст ошибки
+        const QJsonValue severityVal = diagObj.value("severity");
+        diag.severity = severityVal.isDouble() ? severityVal.toInt(3) : 3; // серьезность может отсутствовать, по умолчанию Info (3)
+
+        const QJsonValue startLineVal = start.value("line");
+        const QJsonValue startCharVal = start.value("character");
+        const QJsonValue endLineVal = end.value("line");
+        const QJsonValue endCharVal = end.value("character");
+        if (!startLineVal.isDouble() || !startCharVal.isDouble() || !endLineVal.isDouble() || !endCharVal.isDouble()) {
+            qWarning() << "LSP < Некорректные координаты в диагностике";
+            continue;
+        }
+        diag.startLine = startLineVal.toInt(); // строка начала
+        diag.startChar = startCharVal.toInt(); // символ начала
+        diag.endLine = endLineVal.toInt(); // строка конца
+        diag.endChar = endCharVal.toInt(); // символ конца
+
+        diagnosticsList.append(diag);
+    }
+    return diagnosticsList;
+}
+
+// ответ на запрос автодополнения
+QList<LspCompletionItem> LspTransportWorker::decodeCompletion(const QJsonValue& resultValue)
+{
+    QList<LspCompletionItem> completionList;
+    QJsonArray itemsArray; // сюда массив подсказок из ответа сервера
+
+    // сервер может вернуть результаты в разных форматах:
+    // 1. Обхект CompletionList, содержащий поле items (массив)
+    // 2. Просто массив подсказок
+    // 3. null, если подсказок нет
+    if (resultValue.isObject()) {
+        const QJsonObject resultObj = resultValue.toObject();
+        if (resultObj.contains("items") && resultObj["items"].isArray()) {
+            itemsArray = resultObj["items"].toArray();
+        } else if (!resultObj.isEmpty()) {
+            qWarning() << "LSP < Неожиданный объект в ответе на completion";
+        }
+    } else if (resultValue.isArray()) {
+        itemsArray = resultValue.toArray();
+    } else if (!resultValue.isNull()) {
+        qWarning() << "LSP < Неожиданный тип ответа на completion (не объект, не массив, не null):" << resultValue.type();
+    }
+
+    completionList.reserve(itemsArray.size());
+    // проходимся по каждому элементу массива подсказок от сервера
+    for (const QJsonValue& val : itemsArray) {
+        const QJsonObject itemsObj = val.toObject();
+        LspCompletionItem item; // создаем структуру дял подсказки
+
+        // заполняем поля структуры из джсон-объкт подсказки
+        item.label = itemsObj["label"].toString(); // текст для списка
+        const QJsonValue insertTextVal = itemsObj.value("insertText");
+        item.insertText = insertTextVal.isString() ? insertTextVal.toString() : item.label; // текст который фактически вставиться
+        item.detail = itemsObj.value("detail").toString(); // тип
+
+        // документация может быть строкой или объектом { kind: "markdown", value: "..." }
+        const QJsonValue docVal = itemsObj["documentation"];
+        if (docVal.isString()) {
+            item.documentation = docVal.toString();
+        } else if (docVal.isObject()) {
+            item.documentation = docVal.toObject().value("value").toString();
+        }
+
+        item.kind = itemsObj.value("kind").toInt(); // тип (функция, класс)
+        completionList.append(item);
+    }
+    return completionList;
+}
+
+// ответ на запрос со всплывашкой (hover)
+LspHoverInfo LspTransportWorker::decodeHover(const QJsonValue& resultValue)
+{
+    LspHoverInfo info;
+    // ответ на запрос может быть пустым (null/{}), если у сервера нет инфы; пустой info скроет старую подсказку
+    const QJsonObject result = resultValue.toObject();
+    if (result.isEmpty() || result.value("contents").isNull()) {
+        return info;
+    }
+
+    const QJsonValue contentsVal = result["contents"];
+    if (contentsVal.isString()) {
+        // когда просто строка
+        info.contents = contentsVal.toString();
+    } else if (contentsVal.isObject() && contentsVal.toObject().contains("value")) {
+        // объект MarkupContent (предпочтительный), содержит тип разметки и текст
+        info.contents = contentsVal.toObject()["value"].toString();
+    } else if (contentsVal.isArray()) {
+        // массив строк или объектов MarkedString (старый формат)
+        QStringList parts; // собираем все части в список строк
+        for (const QJsonValue& partVal : contentsVal.toArray()) {
+            if (partVal.isString()) {
+                parts << partVal.toString();
+            } else if (partVal.isObject() && partVal.toObject().contains("value")) { // может быть { language: 'cpp', value: 'int foo()' }
+                parts << partVal.toObject()["value"].toString();
+            }
+        }
+        // соединяем все части и разделяем их
+        info.contents = parts.join("\n---\n");
+    } else {
+        qWarning() << "LSP < Неизвестный формат поля contents в ответ на hover";
+    }
+    return info;
+}
+
+// ответ на переход к определению: null, Location или Location[]
+QList<LspDefinitionLocation> LspTransportWorker::decodeDefinition(const QJsonValue& resultValue)
+{
+    QList<LspDefinitionLocation> locations; // список мест определения
+
+    // парсинг одного объекта локации
+    auto parseLocation = [](const QJsonObject& locObj) -> LspDefinitionLocation {
+        LspDefinitionLocation loc;
+        loc.fileUri = locObj["uri"].toString(); // путь к файлу
+        const QJsonObject range = locObj["range"].toObject(); // диапозон в файле
+        // начало диапозона - строка и символ
+        loc.line = range["start"].toObject()["line"].toInt();
+        loc.character = range["start"].toObject()["character"].toInt();
+        return loc;
+    };
+
+    if (resultValue.isNull()) {
+        // определение не найдено
+    } else if (resultValue.isArray()) {
+        for (const QJsonValue& val : resultValue.toArray()) {
+            if (val.isObject()) { // каждый элемент должен быть объектом Location
+                locations.append(parseLocation(val.toObject()));
+            }
+        }
+    } else if (resultValue.isObject()) {
+        locations.append(parseLocation(resultValue.toObject()));
+    } else {
+        qWarning() << "LSP < Неизвсетный формат ответа на definition";
+    }
+    return locations;
+}
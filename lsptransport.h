@@ -0,0 +1,116 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef LSPTRANSPORT_H
+#define LSPTRANSPORT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QProcess>
+#include <QSet>
+#include <QStringList>
+#include <QThread>
+#include <atomic>
+#include "lspframereader.h"
+#include "lspmessages.h"
+
+class LspTransportWorker;
+
+// JSON-RPC канал к процессу LSP-сервера
+// QProcess, заголовки Content-Length, сериализация, разбор JSON и сборка LspDiagnostic/LspCompletionItem
+// живут в отдельном потоке; в поток GUI через очередь событий приходят только готовые структуры
+// все методы вызываются из потока GUI
+class LspTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LspTransport(QObject *parent = nullptr);
+    ~LspTransport() override; // ждет завершения процесса сервера
+
+    void start(const QString& program, const QStringList& arguments);
+    // shutdown с этим id, затем exit; процесс, который не вышел сам, завершается принудительно
+    void stop(qint64 shutdownId);
+    void send(const QJsonObject& message); // сериализация и запись - в потоке транспорта
+    // $/cancelRequest серверу; ответ на этот запрос, если еще не разобран, отбрасывается до сборки структур
+    void cancel(qint64 id);
+    qint64 droppedReplies() const { return m_droppedReplies.load(std::memory_order_relaxed); } // отброшено после cancel
+    // true сразу после start и false сразу после stop, поэтому stop + start подряд (перезапуск) работает
+    bool isRunning() const { return m_runningGeneration.load(std::memory_order_acquire) != 0; }
+
+signals:
+    void started();
+    void finished(int exitCode, QProcess::ExitStatus exitStatus);
+    void errorOccurred(const QString& message);
+
+    // decodeNs - время разбора JSON и сборки структур в потоке транспорта
+    void initializeReceived(const QJsonObject& result, qint64 decodeNs);
+    void diagnosticsReceived(const QString& fileUri, const QList<LspDiagnostic>& diagnostics, qint64 decodeNs);
+    void completionReceived(qint64 id, const QList<LspCompletionItem>& items, qint64 decodeNs);
+    void hoverReceived(qint64 id, const LspHoverInfo& hoverInfo, qint64 decodeNs);
+    void definitionReceived(qint64 id, const QList<LspDefinitionLocation>& locations, qint64 decodeNs);
+    void requestFailed(qint64 id, int code, const QString& message); // ответ с error
+
+private:
+    friend class LspTransportWorker;
+
+    QThread m_thread;
+    LspTransportWorker *m_worker = nullptr;
+    quint64 m_lastGeneration = 0; // номер последнего start, только поток GUI
+    // номер запущенного процесса или 0; процесс, упавший сам, сбрасывает только свой номер
+    std::atomic<quint64> m_runningGeneration{0};
+    std::atomic<qint64> m_droppedReplies{0};
+};
+
+// часть транспорта в его потоке; создается и удаляется LspTransport
+class LspTransportWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LspTransportWorker(LspTransport *transport);
+
+    void start(const QString& program, const QStringList& arguments, quint64 generation);
+    void stop(qint64 shutdownId);
+    void send(const QJsonObject& message);
+    void cancel(qint64 id);
+
+    // разбор результатов, без состояния
+    static QList<LspDiagnostic> decodeDiagnostics(const QJsonObject& params);
+    static QList<LspCompletionItem> decodeCompletion(const QJsonValue& result);
+    static LspHoverInfo decodeHover(const QJsonValue& result);
+    static QList<LspDefinitionLocation> decodeDefinition(const QJsonValue& result);
+
+signals:
+    void started();
+    void finished(int exitCode, QProcess::ExitStatus exitStatus);
+    void errorOccurred(const QString& message);
+    void initializeReceived(const QJsonObject& result, qint64 decodeNs);
+    void diagnosticsReceived(const QString& fileUri, const QList<LspDiagnostic>& diagnostics, qint64 decodeNs);
+    void completionReceived(qint64 id, const QList<LspCompletionItem>& items, qint64 decodeNs);
+    void hoverReceived(qint64 id, const LspHoverInfo& hoverInfo, qint64 decodeNs);
+    void definitionReceived(qint64 id, const QList<LspDefinitionLocation>& locations, qint64 decodeNs);
+    void requestFailed(qint64 id, int code, const QString& message);
+
+private:
+    void onReadyReadStandardOutput();
+    void onReadyReadStandardError();
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessError(QProcess::ProcessError error);
+    // разбор одного целого json и сборка результата по методу запроса; jsonContent смотрит в буфер m_reader
+    void parseMessage(QByteArrayView jsonContent);
+    void dropProcess();
+
+    LspTransport *m_transport;
+    QProcess *m_process = nullptr;
+    quint64 m_generation = 0; // номер start, с которым создан m_process
+    LspFrameReader m_reader; // данные с сервера приходят частями, копим до целого сообщения
+    QHash<qint64, QString> m_pendingRequests; // ID запроса - имя метода, по нему выбирается разбор ответа
+    QSet<qint64> m_cancelledRequests; // отменены до ответа, ответ на них не разбирается
+};
+
+#endif // LSPTRANSPORT_H
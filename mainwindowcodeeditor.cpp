@@ -2,10 +2,9 @@
 #include "./ui_mainwindowcodeeditor.h"
 #include "terminalwidget.h"
 #include "todolistwidget.h"
-#include "cursorwidget.h"
-#include "linehighlightwidget.h"
 #include "sessionparamswindow.h"
 #include "lspsettingsdialog.h"
+#include "messagestatsdialog.h"
 #include <QFileDialog>
 #include <QFile>
 #include <QTextStream>
@@ -15,7 +14,6 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QWebSocket>
 #include <QSignalBlocker>
 #include <QCoreApplication>
 #include <QInputDialog>
@@ -23,6 +21,7 @@
 #include <QPushButton>
 #include <QPainter>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QKeyEvent>
 #include <QTextEdit>
 #include <QScrollArea>
@@ -38,6 +37,7 @@
 #include <QSurfaceFormat>
 
 #include <QKeySequence>
+#include <utility>
 #include <QTextCursor>
 #include <QTextCharFormat>
 
@@ -46,6 +46,34 @@ const qreal MESSAGE_WIDTH_PERCENT = 75; // Макс. ширина сообщен
 const int HORIZONTAL_MARGIN = 10;      // Боковые отступы от краев ScrollArea
 const int MESSAGE_SPACING = 5;         // Вертикальный отступ между сообщениями
 
+namespace {
+
+// откат уже примененных в тексте операций; удаленный текст в операции не хранится, поэтому только вставки
+bool revertInserts(QString& text, const QList<CollabOp>& ops)
+{
+    for (auto it = ops.crbegin(); it != ops.crend(); ++it) {
+        if (it->type != CollabOp::Insert || it->position < 0 || it->position + it->text.length() > text.length()) {
+            return false;
+        }
+        text.remove(it->position, it->text.length());
+    }
+    return true;
+}
+
+// участки базы, которые меняют две разницы OtTransform::diff(), пересекаются или стоят вплотную
+bool editsTouch(const QList<CollabOp>& a, const QList<CollabOp>& b)
+{
+    if (a.isEmpty() || b.isEmpty()) {
+        return false;
+    }
+    const auto end = [](const QList<CollabOp>& ops) {
+        return ops.first().position + (ops.first().type == CollabOp::Delete ? ops.first().count : 0);
+    };
+    return a.first().position <= end(b) && b.first().position <= end(a);
+}
+
+} // namespace
+
 MainWindowCodeEditor::MainWindowCodeEditor(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindowCodeEditor)
@@ -204,6 +232,7 @@ void MainWindowCodeEditor::setupCodeEditorArea()
     QFileInfo fileInfo(currentFilePath);
     highlighter = new CppHighlighter(m_codeEditor->document(), currentFilePath); //подсветка только для C++ и C
     m_codeEditor->viewport()->installEventFilter(this);
+    m_cursorOverlay = new RemoteCursorOverlay(m_codeEditor, &m_participants); // курсоры и подсветки всех участников
 
     connect(m_findLineEdit, &QLineEdit::returnPressed, this, &MainWindowCodeEditor::findNext);
     connect(m_findLineEdit, &QLineEdit::textChanged, this, &MainWindowCodeEditor::updateFindHighlights);
@@ -362,7 +391,7 @@ void MainWindowCodeEditor::setupUserFeatures()
 
     //m_muteTimer = new QTimer(this);
     connect(m_muteTimer, &QTimer::timeout, this, &MainWindowCodeEditor::updateStatusBarMuteTime); // вызывает каждую секунду, когда таймер запущен, чтоы обновлять время мьюта в статус-баре
-    connect(m_muteTimer, &QTimer::timeout, this, &MainWindowCodeEditor::updateMuteTimeDisplayInUserInfo);
+    // окно "Информация" обновляет свой отсчет само, пока открыто
     //connect(m_muteTimer, &QTimer::timeout, this, &MainWindowCodeEditor::updateAllUsersMuteTimeDisplay);
 }
 
@@ -383,6 +412,8 @@ void MainWindowCodeEditor::setupMenuBarActions()
     connect(ui->actionCopyId, &QAction::triggered, this, &MainWindowCodeEditor::onCopyIdClicked);
     connect(ui->actionLeaveSession, &QAction::triggered, this, &MainWindowCodeEditor::onLeaveSession);
     connect(ui->actionShowListUsers, &QAction::triggered, this, &MainWindowCodeEditor::onShowUserList);
+    connect(ui->actionMessageStats, &QAction::triggered, this, &MainWindowCodeEditor::onShowMessageStats);
+    connect(ui->actionRecordSession, &QAction::toggled, this, &MainWindowCodeEditor::onRecordSessionToggled);
     ui->actionShowListUsers->setVisible(false);
     ui->actionLeaveSession->setVisible(false);
     ui->actionSaveSession->setVisible(false);
@@ -392,6 +423,7 @@ void MainWindowCodeEditor::setupMenuBarActions()
     //connect(ui->actionToDoList, &QAction::triggered, this, &MainWindowCodeEditor::on_actionToDoList_triggered);
     //connect(ui->actionChangeTheme, &QAction::triggered, this, &MainWindowCodeEditor::on_actionChangeTheme_triggered);
     connect(ui->actionLSP, &QAction::triggered, this, &MainWindowCodeEditor::onLspSettings);
+    connect(ui->actionServerAddress, &QAction::triggered, this, &MainWindowCodeEditor::onServerAddress);
 
     // подключение сигнала измнения значения вертикального скроллбара
     connect(m_codeEditor->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindowCodeEditor::onVerticalScrollBarValueChanged);
@@ -423,8 +455,95 @@ void MainWindowCodeEditor::setupFileSystemView()
 
 void MainWindowCodeEditor::setupNetwork()
 {
+    // сокет и разбор кадров живут в отдельном потоке, сюда приходят готовые сообщения
+    m_connection = new CollabConnection(this);
+    connect(m_connection, &CollabConnection::connected, this, &MainWindowCodeEditor::onConnected);
+    connect(m_connection, &CollabConnection::disconnected, this, &MainWindowCodeEditor::onDisconnected);
+    connect(m_connection, &CollabConnection::messageReceived, this, &MainWindowCodeEditor::processServerMessage);
+    // неудачная попытка переподключения не всегда дает disconnected, а смену состояния сокета - всегда
+    connect(m_connection, &CollabConnection::stateChanged, this, [this](QAbstractSocket::SocketState state) {
+        if (state == QAbstractSocket::UnconnectedState && m_reconnect->isReconnecting()) {
+            m_reconnect->connectionLost();
+        }
+    });
+
     m_clientId = QUuid::createUuid().toString();
     qDebug() << "Уникальный идентификатор клиента:" << m_clientId;
+    m_otClient.setClientId(m_clientId);
+
+    // окно склейки нажатий клавиш перед отправкой на сервер
+    QSettings settings("ToMaTiK", "BAM_IDE");
+    m_opQueue = new OutgoingOpQueue(this);
+    m_opQueue->setWindow(settings.value("Collab/CoalesceWindowMs", 30).toInt());
+    connect(m_opQueue, &OutgoingOpQueue::flushReady, this, &MainWindowCodeEditor::sendOutgoingOps);
+
+    // ни один кадр не больше Collab/MaxFrameBytes: большая вставка уходит кусками по одному на ack,
+    // длинный текст остальных сообщений режется в сетевом потоке
+    m_maxFrameBytes = qMax(int(CollabChunker::MinFrameBytes),
+                           settings.value("Collab/MaxFrameBytes", CollabChunker::DefaultMaxFrameBytes).toInt());
+    m_connection->setMaxFrameBytes(m_maxFrameBytes);
+    m_otClient.setMaxBatchBytes(m_maxFrameBytes - CollabChunker::HeaderReserveBytes);
+
+    // защита от потока сообщений: курсоры и чат одного участника не чаще Collab/SenderRateCap в секунду,
+    // при очереди длиннее Collab/InboundHighWatermark курсоры придерживаются, правки доходят всегда
+    m_connection->setInboundLimits(settings.value("Collab/SenderRateCap", InboundAdmission::DefaultSenderRate).toInt(),
+                                   settings.value("Collab/InboundHighWatermark", InboundAdmission::DefaultHighWatermark).toInt());
+    connect(m_connection, &CollabConnection::degradedChanged, this, &MainWindowCodeEditor::onInboundDegradedChanged);
+
+    // позиция курсора уходит отдельным каналом, не чаще Collab/PresenceHz раз в секунду
+    m_presence = new PresenceChannel(this);
+    m_presence->setRate(settings.value("Collab/PresenceHz", 20).toInt());
+    m_presence->setSender([this](int position, int anchor) { return sendPresence(position, anchor); });
+
+    // чужие операции применяются пачкой раз за проход цикла событий
+    m_remoteOps = new RemoteOpApplier(m_codeEditor->document(), &m_participants, this);
+    m_remoteOps->setTransform([this](const RemoteOpApplier::Batch& batch) {
+        if (!m_otEnabled) return batch.ops;
+        if (batch.senderId == m_clientId) {
+            // своя пачка среди догоняющих операций: сервер принял ее до обрыва, это и есть ее ack
+            m_otClient.serverAck(batch.revision);
+            return QList<CollabOp>();
+        }
+        // позиции отправителя относятся к ревизии сервера, сдвигаем их с учетом наших неподтвержденных правок
+        return m_otClient.applyRemote(batch.ops, batch.senderId, batch.revision);
+    });
+    connect(m_remoteOps, &RemoteOpApplier::aboutToDrain, this, [this]() {
+        m_opQueue->flush(); // свои накопленные правки уходят раньше, чем применяется чужая
+    });
+    connect(m_remoteOps, &RemoteOpApplier::drained, this, [this](int, int opCount) {
+        repositionRemoteDecorations(); // один пересчет на все пачки
+        if (opCount > 0 && m_lspManager) {
+            m_lspManager->markDocumentStale(m_currentLspFileUri, m_codeEditor->document()); // правки шли с заглушенными сигналами, LSP о них не знает
+        }
+        m_messageStats.recordApply(m_remoteOps->lastDrainUs() * 1000); // время применения видно в «Статистике сообщений»
+    });
+
+    // периодическая сверка с сервером по хешам строк: расхождение чинится заменой только различающихся строк
+    m_divergence = new DivergenceChecker(m_codeEditor->document(), this);
+    m_divergence->setSender([this](const QJsonObject& message) { sendToServer(message); });
+    m_hashCheckTimer = new QTimer(this);
+    connect(m_hashCheckTimer, &QTimer::timeout, this, &MainWindowCodeEditor::onHashCheckTimer);
+    const int hashCheckMs = settings.value("Collab/HashCheckMs", 15000).toInt();
+    if (hashCheckMs > 0) {
+        m_hashCheckTimer->start(hashCheckMs);
+    }
+
+    // после обрыва переподключаемся сами, правки за время обрыва копятся в журнале
+    // журнал прошлого запуска не к чему применять: client_id и состояние сессии уже другие
+    m_offlineOps.setFilePath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/offline-ops.log");
+    m_offlineOps.clear();
+    m_reconnect = new ReconnectSupervisor(this);
+    m_reconnect->setBackoff(settings.value("Collab/ReconnectInitialMs", 500).toInt(),
+                            settings.value("Collab/ReconnectMaxMs", 30000).toInt());
+    connect(m_reconnect, &ReconnectSupervisor::reconnectRequested, this, [this](int attempt) {
+        qDebug() << "Попытка переподключения" << attempt;
+        statusBar()->showMessage(tr("Переподключение к серверу (попытка %1)...").arg(attempt));
+        connectToServer();
+    });
+    connect(m_reconnect, &ReconnectSupervisor::retryScheduled, this, [this](int attempt, int delayMs) {
+        statusBar()->showMessage(tr("Нет связи с сервером. Попытка %1 через %2 с, правок в ожидании: %3")
+                                     .arg(attempt).arg(delayMs / 1000.0, 0, 'f', 1).arg(m_offlineOps.size()));
+    });
 }
 
 void MainWindowCodeEditor::setupThemeAndNick()
@@ -568,6 +687,20 @@ void MainWindowCodeEditor::setupStatusBarWidgets()
     m_diagnosticsStatusBtn->setToolButtonStyle(Qt::ToolButtonTextOnly);
     m_diagnosticsStatusBtn->setAutoRaise(true);
     statusBar()->addPermanentWidget(m_diagnosticsStatusBtn);
+
+    // прогресс отправки большого куска текста, виден только пока он уходит
+    m_pushProgress = new QProgressBar();
+    m_pushProgress->setRange(0, 100);
+    m_pushProgress->setMaximumWidth(160);
+    m_pushProgress->setFormat(tr("Отправка: %p%"));
+    m_pushProgress->hide();
+    statusBar()->addPermanentWidget(m_pushProgress);
+
+    // режим перегрузки входящего потока, виден только пока он длится
+    m_overloadLabel = new QLabel(tr("Перегрузка"));
+    m_overloadLabel->setStyleSheet("color: #d08000;");
+    m_overloadLabel->hide();
+    statusBar()->addPermanentWidget(m_overloadLabel);
 }
 
 MainWindowCodeEditor::~MainWindowCodeEditor()
@@ -584,9 +717,6 @@ MainWindowCodeEditor::~MainWindowCodeEditor()
     }
 
     delete ui; // освобождает память, выделенную под интерфейс
-    qDeleteAll(remoteCursors); // удаление курсоров всех пользователей
-    qDeleteAll(remoteLineHighlights);
-    delete socket;
     delete highlighter;
     delete m_themeCheckBox;
     delete m_userListMenu;
@@ -678,13 +808,7 @@ bool MainWindowCodeEditor::eventFilter(QObject *obj, QEvent *event)
 
     if (obj == m_codeEditor->viewport()) {
         if (event->type() == QEvent::Resize) {
-            for (auto it = remoteLineHighlights.begin(); it != remoteLineHighlights.end(); ++it) {
-                QString senderId = it.key();
-                int position = lastCursorPositions.value(senderId, -1);
-                if (position != -1) {
-                    updateLineHighlight(senderId, position);
-                }
-            }
+            repositionRemoteDecorations();
         } else if (event->type() == QEvent::MouseMove) {
             handleEditorMouseMoveEvent(static_cast<QMouseEvent*>(event));
         } else if (event->type() == QEvent::Leave) {
@@ -1275,6 +1399,12 @@ void MainWindowCodeEditor::onConnected()
         return;
     }
 
+    sendJoinRequest();
+}
+
+void MainWindowCodeEditor::sendJoinRequest()
+{
+    m_opQueue->flush(); // при переподключении набранное уходит в журнал, и точка возобновления учитывает его
     QJsonObject message;
     if (m_sessionId == "NEW") {
         message["type"] = "create_session";
@@ -1282,26 +1412,67 @@ void MainWindowCodeEditor::onConnected()
         message["days"]= m_pendingSaveDays;
         if (!pendingSessionSave.isEmpty()) {
             QJsonDocument saveDoc = QJsonDocument::fromJson(pendingSessionSave);
-            socket->sendTextMessage(QString::fromUtf8(saveDoc.toJson(QJsonDocument::Compact)));
+            m_connection->send(saveDoc.object());
             pendingSessionSave.clear();
         }
     } else {
         message["type"] = "join_session";
         message["session_id"] = m_sessionId;
         message["password"] = m_sessionPassword; // Добавляем пароль
+        // возвращаемся в ту же сессию с тем же текстом - просим только то, что пропустили
+        m_resumeRequested = m_resume.isValid() && m_resume.sessionId == m_sessionId
+                            && m_resume.documentRevision == m_codeEditor->document()->revision();
+        if (m_resumeRequested) {
+            message["since_revision"] = m_resume.revision;
+            qDebug() << "Возобновление сессии" << m_sessionId << "с ревизии" << m_resume.revision;
+        }
+    }
+    // входим сразу в документ открытого файла; сервер без документов эти поля не заметит
+    if (!m_resumeRequested) {
+        m_documentPath = sharedDocumentPath();
+        const QString text = m_codeEditor->toPlainText();
+        if (fitsInFrame(text)) {
+            message["text"] = text; // станет текстом документа, если его в сессии еще нет
+        } else {
+            // больше кадра: новый документ сервер создаст пустым (seed), и текст уйдет вставками по кускам
+            message["text_length"] = int(text.length());
+        }
+    }
+    if (!m_documentPath.isEmpty()) {
+        message["path"] = m_documentPath;
     }
+    message["snapshot_compression"] = "zlib"; // полный текст можно прислать сжатым
     message["username"] = m_username;
     message["client_id"] = m_clientId;
-    QJsonDocument doc(message);
-    socket->sendTextMessage(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+    // предлагаем бинарный формат, сервер выберет его в session_info, старый сервер поле просто не заметит
+    // до session_info соединение всегда говорит текстовым JSON
+    message["protocols"] = QJsonArray{CollabCodec::CborProtocolName, CollabCodec::JsonProtocolName};
+    // участников присылать дельтами (user_joined), полный user_list_update - только при входе
+    message["features"] = QJsonArray{"user_deltas"};
+    m_connection->send(message);
 }
 
 void MainWindowCodeEditor::onDisconnected()
 {
     statusBar()->showMessage("Отключено от сервера");
     qDebug() << "WebSocket disconnected";
+    m_resyncRequested = false;
 
-    clearRemoteInfo();
+    if (m_reconnect->isReconnecting()) {
+        m_reconnect->connectionLost(); // неудачная попытка, пробуем снова позже
+        return;
+    }
+    if (m_reconnect->state() == ReconnectSupervisor::State::Connected) {
+        // обрыв посреди сессии: документ остается, дальнейшие правки пишутся в журнал до переподключения
+        const QString sessionId = m_sessionId;
+        saveResumePoint(); // до сброса окна склейки в журнал: его правок сервер еще не видел
+        m_reconnect->connectionLost();
+        m_opQueue->flush(); // ненабранное окно склейки тоже в журнал
+        clearRemoteInfo(true);
+        m_sessionId = sessionId;
+    } else {
+        clearRemoteInfo();
+    }
     ui->actionShowListUsers->setVisible(false);
     ui->actionLeaveSession->setVisible(false);
     ui->actionSaveSession->setVisible(false);
@@ -1313,25 +1484,50 @@ void MainWindowCodeEditor::onDisconnected()
 
 void MainWindowCodeEditor::connectToServer()
 {
-    if (socket && socket->state() == QAbstractSocket::ConnectedState) return; // уже подключены
+    if (m_connection->isConnected()) return; // уже подключены
 
-    if (!socket) {
-        // Создаем QWebSocket и подключаем его сигналы
-        socket = new QWebSocket();
+    m_connection->open(serverUrl());
+}
 
-        // Сигнал "connected" – когда соединение установлено
-        connect(socket, &QWebSocket::connected, this, &MainWindowCodeEditor::onConnected);
-        connect(socket, &QWebSocket::disconnected, this, &MainWindowCodeEditor::onDisconnected);
-        connect(socket, &QWebSocket::textMessageReceived, this, &MainWindowCodeEditor::onTextMessageReceived);
-    }
+// адрес сервера совместной работы, по умолчанию - локальный bam_server
+QUrl MainWindowCodeEditor::serverUrl() const
+{
+    QSettings settings("ToMaTiK", "BAM_IDE");
+    return QUrl(settings.value("Network/ServerUrl", DefaultServerUrl).toString());
+}
 
-    socket->open(QUrl("ws://YOUR_SERVER_IP_ADDRESS:YOUR_SERVER_PORT"));
+void MainWindowCodeEditor::onServerAddress()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, tr("Адрес сервера"), tr("WebSocket-адрес сервера совместной работы:"),
+                                               QLineEdit::Normal, serverUrl().toString(), &ok).trimmed();
+    if (!ok) return;
+    const QUrl url(text.isEmpty() ? QString(DefaultServerUrl) : text);
+    if (!url.isValid() || (url.scheme() != "ws" && url.scheme() != "wss")) {
+        QMessageBox::warning(this, tr("Адрес сервера"), tr("Нужен адрес вида ws://хост:порт или wss://хост:порт"));
+        return;
+    }
+    QSettings settings("ToMaTiK", "BAM_IDE");
+    settings.setValue("Network/ServerUrl", url.toString());
+    statusBar()->showMessage(tr("Адрес сервера: %1. Применится при следующем подключении").arg(url.toString()), 5000);
 }
 
 void MainWindowCodeEditor::disconnectFromServer()
 {
-    if (socket && socket->state() == QAbstractSocket::ConnectedState) {
-        socket->close();
+    // уходим сами - переподключаться и повторять офлайн-правки не нужно
+    const bool wasReconnecting = isBufferingOffline();
+    if (m_reconnect) {
+        m_reconnect->stop();
+    }
+    m_offlineOps.clear();
+    if (m_connection->isConnected()) {
+        if (m_opQueue) {
+            m_opQueue->flush(); // не теряем последние нажатия перед закрытием
+        }
+        m_connection->close();
+        clearRemoteInfo();
+    } else if (wasReconnecting) {
+        m_connection->abort();
         clearRemoteInfo();
     }
     if (m_trayIcon) {
@@ -1349,18 +1545,59 @@ bool MainWindowCodeEditor::confirmChangeSession(const QString &message)
     return msgBoxConfirm.exec() == QMessageBox::Yes;
 }
 
+// при обрыве связи запоминаем ревизию сервера: переподключение догонит документ операциями, а не полным текстом
+// неподтвержденная пачка остается в OtClient, ее судьбу покажут догоняющие операции
+void MainWindowCodeEditor::saveResumePoint()
+{
+    m_resume = {};
+    if (!m_otEnabled || m_sessionId.isEmpty() || m_sessionId == "NEW") return;
+    m_remoteOps->drain(); // уже пришедшее входит в ревизию
+    m_resume.sessionId = m_sessionId;
+    m_resume.revision = m_otClient.revision();
+    m_resume.documentRevision = m_codeEditor->document()->revision();
+    // текст на этой ревизии: если вместо catch_up придет снимок, свои правки сводятся с ним через эту базу
+    // неподтвержденная пачка то ли есть на сервере, то ли нет - тогда базы нет
+    if (!m_otClient.isAwaitingAck()) {
+        m_resume.baseText = m_codeEditor->toPlainText();
+        m_resume.hasBase = revertInserts(m_resume.baseText, m_opQueue->pending());
+        if (!m_resume.hasBase) {
+            m_resume.baseText.clear();
+        }
+    }
+}
+
 // функция после выхода из сессии
-void MainWindowCodeEditor::clearRemoteInfo()
+void MainWindowCodeEditor::clearRemoteInfo(bool keepDocument)
 {
     // очистка данных, связанных с сессией
-    m_codeEditor->setPlainText("");
+    m_remoteOps->clear(); // чужие правки к очищенному документу уже не относятся
+    if (!keepDocument) {
+        m_resume = {};
+        m_codeEditor->setPlainText("");
+        m_otClient.reset(0);
+    }
+    m_closingDocuments.clear();
+    m_divergence->cancel();
+    if (std::exchange(m_documentPending, false)) {
+        m_codeEditor->setReadOnly(m_mutedClients.value(m_clientId));
+    }
+    m_resumeRequested = false;
     m_sessionId.clear();
-    qDeleteAll(remoteCursors);
-    remoteCursors.clear();
-    qDeleteAll(remoteLineHighlights);
-    remoteLineHighlights.clear();
+    m_participants.clear();
+    m_cursorOverlay->clearHidden();
     remoteUsers.clear();
-    statusBar()->clearMessage();
+    updateUserListUI(); // пункты ушедшей сессии убираются
+    m_serverFeatures.clear();
+    m_otEnabled = false;
+    updatePushProgress(); // без OT отправлять кусками нечего, индикатор прячется
+    m_presence->reset();
+    m_pendingRemotePresence.clear();
+    if (m_opQueue) {
+        m_opQueue->clear();
+    }
+    if (!keepDocument) {
+        statusBar()->clearMessage();
+    }
     m_muteTimer->stop();
 }
 
@@ -1370,7 +1607,7 @@ void MainWindowCodeEditor::onCreateSession()
         return; // нажали отмену
     }
 
-    if (socket && socket->state() == QAbstractSocket::ConnectedState) {
+    if (m_connection->isConnected()) {
         if (!confirmChangeSession(tr("Вы уверены, что хотите создать новую сессию? Текущее соединение будет прервано."))) {
             return;
         }
@@ -1400,7 +1637,7 @@ void MainWindowCodeEditor::onJoinSession()
         return; // нажали отмену
     }
 
-    if (socket && socket->state() == QAbstractSocket::ConnectedState) {
+    if (m_connection->isConnected()) {
         if (!confirmChangeSession(tr("Вы уверены, что хотите создать новую сессию? Текущее соединение будет прервано."))) {
             return;
         }
@@ -1435,13 +1672,13 @@ void MainWindowCodeEditor::onLeaveSession()
         return;
     }
 
-    if (!m_sessionId.isEmpty() && socket->state() == QAbstractSocket::ConnectedState)
+    if (!m_sessionId.isEmpty() && m_connection->isConnected())
     {
         QJsonObject message;
         message["type"] = "leave_session";
         message["client_id"] = m_clientId;
-        QJsonDocument doc(message);
-        socket->sendTextMessage(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+        m_opQueue->flush();
+        sendToServer(message);
     }
     disconnectFromServer();
 }
@@ -1463,10 +1700,10 @@ void MainWindowCodeEditor::onSaveSessionClicked() {
     saveSessionMessage["client_id"] = m_clientId;
     saveSessionMessage["session_id"] = m_sessionId;
     saveSessionMessage["days"] = days;
-    QJsonDocument doc(saveSessionMessage);
 
-    if (socket && socket->state() == QAbstractSocket::ConnectedState) {
-        socket->sendTextMessage(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+    if (m_connection->isConnected()) {
+        m_opQueue->flush(); // сервер должен сохранить текст уже с последними правками
+        sendToServer(saveSessionMessage);
     }
 }
 
@@ -1493,6 +1730,8 @@ void MainWindowCodeEditor::onOpenFileClicked()
             fileContent = in.readAll();
             file.close();
             currentFilePath = fileName; // сохраняем локальный путь
+            m_remoteOps->drain(); // заменяем текст, в котором уже есть пришедшие правки
+            const int previousLength = m_codeEditor->document()->characterCount() - 1; // длина до замены, нужна для OT
             {
                 QSignalBlocker blocker(m_codeEditor->document());
                 loadingFile = true;
@@ -1522,19 +1761,8 @@ void MainWindowCodeEditor::onOpenFileClicked()
                 }
             }
 
-            // ОТправка соо на сервер с полным содержимым файла
-            QJsonObject fileUpdate;
-            fileUpdate["type"] = "file_content_update";
-            fileUpdate["text"] = fileContent;
-            fileUpdate["client_id"] = m_clientId;
-            fileUpdate["username"] = m_username;
-            QJsonDocument doc(fileUpdate);
-            QString message = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-            if (socket && socket->state() == QAbstractSocket::ConnectedState)
-            {
-                socket->sendTextMessage(message);
-                qDebug() << "Отправлено сообщение о загрузку файла на сервер";
-            }
+            // в сессии - общий документ этого файла
+            openSharedDocument(previousLength, fileContent);
         } else {
             QMessageBox::critical(this, "ОШИБКА", "Невозможно открыть файл");
         }
@@ -1654,6 +1882,8 @@ void MainWindowCodeEditor::onNewFileClicked()
     updateDiagnosticsView();
 
     // очищения поля редактирование и очищение пути к текущему файлу
+    m_remoteOps->drain();
+    const int previousLength = m_codeEditor->document()->characterCount() - 1;
     m_codeEditor->clear();
     currentFilePath.clear();
     m_currentLspFileUri.clear();
@@ -1661,18 +1891,8 @@ void MainWindowCodeEditor::onNewFileClicked()
     m_codeEditor->document()->setModified(false);
 
     // TODO: реализовать генерацию временного URI, чтобы для нового и несохраненного файла иметь Lsp
-    if (socket && socket->state() == QAbstractSocket::ConnectedState) {
-        QJsonObject fileUpdate;
-        fileUpdate["type"] = "file_content_update";
-        fileUpdate["text"] = "";
-        fileUpdate["client_id"] = m_clientId;
-        fileUpdate["username"] = m_username;
-        QJsonDocument doc(fileUpdate);
-        QString message = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-        socket->sendTextMessage(message);
-        qDebug() << "Отправлено сообщении о создании нового файла (очистке)";
-    }
     statusBar()->showMessage(tr("Новый файл создан"), 2000);
+    openSharedDocument(previousLength, QString()); // несохраненный файл - общий буфер сессии
 }
 
 void MainWindowCodeEditor::onCopyIdClicked()
@@ -1752,6 +1972,8 @@ void MainWindowCodeEditor::onFileSystemTreeViewDoubleClicked(const QModelIndex &
             QString fileContent = in.readAll();
             file.close();
             currentFilePath = filePath;
+            m_remoteOps->drain(); // заменяем текст, в котором уже есть пришедшие правки
+            const int previousLength = m_codeEditor->document()->characterCount() - 1; // длина до замены, нужна для OT
             {
                 QSignalBlocker blocker(m_codeEditor->document());
                 loadingFile = true;
@@ -1787,20 +2009,9 @@ void MainWindowCodeEditor::onFileSystemTreeViewDoubleClicked(const QModelIndex &
                 updateLspStatus(tr("LSP[%1]: %2").arg(languageId, tr("Отключён")));
             }
 
-            // ОТправка соо на сервер с полным содержимым файла
-            QJsonObject fileUpdate;
-            fileUpdate["type"] = "file_content_update";
-            fileUpdate["text"] = fileContent;
-            fileUpdate["client_id"] = m_clientId;
-            fileUpdate["username"] = m_username;
-            QJsonDocument doc(fileUpdate);
-            QString message = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
-            if (socket && socket->state() == QAbstractSocket::ConnectedState)
-            {
-                socket->sendTextMessage(message);
-                qDebug() << "Отправлено сообщение о загрузку файла на сервер";
-            }
             statusBar()->showMessage("Открыт файл: " + filePath);
+            // в сессии - общий документ этого файла; другие файлы участников наш буфер больше не затирают
+            openSharedDocument(previousLength, fileContent);
         } else {
             QMessageBox::critical(this, "ОШИБКА", "Невозможно открыть файл: " + filePath);
         }
@@ -1809,41 +2020,32 @@ void MainWindowCodeEditor::onFileSystemTreeViewDoubleClicked(const QModelIndex &
 
 void MainWindowCodeEditor::onContentsChange(int position, int charsRemoved, int charsAdded) // получает позицию, количество удаленных символов и добавленных символов
 {
+    // чужие курсоры после места правки сдвигаются вместе с текстом
+    if (m_participants.size() > 0) {
+        m_participants.adjustForEdit(position, charsRemoved, charsAdded);
+        repositionRemoteDecorations();
+    }
     if (loadingFile) return;
     if (m_mutedClients.contains(m_clientId) && m_mutedClients.value(m_clientId) != -1) return;
-    QJsonObject op; // формирование джсон с информацией
-    if (charsAdded > 0)
-    {
-        op["client_id"] = m_clientId;
-        op["type"] = "insert";
-        op["position"] = position;
-        QString insertedText = m_codeEditor->toPlainText().mid(position, charsAdded); // извлечение вставленного текста
-        op["text"] = insertedText;
-    } else if (charsRemoved > 0)
-    {
-        op["client_id"] = m_clientId;
-        op["type"] = "delete";
-        op["position"] = position;
-        op["count"] = charsRemoved;
-    }
-    QJsonDocument doc(op);
-    QString message = QString::fromUtf8(doc.toJson(QJsonDocument::Compact)); // преобразование джсон в строку и отправка на сервер
-    if (socket && socket->state() == QAbstractSocket::ConnectedState)
-    {
-        socket->sendTextMessage(message);
-        qDebug() << "Отправлено сообщение:" << message;
-    }
+
+    // один снимок изменения на всех потребителей, читаем только затронутые блоки, а не весь документ
+    const QTextCursor editorCursor = m_codeEditor->textCursor();
+    const EditDelta delta = EditDelta::capture(m_codeEditor->document(), position, charsRemoved, charsAdded, editorCursor.position(),
+                                               &m_editPreimage);
+    // окно для следующей правки того же действия (автоотступ, закрывающая скобка) - до курсора не дошел сигнал о движении
+    m_editPreimage.capture(m_codeEditor->document(), qMin(position, editorCursor.selectionStart()),
+                           qMax(position + charsAdded, editorCursor.selectionEnd()));
+    if (delta.isEmpty()) return;
+
+    sendEditDelta(delta);
 
     if (m_lspManager && m_lspManager->isReady() && !m_currentLspFileUri.isEmpty()) {
-        m_currentDocumentVersion++;
-        QString currentText = m_codeEditor->toPlainText();
-        m_lspManager->notifyDidChange(m_currentLspFileUri, currentText, m_currentDocumentVersion);
+        // только измененный диапазон; LspManager копит правки и отправляет их одним didChange после паузы в наборе
+        m_lspManager->notifyDidChange(m_currentLspFileUri, m_codeEditor->document(), delta);
 
         // авто-запрос автодополнения после точки или ->
-        QTextCursor cursor = m_codeEditor->textCursor();
-        if (cursor.position() > 0 && charsAdded > 0) {
-            QString currentText = m_codeEditor->toPlainText();
-            QChar lastChar = currentText.at(cursor.position() - 1);
+        if (delta.cursorPosition > 0 && delta.hasInsert()) {
+            const QChar lastChar = delta.charBeforeCursor;
             bool shouldTrigger = false;
 
             // тригеры от сервера
@@ -1851,11 +2053,11 @@ void MainWindowCodeEditor::onContentsChange(int position, int charsRemoved, int
             const QString triggerChars = ".:>";
             if (triggerChars.contains(lastChar)) {
                 if (lastChar == QLatin1Char(':')) {
-                    if (cursor.position() > 1 && currentText.at(cursor.position() - 2) == QLatin1Char(':')) {
+                    if (delta.cursorPosition > 1 && delta.secondCharBeforeCursor == QLatin1Char(':')) {
                         shouldTrigger = true;
                     }
                 } else if (lastChar == QLatin1Char('>')) {
-                    if (cursor.position() > 1 && currentText.at(cursor.position() - 2) == QLatin1Char('>')) {
+                    if (delta.cursorPosition > 1 && delta.secondCharBeforeCursor == QLatin1Char('>')) {
                         shouldTrigger = true;
                     }
                 } else if (lastChar == QLatin1Char('.')) {
@@ -1866,10 +2068,10 @@ void MainWindowCodeEditor::onContentsChange(int position, int charsRemoved, int
             // тригер при начале или продолжении ввода идентификатора (буквы, цифры, _)
             if (lastChar.isLetterOrNumber() || lastChar == QLatin1Char('_')) {
                 // проверяем символ перед последним введем для контекста
-                if (cursor.position() == 1) { // если это самый первый символ в документе
+                if (delta.cursorPosition == 1) { // если это самый первый символ в документе
                     shouldTrigger = true;
                 } else {
-                    QChar charBeforeLast = currentText.at(cursor.position() - 2);
+                    const QChar charBeforeLast = delta.secondCharBeforeCursor;
                     // тригерим и проверяем, а вдруг начали новое слово или предыдущий символ тоже буква или цифра или _, то есть продолжаем слово (для фильтрации)
                     if (!charBeforeLast.isLetterOrNumber() && charBeforeLast != QLatin1Char('_')) {
                         // начали новое слова после пробела, скобки, оператора и тп
@@ -1893,7 +2095,7 @@ void MainWindowCodeEditor::onContentsChange(int position, int charsRemoved, int
                     m_completionWidget->hide();
                 }
             }
-        } else if (charsRemoved > 0 && m_completionWidget && m_completionWidget->isVisible() && charsAdded == 0) {
+        } else if (delta.hasDelete() && m_completionWidget && m_completionWidget->isVisible() && !delta.hasInsert()) {
             // пользователь удалил символ
             //m_completionWidget->hide();
             // получение текста для автодополнения
@@ -1912,6 +2114,221 @@ void MainWindowCodeEditor::onContentsChange(int position, int charsRemoved, int
     m_codeEditor->document()->setModified(true);
 }
 
+// отправка локального изменения на сервер в виде операций delete/insert
+void MainWindowCodeEditor::sendEditDelta(const EditDelta& delta)
+{
+    if (!m_opQueue) return;
+    if (!isBufferingOffline() && !m_connection->isConnected()) return;
+
+    // замена выделенного текста приходит одним изменением, сначала удаляем старое, потом вставляем новое
+    // сами операции не отправляются сразу, а копятся в очереди и склеиваются с соседними
+    if (delta.hasDelete()) {
+        m_opQueue->enqueue(CollabOp::makeDelete(delta.position, delta.charsRemoved));
+    }
+    if (delta.hasInsert()) {
+        m_opQueue->enqueue(CollabOp::makeInsert(delta.position, delta.insertedText));
+    }
+}
+
+void MainWindowCodeEditor::sendOutgoingOps(const QList<CollabOp>& ops)
+{
+    if (isBufferingOffline()) {
+        // связи нет или сессия еще не восстановлена: правки ждут в журнале и повторятся после session_info
+        m_offlineOps.append(ops);
+        m_resume.documentRevision = m_codeEditor->document()->revision(); // документ изменился только тем, что есть в журнале
+        return;
+    }
+    if (m_connection->isConnected() && !ops.isEmpty()) {
+        if (m_otEnabled) {
+            // пока сервер не подтвердил прошлую пачку, новые операции копятся в OtClient
+            const QList<CollabOp> toSend = m_otClient.applyLocal(ops);
+            if (!toSend.isEmpty()) {
+                sendOpsFrame(toSend);
+            }
+            updatePushProgress();
+        } else {
+            // без OT нет ack и нечем ограничить поток, но кадры все равно не больше предела
+            const int budget = m_maxFrameBytes - CollabChunker::HeaderReserveBytes;
+            QList<CollabOp> frame;
+            int bytes = 0;
+            for (const CollabOp& op : ops) {
+                for (const CollabOp& piece : op.split(budget)) {
+                    if (!frame.isEmpty() && bytes + piece.wireSize() > budget) {
+                        sendOpsFrame(frame);
+                        frame.clear();
+                        bytes = 0;
+                    }
+                    frame.append(piece);
+                    bytes += piece.wireSize();
+                }
+            }
+            sendOpsFrame(frame);
+        }
+    }
+}
+
+bool MainWindowCodeEditor::fitsInFrame(const QString& text) const
+{
+    return CollabOp::wireLength(text) <= m_maxFrameBytes - CollabChunker::HeaderReserveBytes;
+}
+
+// большая вставка уходит кусками по мере ack; пока она в пути, в строке состояния виден прогресс
+void MainWindowCodeEditor::updatePushProgress()
+{
+    if (!m_pushProgress) return;
+    const qint64 pending = m_otEnabled ? m_otClient.pendingLength() : 0;
+    if (pending == 0 || (m_pushTotal == 0 && pending < PushProgressMinChars)) {
+        m_pushTotal = 0;
+        m_pushProgress->hide();
+        return;
+    }
+    m_pushTotal = qMax(m_pushTotal, pending); // пока идет отправка, могли вставить еще
+    m_pushProgress->setValue(int((m_pushTotal - pending) * 100 / m_pushTotal));
+    m_pushProgress->setToolTip(tr("Осталось отправить %1 КБ").arg(pending / 1024));
+    m_pushProgress->show();
+}
+
+// индикатор перегрузки входящего потока в строке состояния, подсказка с длиной очереди и счетчиками
+void MainWindowCodeEditor::onInboundDegradedChanged(bool degraded)
+{
+    if (!m_overloadLabel) return;
+    const CollabConnection::InboundPressure pressure = m_connection->inboundPressure();
+    m_overloadLabel->setToolTip(tr("Сообщений от сервера больше, чем успевает обработать редактор.\n"
+                                   "Курсоры участников обновляются реже, лишний чат отбрасывается, правки доходят все.\n"
+                                   "В очереди: %1 (максимум %2), заменено положений курсора: %3, отброшено сообщений чата: %4")
+                                    .arg(pressure.depth).arg(pressure.maxDepth).arg(pressure.coalesced).arg(pressure.dropped));
+    m_overloadLabel->setVisible(degraded);
+}
+
+void MainWindowCodeEditor::sendOpsFrame(const QList<CollabOp>& ops, const QString& path, int revision)
+{
+    if (!m_connection->isConnected() || ops.isEmpty()) return;
+
+    // с OT вся пачка основана на одной ревизии, поэтому уходит только одним кадром
+    if (ops.size() > 1 && (m_otEnabled || m_serverFeatures.contains("batch"))) {
+        // несколько операций одним кадром, сервер применяет их по порядку
+        QJsonArray opsArray;
+        for (const CollabOp& op : ops) {
+            opsArray.append(op.toJson());
+        }
+        QJsonObject batch;
+        batch["type"] = "batch";
+        batch["client_id"] = m_clientId;
+        batch["ops"] = opsArray;
+        if (m_otEnabled) {
+            batch["revision"] = revision;
+        }
+        if (!path.isEmpty()) {
+            batch["path"] = path;
+        }
+        sendToServer(batch);
+    } else {
+        // старый сервер не знает batch, отправляем склеенные операции обычными insert/delete
+        for (const CollabOp& op : ops) {
+            QJsonObject message = op.toJson();
+            message["client_id"] = m_clientId;
+            if (m_otEnabled) {
+                message["revision"] = revision;
+            }
+            if (!path.isEmpty()) {
+                message["path"] = path;
+            }
+            sendToServer(message);
+        }
+    }
+}
+
+void MainWindowCodeEditor::publishDocumentReplace(int previousLength, const QString& text)
+{
+    const bool offline = isBufferingOffline();
+    if (!offline && !m_connection->isConnected()) return;
+
+    // без связи замена тоже пишется операциями, чтобы повториться после переподключения
+    if (m_otEnabled || offline) {
+        // в режиме OT замена файла - обычная пачка "удалить все + вставить", чтобы не терять параллельные правки
+        QList<CollabOp> ops;
+        if (previousLength > 0) {
+            ops.append(CollabOp::makeDelete(0, previousLength));
+        }
+        if (!text.isEmpty()) {
+            ops.append(CollabOp::makeInsert(0, text));
+        }
+        m_opQueue->flush();
+        sendOutgoingOps(ops);
+        qDebug() << "Отправлена замена содержимого файла операциями OT";
+        return;
+    }
+
+    QJsonObject fileUpdate;
+    fileUpdate["type"] = "file_content_update";
+    fileUpdate["text"] = text;
+    fileUpdate["client_id"] = m_clientId;
+    fileUpdate["username"] = m_username;
+    sendToServer(fileUpdate);
+    qDebug() << "Отправлено сообщение с полным содержимым файла на сервер";
+}
+
+// путь общего документа для открытого файла: относительно корня проекта, у всех участников одинаковый
+// файл вне проекта - по имени, несохраненный файл - общий буфер сессии ("")
+QString MainWindowCodeEditor::sharedDocumentPath() const
+{
+    if (currentFilePath.isEmpty()) return QString();
+    if (!m_projectRootPath.isEmpty()) {
+        const QString relative = QDir(m_projectRootPath).relativeFilePath(currentFilePath);
+        if (!relative.startsWith("..")) {
+            return relative;
+        }
+    }
+    return QFileInfo(currentFilePath).fileName();
+}
+
+void MainWindowCodeEditor::openSharedDocument(int previousLength, const QString& text)
+{
+    if (!m_serverFeatures.contains("documents")) {
+        publishDocumentReplace(previousLength, text); // сервер с одним буфером на сессию
+        return;
+    }
+    const QString path = sharedDocumentPath();
+    m_remoteOps->drain();
+    m_opQueue->flush(); // набранное в прошлом файле уходит с его путем
+    if (isBufferingOffline()) {
+        // журнал и точка возобновления относились к прошлому файлу; после переподключения войдем сразу в новый
+        m_offlineOps.clear();
+        m_resume = {};
+        m_documentPath = path;
+        return;
+    }
+    if (!m_connection->isConnected()) return;
+
+    // открыт все тот же файл - состояние придет в document_info целиком, закрывать нечего
+    if (path != m_documentPath) {
+        if (m_otClient.isAwaitingAck()) {
+            m_closingDocuments.insert(m_documentPath, m_otClient);
+        }
+        sendToServer(QJsonObject{{"type", "close_document"}, {"client_id", m_clientId}, {"path", m_documentPath}});
+    }
+    m_closingDocuments.remove(path); // его неподтвержденное сервер учтет в document_info
+    m_divergence->cancel();
+    m_documentPath = path;
+    m_documentPending = true;
+    m_otClient.reset(0);
+    m_codeEditor->setReadOnly(true); // если файл уже открыт у других, текст придет от сервера
+    m_participants.clear();
+    m_pendingRemotePresence.clear();
+    m_cursorOverlay->clearHidden();
+    repositionRemoteDecorations();
+    updatePushProgress();
+    // text станет содержимым документа, только если его в сессии еще никто не открывал
+    // файл больше кадра уходит после document_info вставками по кускам (seed)
+    QJsonObject open{{"type", "open_document"}, {"client_id", m_clientId}, {"path", path}};
+    if (fitsInFrame(text)) {
+        open["text"] = text;
+    } else {
+        open["text_length"] = int(text.length());
+    }
+    sendToServer(open);
+}
+
 // вспомогательный метод для для получения текущего слова перед курсором
 QString MainWindowCodeEditor::getCurrentWordBeforeCursor(QTextCursor cursor) {
     int position = cursor.position();
@@ -1932,385 +2349,784 @@ QString MainWindowCodeEditor::getCurrentWordBeforeCursor(QTextCursor cursor) {
     return text.mid(wordStart, posInBlock - wordStart);
 }
 
-void MainWindowCodeEditor::onTextMessageReceived(const QString &message)
+// сообщение уходит в сетевой поток, там оно кодируется в согласованном формате (JSON или CBOR) и пишется в сокет
+void MainWindowCodeEditor::sendToServer(const QJsonObject& message)
 {
-    qDebug() << "Получено сообщение от сервера:" << message;
-    //QSignalBlocker blocker(m_codeEditor->document()); // предотвращение циклического обмена, чтобы примененные изменения снова не отправились на сервер
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
-    QJsonObject op = doc.object();
-    QString opType = op["type"].toString();
+    if (!m_connection->isConnected()) return;
+    m_connection->send(message);
+}
 
-    if (opType == "error") {
-        if (op.contains("days")) {
-            int days = op["days"].toInt();
-            if ( days == -1) {
-                QMessageBox::warning(this, "Ошибка",
-                                     QString("Не удалось сохранить сессию"));
-                m_pendingSaveDays = 0;
-                m_shouldSaveAfterCreation = false;
-            }
-        }
+// обработчики по номеру типа сообщения; тип определен в сетевом потоке, здесь только индекс в таблице
+const std::array<MainWindowCodeEditor::ServerMessageHandler, size_t(ServerMessageType::Count)>& MainWindowCodeEditor::serverMessageHandlers()
+{
+    static const std::array<ServerMessageHandler, size_t(ServerMessageType::Count)> handlers = [] {
+        std::array<ServerMessageHandler, size_t(ServerMessageType::Count)> table{}; // Unknown - nullptr
+        table[size_t(ServerMessageType::Insert)] = &MainWindowCodeEditor::handleRemoteOps;
+        table[size_t(ServerMessageType::Delete)] = &MainWindowCodeEditor::handleRemoteOps;
+        table[size_t(ServerMessageType::Batch)] = &MainWindowCodeEditor::handleRemoteOps;
+        table[size_t(ServerMessageType::Ack)] = &MainWindowCodeEditor::handleAck;
+        table[size_t(ServerMessageType::CursorPositionUpdate)] = &MainWindowCodeEditor::handleCursorPositionUpdate;
+        table[size_t(ServerMessageType::ChatMessage)] = &MainWindowCodeEditor::handleChatMessage;
+        table[size_t(ServerMessageType::FileContentUpdate)] = &MainWindowCodeEditor::handleFileContentUpdate;
+        table[size_t(ServerMessageType::SessionInfo)] = &MainWindowCodeEditor::handleSessionInfo;
+        table[size_t(ServerMessageType::UserListUpdate)] = &MainWindowCodeEditor::handleUserListUpdate;
+        table[size_t(ServerMessageType::UserDisconnected)] = &MainWindowCodeEditor::handleUserDisconnected;
+        table[size_t(ServerMessageType::MuteNotification)] = &MainWindowCodeEditor::handleMuteNotification;
+        table[size_t(ServerMessageType::MutedStatusUpdate)] = &MainWindowCodeEditor::handleMutedStatusUpdate;
+        table[size_t(ServerMessageType::AdminChanged)] = &MainWindowCodeEditor::handleAdminChanged;
+        table[size_t(ServerMessageType::SessionSaved)] = &MainWindowCodeEditor::handleSessionSaved;
+        table[size_t(ServerMessageType::Error)] = &MainWindowCodeEditor::handleServerError;
+        table[size_t(ServerMessageType::DocumentInfo)] = &MainWindowCodeEditor::handleDocumentInfo;
+        table[size_t(ServerMessageType::DocumentClosed)] = &MainWindowCodeEditor::handleDocumentClosed;
+        table[size_t(ServerMessageType::HashRanges)] = &MainWindowCodeEditor::handleHashRanges;
+        table[size_t(ServerMessageType::BlockText)] = &MainWindowCodeEditor::handleBlockText;
+        table[size_t(ServerMessageType::UserJoined)] = &MainWindowCodeEditor::handleUserJoined;
+        return table;
+    }();
+    return handlers;
+}
 
-        QString error = op["message"].toString();
-        if (error == "Сессия не найдена") {
-            disconnectFromServer();
-            QString notFoundSession = op["session_id"].toString();
-            statusBar()->showMessage("Сессия с таким идентификатором '" + notFoundSession + "' не найдена");
-            QMessageBox::critical(this, "Ошибка", "Сессия не найдена. Проверьте корректность данных");
-        }
-        else if (error == "Неверный пароль") {
-            disconnectFromServer();
-            QString sessionId = op.value("session_id").toString();
-            statusBar()->showMessage("Неверный пароль для сессии " + sessionId);
-            QMessageBox::critical(this, "Ошибка", "Введен неверный пароль для сессии");
+// сообщение уже разобрано в сетевом потоке, здесь только применяется
+void MainWindowCodeEditor::processServerMessage(const InboundMessage& message)
+{
+    if (m_resyncRequested) return; // поток правок уже разошелся с нашим, все нужное придет после переподключения
 
-            // Предлагаем повторить ввод пароля
-            if (!sessionId.isEmpty()) {
-                onJoinSession(); // Повторный вызов диалога подключения
-            }
-        }
-        else if (error == "Пароль должен содержать минимум 4 символа") {
-            QMessageBox::critical(this, "Ошибка", error);
-            onCreateSession(); // Повторный вызов диалога создания сессии
-        }
-        return;
+    // ack, полная замена текста и прочее относятся к состоянию после уже пришедших операций
+    if (!ServerMessageDecoder::isEdit(message.type) && message.type != ServerMessageType::CursorPositionUpdate) {
+        m_remoteOps->drain();
+    }
 
-    } else if (opType == "session_info")
-    {
-        m_sessionId = op["session_id"].toString();
-        statusBar()->showMessage("Session ID: " + m_sessionId);
-        qDebug() << "ID session" << m_sessionId;
-        m_isAdmin = (op["creator_client_id"].toString() == m_clientId);
-        QString fileText = op["text"].toString();
-        m_codeEditor->setPlainText(fileText);
-        QJsonObject cursors = op["cursors"].toObject();
-        for (const QString& otherClientId : cursors.keys()) {
-            QJsonObject cursorInfo = cursors[otherClientId].toObject();
-            int position = cursorInfo["position"].toInt();
-            QString username = cursorInfo["username"].toString();
-            QColor color = QColor(cursorInfo["color"].toString());
-
-            // создаем/обновляем виджеты курсоров и подсветок
-            if (!remoteCursors.contains(otherClientId))
-            {
-                CursorWidget* cursorWidget = new CursorWidget(m_codeEditor->viewport(), color);
-                remoteCursors[otherClientId] = cursorWidget;
-                cursorWidget->show();
-                cursorWidget->setCustomToolTipStyle(color);
-                cursorWidget->setUsername(username);
-
-                LineHighlightWidget* lineHighlight = new LineHighlightWidget(m_codeEditor->viewport(), color.lighter(150));
-                remoteLineHighlights[otherClientId] = lineHighlight;
-                lineHighlight->show();
-            }
-            updateRemoteWidgetGeometry(remoteCursors[otherClientId], position);
-            updateLineHighlight(otherClientId, position);
+    QElapsedTimer timer;
+    timer.start();
+    const ServerMessageHandler handler = serverMessageHandlers()[size_t(message.type)];
+    if (handler) {
+        (this->*handler)(message);
+    } else {
+        qDebug() << "Неизвестное сообщение сервера:" << message.typeName << message.wireBytes << "байт";
+    }
+    m_messageStats.record(message, timer.nsecsElapsed());
+}
+
+void MainWindowCodeEditor::handleServerError(const InboundMessage& message)
+{
+    const ErrorMessage& op = message.as<ErrorMessage>();
+    if (op.hasDays && op.days == -1) {
+        QMessageBox::warning(this, "Ошибка",
+                             QString("Не удалось сохранить сессию"));
+        m_pendingSaveDays = 0;
+        m_shouldSaveAfterCreation = false;
+    }
 
+    const QString& error = op.message;
+    if (error == "Сессия не найдена") {
+        disconnectFromServer();
+        statusBar()->showMessage("Сессия с таким идентификатором '" + op.sessionId + "' не найдена");
+        QMessageBox::critical(this, "Ошибка", "Сессия не найдена. Проверьте корректность данных");
+    }
+    else if (error == "Неверный пароль") {
+        disconnectFromServer();
+        statusBar()->showMessage("Неверный пароль для сессии " + op.sessionId);
+        QMessageBox::critical(this, "Ошибка", "Введен неверный пароль для сессии");
+
+        // Предлагаем повторить ввод пароля
+        if (!op.sessionId.isEmpty()) {
+            onJoinSession(); // Повторный вызов диалога подключения
         }
-        updateUserListUI();
-        highlighter->rehighlight();
+    }
+    else if (error == "Пароль должен содержать минимум 4 символа") {
+        QMessageBox::critical(this, "Ошибка", error);
+        onCreateSession(); // Повторный вызов диалога создания сессии
+    }
+}
 
-        ui->actionSaveSession->setVisible(m_isAdmin);
-        ui->actionCopyId->setVisible(true);
-        ui->actionShowListUsers->setVisible(true);
-        ui->actionLeaveSession->setVisible(true);
-        if (m_shouldSaveAfterCreation) {
-            QJsonObject saveSessionMessage;
-            saveSessionMessage["type"] = "save_session";
-            saveSessionMessage["client_id"] = m_clientId;
-            saveSessionMessage["session_id"] = m_sessionId; // Используем ПОЛУЧЕННЫЙ ID
-            saveSessionMessage["days"] = m_pendingSaveDays;
-            QJsonDocument saveDoc(saveSessionMessage);
-
-            if (socket && socket->state() == QAbstractSocket::ConnectedState) {
-                socket->sendTextMessage(QString::fromUtf8(saveDoc.toJson(QJsonDocument::Compact)));
-                qDebug() << "Отправлен запрос на сохранение сессии" << m_sessionId << "на" << m_pendingSaveDays << "дней (после создания)";
-            } else {
-                qDebug() << "Ошибка: Не удалось отправить запрос на сохранение сессии после создания (сокет не подключен?)";
+void MainWindowCodeEditor::handleSessionInfo(const InboundMessage& message)
+{
+    const SessionInfoMessage& op = message.as<SessionInfoMessage>();
+    m_sessionId = op.sessionId;
+    statusBar()->showMessage("Session ID: " + m_sessionId);
+    qDebug() << "ID session" << m_sessionId;
+    m_isAdmin = (op.creatorClientId == m_clientId);
+    m_serverFeatures = QSet<QString>(op.features.cbegin(), op.features.cend());
+    m_documentPath = op.path; // сервер без документов пути не вернет - мы в общем буфере
+    m_closingDocuments.clear();
+    if (std::exchange(m_documentPending, false)) {
+        m_codeEditor->setReadOnly(m_mutedClients.value(m_clientId));
+    }
+    // сервер с ревизиями ведет OT, без них - старый режим с применением позиций как есть
+    m_otEnabled = op.revision >= 0;
+    const bool resuming = std::exchange(m_resumeRequested, false) && op.hasCatchUp;
+    // формат кадров (protocol) сетевой поток переключил сам, когда разбирал это сообщение
+    m_presence->reset();
+    onCursorPositionChanged(); // сразу показываем свой курсор остальным
+    m_opQueue->flush(); // при переподключении - в журнал, он повторится ниже
+    QList<CollabOp> toResend;
+    if (resuming) {
+        if (!applyCatchUp(op, toResend)) {
+            // догнать не вышло, документ не тронут; просим полный снимок обычным входом, база для него остается
+            m_resume.revision = -1;
+            sendJoinRequest();
+            return;
+        }
+    } else {
+        // полный снимок: своя неподтвержденная пачка и журнал уже в тексте редактора, сводится с ним весь текст
+        const bool unconfirmed = m_otClient.isAwaitingAck();
+        const bool journaled = !m_offlineOps.isEmpty();
+        m_offlineOps.clear();
+        m_otClient.reset(qMax(0, op.revision));
+        if (op.seed) {
+            // документ создан пустым по нашему text_length: редактор не трогаем, его текст уходит вставками
+            const QString text = m_codeEditor->toPlainText();
+            if (!text.isEmpty()) {
+                toResend.append(CollabOp::makeInsert(0, text));
             }
-            m_pendingSaveDays = 0; // сброс флага
-            m_shouldSaveAfterCreation = false;
+        } else {
+            toResend = mergeIntoSnapshot(op.text, unconfirmed, journaled); // text_compressed уже распакован в сетевом потоке
+        }
+    }
+    m_resume = {};
+    const bool reconnected = m_reconnect->sessionEstablished();
+    if (resuming) {
+        sendOpsFrame(toResend); // уже лежит в OtClient как неподтвержденная пачка
+    } else {
+        sendOutgoingOps(toResend);
+    }
+    updatePushProgress();
+    if (reconnected) {
+        statusBar()->showMessage(tr("Переподключено за %1 с, повторено своих операций: %2")
+                                     .arg(m_reconnect->lastOutageMs() / 1000.0, 0, 'f', 1).arg(toResend.size()));
+    }
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (const CursorMessage& cursorInfo : op.cursors) {
+        // создаем/обновляем запись участника, рисует его слой курсоров
+        m_participants.updatePresence(cursorInfo.clientId, cursorInfo.position, cursorInfo.anchor,
+                                      cursorInfo.username, cursorInfo.color, now);
+    }
+    repositionRemoteDecorations();
+    updateUserListUI();
+    highlighter->rehighlight();
+
+    ui->actionSaveSession->setVisible(m_isAdmin);
+    ui->actionCopyId->setVisible(true);
+    ui->actionShowListUsers->setVisible(true);
+    ui->actionLeaveSession->setVisible(true);
+    if (m_shouldSaveAfterCreation) {
+        QJsonObject saveSessionMessage;
+        saveSessionMessage["type"] = "save_session";
+        saveSessionMessage["client_id"] = m_clientId;
+        saveSessionMessage["session_id"] = m_sessionId; // Используем ПОЛУЧЕННЫЙ ID
+        saveSessionMessage["days"] = m_pendingSaveDays;
+
+        if (m_connection->isConnected()) {
+            sendToServer(saveSessionMessage);
+            qDebug() << "Отправлен запрос на сохранение сессии" << m_sessionId << "на" << m_pendingSaveDays << "дней (после создания)";
+        } else {
+            qDebug() << "Ошибка: Не удалось отправить запрос на сохранение сессии после создания (сокет не подключен?)";
         }
+        m_pendingSaveDays = 0; // сброс флага
+        m_shouldSaveAfterCreation = false;
+    }
+}
 
-    } else if (opType == "user_list_update")
-    {
-        remoteUsers.clear();
-        QJsonArray users = op["users"].toArray();
-        for (const QJsonValue& userValue : users) {
-            QJsonObject user = userValue.toObject();
-            QString clientId = user["client_id"].toString();
-            remoteUsers[clientId] = user;
-
-            // Добавляем обработку mute_end_time
-            if(user.contains("mute_end_time")) {
-                QJsonValue muteEndTimeValue = user["mute_end_time"];
-                if(muteEndTimeValue.isNull()){
-                    m_muteEndTimes.remove(clientId);
-                } else {
-                    m_muteEndTimes[clientId] = muteEndTimeValue.toVariant().toLongLong();
-                }
+// полный список приходит при входе (и от старого сервера на каждое изменение): меню меняется только в отличиях
+void MainWindowCodeEditor::handleUserListUpdate(const InboundMessage& message)
+{
+    const QList<CollabUser>& users = message.as<UserListMessage>().users;
+    for (const CollabUser& user : users) {
+        // Добавляем обработку mute_end_time
+        if (user.hasMuteEndTime) {
+            if (user.muteEndTime < 0) {
+                m_muteEndTimes.remove(user.clientId);
+            } else {
+                m_muteEndTimes[user.clientId] = user.muteEndTime;
             }
         }
-        updateUserListUI();
+    }
+    applyUserListDiff(remoteUsers.replaceAll(users));
+}
 
-    } else if (opType == "user_disconnected")
-    {
-        QString disconnectedClientId = op["client_id"].toString();
-        QString disconnectedUsername = op["username"].toString();
-        qDebug() << "Клиент отключился (уведомление)" << disconnectedUsername << disconnectedClientId;
-        statusBar()->showMessage("Клиент отключился (уведомление) " + disconnectedUsername);
+void MainWindowCodeEditor::handleUserJoined(const InboundMessage& message)
+{
+    const CollabUser& user = message.as<UserJoinedMessage>().user;
+    if (user.hasMuteEndTime && user.muteEndTime >= 0) {
+        m_muteEndTimes[user.clientId] = user.muteEndTime;
+    }
+    applyUserListDiff(remoteUsers.upsert(user));
+}
 
-        if (remoteCursors.contains(disconnectedClientId)) {
-            delete remoteCursors.take(disconnectedClientId);
-        }
+void MainWindowCodeEditor::handleUserDisconnected(const InboundMessage& message)
+{
+    const UserDisconnectedMessage& op = message.as<UserDisconnectedMessage>();
+    qDebug() << "Клиент отключился (уведомление)" << op.username << op.clientId;
+    statusBar()->showMessage("Клиент отключился (уведомление) " + op.username);
+
+    m_participants.remove(op.clientId);
+    m_pendingRemotePresence.remove(op.clientId);
+    m_cursorOverlay->setLineHighlightHidden(op.clientId, false);
+    applyUserListDiff(remoteUsers.remove(op.clientId));
+}
+
+void MainWindowCodeEditor::handleFileContentUpdate(const InboundMessage& message)
+{
+    const FileContentMessage& op = message.as<FileContentMessage>();
+    if (op.path != m_documentPath || m_documentPending) {
+        // снимок закрытого документа: сервер отверг его пачку, досылать больше нечего
+        m_closingDocuments.remove(op.path);
+        return;
+    }
+    QSignalBlocker blocker(m_codeEditor->document());
+    if (m_otEnabled && op.revision >= 0) {
+        // полная синхронизация от сервера, все неподтвержденное считается устаревшим
+        m_opQueue->clear();
+        m_otClient.reset(op.revision);
+        updatePushProgress();
+    }
+    m_codeEditor->setPlainText(op.text); // замена всего содержимого в редакторе
+    if (m_lspManager) {
+        m_lspManager->markDocumentStale(m_currentLspFileUri, m_codeEditor->document());
+    }
+    qDebug() << "Применено обновление содержимого файла";
+}
+
+void MainWindowCodeEditor::handleChatMessage(const InboundMessage& message)
+{
+    const ChatTextMessage& op = message.as<ChatTextMessage>();
+    addChatMessageWidget(op.username, op.text, QTime::currentTime(), false); // false - не свое сообщение
 
-        if (remoteLineHighlights.contains(disconnectedClientId)) {
-            delete remoteLineHighlights.take(disconnectedClientId);
+    if (!chatWidget->isVisible() || this->isMinimized()) {
+
+        if (!m_trayIcon) { //m_trayIcon == nullptr) {
+            m_trayIcon = new QSystemTrayIcon(this);
+            connect(m_trayIcon, &QSystemTrayIcon::messageClicked, this, [this]() { // раскрытие чата при клике на уведомление
+                if (this->isMinimized()) {
+                    this->showNormal();
+                    this->activateWindow();
+                }
+                if (!chatWidget->isVisible()) {
+                    chatWidget->setVisible(true);
+                    chatInput->setFocus();
+                    scrollToBottom();
+                }
+            });
         }
+        m_trayIcon->setIcon(QIcon(":/styles/chat_light.png"));
+        m_trayIcon->show();
+        QString title = "У вас новое сообщение от " + op.username; // Заголовок уведомления
+        m_trayIcon->showMessage(title, op.text, QSystemTrayIcon::Information, 3000);
+    }
+}
 
-        remoteUsers.remove(disconnectedClientId);
-        lastCursorPositions.remove(disconnectedClientId);
-        updateUserListUI();
+void MainWindowCodeEditor::handleCursorPositionUpdate(const InboundMessage& message)
+{
+    const CursorMessage& op = message.as<CursorMessage>();
+    if (op.clientId == m_clientId) return; // игнорирование собственных сообщений
+    if (op.path != m_documentPath || m_documentPending) return; // курсор в другом файле
 
-    } else if (opType == "file_content_update")
-    {
-        QSignalBlocker blocker(m_codeEditor->document());
-        QString fileText = op["text"].toString();
-        m_codeEditor->setPlainText(fileText); // замена всего содержимого в редакторе
-        qDebug() << "Применено обновление содержимого файла";
-
-    } else if (opType == "chat_message") {
-        QString username = op["username"].toString();
-        QString chatMessage = op["text_message"].toString();
-        addChatMessageWidget(username, chatMessage, QTime::currentTime(), false); // false - не свое сообщение
-
-        if (!chatWidget->isVisible() || this->isMinimized()) {
-
-            if (!m_trayIcon) { //m_trayIcon == nullptr) {
-                m_trayIcon = new QSystemTrayIcon(this);
-                connect(m_trayIcon, &QSystemTrayIcon::messageClicked, this, [this]() { // раскрытие чата при клике на уведомление
-                    if (this->isMinimized()) {
-                        this->showNormal();
-                        this->activateWindow();
-                    }
-                    if (!chatWidget->isVisible()) {
-                        chatWidget->setVisible(true);
-                        chatInput->setFocus();
-                        scrollToBottom();
-                    }
-                });
+    // из пачки обновлений за один проход цикла событий применяется только последнее для каждого клиента
+    m_pendingRemotePresence.insert(op.clientId, op);
+    if (!m_remotePresenceScheduled) {
+        m_remotePresenceScheduled = true;
+        QTimer::singleShot(0, this, &MainWindowCodeEditor::applyPendingRemotePresence);
+    }
+}
+
+void MainWindowCodeEditor::handleMuteNotification(const InboundMessage& message)
+{
+    const int duration = message.as<MuteNotificationMessage>().duration;
+    QString messageText;
+    if(duration == 0) {
+        messageText = tr("Вы бессрочно заглушены и не можете редактировать текст");
+    } else {
+        messageText = tr("Вы заглушены на %1 секунд. Вы не можете редактировать текст").arg(duration);
+    }
+    //QMessageBox::warning(this, tr("Заглушены"), messageText);
+    QMessageBox *msgBox = new QMessageBox(QMessageBox::Warning, tr("Заглушены"), messageText, QMessageBox::Ok, this);
+    msgBox->show();
+    updateMutedStatus(); //обновляем мьют, так как это сообщение говорит о том, что пользователя замьютили
+}
+
+void MainWindowCodeEditor::handleMutedStatusUpdate(const InboundMessage& message)
+{
+    const MutedStatusMessage& op = message.as<MutedStatusMessage>();
+    m_mutedClients[op.clientId] = op.isMuted;
+
+    // Добавляем обработку времени окончания мьюта
+    if (op.hasMuteEndTime) {
+        if (op.muteEndTime < 0) {
+            m_muteEndTimes.remove(op.clientId);
+            if (m_clientId == op.clientId) {
+                QMessageBox::information(this, tr("Размьют"), tr("Вы разблокированы, можете редактировать текст!"));
             }
-            m_trayIcon->setIcon(QIcon(":/styles/chat_light.png"));
-            m_trayIcon->show();
-            QString title = "У вас новое сообщение от " + username; // Заголовок уведомления
-            QString message = chatMessage;
-            m_trayIcon->showMessage(title, message, QSystemTrayIcon::Information, 3000);
+        } else {
+            m_muteEndTimes[op.clientId] = op.muteEndTime;
         }
-    } else if (opType == "cursor_position_update") {
-        QString senderId = op["client_id"].toString();
-        if (senderId == m_clientId) return; // игнорирование собственных сообщений
+    }
+    onMutedStatusUpdate(op.clientId, op.isMuted);
+}
+
+void MainWindowCodeEditor::handleAdminChanged(const InboundMessage& message)
+{
+    onAdminChanged(message.as<AdminChangedMessage>().newAdminId);
+}
 
-        int position = op["position"].toInt();
-        QString username = op["username"].toString();
-        QColor color = QColor(op["color"].toString());
+void MainWindowCodeEditor::handleRemoteOps(const InboundMessage& message)
+{
+    const OpsMessage& op = message.as<OpsMessage>();
+    if (m_clientId == op.senderId) return;
+    if (op.path != m_documentPath || m_documentPending) {
+        // правки закрытого документа: к нашему тексту не относятся, но его неотправленный буфер должен их учесть
+        // до document_info правки открываемого документа уже входят в его снимок
+        auto closing = m_closingDocuments.find(op.path);
+        if (closing != m_closingDocuments.end() && m_otEnabled) {
+            closing->applyRemote(op.ops, op.senderId, op.revision);
+        }
+        return;
+    }
+    if (!op.valid) {
+        resyncAfterBrokenOps();
+        return;
+    }
 
-        cursorUpdates.append(op);
+    // операции разобраны в сетевом потоке; применяются в конце прохода цикла событий вместе с остальными
+    m_remoteOps->enqueue({op.senderId, op.revision, op.ops});
+}
 
-        if (!remoteCursors.contains(senderId)) // проверка наличия удаленного курсора для данного клиента, если его нет, то он рисуется с нуля
-        {
-            CursorWidget* cursorWidget = new CursorWidget(m_codeEditor->viewport(), color); // создается курсор имнено на области отображения текста для правильного позиционирвоания
-            remoteCursors[senderId] = cursorWidget;
-            cursorWidget->setCustomToolTipStyle(color);
-            cursorWidget->show();
+// часть пачки не разобралась: применить остальное - значит разойтись с сервером, пропустить всю - потерять ревизию
+// рвем соединение сами; переподключение возобновит сессию с последней целой ревизии или возьмет снимок
+void MainWindowCodeEditor::resyncAfterBrokenOps()
+{
+    qWarning() << "Неразборчивые операции в документе" << m_documentPath << "- переподключаемся для сверки";
+    m_resyncRequested = true;
+    m_connection->abort();
+}
 
-            LineHighlightWidget* lineHighlight = new LineHighlightWidget(m_codeEditor->viewport(), color.lighter(150));
-            remoteLineHighlights[senderId] = lineHighlight;
-            lineHighlight->show();
+void MainWindowCodeEditor::handleAck(const InboundMessage& message)
+{
+    const AckMessage& ack = message.as<AckMessage>();
+    if (ack.path != m_documentPath || m_documentPending) {
+        // подтверждение в уже закрытом документе: досылаем его буфер, пока не подтвердится все
+        auto closing = m_closingDocuments.find(ack.path);
+        if (closing == m_closingDocuments.end()) return;
+        const QList<CollabOp> toSend = closing->serverAck(ack.revision);
+        if (toSend.isEmpty()) {
+            m_closingDocuments.erase(closing);
+        } else {
+            sendOpsFrame(toSend, ack.path, closing->revision());
         }
+        return;
+    }
+    // сервер принял нашу пачку, можно отправлять то, что набралось за время ожидания (или следующий кусок большой вставки)
+    const QList<CollabOp> toSend = m_otClient.serverAck(ack.revision);
+    if (!toSend.isEmpty()) {
+        sendOpsFrame(toSend);
+    }
+    updatePushProgress();
+}
 
-        CursorWidget* cursorWidget = remoteCursors[senderId];
-        LineHighlightWidget* lineHighlight = remoteLineHighlights[senderId];
-        if (cursorWidget && lineHighlight)
+void MainWindowCodeEditor::handleDocumentInfo(const InboundMessage& message)
+{
+    const DocumentInfoMessage& info = message.as<DocumentInfoMessage>();
+    if (!m_documentPending || info.path != m_documentPath) return; // пока ждали, открыли другой файл
+    m_documentPending = false;
+    m_otClient.reset(qMax(0, info.revision));
+    if (info.seed) {
+        // файл больше кадра, и в сессии его еще не было: текст уже в редакторе, на сервер он уходит вставками по кускам
+        const QString text = m_codeEditor->toPlainText();
+        if (!text.isEmpty()) {
+            sendOutgoingOps({CollabOp::makeInsert(0, text)});
+        }
+        m_codeEditor->setReadOnly(m_mutedClients.value(m_clientId));
+    } else {
         {
-            cursorWidget->setUsername(username);
-            updateRemoteWidgetGeometry(cursorWidget, position); // обновляем позицию курсора
-            updateLineHighlight(senderId, position); // обновляем подсветку строки
+            QSignalBlocker blocker(m_codeEditor->document());
+            m_codeEditor->setPlainText(info.text); // text_compressed уже распакован в сетевом потоке
         }
-
-    } else if (opType == "mute_notification") {
-        int duration = op["duration"].toInt();
-        QString messageText;
-        if(duration == 0) {
-            messageText = tr("Вы бессрочно заглушены и не можете редактировать текст");
-        } else {
-            messageText = tr("Вы заглушены на %1 секунд. Вы не можете редактировать текст").arg(duration);
-        }
-        //QMessageBox::warning(this, tr("Заглушены"), messageText);
-        QMessageBox *msgBox = new QMessageBox(QMessageBox::Warning, tr("Заглушены"), messageText, QMessageBox::Ok, this);
-        msgBox->show();
-        updateMutedStatus(); //обновляем мьют, так как это сообщение говорит о том, что пользователя замьютили
-
-    } else if (opType == "muted_status_update") {
-        QString mutedClientId = op["client_id"].toString();
-        bool mutedClientStatus = op["is_muted"].toBool();
-        m_mutedClients[mutedClientId] = mutedClientStatus;
-
-        // Добавляем обработку времени окончания мьюта
-        if (op.contains("mute_end_time")) {
-            QJsonValue muteEndTimeValue = op["mute_end_time"];
-            if (muteEndTimeValue.isNull()) {
-                m_muteEndTimes.remove(mutedClientId);
-                if (m_clientId == mutedClientId) {
-                    QMessageBox::information(this, tr("Размьют"), tr("Вы разблокированы, можете редактировать текст!"));
-                }
-            } else {
-                m_muteEndTimes[mutedClientId] = muteEndTimeValue.toVariant().toLongLong();
-            }
+        m_codeEditor->setReadOnly(m_mutedClients.value(m_clientId));
+        lineNumberArea->updateLineNumberAreaWidth();
+        highlighter->rehighlight();
+        if (m_lspManager && m_lspManager->isReady() && !m_currentLspFileUri.isEmpty()) {
+            m_lspManager->notifyDidChange(m_currentLspFileUri, info.text);
         }
-        onMutedStatusUpdate(mutedClientId, mutedClientStatus);
+    }
+    updatePushProgress();
 
-    } else if (opType == "admin_changed") {
-        QString newAdminId = op["new_admin_id"].toString();
-        onAdminChanged(newAdminId);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (const CursorMessage& cursorInfo : info.cursors) {
+        m_participants.updatePresence(cursorInfo.clientId, cursorInfo.position, cursorInfo.anchor,
+                                      cursorInfo.username, cursorInfo.color, now);
+    }
+    repositionRemoteDecorations();
+    m_presence->reset();
+    onCursorPositionChanged(); // свой курсор - тем, у кого этот файл открыт
+    qDebug() << "Открыт общий документ" << info.path << "ревизия" << info.revision << "участников в нем" << info.cursors.size();
+}
+
+void MainWindowCodeEditor::handleDocumentClosed(const InboundMessage& message)
+{
+    const DocumentClosedMessage& closed = message.as<DocumentClosedMessage>();
+    if (closed.path != m_documentPath) return;
+    m_participants.remove(closed.clientId);
+    m_pendingRemotePresence.remove(closed.clientId);
+    m_cursorOverlay->setLineHighlightHidden(closed.clientId, false);
+    repositionRemoteDecorations();
+}
+
+bool MainWindowCodeEditor::isHashCheckIdle() const
+{
+    return m_connection->isConnected() && m_serverFeatures.contains("doc_hash") && m_otEnabled && !m_documentPending
+           && !isBufferingOffline() && !m_otClient.isAwaitingAck() && m_otClient.bufferedOps().isEmpty()
+           && m_opQueue->isEmpty() && !m_remoteOps->hasPending();
+}
+
+void MainWindowCodeEditor::onHashCheckTimer()
+{
+    if (!isHashCheckIdle()) return; // сверим в следующий раз, когда правки улягутся
+    m_divergence->check(m_documentPath, m_otClient.revision());
+}
+
+void MainWindowCodeEditor::handleHashRanges(const InboundMessage& message)
+{
+    const HashRangesMessage& ranges = message.as<HashRangesMessage>();
+    // пока шел ответ, появились правки - сравнивать уже нечего, сверка повторится по таймеру
+    if (!isHashCheckIdle() || ranges.revision != m_otClient.revision()) {
+        m_divergence->cancel();
+        return;
+    }
+    m_divergence->handleRanges(ranges);
+}
 
-    } else if (opType == "insert")
+void MainWindowCodeEditor::handleBlockText(const InboundMessage& message)
+{
+    const BlockTextMessage& block = message.as<BlockTextMessage>();
+    if (!isHashCheckIdle() || block.revision != m_otClient.revision()) {
+        m_divergence->cancel();
+        return;
+    }
+    QList<CollabOp> ops;
+    if (!m_divergence->repairOps(block, ops)) return;
+    const int repairs = m_divergence->repairCount();
     {
+        // как и чужие правки: серверный текст не уходит обратно на сервер как наш
         QSignalBlocker blocker(m_codeEditor->document());
-        QString senderId = op["client_id"].toString();
-        if (m_clientId == senderId) return;
-
-        QString text = op["text"].toString();
-        int position = op["position"].toInt();
         QTextCursor cursor(m_codeEditor->document());
-        cursor.setPosition(position);
-        cursor.insertText(text);
-        qDebug() << "Применена операция вставки";
+        cursor.beginEditBlock();
+        RemoteOpApplier::applyOps(cursor, ops, &m_participants);
+        cursor.endEditBlock();
+    }
+    repositionRemoteDecorations();
+    m_divergence->repairApplied();
+    if (ops.isEmpty()) return;
+
+    // починка редкая, поэтому подсветка и LSP обновляются целиком
+    highlighter->rehighlight();
+    if (m_lspManager && m_lspManager->isReady() && !m_currentLspFileUri.isEmpty()) {
+        m_lspManager->notifyDidChange(m_currentLspFileUri, m_codeEditor->toPlainText());
+    }
+    if (m_divergence->repairCount() > repairs) {
+        statusBar()->showMessage(tr("Документ расходился с сервером, заменено строк: %1").arg(m_divergence->lastRepairLines()), 5000);
+    }
+}
+
+void MainWindowCodeEditor::handleSessionSaved(const InboundMessage& message)
+{
+    statusBar()->showMessage(tr("Сессия сохранена на %1 дней").arg(message.as<SessionSavedMessage>().days));
+}
+
+// догоняющие операции строго по порядку ревизий после нашей
+bool MainWindowCodeEditor::applyCatchUp(const SessionInfoMessage& info, QList<CollabOp>& toSend)
+{
+    if (!info.catchUpValid) {
+        qWarning() << "В догоняющих операциях есть неразборчивые";
+        return false;
+    }
+    int expected = m_resume.revision + 1;
+    QList<RemoteOpApplier::Batch> batches;
+    batches.reserve(info.catchUp.size());
+    for (const CatchUpEntry& entry : info.catchUp) {
+        if (entry.revision != expected++) {
+            qWarning() << "Догоняющие операции идут не по порядку, ревизия" << entry.revision;
+            return false;
+        }
+        // своя пачка уже есть в тексте, у нее учитываем только ревизию (как ack)
+        batches.append({entry.senderId, entry.revision, entry.senderId != m_clientId ? entry.ops : QList<CollabOp>()});
+    }
+    if (expected - 1 != info.revision) {
+        qWarning() << "Догоняющие операции заканчиваются на" << expected - 1 << "а сервер на" << info.revision;
+        return false;
+    }
+
+    if (m_otClient.revision() != m_resume.revision) {
+        qWarning() << "Состояние OT не совпадает с точкой возобновления:" << m_otClient.revision() << m_resume.revision;
+        return false;
+    }
+
+    // набранное без связи продолжает наши неподтвержденные правки и преобразуется вместе с ними
+    m_otClient.applyLocal(m_offlineOps.takeAll());
+    for (RemoteOpApplier::Batch& batch : batches) {
+        m_remoteOps->enqueue(std::move(batch));
+    }
+    m_remoteOps->drain(); // одним блоком правки, как обычные чужие операции
+    toSend = m_otClient.resendPending();
+    qDebug() << "Сессия догнана с ревизии" << m_resume.revision << "до" << m_otClient.revision()
+             << "операциями:" << info.catchUp.size() << "своих к повтору:" << toSend.size();
+    return true;
+}
+
+// снимок после обрыва: своя правка и правки сессии - две разницы с текстом на ревизии обрыва (m_resume.baseText)
+// если они не задевают друг друга, применяются обе, как одновременные операции OT
+// иначе (пересекаются, нет базы, пачка до обрыва не подтверждена) в редакторе снимок, а свой текст предлагается вернуть
+QList<CollabOp> MainWindowCodeEditor::mergeIntoSnapshot(const QString& snapshot, bool unconfirmed, bool journaled)
+{
+    const QString localText = m_codeEditor->toPlainText();
+    QList<CollabOp> local;
+    bool conflict = false;
+    if (m_resume.sessionId.isEmpty() || localText == snapshot) {
+        // обычный вход (текст сессии главнее текста открытого файла) или сессия уже совпадает с нами
+    } else if (m_resume.hasBase) {
+        local = OtTransform::diff(m_resume.baseText, localText);
+        QList<CollabOp> remote = OtTransform::diff(m_resume.baseText, snapshot);
+        conflict = editsTouch(local, remote);
+        if (!conflict) {
+            OtTransform::transform(local, remote, false);
+        }
+    } else {
+        conflict = unconfirmed || journaled || m_resume.documentRevision != m_codeEditor->document()->revision();
+    }
+    if (conflict) {
+        local.clear();
+    }
 
-    } else if (opType == "delete")
     {
+        // без сигналов документа: иначе весь текст снимка ушел бы обратно на сервер как наша вставка
         QSignalBlocker blocker(m_codeEditor->document());
-        QString senderId = op["client_id"].toString();
-        if (m_clientId == senderId) return;
+        m_codeEditor->setPlainText(snapshot);
+        if (!local.isEmpty()) {
+            QTextCursor cursor(m_codeEditor->document());
+            cursor.beginEditBlock();
+            local = RemoteOpApplier::applyOps(cursor, local, nullptr);
+            cursor.endEditBlock();
+        }
+    }
+    if (m_lspManager) {
+        m_lspManager->markDocumentStale(m_currentLspFileUri, m_codeEditor->document());
+    }
+    if (conflict) {
+        qWarning() << "Свои правки не сводятся со снимком сессии" << m_documentPath;
+        offerLocalTextRestore(localText);
+    }
+    return local;
+}
 
-        int count = op["count"].toInt();
-        int position = op["position"].toInt();
+void MainWindowCodeEditor::offerLocalTextRestore(const QString& localText)
+{
+    QApplication::clipboard()->setText(localText);
+    // окно не модальное: пока пользователь думает, документ живет дальше как обычно
+    auto *box = new QMessageBox(QMessageBox::Warning, tr("Конфликт правок"),
+                                tr("Пока не было связи, документ изменился и у вас, и в сессии, и свести правки не удалось. "
+                                   "В редакторе текст сессии, ваш вариант скопирован в буфер обмена."),
+                                QMessageBox::NoButton, this);
+    box->setAttribute(Qt::WA_DeleteOnClose);
+    QPushButton *restore = box->addButton(tr("Вернуть мой текст"), QMessageBox::AcceptRole);
+    box->addButton(tr("Оставить текст сессии"), QMessageBox::RejectRole);
+    const QString path = m_documentPath;
+    connect(restore, &QPushButton::clicked, this, [this, localText, path]() {
+        if (path != m_documentPath || m_codeEditor->isReadOnly()) return;
+        // обычная замена текста: уходит остальным через onContentsChange, как вставка пользователя
         QTextCursor cursor(m_codeEditor->document());
-        cursor.setPosition(position);
-        cursor.setPosition(position + count, QTextCursor::KeepAnchor);
-        cursor.removeSelectedText();
-        qDebug() << "Применена операция удаления";
-    } else if (opType == "session_saved") {
-        int days = op["days"].toInt();
-        statusBar()->showMessage(tr("Сессия сохранена на %1 дней").arg(days));
+        cursor.select(QTextCursor::Document);
+        cursor.insertText(localText);
+    });
+    box->open();
+}
+
+void MainWindowCodeEditor::applyPendingRemotePresence()
+{
+    m_remotePresenceScheduled = false;
+    m_remoteOps->drain(); // позиции курсоров относятся к тексту уже с чужими правками
+    const QHash<QString, CursorMessage> pending = std::exchange(m_pendingRemotePresence, {});
+    for (const CursorMessage& op : pending) {
+        applyRemotePresence(op);
     }
 }
 
+void MainWindowCodeEditor::applyRemotePresence(const CursorMessage& op)
+{
+    m_participants.updatePresence(op.clientId, op.position, op.anchor, op.username, op.color,
+                                  QDateTime::currentMSecsSinceEpoch());
+    repositionRemoteDecorations();
+}
+
+// все удаленные курсоры рисует один слой поверх viewport, здесь только просим перерисовку
+// несколько вызовов подряд склеиваются в один paintEvent
+void MainWindowCodeEditor::repositionRemoteDecorations()
+{
+    if (m_cursorOverlay) {
+        m_cursorOverlay->update();
+    }
+}
 
 void MainWindowCodeEditor::onCursorPositionChanged()
 {
-    int cursorPosition = m_codeEditor->textCursor().position(); // номер символа, где курсор
+    const QTextCursor cursor = m_codeEditor->textCursor();
+    // строки вокруг курсора и выделения - отсюда следующая правка возьмет удаленный текст
+    m_editPreimage.capture(m_codeEditor->document(), cursor.selectionStart(), cursor.selectionEnd());
+    // каждое движение только запоминается, на сервер уходит последнее положение с ограниченной частотой
+    if (m_presence) {
+        m_presence->update(cursor.position(), cursor.anchor());
+    }
+    // автодополнение, запрошенное в другом месте, сервер может не досчитывать
+    if (m_lspManager && m_lspManager->isReady() && !m_currentLspFileUri.isEmpty()) {
+        const QPoint lspPos = m_lspManager->editorPosToLspPos(m_codeEditor->document(), m_codeEditor->textCursor().position());
+        m_lspManager->notifyCursorMoved(m_currentLspFileUri, lspPos.x(), lspPos.y());
+    }
+}
+
+bool MainWindowCodeEditor::sendPresence(int position, int anchor)
+{
+    if (!m_connection->isConnected() || m_sessionId.isEmpty() || isBufferingOffline()) {
+        return true; // вне сессии отправлять некому, после session_info канал сбрасывается
+    }
+    // курсор отправляем после текста, иначе у собеседника он встанет на еще не пришедшую позицию
+    if (m_opQueue && !m_opQueue->isEmpty()) {
+        return false;
+    }
+    // сокет не успевает отдавать данные: операции правки важнее, позицию отправим позже
+    if (m_connection->pendingBytes() > PresenceBackpressureBytes) {
+        return false;
+    }
     QJsonObject cursorUpdate;
     cursorUpdate["type"] = "cursor_position_update";
-    cursorUpdate["position"] = cursorPosition;
+    cursorUpdate["position"] = position;
+    if (anchor != position) {
+        cursorUpdate["anchor"] = anchor; // есть выделение
+    }
     cursorUpdate["client_id"] = m_clientId;
-    QJsonDocument doc(cursorUpdate); // джсон объект в документ
-    QString message = QString::fromUtf8(doc.toJson(QJsonDocument::Compact)); // документ в строку в компактном виде
-    if (socket && socket->state() == QAbstractSocket::ConnectedState)
-    {
-        socket->sendTextMessage(message);
-        qDebug() << "Отправлено сообщение о позиции курсора" << message;
+    if (!m_documentPath.isEmpty()) {
+        cursorUpdate["path"] = m_documentPath;
+    }
+    sendToServer(cursorUpdate);
+    return true;
+}
+
+void MainWindowCodeEditor::onShowMessageStats()
+{
+    if (!m_messageStatsDialog) {
+        m_messageStatsDialog = new MessageStatsDialog(&m_messageStats, m_connection, this);
+        m_messageStatsDialog->setAttribute(Qt::WA_DeleteOnClose);
+    }
+    m_messageStatsDialog->show();
+    m_messageStatsDialog->raise();
+    m_messageStatsDialog->activateWindow();
+}
+
+void MainWindowCodeEditor::onRecordSessionToggled(bool checked)
+{
+    if (!checked) {
+        m_connection->stopRecording();
+        statusBar()->showMessage(tr("Запись сообщений остановлена"), 3000);
+        return;
     }
+    const QString defaultPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/session-"
+                                + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + ".bamrec";
+    const QString path = QFileDialog::getSaveFileName(this, tr("Запись сообщений сессии"), defaultPath,
+                                                      tr("Запись сессии (*.bamrec)"));
+    QString error;
+    if (path.isEmpty() || !m_connection->startRecording(path, &error)) {
+        if (!path.isEmpty()) {
+            QMessageBox::warning(this, tr("Запись сообщений"), tr("Не удалось открыть файл записи: %1").arg(error));
+        }
+        QSignalBlocker blocker(ui->actionRecordSession);
+        ui->actionRecordSession->setChecked(false);
+        return;
+    }
+    statusBar()->showMessage(tr("Сообщения сессии записываются в %1").arg(path), 5000);
 }
 
 void MainWindowCodeEditor::onShowUserList()
 {
-    updateUserListUI(); // обновляем содержмиое меню
+    // меню уже совпадает с remoteUsers: каждое изменение участников правит свой пункт
     QPoint globalPos = QCursor::pos();
     m_userListMenu->exec(globalPos);
 }
 
 void MainWindowCodeEditor::updateUserListUI()
 {
-    m_userListMenu->clear();
-
-    for (const QString& clientId : remoteUsers.keys()) {
-        QJsonObject user = remoteUsers[clientId];
-        QString username = user["username"].toString();
-        QColor color = QColor(user["color"].toString());
-        bool isAdmin = user["is_admin"].toBool();
-        bool isMuted = m_mutedClients.contains(clientId) && m_mutedClients.value(clientId) != 0;
-
-        // создаем иконку с цветным кружком
-        QPixmap pixmap(13, 13); // размер кружка
-        pixmap.fill(Qt::transparent);
-        QPainter painter(&pixmap);
-        painter.setRenderHint(QPainter::Antialiasing);
-        painter.setBrush(color);
-        painter.setPen(Qt::NoPen); // без контура
-        painter.drawEllipse(0, 0, 12, 12); // рисуем кружок
-        QIcon icon(pixmap);
-
-        // создаем QAction
-        QString actionText = username;
-        if (isAdmin) {
-            actionText += " (Админ)";
-        }
-        if (isMuted) {
-            actionText += tr(" (Мьют)");
-        }
-        QAction *userAction = new QAction(icon, actionText, this); // иконка + текст
-        userAction->setData(clientId);
-
-        // создаем меню списка пользователей для каждого пользователя
-        QMenu* userContextMenu = new QMenu(this);
-        if (m_isAdmin) {
-            QAction *muteUnmuteAction = new QAction(isMuted ? tr("Размьют") : tr("Мьют"), this);
-            QAction *transferAdminAction = new QAction("Передать права админа", this);
-            QAction *userInfoAction = new QAction("Информация", this);
-            userContextMenu->addAction(muteUnmuteAction);
-            userContextMenu->addAction(transferAdminAction);
-            userContextMenu->addAction(userInfoAction);
-
-            if (clientId == m_clientId) {
-                transferAdminAction->setVisible(false);
-                muteUnmuteAction->setVisible(false);
-            }
-
-            // подключаем сигналы данных кнопок, используем лямбда-функции для передачи clientId
-            connect(muteUnmuteAction, &QAction::triggered, this, [this, clientId]() { onMuteUnmute(clientId); });
-            connect(transferAdminAction, &QAction::triggered, this, [this, clientId]() { onTransferAdmin(clientId); });
-            connect(userInfoAction, &QAction::triggered, this, [this, clientId]() { showUserInfo(clientId); });
-        } else {
-            QAction *userInfoAction = new QAction(tr("Информация"), this);
-            userContextMenu->addAction(userInfoAction);
-            connect(userInfoAction, &QAction::triggered, this, [this, clientId]() { showUserInfo(clientId); });
+    SessionUserList::Diff diff;
+    for (auto it = m_userActions.cbegin(); it != m_userActions.cend(); ++it) {
+        if (!remoteUsers.contains(it.key())) {
+            diff.removed.append(it.key());
         }
-        userAction->setMenu(userContextMenu); // Связываем QAction с QMenu
-
-        m_userListMenu->addAction(userAction);
     }
+    for (const CollabUser& user : remoteUsers.users()) {
+        if (!m_userActions.contains(user.clientId)) {
+            diff.added.append(user.clientId);
+        }
+    }
+    applyUserListDiff(diff);
 }
 
-// функция обновления информации об одном конкретном пользователе в списке, вместо полного обновления списка, что снизить нагрузку
-void MainWindowCodeEditor::updateUserListUser(const QString& clientId)
+void MainWindowCodeEditor::applyUserListDiff(const SessionUserList::Diff& diff)
 {
-    // находим нужный QAction (кнопку в списке меню пользователей), конкретного пользователя
-    QAction* userAction = nullptr;
-    for (QAction* action : m_userListMenu->actions()) {
-        if (action->data().toString() == clientId) {
-            userAction = action;
-            return;
+    for (const QString& clientId : diff.removed) {
+        if (QAction *action = m_userActions.take(clientId)) {
+            m_userListMenu->removeAction(action);
+            delete action->menu();
+            delete action;
         }
     }
+    for (const QString& clientId : diff.added) {
+        if (m_userActions.contains(clientId)) {
+            updateUserListUser(clientId);
+            continue;
+        }
+        // порядок как в remoteUsers: вставляем перед следующим участником, у которого пункт уже есть
+        QAction *before = nullptr;
+        for (QString next = remoteUsers.nextClientId(clientId); !next.isEmpty() && !before;
+             next = remoteUsers.nextClientId(next)) {
+            before = m_userActions.value(next);
+        }
+        m_userListMenu->insertAction(before, createUserAction(clientId));
+    }
+    for (const QString& clientId : diff.updated) {
+        updateUserListUser(clientId);
+    }
+}
 
-    if (!userAction) return;
+QAction *MainWindowCodeEditor::createUserAction(const QString& clientId)
+{
+    QAction *userAction = new QAction(this);
+    userAction->setData(clientId);
+    // подменю зависит от того, админ ли мы сейчас, поэтому собирается при каждом открытии, а не при смене прав
+    QMenu *userContextMenu = new QMenu(this);
+    connect(userContextMenu, &QMenu::aboutToShow, this, [this, userContextMenu, clientId]() {
+        fillUserContextMenu(userContextMenu, clientId);
+    });
+    userAction->setMenu(userContextMenu); // Связываем QAction с QMenu
+    m_userActions.insert(clientId, userAction);
+    updateUserListUser(clientId);
+    return userAction;
+}
 
-    QJsonObject user = remoteUsers[clientId];
-    QString username = user["username"].toString();
-    QColor color = user["color"].toString();
-    bool isAdmin = user["is_admin"].toBool();
-    bool isMuted = m_mutedClients.contains(clientId) && m_mutedClients.value(clientId) != 0;
+void MainWindowCodeEditor::fillUserContextMenu(QMenu *menu, const QString& clientId)
+{
+    menu->clear(); // действия принадлежат меню и удаляются вместе с очисткой
+    if (m_isAdmin && clientId != m_clientId) {
+        const bool isMuted = m_mutedClients.contains(clientId) && m_mutedClients.value(clientId) != 0;
+        QAction *muteUnmuteAction = menu->addAction(isMuted ? tr("Размьют") : tr("Мьют"));
+        QAction *transferAdminAction = menu->addAction(tr("Передать права админа"));
+        // подключаем сигналы данных кнопок, используем лямбда-функции для передачи clientId
+        connect(muteUnmuteAction, &QAction::triggered, this, [this, clientId]() { onMuteUnmute(clientId); });
+        connect(transferAdminAction, &QAction::triggered, this, [this, clientId]() { onTransferAdmin(clientId); });
+    }
+    QAction *userInfoAction = menu->addAction(tr("Информация"));
+    connect(userInfoAction, &QAction::triggered, this, [this, clientId]() { showUserInfo(clientId); });
+}
 
+QIcon MainWindowCodeEditor::userIcon(const QColor& color)
+{
+    auto it = m_userIcons.constFind(color.rgba());
+    if (it != m_userIcons.cend()) {
+        return *it;
+    }
     // создаем иконку с цветным кружком
     QPixmap pixmap(13, 13); // размер кружка
     pixmap.fill(Qt::transparent);
@@ -2319,76 +3135,35 @@ void MainWindowCodeEditor::updateUserListUser(const QString& clientId)
     painter.setBrush(color);
     painter.setPen(Qt::NoPen); // без контура
     painter.drawEllipse(0, 0, 12, 12); // рисуем кружок
-    QIcon icon(pixmap);
+    painter.end();
+    return *m_userIcons.insert(color.rgba(), QIcon(pixmap));
+}
 
-    // создаем QAction
-    QString actionText = username;
-    if (isAdmin) {
+// функция обновления информации об одном конкретном пользователе в списке, вместо полного обновления списка, что снизить нагрузку
+void MainWindowCodeEditor::updateUserListUser(const QString& clientId)
+{
+    QAction *userAction = m_userActions.value(clientId);
+    if (!userAction || !remoteUsers.contains(clientId)) return;
+
+    const CollabUser user = remoteUsers.value(clientId);
+    bool isMuted = m_mutedClients.contains(clientId) && m_mutedClients.value(clientId) != 0;
+
+    QString actionText = user.username;
+    if (user.isAdmin) {
         actionText += " (Админ)";
     }
     if (isMuted) {
         actionText += tr(" (Мьют)");
     }
-    userAction->setIcon(icon);
+    userAction->setIcon(userIcon(user.color));
     userAction->setText(actionText); // устанавливаем иконку + обновленный текст
 }
 
-// обновление позиции и размера курсора (тултипа соответственно)
-void MainWindowCodeEditor::updateRemoteWidgetGeometry(QWidget* widget, int position)
-{
-    if (!widget) return;
-
-    QTextCursor tempCursor(m_codeEditor->document());
-    tempCursor.setPosition(position);
-    QRect cursorRect = m_codeEditor->cursorRect(tempCursor);
-    widget->move(cursorRect.topLeft());
-    widget->setFixedHeight(cursorRect.height());
-}
-
-void MainWindowCodeEditor::updateLineHighlight(const QString& senderId, int position)
-{
-    if (!remoteLineHighlights.contains(senderId)) return;
-
-    LineHighlightWidget* lineHighlight = remoteLineHighlights[senderId];
-    if (!lineHighlight) return;
-
-    QTextCursor tempCursor(m_codeEditor->document());
-    tempCursor.setPosition(position);
-    QRect cursorRect = m_codeEditor->cursorRect(tempCursor);
-    lineHighlight->setGeometry(
-        0, // х относительно viewport`а
-        cursorRect.top(), // y - верхняя граница cursorRect
-        /*m_codeEditor->viewport()->width(),*/
-        10000,
-        cursorRect.height()
-        );
-    // устанавливаем видимость в зависимости от статуса мьюта
-    bool isMuted = m_mutedClients.contains(senderId) && m_mutedClients.value(senderId, 0) != 0;
-    lineHighlight->setVisible(!isMuted);
-}
-
 // обновлении позиции подсветки при прокрутке
 void MainWindowCodeEditor::onVerticalScrollBarValueChanged(int value)
 {
     Q_UNUSED(value);
-    // обновляем позицию всех виджетов при прокрутке
-    for (auto i = remoteLineHighlights.begin(); i != remoteLineHighlights.end(); ++i)
-    {
-        QString senderId = "";
-        int position = -1; // значение по умолчанию, если позиция курсора для данного клиента не найдена
-        for (const auto& cursorUpdate : cursorUpdates)
-        {
-            if (cursorUpdate["client_id"].toString() == senderId)
-            {
-                position = cursorUpdate["position"].toInt();
-                break;
-            }
-        }
-        if (position != -1)
-        {
-            updateLineHighlight(senderId, position);
-        }
-    }
+    repositionRemoteDecorations(); // обновляем позицию всех виджетов при прокрутке
 }
 
 void MainWindowCodeEditor::applyCurrentTheme()
@@ -2475,15 +3250,12 @@ void MainWindowCodeEditor::onMutedStatusUpdate(const QString &clientId, bool isM
     }
 
     if (clientId != m_clientId) {
-        LineHighlightWidget* lineHighlight = remoteLineHighlights.value(clientId, nullptr);
-        if (lineHighlight) {
-            lineHighlight->setVisible(!isMuted); // Показываем, если НЕ замьючен
-        }
+        m_cursorOverlay->setLineHighlightHidden(clientId, isMuted); // подсветку строки показываем, если НЕ замьючен
     }
     if (clientId == m_clientId) {
         updateMutedStatus(); // обновляем статус, когда мьют накладывается на самого пользователя
     }
-    updateUserListUI(); // обновляем статус пользователя в списке
+    updateUserListUser(clientId); // обновляем статус пользователя в списке
 }
 
 void MainWindowCodeEditor::updateMuteTimeDisplay(const QString& clientId)
@@ -2548,14 +3320,7 @@ void MainWindowCodeEditor::updateStatusBarMuteTime()
         statusBar()->clearMessage();
         if (m_muteTimer->isActive()) m_muteTimer->stop();
     }
-
-    // updateUserListUI();
-    // обновляем время мьюта для ВСЕХ замьюченыхх пользователей в списке
-    for (const QString& clientId : m_muteEndTimes.keys()) {
-        if (m_mutedClients.contains(clientId) && m_mutedClients.value(clientId) != 0) { // проверяем что пользователь действительно замьючен
-            updateUserListUser(clientId);
-        }
-    }
+    // отсчет чужих мьютов считается только там, где виден - в окне "Информация", пока оно открыто
 }
 
 void MainWindowCodeEditor::onMuteUnmute(const QString targetClientId)
@@ -2567,9 +3332,8 @@ void MainWindowCodeEditor::onMuteUnmute(const QString targetClientId)
         unmuteMessage["target_client_id"] = targetClientId;
         unmuteMessage["client_id"] = m_clientId;
         unmuteMessage["session_id"] = m_sessionId;
-        QJsonDocument doc(unmuteMessage);
-        if (socket && socket->state() == QAbstractSocket::ConnectedState) {
-            socket->sendTextMessage(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+        if (m_connection->isConnected()) {
+            sendToServer(unmuteMessage);
             qDebug() << "Отправлен запрос на размут:" << targetClientId;
             onMutedStatusUpdate(targetClientId, false);
         }
@@ -2584,9 +3348,8 @@ void MainWindowCodeEditor::onMuteUnmute(const QString targetClientId)
             muteMessage["duration"] = duration;
             muteMessage["client_id"] = m_clientId;
             muteMessage["session_id"] = m_sessionId;
-            QJsonDocument doc(muteMessage);
-            if (socket && socket->state() == QAbstractSocket::ConnectedState) {
-                socket->sendTextMessage(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+            if (m_connection->isConnected()) {
+                sendToServer(muteMessage);
                 qDebug() << "Отправлен запрос на мут:" << targetClientId << ", " << duration;
                 qint64 endTime = (duration == 0) ? -1 : QDateTime::currentDateTime().toSecsSinceEpoch() + duration;
                 m_muteEndTimes[targetClientId] = endTime;
@@ -2632,7 +3395,7 @@ void MainWindowCodeEditor::onAdminChanged(const QString &newAdminId)
 {
     m_isAdmin = (newAdminId == m_clientId);
     ui->actionSaveSession->setVisible(m_isAdmin); // обновляем видимость кнопки
-    updateUserListUI(); // добавляет или убирает приписку с админом в списоке пользователей
+    applyUserListDiff(remoteUsers.setAdmin(newAdminId)); // приписка "Админ" у прежнего и нового админа
     qDebug() << "Admin status changed. Is admin: " << m_isAdmin;
 
     if (m_isAdmin) {
@@ -2640,7 +3403,7 @@ void MainWindowCodeEditor::onAdminChanged(const QString &newAdminId)
     } else {
         QString newAdminUsername = tr("Другой пользователь");
         if (remoteUsers.contains(newAdminId)) {
-            newAdminUsername = remoteUsers[newAdminId].value("username").toString();
+            newAdminUsername = remoteUsers.value(newAdminId).username;
         }
         statusBar()->showMessage(tr("Администратором сессии стал %1").arg(newAdminUsername), 3000);
     }
@@ -2653,22 +3416,18 @@ void MainWindowCodeEditor::onTransferAdmin(const QString targetClientId)
     transferAdminMessage["type"] = "transfer_admin";
     transferAdminMessage["new_admin_id"] = targetClientId;
     transferAdminMessage["client_id"] = m_clientId;
-    QJsonDocument doc(transferAdminMessage);
-    if (socket && socket->state() == QAbstractSocket::ConnectedState) {
-        socket->sendTextMessage(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+    if (m_connection->isConnected()) {
+        sendToServer(transferAdminMessage);
     }
 }
 
 void MainWindowCodeEditor::showUserInfo(const QString targetClientId)
 {
-    QString username = remoteUsers.value(targetClientId)["username"].toString();
+    const CollabUser user = remoteUsers.value(targetClientId);
+    const QString& username = user.username;
     QString status;
     QString muteTimeInfo;
-    QJsonObject user = remoteUsers.value(targetClientId);
-    bool isAdmin = false;
-    if (!user.isEmpty()) {
-        isAdmin = user["is_admin"].toBool();
-    }
+    bool isAdmin = user.isAdmin;
 
     bool isMuted = m_mutedClients.contains(targetClientId) && m_mutedClients.value(targetClientId, 0) != 0;
     if (isMuted) {
@@ -2725,13 +3484,10 @@ void MainWindowCodeEditor::updateMuteTimeDisplayInUserInfo()
     }
 
     QString clientId = m_currentUserInfoClientId;
-    QString username = remoteUsers.value(clientId)["username"].toString();
+    const CollabUser user = remoteUsers.value(clientId);
+    const QString& username = user.username;
     QString status;
-    QJsonObject user = remoteUsers.value(clientId);
-    bool isAdmin = false;
-    if (!user.isEmpty()) {
-        isAdmin = user["is_admin"].toBool();
-    }
+    bool isAdmin = user.isAdmin;
     bool isMuted = m_mutedClients.contains(clientId) && m_mutedClients.value(clientId, 0) != 0;
     if (isMuted) {
         if (m_muteEndTimes.contains(clientId)) {
@@ -2769,12 +3525,10 @@ void MainWindowCodeEditor::sendMessage() {
         chatOp["client_id"] = m_clientId;
         chatOp["username"] = m_username; // Отправляем реальное имя пользователя
         chatOp["text_message"] = text;
-        QJsonDocument doc(chatOp);
-        QString jsonMessage = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
 
-        if (socket && socket->state() == QAbstractSocket::ConnectedState) {
-            socket->sendTextMessage(jsonMessage);
-            qDebug() << "Отправлено сообщение в чате: " << jsonMessage;
+        if (m_connection->isConnected()) {
+            sendToServer(chatOp);
+            qDebug() << "Отправлено сообщение в чате: " << text;
         } else {
             qDebug() << "Ошибка: сокет не подключен, не могу отправить сообщение.";
             // Можно добавить системное сообщение об ошибке в чат
@@ -3128,6 +3882,10 @@ void MainWindowCodeEditor::performLspStart(const QString& languageId)
     connect(m_lspManager, &LspManager::completionReceived, this, &MainWindowCodeEditor::onLspCompletionReceived);
     connect(m_lspManager, &LspManager::hoverReceived, this, &MainWindowCodeEditor::onLspHoverReceived);
     connect(m_lspManager, &LspManager::definitionReceived, this, &MainWindowCodeEditor::onLspDefinitionReceived);
+    connect(m_lspManager, &LspManager::documentSynced, this, &MainWindowCodeEditor::updateLspToolTip);
+    connect(m_lspManager, &LspManager::replyHandled, this, &MainWindowCodeEditor::updateLspToolTip);
+    m_lspManager->setSyncDelay(QSettings("ToMaTiK", "BAM_IDE").value("LSP/SyncDelayMs", 150).toInt());
+    m_lspManager->setRequestTimeout(QSettings("ToMaTiK", "BAM_IDE").value("LSP/RequestTimeoutMs", 10000).toInt());
 
     QStringList arguments;
     QString fileName = QFileInfo(execPath).fileName();
@@ -3214,6 +3972,29 @@ void MainWindowCodeEditor::updateLspStatus(const QString& text)
     }
 }
 
+// счетчики отложенной отправки текста и обработки ответов LSP-сервера в подсказке статуса
+void MainWindowCodeEditor::updateLspToolTip()
+{
+    if (!m_lspStatusLabel || !m_lspManager) return;
+    const LspSyncStats& stats = m_lspManager->syncStats();
+    const LspReplyStats& replies = m_lspManager->replyStats();
+    const LspRequestStats requests = m_lspManager->requestStats();
+    const qint64 count = qMax<qint64>(1, replies.replies);
+    m_lspStatusLabel->setToolTip(tr("Правок: %1, отправок didChange: %2 (перед запросом: %3)\nЗадержка отправки: средняя %4 мс, максимум %5 мс\n"
+                                    "Ответов: %6, поток GUI: среднее %7 мс, максимум %8 мс; разбор в фоне: среднее %9 мс, максимум %10 мс")
+                                     .arg(stats.edits).arg(stats.flushes).arg(stats.requestFlushes)
+                                     .arg(stats.flushes > 0 ? stats.totalDelayMs / stats.flushes : 0).arg(stats.maxDelayMs)
+                                     .arg(replies.replies)
+                                     .arg(replies.totalGuiNs / count / 1e6, 0, 'f', 2).arg(replies.maxGuiNs / 1e6, 0, 'f', 2)
+                                     .arg(replies.totalDecodeNs / count / 1e6, 0, 'f', 2).arg(replies.maxDecodeNs / 1e6, 0, 'f', 2)
+                                 + tr("\nЗапросов: %1, отвечено: %2 (ожидание: среднее %3 мс, максимум %4 мс)\n"
+                                      "Отменено новым запросом: %5, устарело: %6, без ответа: %7, с ошибкой: %8; ответов отброшено до разбора: %9")
+                                     .arg(requests.sent).arg(requests.answered)
+                                     .arg(requests.answered > 0 ? requests.totalWaitMs / requests.answered : 0).arg(requests.maxWaitMs)
+                                     .arg(requests.superseded).arg(requests.stale).arg(requests.timedOut).arg(requests.failed)
+                                     .arg(requests.droppedBeforeDecode));
+}
+
 void MainWindowCodeEditor::nextDiagnostic()
 {
     if (!m_codeEditor || m_diagnostics.isEmpty()) {
@@ -2,17 +2,28 @@
 #define MAINWINDOWCODEEDITOR_H
 
 #include "terminalwidget.h"
-#include "cursorwidget.h"
-#include "linehighlightwidget.h"
 #include "cpphighlighter.h"
 #include "linenumberarea.h"
 #include "lspmanager.h"
 #include "completionwidget.h"
 #include "diagnostictooltip.h"
 #include "codeplaintextedit.h"
+#include "editdelta.h"
+#include "outgoingopqueue.h"
+#include "otengine.h"
+#include "collabprotocol.h"
+#include "collabconnection.h"
+#include "presencechannel.h"
+#include "remoteparticipantstore.h"
+#include "remotecursoroverlay.h"
+#include "remoteopapplier.h"
+#include "offlineoplog.h"
+#include "reconnectsupervisor.h"
+#include "divergencechecker.h"
+#include "sessionuserlist.h"
 #include <QMainWindow>
+#include <QPointer>
 #include <QFileSystemModel>
-#include <QtWebSockets/QWebSocket>
 #include <QUrl>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -40,6 +51,7 @@
 #include <QFontMetrics>
 #include <QSystemTrayIcon>
 #include <QAction>
+#include <QProgressBar>
 
 #include<QList>
 #include <QPlainTextEdit>
@@ -83,6 +95,8 @@ class QAction;
 }
 QT_END_NAMESPACE
 
+class MessageStatsDialog;
+
 class MainWindowCodeEditor : public QMainWindow
 {
     Q_OBJECT
@@ -102,15 +116,12 @@ private slots: // функции, которые будут вызваны в о
     void onFileSystemTreeViewDoubleClicked(const QModelIndex &index); // когда пользователь дважды кликает по файлу в дереве, то оно открывается в редакторе
 
     void onContentsChange(int position, int charsRemoved, int charsAdded);
-    void onTextMessageReceived(const QString &message);
     void onDisconnected();
     void onConnected();
 
     void onCursorPositionChanged();
 
     void onVerticalScrollBarValueChanged(int value);
-    void updateRemoteWidgetGeometry(QWidget* widget, int position);
-    void updateLineHighlight(const QString& senderId, int position);
 
     void onToolButtonClicked();
     void applyCurrentTheme();
@@ -119,13 +130,20 @@ private slots: // функции, которые будут вызваны в о
     void onCreateSession();
     void onJoinSession();
     void onShowUserList();
+    void onShowMessageStats(); // окно со счетчиками сообщений сервера по типам
+    void onRecordSessionToggled(bool checked); // запись сообщений в файл для bam_replay
     void onLeaveSession();
     bool confirmChangeSession(const QString& message);
-    void clearRemoteInfo();
+    void clearRemoteInfo(bool keepDocument = false); // keepDocument - текст остается для догоняющего переподключения
 
     void connectToServer(); // функция для подключения или переподключения
+    void onServerAddress(); // диалог адреса сервера (Network/ServerUrl)
     void disconnectFromServer(); // функция для отключения
-    void updateUserListUI(); // обновление списка пользователей в интерфейсе
+    void updateUserListUI(); // сверка меню участников с remoteUsers: добавить недостающие пункты, убрать лишние
+    void applyUserListDiff(const SessionUserList::Diff& diff); // перестроить только затронутые пункты меню
+    QAction *createUserAction(const QString& clientId);
+    void fillUserContextMenu(QMenu *menu, const QString& clientId); // подменю участника, собирается при открытии
+    QIcon userIcon(const QColor& color); // цветной кружок, один на цвет
 
     void onMutedStatusUpdate(const QString& clientId, bool isMuted);
     void updateMutedStatus();
@@ -213,6 +231,7 @@ private:
     void onLspSettings();
     bool ensureLspForLanguage(const QString& languageId);
     void updateLspStatus(const QString& text);
+    void updateLspToolTip();
     QString findFirstExecutable(const QStringList& names);
 
     // переопределение событий для hover и хоткеев
@@ -224,9 +243,10 @@ private:
     QString currentFilePath; // хранение пути к текущему открытому файлу, используется, чтобы знать куда записывать изменения
 
     QFileSystemModel *fileSystemModel; // добавление указателя на QFileSystemmodel (древовидный вид файловый системы слева)
-    QWebSocket *socket = nullptr;
+    CollabConnection *m_connection = nullptr; // сокет в сетевом потоке
     CppHighlighter *highlighter;
     bool loadingFile = false;
+    EditPreimage m_editPreimage; // строки вокруг курсора до правки, из них берется удаленный текст для LSP
     bool m_isDarkTheme;
     bool m_isAdmin;
     LineNumberArea *lineNumberArea;
@@ -245,14 +265,15 @@ private:
     QHash<QString, qint64> m_muteEndTimes; // словарь для хранения времени мута каждого клиента
     QString m_currentMessageBoxClientId;
     QMap<QString, int> m_mutedClients;
-    QMap<QString, CursorWidget*> remoteCursors; // словарь с курсора клиентов, ключ - айди, значение - виджет курсора
-    QMap<QString, LineHighlightWidget*> remoteLineHighlights; // хранение подсветки строки, где курсор пользователя, uuid - подсветка
     QString m_username;
     QString m_clientId; // хранение уникального идентификатора клиента, пересоздается при каждом запуске программы
     QString m_sessionId;
-    QList<QJsonObject> cursorUpdates; // хранение последних обновлений позиций курсора
-    QMap<QString, int> lastCursorPositions; // хранение позиций всех курсоров других пользователей
-    QMap<QString, QJsonObject> remoteUsers; // client_id -> {username, color}
+    RemoteParticipantStore m_participants; // последнее состояние курсоров других пользователей, по одной записи на клиента
+    RemoteCursorOverlay *m_cursorOverlay = nullptr; // рисует курсоры и подсветки строк из m_participants
+    RemoteOpApplier *m_remoteOps = nullptr; // чужие операции, применяются пачкой раз за проход цикла событий
+    SessionUserList remoteUsers; // участники сессии из user_list_update и дельт
+    QHash<QString, QAction*> m_userActions; // client_id -> пункт в m_userListMenu
+    QHash<QRgb, QIcon> m_userIcons;
     QWidget *chatWidget; // Виджет чата
     // QTextEdit *chatDisplay; // Поле для отображения сообщений
     QLineEdit *chatInput; // Поле для ввода сообщений
@@ -284,10 +305,13 @@ private:
     //QDockWidget* m_diagnosticsDock;
     //QListWidget* m_diagnosticsList;
     QToolButton* m_diagnosticsStatusBtn;
+    QProgressBar *m_pushProgress = nullptr; // отправка большой вставки или файла кусками
+    QLabel *m_overloadLabel = nullptr; // режим перегрузки входящего потока
+    void onInboundDegradedChanged(bool degraded);
 
     // управление версиями и состоянии LSP для открытого файла
     QString m_currentLspFileUri; // URI текущего файла
-    int m_currentDocumentVersion = 0; // счетчик версий для лсп
+    int m_currentDocumentVersion = 0; // версия для didOpen, дальше версии ведет LspManager
     QString m_projectRootPath; // путь к корневой папке проекта для LSP
     QMap<QString, QList<LspDiagnostic>> m_diagnostics; // хранение диагностик по файлам
 
@@ -304,6 +328,95 @@ private:
 
 
     QString getCurrentWordBeforeCursor(QTextCursor cursor);
+    void sendEditDelta(const EditDelta& delta); // отправка локального изменения на сервер
+    void sendOutgoingOps(const QList<CollabOp>& ops); // отправка склеенных операций одним кадром (batch) или по одной
+    bool sendPresence(int position, int anchor); // отправка позиции своего курсора, false - сейчас нельзя
+    void applyPendingRemotePresence(); // применение последних позиций чужих курсоров, по одной на клиента
+    void applyRemotePresence(const CursorMessage& op);
+    void repositionRemoteDecorations(); // перерисовать слой удаленных курсоров после изменений в m_participants
+    void sendOpsFrame(const QList<CollabOp>& ops) { sendOpsFrame(ops, m_documentPath, m_otClient.revision()); }
+    // запись операций документа path в сокет (с ревизией, если включен OT)
+    void sendOpsFrame(const QList<CollabOp>& ops, const QString& path, int revision);
+    QUrl serverUrl() const;
+    static constexpr const char *DefaultServerUrl = "ws://127.0.0.1:8080";
+    void sendToServer(const QJsonObject& message); // в очередь сетевого потока, там кодируется в согласованном формате
+    void processServerMessage(const InboundMessage& message); // обработка уже разобранного сообщения сервера
+
+    // обработчики сообщений сервера, выбираются по ServerMessageType из таблицы
+    using ServerMessageHandler = void (MainWindowCodeEditor::*)(const InboundMessage& message);
+    static const std::array<ServerMessageHandler, size_t(ServerMessageType::Count)>& serverMessageHandlers();
+    void handleServerError(const InboundMessage& message);
+    void handleSessionInfo(const InboundMessage& message);
+    void handleUserListUpdate(const InboundMessage& message);
+    void handleUserJoined(const InboundMessage& message);
+    void handleUserDisconnected(const InboundMessage& message);
+    void handleFileContentUpdate(const InboundMessage& message);
+    void handleChatMessage(const InboundMessage& message);
+    void handleCursorPositionUpdate(const InboundMessage& message);
+    void handleMuteNotification(const InboundMessage& message);
+    void handleMutedStatusUpdate(const InboundMessage& message);
+    void handleAdminChanged(const InboundMessage& message);
+    void handleRemoteOps(const InboundMessage& message);
+    void handleAck(const InboundMessage& message);
+    void handleSessionSaved(const InboundMessage& message);
+    void handleDocumentInfo(const InboundMessage& message);
+    void handleDocumentClosed(const InboundMessage& message);
+    void handleHashRanges(const InboundMessage& message);
+    void handleBlockText(const InboundMessage& message);
+    ServerMessageStats m_messageStats; // сколько каких сообщений пришло и сколько времени заняла их обработка
+    QPointer<MessageStatsDialog> m_messageStatsDialog;
+    void publishDocumentReplace(int previousLength, const QString& text); // полная замена текста (открыт/создан файл)
+    // открыт другой файл: сервер с документами переводит нас на общий документ этого файла, старый - полная замена
+    void openSharedDocument(int previousLength, const QString& text);
+    QString sharedDocumentPath() const; // путь текущего файла относительно корня проекта, "" - общий буфер сессии
+    OutgoingOpQueue *m_opQueue = nullptr; // очередь склейки исходящих операций
+    PresenceChannel *m_presence = nullptr; // отправка позиции курсора с ограничением частоты
+    QHash<QString, CursorMessage> m_pendingRemotePresence; // client_id -> последнее cursor_position_update, еще не примененное
+    bool m_remotePresenceScheduled = false;
+    static constexpr qint64 PresenceBackpressureBytes = 64 * 1024; // выше этого позиция курсора откладывается
+    QSet<QString> m_serverFeatures; // возможности сервера из session_info (например, "batch")
+    OtClient m_otClient; // состояние OT: ревизия сервера, неподтвержденная пачка и буфер
+    bool m_otEnabled = false; // сервер прислал revision в session_info, работаем через OT
+    QString m_documentPath; // общий документ, на который мы подписаны; "" - общий буфер сессии
+    bool m_documentPending = false; // отправили open_document, ждем document_info, редактор только для чтения
+    // закрытые документы, чья пачка еще ждет ack: буфер досылается после него с путем закрытого документа
+    QHash<QString, OtClient> m_closingDocuments;
+    int m_maxFrameBytes = CollabChunker::DefaultMaxFrameBytes; // Collab/MaxFrameBytes: ни один кадр не больше
+    bool fitsInFrame(const QString& text) const; // можно ли отправить text одним полем, не деля на части
+    void updatePushProgress(); // прогресс отправки неподтвержденных вставок в строке состояния
+    qint64 m_pushTotal = 0; // символов в текущей большой отправке, 0 - индикатор скрыт
+    static constexpr qint64 PushProgressMinChars = 64 * 1024; // меньше - уходит почти мгновенно, индикатор не нужен
+
+    // точка возобновления после обрыва связи: при повторном входе в ту же сессию
+    // запрашиваются только операции после revision, а не весь текст
+    struct ResumePoint
+    {
+        QString sessionId;
+        int revision = -1;
+        int documentRevision = -1; // QTextDocument::revision() после последней правки, попавшей в журнал офлайн-операций
+        QString baseText; // текст документа на ревизии revision, если он известен
+        bool hasBase = false;
+        bool isValid() const { return revision >= 0; }
+    };
+    ResumePoint m_resume;
+    bool m_resumeRequested = false; // в join_session ушел since_revision
+    bool m_resyncRequested = false; // пришли неразборчивые операции: соединение рвется, до обрыва входящие не разбираются
+    void resyncAfterBrokenOps();
+    void saveResumePoint(); // запомнить ревизию при обрыве, если документ совпадает с серверным
+    void sendJoinRequest(); // create_session/join_session для текущего m_sessionId
+    // операции после нашей ревизии из session_info, false - не сошлось; в toSend - свои правки для повторной отправки
+    bool applyCatchUp(const SessionInfoMessage& info, QList<CollabOp>& toSend);
+    // полный снимок вместо catch_up: кладет его в редактор вместе со своими правками, возвращает их для отправки
+    QList<CollabOp> mergeIntoSnapshot(const QString& snapshot, bool unconfirmed, bool journaled);
+    void offerLocalTextRestore(const QString& localText); // свести не удалось: в редакторе снимок, свой текст - по кнопке
+    ReconnectSupervisor *m_reconnect = nullptr; // переподключение к сессии после обрыва связи
+    OfflineOpLog m_offlineOps; // свои правки, набранные без связи, повторяются после переподключения
+    bool isBufferingOffline() const { return m_reconnect && m_reconnect->isReconnecting(); }
+    DivergenceChecker *m_divergence = nullptr; // сверка документа с сервером по хешам строк (doc_hash)
+    QTimer *m_hashCheckTimer = nullptr; // раз в Collab/HashCheckMs, 0 - сверка выключена
+    void onHashCheckTimer();
+    // сверять можно только ревизию без правок в пути: ни своих неподтвержденных, ни чужих непримененных
+    bool isHashCheckIdle() const;
 
     QWidget*     m_findPanel = nullptr;
     QLineEdit*   m_findLineEdit = nullptr;
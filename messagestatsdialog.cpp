@@ -0,0 +1,89 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "messagestatsdialog.h"
+#include "collabconnection.h"
+#include "collabmessages.h"
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+MessageStatsDialog::MessageStatsDialog(ServerMessageStats *stats, const CollabConnection *connection, QWidget *parent)
+    : QDialog(parent)
+    , m_stats(stats)
+    , m_connection(connection)
+{
+    setWindowTitle(tr("Статистика сообщений сервера"));
+    m_table = new QTableWidget(0, 6, this);
+    m_table->setHorizontalHeaderLabels({tr("Тип"), tr("Сообщений"), tr("Байт"), tr("Разбор, мс"),
+                                        tr("Обработка, мс"), tr("Макс. обработка, мс")});
+    m_table->verticalHeader()->setVisible(false);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionMode(QAbstractItemView::NoSelection);
+    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_table->horizontalHeader()->setStretchLastSection(true);
+
+    m_applyLabel = new QLabel(this);
+    m_pressureLabel = new QLabel(this);
+
+    QDialogButtonBox *bb = new QDialogButtonBox(QDialogButtonBox::Close);
+    QPushButton *resetButton = bb->addButton(tr("Сбросить"), QDialogButtonBox::ResetRole);
+    connect(resetButton, &QPushButton::clicked, this, &MessageStatsDialog::onReset);
+    connect(bb, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    QVBoxLayout *mainL = new QVBoxLayout(this);
+    mainL->addWidget(m_table);
+    mainL->addWidget(m_applyLabel);
+    mainL->addWidget(m_pressureLabel);
+    mainL->addWidget(bb);
+    resize(640, 420);
+
+    connect(&m_refreshTimer, &QTimer::timeout, this, &MessageStatsDialog::refresh);
+    m_refreshTimer.start(1000);
+    refresh();
+}
+
+void MessageStatsDialog::refresh()
+{
+    auto ms = [](qint64 ns) { return QString::number(ns / 1.0e6, 'f', 2); };
+    auto addRow = [&](const QString& name, const ServerMessageStats::Entry& entry) {
+        const int row = m_table->rowCount();
+        m_table->insertRow(row);
+        const QStringList cells{name, QString::number(entry.count), QString::number(entry.bytes),
+                                ms(entry.decodeNs), ms(entry.handleNs), ms(entry.maxHandleNs)};
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *item = new QTableWidgetItem(cells.at(column));
+            if (column > 0) {
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            }
+            m_table->setItem(row, column, item);
+        }
+    };
+
+    m_table->setRowCount(0);
+    // пустые типы не показываем, чтобы сразу было видно, из чего состоит трафик
+    for (int i = 0; i < int(ServerMessageType::Count); ++i) {
+        const ServerMessageType type = ServerMessageType(i);
+        const ServerMessageStats::Entry& entry = m_stats->entry(type);
+        if (entry.count > 0) {
+            addRow(type == ServerMessageType::Unknown ? tr("(неизвестные)") : ServerMessageDecoder::typeName(type), entry);
+        }
+    }
+    addRow(tr("Всего"), m_stats->total());
+    m_applyLabel->setText(tr("Применение чужих правок в документе: %1 мс").arg(ms(m_stats->applyNs())));
+
+    const CollabConnection::InboundPressure pressure = m_connection->inboundPressure();
+    m_pressureLabel->setText(tr("Очередь входящих: %1 (максимум %2), заменено положений курсора: %3, отброшено чата: %4%5")
+                                 .arg(pressure.depth).arg(pressure.maxDepth).arg(pressure.coalesced).arg(pressure.dropped)
+                                 .arg(pressure.degraded ? tr(", перегрузка") : QString()));
+}
+
+void MessageStatsDialog::onReset()
+{
+    m_stats->reset();
+    refresh();
+}
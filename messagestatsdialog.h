@@ -0,0 +1,35 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef MESSAGESTATSDIALOG_H
+#define MESSAGESTATSDIALOG_H
+
+#include <QDialog>
+#include <QTimer>
+
+class CollabConnection;
+class QLabel;
+class QTableWidget;
+class ServerMessageStats;
+
+// таблица счетчиков сообщений сервера по типам, обновляется раз в секунду, пока окно открыто
+class MessageStatsDialog : public QDialog {
+    Q_OBJECT
+public:
+    MessageStatsDialog(ServerMessageStats *stats, const CollabConnection *connection, QWidget *parent = nullptr);
+
+private slots:
+    void refresh();
+    void onReset();
+
+private:
+    ServerMessageStats *m_stats; // принадлежит главному окну и живет дольше диалога
+    QTableWidget *m_table;
+    const CollabConnection *m_connection; // очередь входящих и перегрузка
+    QLabel *m_applyLabel; // время отложенного применения чужих правок
+    QLabel *m_pressureLabel;
+    QTimer m_refreshTimer;
+};
+
+#endif // MESSAGESTATSDIALOG_H
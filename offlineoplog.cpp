@@ -0,0 +1,97 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "offlineoplog.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+
+OfflineOpLog::OfflineOpLog(const QString& filePath)
+    : m_filePath(filePath)
+{
+}
+
+void OfflineOpLog::append(const QList<CollabOp>& ops)
+{
+    if (ops.isEmpty()) {
+        return;
+    }
+    m_count += ops.size();
+    if (m_spilled) {
+        if (writeToFile(ops)) {
+            return;
+        }
+        // диск недоступен - лучше держать в памяти, чем потерять правки
+        m_spilled = false;
+    }
+
+    m_memory.append(ops);
+    for (const CollabOp& op : ops) {
+        m_memoryBytes += sizeof(CollabOp) + op.text.size() * sizeof(QChar);
+    }
+    if (m_memoryBytes > SpillBytes && writeToFile(m_memory)) {
+        qDebug() << "Журнал офлайн-операций сброшен на диск:" << m_memory.size() << "операций," << m_filePath;
+        m_memory.clear();
+        m_memoryBytes = 0;
+        m_spilled = true;
+    }
+}
+
+QList<CollabOp> OfflineOpLog::takeAll()
+{
+    QList<CollabOp> ops;
+    ops.reserve(m_count);
+    QFile file(m_filePath);
+    if (file.exists()) {
+        // в файле всегда более ранние операции, чем в памяти
+        if (file.open(QIODevice::ReadOnly)) {
+            while (!file.atEnd()) {
+                const QByteArray line = file.readLine().trimmed();
+                if (line.isEmpty()) continue;
+                bool ok = false;
+                const CollabOp op = CollabOp::fromJson(QJsonDocument::fromJson(line).object(), &ok);
+                if (ok) {
+                    ops.append(op);
+                } else {
+                    qWarning() << "Поврежденная строка в журнале офлайн-операций:" << line.left(80);
+                }
+            }
+            file.close();
+        } else {
+            qWarning() << "Не удалось прочитать журнал офлайн-операций:" << file.errorString();
+        }
+    }
+    ops.append(m_memory);
+    clear();
+    return ops;
+}
+
+void OfflineOpLog::clear()
+{
+    m_memory.clear();
+    m_memoryBytes = 0;
+    m_count = 0;
+    m_spilled = false;
+    if (QFile::exists(m_filePath)) {
+        QFile::remove(m_filePath);
+    }
+}
+
+bool OfflineOpLog::writeToFile(const QList<CollabOp>& ops)
+{
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Не удалось открыть журнал офлайн-операций:" << m_filePath << file.errorString();
+        return false;
+    }
+    QByteArray data;
+    for (const CollabOp& op : ops) {
+        data += QJsonDocument(op.toJson()).toJson(QJsonDocument::Compact);
+        data += '\n';
+    }
+    return file.write(data) == data.size();
+}
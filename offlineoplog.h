@@ -0,0 +1,43 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef OFFLINEOPLOG_H
+#define OFFLINEOPLOG_H
+
+#include <QList>
+#include <QString>
+#include "collabop.h"
+
+// свои операции правки, набранные без связи с сервером, в порядке набора
+// пока их немного, они лежат в памяти; при росте сбрасываются в файл-журнал (одна операция JSON на строку)
+// и дальше только дописываются в его конец, чтобы долгий обрыв не раздувал память
+class OfflineOpLog
+{
+public:
+    explicit OfflineOpLog(const QString& filePath = QString());
+
+    void setFilePath(const QString& filePath) { m_filePath = filePath; }
+
+    void append(const QList<CollabOp>& ops);
+    QList<CollabOp> takeAll(); // все операции по порядку, журнал после этого пуст
+    void clear(); // выбросить без повтора (выход из сессии), файл удаляется
+
+    int size() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+    bool isSpilled() const { return m_spilled; }
+    const QString& filePath() const { return m_filePath; }
+
+    static constexpr qint64 SpillBytes = 256 * 1024; // примерный объем в памяти, после которого пишем в файл
+
+private:
+    bool writeToFile(const QList<CollabOp>& ops);
+
+    QString m_filePath;
+    QList<CollabOp> m_memory;
+    qint64 m_memoryBytes = 0;
+    int m_count = 0;
+    bool m_spilled = false;
+};
+
+#endif // OFFLINEOPLOG_H
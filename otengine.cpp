@@ -0,0 +1,304 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "otengine.h"
+#include <QDebug>
+#include <utility>
+
+void OtTransform::transform(QList<CollabOp>& a, QList<CollabOp>& b, bool aFirstOnTie)
+{
+    if (a.isEmpty() || b.isEmpty()) {
+        return;
+    }
+
+    if (a.size() == 1 && b.size() == 1) {
+        QList<CollabOp> aOut;
+        QList<CollabOp> bOut;
+        transformOps(a.first(), b.first(), aFirstOnTie, aOut, bOut);
+        a = aOut;
+        b = bOut;
+        return;
+    }
+
+    // пачки раскладываем по одной операции: голову против всей b, затем хвост против уже сдвинутой b
+    if (a.size() > 1) {
+        QList<CollabOp> head{a.first()};
+        QList<CollabOp> tail = a.mid(1);
+        transform(head, b, aFirstOnTie);
+        transform(tail, b, aFirstOnTie);
+        a = head + tail;
+        return;
+    }
+
+    QList<CollabOp> head{b.first()};
+    QList<CollabOp> tail = b.mid(1);
+    transform(a, head, aFirstOnTie);
+    transform(a, tail, aFirstOnTie);
+    b = head + tail;
+}
+
+void OtTransform::transformOps(const CollabOp& a, const CollabOp& b, bool aFirstOnTie, QList<CollabOp>& aOut, QList<CollabOp>& bOut)
+{
+    aOut = {a};
+    bOut = {b};
+
+    if (a.type == CollabOp::Insert && b.type == CollabOp::Insert) {
+        if (a.position < b.position || (a.position == b.position && aFirstOnTie)) {
+            bOut[0].position += a.text.length();
+        } else {
+            aOut[0].position += b.text.length();
+        }
+        return;
+    }
+
+    if (a.type == CollabOp::Insert && b.type == CollabOp::Delete) {
+        const int bEnd = b.position + b.count;
+        if (a.position <= b.position) {
+            bOut[0].position += a.text.length();
+        } else if (a.position >= bEnd) {
+            aOut[0].position -= b.count;
+        } else {
+            // вставка внутри удаляемого диапазона: текст сохраняется, удаление обходит его с двух сторон
+            aOut[0].position = b.position;
+            bOut = {CollabOp::makeDelete(b.position, a.position - b.position),
+                    CollabOp::makeDelete(b.position + a.text.length(), bEnd - a.position)};
+        }
+        return;
+    }
+
+    if (a.type == CollabOp::Delete && b.type == CollabOp::Insert) {
+        const int aEnd = a.position + a.count;
+        if (b.position <= a.position) {
+            aOut[0].position += b.text.length();
+        } else if (b.position >= aEnd) {
+            bOut[0].position -= a.count;
+        } else {
+            bOut[0].position = a.position;
+            aOut = {CollabOp::makeDelete(a.position, b.position - a.position),
+                    CollabOp::makeDelete(a.position + b.text.length(), aEnd - b.position)};
+        }
+        return;
+    }
+
+    // два удаления: общий кусок удаляется один раз, остальное сдвигается на удаленное слева
+    const int aEnd = a.position + a.count;
+    const int bEnd = b.position + b.count;
+    const int overlap = qMax(0, qMin(aEnd, bEnd) - qMax(a.position, b.position));
+    aOut[0].position = a.position - qMax(0, qMin(bEnd, a.position) - b.position);
+    aOut[0].count = a.count - overlap;
+    bOut[0].position = b.position - qMax(0, qMin(aEnd, b.position) - a.position);
+    bOut[0].count = b.count - overlap;
+    if (aOut[0].count <= 0) {
+        aOut.clear();
+    }
+    if (bOut[0].count <= 0) {
+        bOut.clear();
+    }
+}
+
+void OtTransform::applyToText(QString& text, const QList<CollabOp>& ops)
+{
+    for (const CollabOp& op : ops) {
+        const int position = qBound(0, op.position, int(text.length()));
+        if (op.type == CollabOp::Insert) {
+            text.insert(position, op.text);
+        } else {
+            text.remove(position, qMin(op.count, int(text.length()) - position));
+        }
+    }
+}
+
+QList<CollabOp> OtTransform::diff(const QString& from, const QString& to)
+{
+    const int common = qMin(from.length(), to.length());
+    int prefix = 0;
+    while (prefix < common && from.at(prefix) == to.at(prefix)) {
+        ++prefix;
+    }
+    int suffix = 0;
+    while (suffix < common - prefix && from.at(from.length() - 1 - suffix) == to.at(to.length() - 1 - suffix)) {
+        ++suffix;
+    }
+
+    QList<CollabOp> ops;
+    const int removed = int(from.length()) - prefix - suffix;
+    if (removed > 0) {
+        ops.append(CollabOp::makeDelete(prefix, removed));
+    }
+    const int added = int(to.length()) - prefix - suffix;
+    if (added > 0) {
+        ops.append(CollabOp::makeInsert(prefix, to.mid(prefix, added)));
+    }
+    return ops;
+}
+
+void OtClient::reset(int revision)
+{
+    m_revision = revision;
+    m_outstanding.clear();
+    m_buffer.clear();
+    m_awaitingAck = false;
+}
+
+QList<CollabOp> OtClient::applyLocal(const QList<CollabOp>& ops)
+{
+    // пока ждем ack, продолжаем склеивать набор, чтобы следующая пачка была короче
+    const int limit = mergeLimit();
+    for (const CollabOp& op : ops) {
+        const QList<CollabOp> pieces = m_maxBatchBytes > 0 ? op.split(m_maxBatchBytes) : QList<CollabOp>{op};
+        for (const CollabOp& piece : pieces) {
+            if (!m_buffer.isEmpty() && m_buffer.last().tryMerge(piece, limit)) {
+                if (m_buffer.last().isNoop()) {
+                    m_buffer.removeLast();
+                }
+                continue;
+            }
+            m_buffer.append(piece);
+        }
+    }
+    if (m_awaitingAck) {
+        return {};
+    }
+    takeBatch();
+    return m_outstanding;
+}
+
+QList<CollabOp> OtClient::serverAck(int revision)
+{
+    if (!m_awaitingAck) {
+        qWarning() << "OT: ack без отправленной пачки, ревизия" << revision;
+    }
+    m_revision = revision;
+    takeBatch();
+    return m_outstanding;
+}
+
+QList<CollabOp> OtClient::applyRemote(const QList<CollabOp>& ops, const QString& senderId, int revision)
+{
+    if (revision != m_revision + 1) {
+        qWarning() << "OT: пропущена ревизия, ожидали" << m_revision + 1 << "пришла" << revision;
+    }
+    m_revision = revision;
+
+    // чужая операция основана на состоянии сервера без наших неподтвержденных правок,
+    // поэтому сначала проводим ее через отправленную пачку, затем через буфер
+    const bool ourFirst = OtTransform::firstOnTie(m_clientId, senderId);
+    QList<CollabOp> remote = ops;
+    OtTransform::transform(m_outstanding, remote, ourFirst);
+    OtTransform::transform(m_buffer, remote, ourFirst);
+    return remote;
+}
+
+QList<CollabOp> OtClient::resendPending()
+{
+    m_buffer = m_outstanding + m_buffer;
+    takeBatch();
+    return m_outstanding;
+}
+
+qint64 OtClient::pendingLength() const
+{
+    qint64 length = 0;
+    for (const QList<CollabOp> *ops : {&m_outstanding, &m_buffer}) {
+        for (const CollabOp& op : *ops) {
+            if (op.type == CollabOp::Insert) {
+                length += op.text.length();
+            }
+        }
+    }
+    return length;
+}
+
+void OtClient::takeBatch()
+{
+    // одна пачка - один кадр; первая операция берется всегда, она уже не больше предела после split
+    qsizetype count = 0;
+    int bytes = 0;
+    while (count < m_buffer.size()) {
+        const int size = m_buffer.at(count).wireSize();
+        if (count > 0 && m_maxBatchBytes > 0 && bytes + size > m_maxBatchBytes) break;
+        bytes += size;
+        ++count;
+    }
+    m_outstanding = m_buffer.first(count);
+    m_buffer.remove(0, count);
+    m_awaitingAck = !m_outstanding.isEmpty();
+}
+
+int OtClient::mergeLimit() const
+{
+    // склеенная вставка не должна перерасти кадр даже из одних экранированных символов
+    if (m_maxBatchBytes <= 0) return MaxBufferedOpLength;
+    return qBound(1, (m_maxBatchBytes - CollabOp::WireOverheadBytes) / CollabOp::MaxWireBytesPerChar, MaxBufferedOpLength);
+}
+
+OtServerDocument::OtServerDocument(const QString& text, int revision)
+    : m_text(text)
+    , m_revision(revision)
+{
+}
+
+bool OtServerDocument::receive(const QString& clientId, int baseRevision, QList<CollabOp>& ops)
+{
+    const int oldestKnown = m_revision - m_history.size(); // ревизия до первой записи истории
+    if (baseRevision < oldestKnown || baseRevision > m_revision) {
+        return false;
+    }
+
+    // догоняем все, что сервер принял после baseRevision
+    for (int i = baseRevision - oldestKnown; i < m_history.size(); ++i) {
+        QList<CollabOp> committed = m_history.at(i).ops;
+        OtTransform::transform(ops, committed, OtTransform::firstOnTie(clientId, m_history.at(i).clientId));
+    }
+
+    // позиции вне текста не подрезаем: в историю и остальным клиентам ушли бы исходные значения,
+    // и каждый подрезал бы их по-своему. такую правку не принимаем, клиент получит полный текст
+    int length = m_text.length();
+    for (const CollabOp& op : std::as_const(ops)) {
+        if (op.position < 0 || op.position > length) return false;
+        if (op.type == CollabOp::Insert) {
+            length += op.text.length();
+        } else {
+            if (op.count < 0 || op.count > length - op.position) return false;
+            length -= op.count;
+        }
+    }
+
+    OtTransform::applyToText(m_text, ops);
+    append(clientId, ops);
+    return true;
+}
+
+QList<CollabOp> OtServerDocument::replaceText(const QString& clientId, const QString& text)
+{
+    QList<CollabOp> ops;
+    if (!m_text.isEmpty()) {
+        ops.append(CollabOp::makeDelete(0, m_text.length()));
+    }
+    if (!text.isEmpty()) {
+        ops.append(CollabOp::makeInsert(0, text));
+    }
+    m_text = text;
+    append(clientId, ops);
+    return ops;
+}
+
+bool OtServerDocument::entriesSince(int revision, QList<Entry>& entries) const
+{
+    const int oldestKnown = m_revision - m_history.size();
+    if (revision < oldestKnown || revision > m_revision) {
+        return false;
+    }
+    entries = m_history.mid(revision - oldestKnown);
+    return true;
+}
+
+void OtServerDocument::append(const QString& clientId, const QList<CollabOp>& ops)
+{
+    m_history.append(Entry{clientId, ops});
+    while (m_history.size() > m_historyLimit) {
+        m_history.removeFirst();
+    }
+    ++m_revision;
+}
@@ -0,0 +1,110 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef OTENGINE_H
+#define OTENGINE_H
+
+#include <QString>
+#include <QList>
+#include "collabop.h"
+
+// операционное преобразование (OT) для операций insert/delete
+// схема клиент-сервер как в Jupiter: сервер задает единый порядок ревизий,
+// клиент держит не более одной неподтвержденной пачки и преобразует ее против чужих
+class OtTransform
+{
+public:
+    // a и b применимы к одному и тому же состоянию документа
+    // после вызова a применима после b, а b - после a, и оба пути дают одинаковый текст
+    // aFirstOnTie - чья вставка встает левее, если оба вставили в одну позицию
+    static void transform(QList<CollabOp>& a, QList<CollabOp>& b, bool aFirstOnTie);
+    // порядок при равных позициях вставки, одинаковый на клиенте и на сервере
+    static bool firstOnTie(const QString& clientA, const QString& clientB) { return clientA < clientB; }
+    // применение операций к строке (сервер, проверки), позиции вне текста прижимаются к границам
+    static void applyToText(QString& text, const QList<CollabOp>& ops);
+    // разница двух текстов одним участком (удалить + вставить), общие начало и конец не трогаются
+    static QList<CollabOp> diff(const QString& from, const QString& to);
+
+private:
+    static void transformOps(const CollabOp& a, const CollabOp& b, bool aFirstOnTie, QList<CollabOp>& aOut, QList<CollabOp>& bOut);
+};
+
+// клиентская сторона: ревизия сервера, отправленная пачка (ждет ack) и буфер набранного за это время
+class OtClient
+{
+public:
+    void setClientId(const QString& clientId) { m_clientId = clientId; }
+    void reset(int revision); // новое состояние от сервера, локальные ожидания сбрасываются
+    int revision() const { return m_revision; }
+    bool isAwaitingAck() const { return m_awaitingAck; }
+
+    // локальные операции (уже примененные в редакторе); возвращает то, что надо отправить прямо сейчас
+    // пустой список - ждем ack предыдущей пачки, операции легли в буфер
+    QList<CollabOp> applyLocal(const QList<CollabOp>& ops);
+    // сервер подтвердил нашу пачку; возвращает буфер, который теперь надо отправить
+    QList<CollabOp> serverAck(int revision);
+    // чужие операции с сервера; возвращает их в виде, пригодном для применения к локальному документу
+    QList<CollabOp> applyRemote(const QList<CollabOp>& ops, const QString& senderId, int revision);
+    // после переподключения: неподтвержденная пачка и буфер, уже сдвинутые к текущей ревизии,
+    // уходят заново с первой пачки; возвращает то, что надо отправить
+    QList<CollabOp> resendPending();
+    const QList<CollabOp>& bufferedOps() const { return m_buffer; } // набрано, но ни разу не отправлено
+
+    // предел пачки в байтах кадра, 0 - без предела; большие вставки режутся на куски,
+    // и следующий кусок уходит только после ack предыдущего - это и есть управление потоком
+    void setMaxBatchBytes(int bytes) { m_maxBatchBytes = qMax(0, bytes); }
+    qint64 pendingLength() const; // символов вставок, еще не подтвержденных сервером (отправлено + буфер)
+
+    static constexpr int MaxBufferedOpLength = 4096;
+
+private:
+    void takeBatch(); // начало буфера, которое помещается в один кадр, становится отправленной пачкой
+    int mergeLimit() const;
+
+    QString m_clientId;
+    int m_revision = 0; // последняя известная ревизия сервера, на ней основана следующая отправка
+    QList<CollabOp> m_outstanding; // отправлено, ждем ack
+    QList<CollabOp> m_buffer; // набрано, пока ждали ack
+    // ждем ack отдельно от m_outstanding: чужое удаление может "съесть" отправленную пачку целиком,
+    // но ack на нее все равно придет, и буфер нельзя отправлять раньше него
+    bool m_awaitingAck = false;
+    int m_maxBatchBytes = 0;
+};
+
+// серверная сторона: текст, номер ревизии и история для преобразования запоздавших операций
+class OtServerDocument
+{
+public:
+    explicit OtServerDocument(const QString& text = QString(), int revision = 0);
+
+    // операции клиента, основанные на baseRevision; при успехе ops преобразованы к текущей ревизии,
+    // применены к тексту и записаны в историю; false - ревизия вне истории или позиция/длина операции
+    // выходит за текст, клиенту нужна полная синхронизация
+    bool receive(const QString& clientId, int baseRevision, QList<CollabOp>& ops);
+    // полная замена текста (file_content_update), записывается в историю как удаление всего и вставка
+    QList<CollabOp> replaceText(const QString& clientId, const QString& text);
+
+    const QString& text() const { return m_text; }
+    int revision() const { return m_revision; }
+    void setHistoryLimit(int limit) { m_historyLimit = qMax(1, limit); }
+
+    struct Entry
+    {
+        QString clientId;
+        QList<CollabOp> ops;
+    };
+    // все, что принято после revision (запись i получила ревизию revision + 1 + i);
+    // false - revision вне истории, нужен полный текст
+    bool entriesSince(int revision, QList<Entry>& entries) const;
+
+private:
+    void append(const QString& clientId, const QList<CollabOp>& ops);
+
+    QString m_text;
+    int m_revision = 0;
+    QList<Entry> m_history; // последняя запись соответствует m_revision
+    int m_historyLimit = 1000;
+};
+
+#endif // OTENGINE_H
@@ -0,0 +1,244 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "otengine.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+
+namespace {
+
+// пачка клиента в пути к серверу
+struct Upload
+{
+    QList<CollabOp> ops;
+    int revision = 0;
+};
+
+// сообщение сервера в пути к клиенту: ack автору или преобразованные операции остальным
+struct Download
+{
+    bool ack = false;
+    QList<CollabOp> ops;
+    QString senderId;
+    int revision = 0;
+};
+
+struct SimClient
+{
+    QString id;
+    QString text;
+    OtClient ot;
+    QList<Upload> toServer; // каждое направление - очередь по порядку, как в одном сокете
+    QList<Download> fromServer;
+};
+
+struct SimResult
+{
+    bool converged = false;
+    QString error;
+    qint64 localOps = 0;
+    qint64 serverRevision = 0;
+};
+
+const QString alphabet = QStringLiteral("abcxyz \n{}");
+
+// случайная правка, допустимая для текущего текста клиента
+CollabOp randomOp(QRandomGenerator& random, const QString& text)
+{
+    const int length = int(text.length());
+    if (length == 0 || random.bounded(100) < 60) {
+        QString inserted;
+        const int size = random.bounded(1, 4);
+        for (int i = 0; i < size; ++i) {
+            inserted.append(alphabet.at(random.bounded(int(alphabet.length()))));
+        }
+        return CollabOp::makeInsert(random.bounded(length + 1), inserted);
+    }
+    const int position = random.bounded(length);
+    return CollabOp::makeDelete(position, random.bounded(1, qMin(5, length - position) + 1));
+}
+
+void send(SimClient& client, const QList<CollabOp>& ops)
+{
+    if (!ops.isEmpty()) {
+        client.toServer.append(Upload{ops, client.ot.revision()});
+    }
+}
+
+// один прогон: clients участников, steps случайных событий, затем доставка всего, что осталось в пути
+SimResult simulate(quint32 seed, int clientCount, int steps)
+{
+    QRandomGenerator random(seed);
+    SimResult result;
+    const QString initial = QStringLiteral("int main() {\n    return 0;\n}\n");
+    OtServerDocument server(initial);
+    QList<SimClient> clients(clientCount);
+    for (int i = 0; i < clientCount; ++i) {
+        SimClient& client = clients[i];
+        client.id = QStringLiteral("client-%1").arg(i);
+        client.text = initial;
+        client.ot.setClientId(client.id);
+        client.ot.reset(0);
+        // часть прогонов с маленьким кадром: пачки режутся и ждут ack по частям
+        client.ot.setMaxBatchBytes(random.bounded(3) == 0 ? 96 : 0);
+    }
+
+    const auto deliverToServer = [&](int index) {
+        SimClient& author = clients[index];
+        Upload upload = author.toServer.takeFirst();
+        if (!server.receive(author.id, upload.revision, upload.ops)) {
+            result.error = QStringLiteral("сервер отклонил пачку %1 с ревизией %2").arg(author.id).arg(upload.revision);
+            return false;
+        }
+        author.fromServer.append(Download{true, {}, author.id, server.revision()});
+        for (SimClient& other : clients) {
+            if (other.id != author.id) {
+                other.fromServer.append(Download{false, upload.ops, author.id, server.revision()});
+            }
+        }
+        return true;
+    };
+    const auto deliverToClient = [&](int index) {
+        SimClient& client = clients[index];
+        const Download download = client.fromServer.takeFirst();
+        if (download.ack) {
+            send(client, client.ot.serverAck(download.revision));
+        } else {
+            OtTransform::applyToText(client.text, client.ot.applyRemote(download.ops, download.senderId, download.revision));
+        }
+    };
+    // случайный непустой канал; -1 - в пути ничего нет
+    const auto pickChannel = [&](bool toServer) {
+        QList<int> candidates;
+        for (int i = 0; i < clientCount; ++i) {
+            if (!(toServer ? clients[i].toServer.isEmpty() : clients[i].fromServer.isEmpty())) candidates.append(i);
+        }
+        return candidates.isEmpty() ? -1 : candidates.at(random.bounded(int(candidates.size())));
+    };
+
+    for (int step = 0; step < steps; ++step) {
+        const int roll = random.bounded(100);
+        if (roll < 40) {
+            SimClient& client = clients[random.bounded(clientCount)];
+            const CollabOp op = randomOp(random, client.text);
+            OtTransform::applyToText(client.text, {op});
+            send(client, client.ot.applyLocal({op}));
+            ++result.localOps;
+        } else if (roll < 70) {
+            const int index = pickChannel(true);
+            if (index >= 0 && !deliverToServer(index)) return result;
+        } else {
+            const int index = pickChannel(false);
+            if (index >= 0) deliverToClient(index);
+        }
+    }
+
+    // тишина: доставляем все в случайном порядке, пока каналы не опустеют
+    while (true) {
+        const int toServer = pickChannel(true);
+        const int toClient = pickChannel(false);
+        if (toServer < 0 && toClient < 0) break;
+        if (toServer >= 0 && (toClient < 0 || random.bounded(2) == 0)) {
+            if (!deliverToServer(toServer)) return result;
+        } else {
+            deliverToClient(toClient);
+        }
+    }
+
+    result.serverRevision = server.revision();
+    for (const SimClient& client : std::as_const(clients)) {
+        if (client.ot.isAwaitingAck() || !client.ot.bufferedOps().isEmpty()) {
+            result.error = QStringLiteral("%1 остался с неподтвержденными правками").arg(client.id);
+            return result;
+        }
+        if (client.text != server.text()) {
+            result.error = QStringLiteral("%1 разошелся с сервером: %2 символов против %3")
+                               .arg(client.id).arg(client.text.length()).arg(server.text().length());
+            return result;
+        }
+    }
+    result.converged = true;
+    return result;
+}
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QFile out;
+    const bool toStdout = path.isEmpty() || path == QLatin1String("-");
+    if (toStdout) {
+        if (!out.open(stdout, QIODevice::WriteOnly)) return false;
+    } else {
+        out.setFileName(path);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical() << "Не удалось записать" << path << out.errorString();
+            return false;
+        }
+    }
+    return out.write(data) == data.size();
+}
+
+} // namespace
+
+// проверка сходимости OT: bam_ottest [--seeds 3000] [--first-seed 1] [--steps 300] [--clients-min 2 --clients-max 4] [--output report.json]
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bam_ottest");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("BAM_IDE OT convergence simulation");
+    parser.addHelpOption();
+    QCommandLineOption seedsOption("seeds", "Сколько прогонов, по одному на зерно.", "count", "3000");
+    QCommandLineOption firstSeedOption("first-seed", "Первое зерно, дальше подряд.", "seed", "1");
+    QCommandLineOption stepsOption("steps", "Случайных событий (правка или доставка) в прогоне.", "count", "300");
+    QCommandLineOption clientsMinOption("clients-min", "Наименьшее число участников.", "count", "2");
+    QCommandLineOption clientsMaxOption("clients-max", "Наибольшее число участников.", "count", "4");
+    QCommandLineOption outputOption("output", "Файл отчета JSON, по умолчанию stdout.", "file");
+    parser.addOptions({seedsOption, firstSeedOption, stepsOption, clientsMinOption, clientsMaxOption, outputOption});
+    parser.process(app);
+
+    const int seeds = qMax(1, parser.value(seedsOption).toInt());
+    const quint32 firstSeed = parser.value(firstSeedOption).toUInt();
+    const int steps = qMax(1, parser.value(stepsOption).toInt());
+    const int clientsMin = qMax(2, parser.value(clientsMinOption).toInt());
+    const int clientsMax = qMax(clientsMin, parser.value(clientsMaxOption).toInt());
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 localOps = 0;
+    QJsonArray failures;
+    for (int i = 0; i < seeds; ++i) {
+        const quint32 seed = firstSeed + quint32(i);
+        // число участников тоже от зерна, чтобы прогон повторялся по одному --first-seed
+        const int clientCount = clientsMin + int(QRandomGenerator(seed ^ 0x9e3779b9u).bounded(clientsMax - clientsMin + 1));
+        const SimResult result = simulate(seed, clientCount, steps);
+        localOps += result.localOps;
+        if (!result.converged) {
+            qWarning().noquote() << QStringLiteral("зерно %1, участников %2: %3").arg(seed).arg(clientCount).arg(result.error);
+            failures.append(QJsonObject{{"seed", qint64(seed)}, {"clients", clientCount}, {"error", result.error}});
+        }
+    }
+
+    const QJsonObject report{
+        {"seeds", seeds},
+        {"first_seed", qint64(firstSeed)},
+        {"steps", steps},
+        {"clients", QJsonObject{{"min", clientsMin}, {"max", clientsMax}}},
+        {"local_ops", localOps},
+        {"elapsed_ms", timer.elapsed()},
+        {"failed", qint64(failures.size())},
+        {"failures", failures},
+    };
+    qInfo().noquote() << QStringLiteral("OT: прогонов %1, правок %2, разошлось %3").arg(seeds).arg(localOps).arg(failures.size());
+    const bool ok = writeFile(parser.value(outputOption), QJsonDocument(report).toJson(QJsonDocument::Indented));
+    return ok && failures.isEmpty() ? 0 : 1;
+}
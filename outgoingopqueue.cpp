@@ -0,0 +1,68 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "outgoingopqueue.h"
+
+OutgoingOpQueue::OutgoingOpQueue(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &OutgoingOpQueue::flush);
+}
+
+void OutgoingOpQueue::setWindow(int ms)
+{
+    m_windowMs = qBound(0, ms, 200); // больше 200 мс уже заметно для собеседника
+}
+
+void OutgoingOpQueue::enqueue(const CollabOp& op)
+{
+    if (op.isNoop()) {
+        return;
+    }
+
+    if (!m_ops.isEmpty()) {
+        CollabOp& last = m_ops.last();
+        if (last.tryMerge(op, MaxMergedLength)) {
+            if (last.isNoop()) {
+                m_ops.removeLast(); // набрали и тут же стерли, отправлять нечего
+            }
+            if (m_ops.isEmpty()) {
+                m_timer.stop();
+            }
+            return;
+        }
+        if (!last.touches(op)) {
+            flush(); // правка в другом месте документа, закрываем текущую пачку
+        }
+    }
+
+    m_ops.append(op);
+
+    if (m_windowMs == 0) {
+        flush();
+        return;
+    }
+    // таймер не перезапускаем, иначе при непрерывном наборе пачка никогда не уйдет
+    if (!m_timer.isActive()) {
+        m_timer.start(m_windowMs);
+    }
+}
+
+void OutgoingOpQueue::flush()
+{
+    m_timer.stop();
+    if (m_ops.isEmpty()) {
+        return;
+    }
+    QList<CollabOp> ops;
+    ops.swap(m_ops);
+    emit flushReady(ops);
+}
+
+void OutgoingOpQueue::clear()
+{
+    m_timer.stop();
+    m_ops.clear();
+}
@@ -0,0 +1,42 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef OUTGOINGOPQUEUE_H
+#define OUTGOINGOPQUEUE_H
+
+#include <QObject>
+#include <QList>
+#include <QTimer>
+#include "collabop.h"
+
+// очередь исходящих операций правки: копит нажатия клавиш в течение короткого окна,
+// склеивает соседние вставки/удаления и отдает их одной пачкой, вместо кадра на каждый символ
+class OutgoingOpQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OutgoingOpQueue(QObject *parent = nullptr);
+
+    void setWindow(int ms); // 0 - отправлять сразу, без склейки по времени
+    int window() const { return m_windowMs; }
+
+    void enqueue(const CollabOp& op);
+    void flush(); // отдать накопленное прямо сейчас (перед курсором, чатом и т.п.)
+    void clear(); // выбросить накопленное без отправки (например, при отключении)
+    bool isEmpty() const { return m_ops.isEmpty(); }
+    const QList<CollabOp>& pending() const { return m_ops; } // накопленное, уже примененное в редакторе
+
+    static constexpr int MaxMergedLength = 4096; // предел длины одной склеенной операции
+
+signals:
+    void flushReady(const QList<CollabOp>& ops);
+
+private:
+    QList<CollabOp> m_ops;
+    QTimer m_timer;
+    int m_windowMs = 30;
+};
+
+#endif // OUTGOINGOPQUEUE_H
@@ -0,0 +1,58 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "presencechannel.h"
+
+PresenceChannel::PresenceChannel(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(50);
+    connect(&m_timer, &QTimer::timeout, this, &PresenceChannel::onTick);
+}
+
+void PresenceChannel::setRate(int hz)
+{
+    hz = qBound(1, hz, 60);
+    m_timer.setInterval(1000 / hz);
+}
+
+void PresenceChannel::update(int position, int anchor)
+{
+    m_position = position;
+    m_anchor = anchor;
+    m_dirty = true;
+    // таймер не перезапускаем: при зажатой стрелке отправка все равно идет с заданной частотой
+    if (!m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+void PresenceChannel::reset()
+{
+    m_timer.stop();
+    m_dirty = false;
+    m_sentPosition = -1;
+    m_sentAnchor = -1;
+}
+
+void PresenceChannel::onTick()
+{
+    if (!m_dirty) {
+        return;
+    }
+    if (m_position == m_sentPosition && m_anchor == m_sentAnchor) {
+        m_dirty = false; // вернулись туда же, откуда начали - собеседникам ничего нового
+        return;
+    }
+    if (!m_sender || !m_sender(m_position, m_anchor)) {
+        ++m_deferredCount;
+        m_timer.start(); // пробуем позже, промежуточные положения при этом просто теряются
+        return;
+    }
+    m_sentPosition = m_position;
+    m_sentAnchor = m_anchor;
+    m_dirty = false;
+    ++m_sentCount;
+}
@@ -0,0 +1,48 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PRESENCECHANNEL_H
+#define PRESENCECHANNEL_H
+
+#include <QObject>
+#include <QTimer>
+#include <functional>
+
+// канал присутствия (позиция курсора и выделения) отдельно от операций правки
+// хранит только последнее положение, отправляет не чаще заданной частоты и пропускает неизменившееся
+// если отправитель отказал (сокет забит, в очереди еще есть операции) - положение остается грязным и уйдет позже
+class PresenceChannel : public QObject
+{
+    Q_OBJECT
+
+public:
+    // возвращает false, если отправить сейчас нельзя
+    using Sender = std::function<bool(int position, int anchor)>;
+
+    explicit PresenceChannel(QObject *parent = nullptr);
+
+    void setSender(Sender sender) { m_sender = std::move(sender); }
+    void setRate(int hz); // частота отправки, по умолчанию 20 Гц
+    void update(int position, int anchor); // новое положение своего курсора
+    void reset(); // новая сессия: забываем, что уже отправляли
+
+    int sentCount() const { return m_sentCount; }
+    int deferredCount() const { return m_deferredCount; } // сколько раз отправку откладывали из-за нагрузки
+
+private slots:
+    void onTick();
+
+private:
+    QTimer m_timer;
+    Sender m_sender;
+    int m_position = -1;
+    int m_anchor = -1;
+    int m_sentPosition = -1;
+    int m_sentAnchor = -1;
+    bool m_dirty = false;
+    int m_sentCount = 0;
+    int m_deferredCount = 0;
+};
+
+#endif // PRESENCECHANNEL_H
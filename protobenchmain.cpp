@@ -0,0 +1,209 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "collabop.h"
+#include "collabprotocol.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+
+namespace {
+
+QString randomText(QRandomGenerator& random, int length)
+{
+    static const QString alphabet = QStringLiteral("abcdefghijklmnopqrstuvwxyz_0123456789 (){};:<>=+-*/\"\n");
+    QString text;
+    text.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        text.append(alphabet.at(random.bounded(int(alphabet.length()))));
+    }
+    return text;
+}
+
+// поток правок, как его отправляет sendOpsFrame: в основном одиночные символы и Backspace,
+// реже склеенные пачки и вставки из буфера обмена; несколько участников, чтобы работала таблица client_id
+QList<QJsonObject> makeOpMix(int count, QRandomGenerator& random, qint64& ops)
+{
+    const QStringList clients{QStringLiteral("3f2a9c1e-7b44-4d0e-9a61-52c8e0d1b7a3"), QStringLiteral("b81d0f52-1c9e-4f6a-8d27-0e93a4c5f618"),
+                              QStringLiteral("6c0e4a9b-d2f1-4b83-a5e7-19f0c3d8b246"), QStringLiteral("e49b7d13-80a6-4c2f-b1d5-7a62f9e0c38d"),
+                              QStringLiteral("0a5f3e87-4d1b-4e9c-92f6-c8b1d7a3e504")};
+    const QString path = QStringLiteral("src/collabserver.cpp");
+    QList<QJsonObject> messages;
+    messages.reserve(count);
+    int revision = 1000;
+    for (int i = 0; i < count; ++i) {
+        const int roll = random.bounded(100);
+        const int position = random.bounded(200000);
+        QList<CollabOp> batch;
+        if (roll < 60) {
+            batch.append(CollabOp::makeInsert(position, randomText(random, 1)));
+        } else if (roll < 75) {
+            batch.append(CollabOp::makeDelete(position, 1));
+        } else if (roll < 90) {
+            const int size = random.bounded(2, 9);
+            for (int j = 0; j < size; ++j) {
+                batch.append(random.bounded(3) == 0 ? CollabOp::makeDelete(position + j, random.bounded(1, 4))
+                                                    : CollabOp::makeInsert(position + j, randomText(random, random.bounded(1, 12))));
+            }
+        } else {
+            batch.append(CollabOp::makeInsert(position, randomText(random, random.bounded(200, 2000))));
+        }
+        ops += batch.size();
+
+        QJsonObject message;
+        if (batch.size() > 1) {
+            QJsonArray opsArray;
+            for (const CollabOp& op : std::as_const(batch)) {
+                opsArray.append(op.toJson());
+            }
+            message["type"] = "batch";
+            message["ops"] = opsArray;
+        } else {
+            message = batch.first().toJson();
+        }
+        message["client_id"] = clients.at(random.bounded(int(clients.size())));
+        message["revision"] = ++revision;
+        message["path"] = path;
+        messages.append(message);
+    }
+    return messages;
+}
+
+struct FormatResult
+{
+    qint64 bytes = 0;
+    qint64 encodeNs = 0;
+    qint64 decodeNs = 0;
+    bool roundTrip = true;
+};
+
+// кодирование одним кодеком (отправитель) и разбор другим (получатель), как на двух концах соединения;
+// разбор включает CollabOp::fromJson - до этого места доходит каждая принятая правка
+FormatResult runFormat(CollabCodec::Format format, const QList<QJsonObject>& messages, int rounds)
+{
+    FormatResult result;
+    QElapsedTimer timer;
+    for (int round = 0; round < rounds; ++round) {
+        CollabCodec sender;
+        CollabCodec receiver;
+        sender.setFormat(format);
+        receiver.setFormat(format);
+
+        QList<QByteArray> frames;
+        frames.reserve(messages.size());
+        timer.start();
+        for (const QJsonObject& message : messages) {
+            frames.append(sender.encode(message));
+        }
+        result.encodeNs += timer.nsecsElapsed();
+        if (round == 0) {
+            for (const QByteArray& frame : std::as_const(frames)) {
+                result.bytes += frame.size();
+            }
+        }
+
+        qint64 checksum = 0;
+        timer.restart();
+        for (qsizetype i = 0; i < frames.size(); ++i) {
+            bool ok = false;
+            const QJsonObject message = receiver.decode(frames.at(i), &ok);
+            const QJsonArray opsArray = message.value(QLatin1String("type")).toString() == QLatin1String("batch")
+                                            ? message.value(QLatin1String("ops")).toArray()
+                                            : QJsonArray{message};
+            for (const QJsonValue& value : opsArray) {
+                checksum += CollabOp::fromJson(value.toObject()).position;
+            }
+            if (round == 0 && (!ok || message != messages.at(i))) {
+                result.roundTrip = false;
+            }
+        }
+        result.decodeNs += timer.nsecsElapsed();
+        Q_UNUSED(checksum);
+    }
+    result.encodeNs /= rounds;
+    result.decodeNs /= rounds;
+    return result;
+}
+
+QJsonObject formatReport(const FormatResult& result, qint64 messages, qint64 ops)
+{
+    return QJsonObject{
+        {"bytes", result.bytes},
+        {"bytes_per_op", double(result.bytes) / ops},
+        {"bytes_per_message", double(result.bytes) / messages},
+        {"encode_ns_per_op", double(result.encodeNs) / ops},
+        {"decode_ns_per_op", double(result.decodeNs) / ops}, // разбор кадра и CollabOp::fromJson
+        {"round_trip", result.roundTrip},
+    };
+}
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QFile out;
+    const bool toStdout = path.isEmpty() || path == QLatin1String("-");
+    if (toStdout) {
+        if (!out.open(stdout, QIODevice::WriteOnly)) return false;
+    } else {
+        out.setFileName(path);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical() << "Не удалось записать" << path << out.errorString();
+            return false;
+        }
+    }
+    return out.write(data) == data.size();
+}
+
+} // namespace
+
+// размер и скорость кадров правок в JSON и bam-cbor-1: bam_protobench [--messages 100000] [--rounds 5] [--seed 1] [--output report.json]
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bam_protobench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("BAM_IDE collaboration frame size and codec benchmark");
+    parser.addHelpOption();
+    QCommandLineOption messagesOption("messages", "Сколько сообщений правки в наборе.", "count", "100000");
+    QCommandLineOption roundsOption("rounds", "Сколько раз прогнать набор, время усредняется.", "count", "5");
+    QCommandLineOption seedOption("seed", "Зерно генератора набора.", "seed", "1");
+    QCommandLineOption outputOption("output", "Файл отчета JSON, по умолчанию stdout.", "file");
+    parser.addOptions({messagesOption, roundsOption, seedOption, outputOption});
+    parser.process(app);
+
+    const int count = qMax(1, parser.value(messagesOption).toInt());
+    const int rounds = qMax(1, parser.value(roundsOption).toInt());
+    QRandomGenerator random(parser.value(seedOption).toUInt());
+    qint64 ops = 0;
+    const QList<QJsonObject> messages = makeOpMix(count, random, ops);
+
+    const FormatResult json = runFormat(CollabCodec::Format::Json, messages, rounds);
+    const FormatResult cbor = runFormat(CollabCodec::Format::Cbor, messages, rounds);
+
+    const QJsonObject report{
+        {"messages", count},
+        {"ops", ops},
+        {"rounds", rounds},
+        {"mix", "60% символ, 15% Backspace, 15% пачка 2-8 операций, 10% вставка 200-2000 символов"},
+        {"json", formatReport(json, count, ops)},
+        {"cbor", formatReport(cbor, count, ops)},
+    };
+    qInfo().noquote() << QStringLiteral("JSON: %1 Б/оп, кодирование %2 нс/оп, разбор %3 нс/оп; CBOR: %4 Б/оп, кодирование %5 нс/оп, разбор %6 нс/оп")
+                             .arg(double(json.bytes) / ops, 0, 'f', 1).arg(double(json.encodeNs) / ops, 0, 'f', 0)
+                             .arg(double(json.decodeNs) / ops, 0, 'f', 0)
+                             .arg(double(cbor.bytes) / ops, 0, 'f', 1).arg(double(cbor.encodeNs) / ops, 0, 'f', 0)
+                             .arg(double(cbor.decodeNs) / ops, 0, 'f', 0);
+    if (!json.roundTrip || !cbor.roundTrip) {
+        qCritical() << "Разобранное сообщение не совпало с исходным";
+    }
+    const bool ok = writeFile(parser.value(outputOption), QJsonDocument(report).toJson(QJsonDocument::Indented));
+    return ok && json.roundTrip && cbor.roundTrip ? 0 : 1;
+}
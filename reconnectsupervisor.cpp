@@ -0,0 +1,68 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "reconnectsupervisor.h"
+#include <QRandomGenerator>
+
+ReconnectSupervisor::ReconnectSupervisor(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, [this]() {
+        ++m_attempt;
+        emit reconnectRequested(m_attempt);
+    });
+}
+
+void ReconnectSupervisor::setBackoff(int initialMs, int maxMs)
+{
+    m_initialMs = qMax(50, initialMs);
+    m_maxMs = qMax(m_initialMs, maxMs);
+}
+
+bool ReconnectSupervisor::sessionEstablished()
+{
+    m_timer.stop();
+    const bool restored = m_state == State::Reconnecting;
+    if (restored) {
+        m_lastOutageMs = m_outage.elapsed();
+    }
+    m_state = State::Connected;
+    m_attempt = 0;
+    return restored;
+}
+
+void ReconnectSupervisor::connectionLost()
+{
+    if (m_state == State::Idle) {
+        return;
+    }
+    if (m_state == State::Connected) {
+        m_state = State::Reconnecting;
+        m_attempt = 0;
+        m_outage.start();
+    }
+    // обрыв и неудачная попытка могут прийти двумя сигналами сокета, вторая пауза не нужна
+    if (m_timer.isActive()) {
+        return;
+    }
+    const int delay = nextDelayMs();
+    m_timer.start(delay);
+    emit retryScheduled(m_attempt + 1, delay);
+}
+
+void ReconnectSupervisor::stop()
+{
+    m_timer.stop();
+    m_state = State::Idle;
+    m_attempt = 0;
+}
+
+int ReconnectSupervisor::nextDelayMs() const
+{
+    // initial * 2^attempt с потолком, затем случайно в [половина, целое]: паузы растут, но не совпадают у разных клиентов
+    const qint64 base = qMin<qint64>(m_maxMs, qint64(m_initialMs) << qMin(m_attempt, 16));
+    const qint64 half = base / 2;
+    return int(half + QRandomGenerator::global()->bounded(half + 1));
+}
@@ -0,0 +1,54 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef RECONNECTSUPERVISOR_H
+#define RECONNECTSUPERVISOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+
+// следит за соединением с сессией: после неожиданного обрыва просит переподключиться
+// с экспоненциально растущей паузой и случайным разбросом, чтобы клиенты не ломились на сервер разом
+class ReconnectSupervisor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class State {
+        Idle, // не в сессии или пользователь отключился сам
+        Connected, // сессия установлена, обрыв надо чинить
+        Reconnecting, // связи нет, ждем следующую попытку или ее результат
+    };
+
+    explicit ReconnectSupervisor(QObject *parent = nullptr);
+
+    void setBackoff(int initialMs, int maxMs);
+
+    bool sessionEstablished(); // пришел session_info; true - это восстановление после обрыва
+    void connectionLost(); // обрыв или неудачная попытка; в Idle ничего не делает
+    void stop(); // пользователь отключился или сменил сессию
+
+    State state() const { return m_state; }
+    bool isReconnecting() const { return m_state == State::Reconnecting; }
+    int attempt() const { return m_attempt; }
+    qint64 lastOutageMs() const { return m_lastOutageMs; } // сколько длился последний обрыв до восстановления сессии
+
+signals:
+    void reconnectRequested(int attempt); // пора открыть сокет заново
+    void retryScheduled(int attempt, int delayMs); // для строки состояния
+
+private:
+    int nextDelayMs() const;
+
+    State m_state = State::Idle;
+    QTimer m_timer;
+    QElapsedTimer m_outage;
+    int m_attempt = 0;
+    int m_initialMs = 500;
+    int m_maxMs = 30000;
+    qint64 m_lastOutageMs = 0;
+};
+
+#endif // RECONNECTSUPERVISOR_H
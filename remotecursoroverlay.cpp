@@ -0,0 +1,180 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "remotecursoroverlay.h"
+#include "codeplaintextedit.h"
+#include "remoteparticipantstore.h"
+#include <QAbstractTextDocumentLayout>
+#include <QEvent>
+#include <QPainter>
+#include <QPainterPath>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextDocument>
+
+namespace {
+const QColor kDefaultCaretColor(184, 64, 245); // цвет, которым курсоры рисовались раньше
+}
+
+RemoteCursorOverlay::RemoteCursorOverlay(CodePlainTextEdit *editor, const RemoteParticipantStore *participants)
+    : QWidget(editor->viewport())
+    , m_editor(editor)
+    , m_participants(participants)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents); // слой только рисует, мышь уходит в редактор
+    setAttribute(Qt::WA_NoSystemBackground);
+    setAutoFillBackground(false);
+    setGeometry(editor->viewport()->rect());
+    editor->viewport()->installEventFilter(this);
+
+    // любая правка может сдвинуть строки под курсорами; слушаем раскладку, а не документ:
+    // чужие правки и снимок сессии применяются с заглушенными сигналами документа
+    connect(editor->document()->documentLayout(), &QAbstractTextDocumentLayout::update, this, &RemoteCursorOverlay::invalidateLayout);
+    // прокрутка и перерисовка редактора: геометрия в кэше относительно блоков, пересчет не нужен
+    connect(editor, &QPlainTextEdit::updateRequest, this, [this](const QRect&, int) { update(); });
+    connect(editor->horizontalScrollBar(), &QScrollBar::valueChanged, this, qOverload<>(&QWidget::update));
+
+    m_blinkTimer.setInterval(500); // как у обычного курсора, каждые 500 мс переключение видимости
+    connect(&m_blinkTimer, &QTimer::timeout, this, [this]() {
+        m_blinkOn = !m_blinkOn;
+        if (m_participants && m_participants->size() > 0) {
+            update();
+        }
+    });
+    m_blinkTimer.start();
+
+    raise();
+    show();
+}
+
+void RemoteCursorOverlay::setLineHighlightHidden(const QString& clientId, bool hidden)
+{
+    if (hidden) {
+        m_hiddenHighlights.insert(clientId);
+    } else {
+        m_hiddenHighlights.remove(clientId);
+    }
+    update();
+}
+
+void RemoteCursorOverlay::invalidateLayout()
+{
+    ++m_layoutRevision;
+    update();
+}
+
+bool RemoteCursorOverlay::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_editor->viewport() && event->type() == QEvent::Resize) {
+        setGeometry(m_editor->viewport()->rect());
+        invalidateLayout(); // ширина могла поменять перенос строк
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+QRect RemoteCursorOverlay::caretRect(const RemoteParticipant& participant, int position)
+{
+    QTextDocument *doc = m_editor->document();
+    CachedGeometry& cached = m_geometry[participant.clientId];
+    if (cached.position != position || cached.layoutRevision != m_layoutRevision) {
+        QTextCursor cursor(doc);
+        cursor.setPosition(position);
+        const QTextBlock block = cursor.block();
+        const QRect rect = m_editor->cursorRect(cursor);
+        cached.position = position;
+        cached.layoutRevision = m_layoutRevision;
+        cached.blockNumber = block.blockNumber();
+        cached.relativeRect = rect.translated(-m_editor->visibleBlockRect(block).topLeft().toPoint());
+    }
+    const QTextBlock block = doc->findBlockByNumber(cached.blockNumber);
+    return cached.relativeRect.translated(m_editor->visibleBlockRect(block).topLeft().toPoint());
+}
+
+void RemoteCursorOverlay::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    if (!m_participants || m_participants->size() == 0) {
+        m_geometry.clear();
+        return;
+    }
+
+    // видимый диапазон позиций: от первого видимого блока до первого блока ниже нижнего края
+    QTextBlock block = m_editor->firstVisibleTextBlock();
+    if (!block.isValid()) {
+        return;
+    }
+    const int firstPosition = block.position();
+    int lastPosition = firstPosition;
+    while (block.isValid()) {
+        const QRectF rect = m_editor->visibleBlockRect(block);
+        if (rect.top() > height()) {
+            break;
+        }
+        lastPosition = block.position() + block.length() - 1;
+        block = block.next();
+    }
+    const int maxPosition = m_editor->document()->characterCount() - 1;
+
+    QPainter painter(this);
+    QFont tagFont = font();
+    tagFont.setPixelSize(9);
+    const QFontMetrics tagMetrics(tagFont);
+
+    struct VisibleCaret
+    {
+        QRect rect;
+        QColor color;
+        QString username;
+    };
+    QList<VisibleCaret> carets;
+    carets.reserve(m_participants->size());
+
+    // сначала подсветки строк, чтобы курсоры и имена рисовались поверх
+    for (const RemoteParticipant& participant : m_participants->participants()) {
+        if (participant.position < 0) continue;
+        const int position = qBound(0, participant.position, maxPosition);
+        if (position < firstPosition || position > lastPosition) continue;
+
+        const QRect rect = caretRect(participant, position);
+        const QColor color = participant.color.isValid() ? participant.color : kDefaultCaretColor;
+        if (!m_hiddenHighlights.contains(participant.clientId)) {
+            painter.setOpacity(0.08);
+            painter.fillRect(QRect(0, rect.top(), width(), rect.height()), color.lighter(150));
+        }
+        carets.append({rect, color, participant.username});
+    }
+
+    for (const VisibleCaret& caret : carets) {
+        if (m_blinkOn) {
+            painter.setOpacity(0.8);
+            painter.setPen(caret.color);
+            painter.drawLine(caret.rect.left(), caret.rect.top(), caret.rect.left(), caret.rect.bottom());
+            painter.setOpacity(0.3);
+            painter.fillRect(QRect(caret.rect.left(), caret.rect.top(), 2, caret.rect.height()), caret.color);
+        }
+        if (caret.username.isEmpty()) continue;
+
+        // плашка с именем в том же стиле, что был у CustomToolTip
+        const QSize textSize = tagMetrics.size(Qt::TextSingleLine, caret.username);
+        const QRect tagRect(caret.rect.left() + 11, caret.rect.top() - 9, textSize.width() + 8, textSize.height() + 2);
+        QPainterPath path;
+        path.addRoundedRect(QRectF(tagRect).adjusted(0.5, 0.5, -0.5, -0.5), 5, 5);
+        painter.setOpacity(0.75);
+        painter.setRenderHint(QPainter::Antialiasing, true);
+        painter.fillPath(path, caret.color);
+        painter.setPen(caret.color.darker());
+        painter.drawPath(path);
+        painter.setPen(Qt::white);
+        painter.setFont(tagFont);
+        painter.drawText(tagRect, Qt::AlignCenter, caret.username);
+        painter.setRenderHint(QPainter::Antialiasing, false);
+    }
+
+    // записи ушедших участников в кэше не нужны
+    if (m_geometry.size() > m_participants->size()) {
+        for (auto it = m_geometry.begin(); it != m_geometry.end();) {
+            it = m_participants->contains(it.key()) ? std::next(it) : m_geometry.erase(it);
+        }
+    }
+}
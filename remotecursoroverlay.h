@@ -0,0 +1,56 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef REMOTECURSOROVERLAY_H
+#define REMOTECURSOROVERLAY_H
+
+#include <QWidget>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QRect>
+
+class CodePlainTextEdit;
+class RemoteParticipantStore;
+struct RemoteParticipant;
+
+// один прозрачный слой поверх viewport редактора, рисует курсоры, имена и подсветку строк всех участников
+// за один paintEvent; рисуются только участники в видимом диапазоне блоков
+// геометрия курсора кэшируется относительно его блока, поэтому прокрутка не требует пересчета cursorRect
+class RemoteCursorOverlay : public QWidget
+{
+    Q_OBJECT
+
+public:
+    RemoteCursorOverlay(CodePlainTextEdit *editor, const RemoteParticipantStore *participants);
+
+    void setLineHighlightHidden(const QString& clientId, bool hidden); // замьюченным подсветку строки не показываем
+    void clearHidden() { m_hiddenHighlights.clear(); update(); }
+    void invalidateLayout(); // текст или ширина поменялись, кэш геометрии устарел
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct CachedGeometry
+    {
+        int position = -1;
+        int layoutRevision = -1;
+        int blockNumber = -1;
+        QRect relativeRect; // прямоугольник курсора относительно левого верхнего угла блока
+    };
+
+    QRect caretRect(const RemoteParticipant& participant, int position); // в координатах viewport
+
+    CodePlainTextEdit *m_editor;
+    const RemoteParticipantStore *m_participants;
+    QHash<QString, CachedGeometry> m_geometry;
+    QSet<QString> m_hiddenHighlights;
+    int m_layoutRevision = 0;
+    QTimer m_blinkTimer;
+    bool m_blinkOn = true;
+};
+
+#endif // REMOTECURSOROVERLAY_H
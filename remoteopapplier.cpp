@@ -0,0 +1,94 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "remoteopapplier.h"
+#include "remoteparticipantstore.h"
+#include <QElapsedTimer>
+#include <QSignalBlocker>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <utility>
+
+RemoteOpApplier::RemoteOpApplier(QTextDocument *document, RemoteParticipantStore *participants, QObject *parent)
+    : QObject(parent)
+    , m_document(document)
+    , m_participants(participants)
+{
+    // нулевой интервал: срабатывает после того, как обработаны все уже пришедшие кадры
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(0);
+    connect(&m_timer, &QTimer::timeout, this, &RemoteOpApplier::drain);
+}
+
+void RemoteOpApplier::enqueue(Batch batch)
+{
+    if (batch.ops.isEmpty() && batch.revision < 0) {
+        return; // без OT пустую пачку можно не применять, с OT ревизию все равно надо учесть
+    }
+    m_pending.append(std::move(batch));
+    if (!m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+void RemoteOpApplier::clear()
+{
+    m_timer.stop();
+    m_pending.clear();
+}
+
+QList<CollabOp> RemoteOpApplier::applyOps(QTextCursor& cursor, const QList<CollabOp>& ops, RemoteParticipantStore *participants)
+{
+    QList<CollabOp> applied;
+    applied.reserve(ops.size());
+    QTextDocument *document = cursor.document();
+    for (const CollabOp& op : ops) {
+        const int maxPosition = document->characterCount() - 1;
+        const int position = qBound(0, op.position, maxPosition);
+        cursor.setPosition(position);
+        if (op.type == CollabOp::Insert) {
+            cursor.insertText(op.text);
+            applied.append(CollabOp::makeInsert(position, op.text));
+            if (participants) participants->adjustForEdit(position, 0, op.text.length());
+        } else {
+            const int end = qMin(position + op.count, maxPosition);
+            if (end <= position) continue;
+            cursor.setPosition(end, QTextCursor::KeepAnchor);
+            cursor.removeSelectedText();
+            applied.append(CollabOp::makeDelete(position, end - position));
+            if (participants) participants->adjustForEdit(position, end - position, 0);
+        }
+    }
+    return applied;
+}
+
+void RemoteOpApplier::drain()
+{
+    m_timer.stop();
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    emit aboutToDrain();
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const QList<Batch> batches = std::exchange(m_pending, {});
+    int opCount = 0;
+    {
+        // сигналы документа глушим, чтобы чужие правки не ушли обратно на сервер как свои;
+        // блокировщик живет дольше endEditBlock, где документ сообщает об изменениях
+        QSignalBlocker blocker(m_document);
+        QTextCursor cursor(m_document);
+        cursor.beginEditBlock();
+        for (const Batch& batch : batches) {
+            opCount += applyOps(cursor, m_transform ? m_transform(batch) : batch.ops, m_participants).size();
+        }
+        cursor.endEditBlock(); // здесь один раз перекладывается текст и перерисовывается редактор
+    }
+
+    m_appliedOps += opCount;
+    m_lastDrainOps = opCount;
+    m_lastDrainUs = elapsed.nsecsElapsed() / 1000;
+    emit drained(batches.size(), opCount);
+}
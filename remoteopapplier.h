@@ -0,0 +1,71 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef REMOTEOPAPPLIER_H
+#define REMOTEOPAPPLIER_H
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QTimer>
+#include <functional>
+#include "collabop.h"
+
+class QTextCursor;
+class QTextDocument;
+class RemoteParticipantStore;
+
+// очередь входящих чужих операций правки
+// операции не применяются сразу по приходу, а копятся до конца текущего прохода цикла событий
+// и применяются все вместе внутри одного beginEditBlock/endEditBlock: одна перекладка текста
+// и одна перерисовка на пачку, а не на каждую операцию
+class RemoteOpApplier : public QObject
+{
+    Q_OBJECT
+
+public:
+    // пачка операций от одного отправителя в том виде, в каком ее прислал сервер
+    struct Batch
+    {
+        QString senderId;
+        int revision = -1; // -1 - сервер без OT
+        QList<CollabOp> ops;
+    };
+
+    // преобразование пачки перед применением (OT), вызывается в момент применения, а не приема
+    using Transform = std::function<QList<CollabOp>(const Batch& batch)>;
+
+    RemoteOpApplier(QTextDocument *document, RemoteParticipantStore *participants, QObject *parent = nullptr);
+
+    void setTransform(Transform transform) { m_transform = std::move(transform); }
+
+    // применение операций через cursor (позиции прижимаются к границам документа), курсоры участников сдвигаются;
+    // возвращает операции в том виде, в каком они реально применены
+    static QList<CollabOp> applyOps(QTextCursor& cursor, const QList<CollabOp>& ops, RemoteParticipantStore *participants);
+
+    void enqueue(Batch batch);
+    void drain(); // применить все накопленное прямо сейчас (перед ack, полной заменой текста и т.п.)
+    void clear(); // выбросить накопленное без применения (выход из сессии)
+    bool hasPending() const { return !m_pending.isEmpty(); }
+
+    qint64 appliedOpCount() const { return m_appliedOps; }
+    int lastDrainOpCount() const { return m_lastDrainOps; }
+    qint64 lastDrainUs() const { return m_lastDrainUs; } // время последнего применения, мкс
+
+signals:
+    void aboutToDrain(); // до преобразования: свои накопленные правки должны уйти раньше
+    void drained(int batchCount, int opCount); // документ изменен, пора перерисовать курсоры
+
+private:
+    QTextDocument *m_document;
+    RemoteParticipantStore *m_participants;
+    Transform m_transform;
+    QList<Batch> m_pending;
+    QTimer m_timer;
+    qint64 m_appliedOps = 0;
+    int m_lastDrainOps = 0;
+    qint64 m_lastDrainUs = 0;
+};
+
+#endif // REMOTEOPAPPLIER_H
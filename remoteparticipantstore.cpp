@@ -0,0 +1,61 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "remoteparticipantstore.h"
+
+namespace {
+
+// куда переезжает позиция после замены [position, position + removed) на added символов
+int shiftPosition(int value, int position, int removed, int added)
+{
+    if (value < 0 || value <= position) {
+        return value; // до места правки ничего не меняется
+    }
+    if (value >= position + removed) {
+        return value + added - removed;
+    }
+    return position; // позиция была внутри удаленного текста
+}
+
+} // namespace
+
+RemoteParticipant& RemoteParticipantStore::upsert(const QString& clientId)
+{
+    RemoteParticipant& participant = m_participants[clientId];
+    participant.clientId = clientId;
+    return participant;
+}
+
+RemoteParticipant* RemoteParticipantStore::find(const QString& clientId)
+{
+    auto it = m_participants.find(clientId);
+    return it == m_participants.end() ? nullptr : &it.value();
+}
+
+RemoteParticipant& RemoteParticipantStore::updatePresence(const QString& clientId, int position, int anchor,
+                                                          const QString& username, const QColor& color, qint64 nowMs)
+{
+    RemoteParticipant& participant = upsert(clientId);
+    participant.position = position;
+    participant.anchor = anchor >= 0 ? anchor : position;
+    if (!username.isEmpty()) {
+        participant.username = username;
+    }
+    if (color.isValid()) {
+        participant.color = color;
+    }
+    participant.lastSeenMs = nowMs;
+    return participant;
+}
+
+void RemoteParticipantStore::adjustForEdit(int position, int charsRemoved, int charsAdded)
+{
+    if (charsRemoved == charsAdded && charsRemoved == 0) {
+        return;
+    }
+    for (RemoteParticipant& participant : m_participants) {
+        participant.position = shiftPosition(participant.position, position, charsRemoved, charsAdded);
+        participant.anchor = shiftPosition(participant.anchor, position, charsRemoved, charsAdded);
+    }
+}
@@ -0,0 +1,49 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef REMOTEPARTICIPANTSTORE_H
+#define REMOTEPARTICIPANTSTORE_H
+
+#include <QColor>
+#include <QHash>
+#include <QString>
+
+// последнее известное состояние одного удаленного участника
+struct RemoteParticipant
+{
+    QString clientId;
+    QString username;
+    QColor color;
+    int position = -1; // позиция курсора, -1 - еще не присылал
+    int anchor = -1; // второй конец выделения, равен position если выделения нет
+    qint64 lastSeenMs = 0; // когда пришло последнее обновление присутствия
+
+    bool hasSelection() const { return anchor >= 0 && anchor != position; }
+};
+
+// таблица удаленных участников по client_id, одна запись на участника
+// размер не зависит от количества пришедших обновлений, только от числа участников
+class RemoteParticipantStore
+{
+public:
+    RemoteParticipant& upsert(const QString& clientId); // найти или создать запись
+    RemoteParticipant* find(const QString& clientId);
+    bool contains(const QString& clientId) const { return m_participants.contains(clientId); }
+    void remove(const QString& clientId) { m_participants.remove(clientId); }
+    void clear() { m_participants.clear(); }
+    int size() const { return m_participants.size(); }
+
+    // новое положение курсора участника; username/color обновляются, только если пришли непустыми
+    RemoteParticipant& updatePresence(const QString& clientId, int position, int anchor,
+                                      const QString& username, const QColor& color, qint64 nowMs);
+    // сдвиг всех сохраненных позиций после правки документа (своей или чужой), O(участников)
+    void adjustForEdit(int position, int charsRemoved, int charsAdded);
+
+    const QHash<QString, RemoteParticipant>& participants() const { return m_participants; }
+
+private:
+    QHash<QString, RemoteParticipant> m_participants;
+};
+
+#endif // REMOTEPARTICIPANTSTORE_H
@@ -0,0 +1,99 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "sessionreplayer.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTimer>
+
+namespace {
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QFile out;
+    const bool toStdout = path.isEmpty() || path == QLatin1String("-");
+    if (toStdout) {
+        if (!out.open(stdout, QIODevice::WriteOnly)) return false;
+    } else {
+        out.setFileName(path);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical() << "Не удалось записать" << path << out.errorString();
+            return false;
+        }
+    }
+    return out.write(data) == data.size();
+}
+
+} // namespace
+
+// воспроизведение записи сессии: bam_replay session.bamrec [--speed max|1] [--output report.json] [--text final.txt]
+int main(int argc, char *argv[])
+{
+    // редактор без окна: документу нужны шрифты, но не экран
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bam_replay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("BAM_IDE collaboration session replay");
+    parser.addHelpOption();
+    parser.addPositionalArgument("recording", "Файл записи (меню «Сессии → Записывать сообщения...»).");
+    QCommandLineOption speedOption("speed", "max - как можно быстрее, число - множитель темпа записи (1 - как было).",
+                                   "speed", "max");
+    QCommandLineOption outputOption("output", "Файл отчета JSON, по умолчанию stdout.", "file");
+    QCommandLineOption textOption("text", "Записать итоговый текст документа в файл.", "file");
+    parser.addOptions({speedOption, outputOption, textOption});
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != 1) {
+        parser.showHelp(1);
+    }
+    double speed = 0;
+    const QString speedValue = parser.value(speedOption);
+    if (speedValue != QLatin1String("max")) {
+        bool ok = false;
+        speed = speedValue.toDouble(&ok);
+        if (!ok || speed <= 0) {
+            qCritical() << "--speed ждет max или положительное число";
+            return 1;
+        }
+    }
+
+    SessionReplayer replayer;
+    if (!replayer.open(arguments.first())) {
+        qCritical() << "Не удалось открыть запись" << arguments.first() << ":" << replayer.errorString();
+        return 1;
+    }
+    replayer.setSpeed(speed);
+    QObject::connect(&replayer, &SessionReplayer::finished, &app, [&]() {
+        const QJsonObject report = replayer.report();
+        const QJsonObject frames = report["frame_ms"].toObject();
+        const QJsonObject apply = report["apply_ms"].toObject();
+        qInfo().noquote() << QStringLiteral("сообщений %1, кадров %2 (p99 %3 мс, дольше 16 мс: %4), применение правок p99 %5 мс, %6 оп/с")
+                                 .arg(report["messages"]["inbound"].toInteger() + report["messages"]["outbound"].toInteger())
+                                 .arg(frames["count"].toInteger())
+                                 .arg(frames["p99"].toDouble(), 0, 'f', 2)
+                                 .arg(report["frames_over_budget"].toInteger())
+                                 .arg(apply["p99"].toDouble(), 0, 'f', 2)
+                                 .arg(report["remote_ops_per_s"].toDouble(), 0, 'f', 0);
+        qInfo().noquote() << QStringLiteral("итоговый документ: %1 строк, хеш %2")
+                                 .arg(report["final"]["lines"].toInt())
+                                 .arg(report["final"]["hash"].toString());
+
+        bool ok = writeFile(parser.value(outputOption), QJsonDocument(report).toJson(QJsonDocument::Indented));
+        if (parser.isSet(textOption)) {
+            ok = writeFile(parser.value(textOption), replayer.text().toUtf8()) && ok;
+        }
+        QCoreApplication::exit(ok ? 0 : 1);
+    });
+    QTimer::singleShot(0, &replayer, &SessionReplayer::start);
+    return app.exec();
+}
@@ -0,0 +1,44 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "collabserver.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+
+// локальный сервер совместной работы: bam_server --port 8080 [--listen 127.0.0.1] [--store sessions.json]
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("bam_server");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("BAM_IDE collaboration server (headless)");
+    parser.addHelpOption();
+    QCommandLineOption portOption("port", "Порт WebSocket.", "port", "8080");
+    QCommandLineOption listenOption("listen", "Адрес, на котором слушать.", "address", "0.0.0.0");
+    QCommandLineOption historyOption("history", "Сколько ревизий хранить на сессию для OT и догоняния.", "count", "1000");
+    QCommandLineOption compressOption("compress-threshold", "Снимки меньше (байт) отправляются без сжатия.", "bytes", "4096");
+    QCommandLineOption storeOption("store", "Файл сохраненных сессий (save_session).", "file");
+    QCommandLineOption maxFrameOption("max-frame", "Предел размера кадра (байт), длинный текст уходит частями.", "bytes",
+                                      QString::number(CollabChunker::DefaultMaxFrameBytes));
+    parser.addOptions({portOption, listenOption, historyOption, compressOption, storeOption, maxFrameOption});
+    parser.process(app);
+
+    CollabServer server;
+    server.setHistoryLimit(parser.value(historyOption).toInt());
+    server.setCompressionThreshold(parser.value(compressOption).toInt());
+    server.setMaxFrameBytes(parser.value(maxFrameOption).toInt());
+    if (parser.isSet(storeOption)) {
+        server.setStorePath(parser.value(storeOption));
+    }
+    const QHostAddress address(parser.value(listenOption));
+    if (!server.listen(address, quint16(parser.value(portOption).toUInt()))) {
+        qCritical() << "Не удалось открыть порт:" << server.errorString();
+        return 1;
+    }
+    qInfo() << "Сервер слушает" << address.toString() << server.port();
+    return app.exec();
+}
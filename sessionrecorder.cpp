@@ -0,0 +1,95 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "sessionrecorder.h"
+#include <QCborValue>
+#include <QDebug>
+
+namespace {
+
+constexpr QDataStream::Version kStreamVersion = QDataStream::Qt_6_0; // формат файла не зависит от версии Qt
+
+} // namespace
+
+bool SessionRecorder::open(const QString& path)
+{
+    close();
+    m_path = path;
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(kStreamVersion);
+    m_stream << Magic << Version << QDateTime::currentMSecsSinceEpoch();
+    m_clock.start();
+    m_records = 0;
+    return m_stream.status() == QDataStream::Ok;
+}
+
+void SessionRecorder::close()
+{
+    if (!m_file.isOpen()) return;
+    m_stream.setDevice(nullptr);
+    m_file.close(); // здесь же дописывается буфер QFile
+    qDebug() << "Запись сессии" << m_path << "закрыта, сообщений:" << m_records;
+}
+
+void SessionRecorder::record(Direction direction, const QJsonObject& message, int wireBytes)
+{
+    if (!m_file.isOpen()) return;
+    // CBOR компактнее JSON и читается обратно без потерь для того, что ходит в протоколе
+    m_stream << m_clock.nsecsElapsed() << quint8(direction) << qint32(wireBytes)
+             << QCborValue::fromJsonValue(message).toCbor();
+    ++m_records;
+    if (m_stream.status() != QDataStream::Ok) {
+        qWarning() << "Запись сессии остановлена:" << m_file.errorString();
+        close();
+    }
+}
+
+bool SessionRecordingReader::open(const QString& path)
+{
+    m_error.clear();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(kStreamVersion);
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint64 startedAtMs = 0;
+    m_stream >> magic >> version >> startedAtMs;
+    if (m_stream.status() != QDataStream::Ok || magic != SessionRecorder::Magic) {
+        m_error = QStringLiteral("это не запись сессии");
+        return false;
+    }
+    if (version != SessionRecorder::Version) {
+        m_error = QStringLiteral("неподдерживаемая версия записи %1").arg(version);
+        return false;
+    }
+    m_startedAt = QDateTime::fromMSecsSinceEpoch(startedAtMs);
+    return true;
+}
+
+bool SessionRecordingReader::readNext(SessionRecorder::Record& record)
+{
+    if (!m_file.isOpen() || m_stream.atEnd()) return false;
+    quint8 direction = 0;
+    qint32 wireBytes = 0;
+    QByteArray cbor;
+    m_stream >> record.timeNs >> direction >> wireBytes >> cbor;
+    if (m_stream.status() != QDataStream::Ok) {
+        // оборванная последняя запись (программа закрылась аварийно) - просто конец
+        m_error = m_stream.status() == QDataStream::ReadPastEnd ? QString() : QStringLiteral("поврежденная запись");
+        return false;
+    }
+    record.direction = direction == quint8(SessionRecorder::Direction::Outbound) ? SessionRecorder::Direction::Outbound
+                                                                                 : SessionRecorder::Direction::Inbound;
+    record.wireBytes = wireBytes;
+    record.message = QCborValue::fromCbor(cbor).toJsonValue().toObject();
+    return true;
+}
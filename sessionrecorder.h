@@ -0,0 +1,78 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SESSIONRECORDER_H
+#define SESSIONRECORDER_H
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonObject>
+#include <QString>
+
+// запись сообщений совместной работы в компактный двоичный файл для воспроизведения (bam_replay, Doc.md 3.3.5)
+// пишется на границе сети: входящие - уже собранные из частей и распакованные, исходящие - до деления на кадры
+// формат: заголовок (Magic, Version, время начала), затем записи QDataStream:
+// qint64 нс от начала, quint8 направление, qint32 байт в сети, QByteArray сообщение в CBOR
+// используется только из сетевого потока
+class SessionRecorder
+{
+public:
+    enum class Direction : quint8
+    {
+        Inbound = 0, // от сервера
+        Outbound = 1, // на сервер
+    };
+
+    struct Record
+    {
+        qint64 timeNs = 0;
+        Direction direction = Direction::Inbound;
+        int wireBytes = 0;
+        QJsonObject message;
+    };
+
+    SessionRecorder() = default;
+    ~SessionRecorder() { close(); }
+    Q_DISABLE_COPY(SessionRecorder)
+
+    bool open(const QString& path); // файл перезаписывается
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString errorString() const { return m_file.errorString(); }
+    const QString& path() const { return m_path; }
+
+    void record(Direction direction, const QJsonObject& message, int wireBytes);
+    qint64 recordCount() const { return m_records; }
+
+    static constexpr quint32 Magic = 0x42414d52; // "BAMR"
+    static constexpr quint16 Version = 1;
+
+private:
+    QString m_path;
+    QFile m_file;
+    QDataStream m_stream;
+    QElapsedTimer m_clock;
+    qint64 m_records = 0;
+};
+
+// чтение записи SessionRecorder по порядку
+class SessionRecordingReader
+{
+public:
+    bool open(const QString& path);
+    // false - конец файла или ошибка, тогда errorString() не пустая
+    bool readNext(SessionRecorder::Record& record);
+    const QString& errorString() const { return m_error; }
+    const QDateTime& startedAt() const { return m_startedAt; }
+
+private:
+    QFile m_file;
+    QDataStream m_stream;
+    QDateTime m_startedAt;
+    QString m_error;
+};
+
+#endif // SESSIONRECORDER_H
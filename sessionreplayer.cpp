@@ -0,0 +1,304 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "sessionreplayer.h"
+#include "blockhashtree.h"
+#include <QDebug>
+#include <QPlainTextDocumentLayout>
+#include <QTextCursor>
+#include <QTimer>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr qint64 kFrameNs = qint64(SessionReplayer::FrameMs) * 1000000;
+
+// перцентили по методу ближайшего ранга, в миллисекундах (как в отчете bam_loadgen)
+QJsonObject latencySummary(QList<qint64> samplesNs)
+{
+    std::sort(samplesNs.begin(), samplesNs.end());
+    const auto percentile = [&samplesNs](double p) {
+        if (samplesNs.isEmpty()) return 0.0;
+        const qsizetype rank = qBound<qsizetype>(0, qsizetype(p * samplesNs.size() + 0.5) - 1, samplesNs.size() - 1);
+        return samplesNs.at(rank) / 1e6;
+    };
+    return QJsonObject{
+        {"count", qint64(samplesNs.size())},
+        {"p50", percentile(0.50)},
+        {"p90", percentile(0.90)},
+        {"p99", percentile(0.99)},
+        {"max", samplesNs.isEmpty() ? 0.0 : samplesNs.last() / 1e6},
+    };
+}
+
+} // namespace
+
+SessionReplayer::SessionReplayer(QObject *parent)
+    : QObject(parent)
+{
+    // та же раскладка, что у QPlainTextEdit, чтобы стоимость правок была как в редакторе
+    m_document.setDocumentLayout(new QPlainTextDocumentLayout(&m_document));
+    m_remoteOps = new RemoteOpApplier(&m_document, nullptr, this);
+    m_remoteOps->setTransform([this](const RemoteOpApplier::Batch& batch) {
+        if (!m_otEnabled) return batch.ops;
+        if (batch.senderId == m_clientId) {
+            m_otClient.serverAck(batch.revision); // своя пачка в catch_up, как в MainWindowCodeEditor
+            return QList<CollabOp>();
+        }
+        return m_otClient.applyRemote(batch.ops, batch.senderId, batch.revision);
+    });
+    connect(m_remoteOps, &RemoteOpApplier::drained, this, [this]() {
+        m_applyNs.append(m_remoteOps->lastDrainUs() * 1000);
+    });
+}
+
+bool SessionReplayer::open(const QString& path)
+{
+    m_path = path;
+    if (!m_reader.open(path)) {
+        m_error = m_reader.errorString();
+        return false;
+    }
+    m_hasNext = m_reader.readNext(m_next);
+    if (!m_hasNext && !m_reader.errorString().isEmpty()) {
+        m_error = m_reader.errorString();
+        return false;
+    }
+    return true;
+}
+
+void SessionReplayer::start()
+{
+    m_clock.start();
+    QTimer::singleShot(0, this, &SessionReplayer::runFrame);
+}
+
+void SessionReplayer::runFrame()
+{
+    if (!m_hasNext) {
+        m_wallNs = m_clock.nsecsElapsed();
+        emit finished();
+        return;
+    }
+    // кадр - окно FrameMs времени записи, в которое попала следующая запись; паузы без сообщений кадров не дают
+    m_frameEndNs = (m_next.timeNs / kFrameNs + 1) * kFrameNs;
+    if (m_speed > 0) {
+        const qint64 dueNs = qint64((m_frameEndNs - kFrameNs) / m_speed);
+        const qint64 waitNs = dueNs - m_clock.nsecsElapsed();
+        if (waitNs > 1000000) {
+            QTimer::singleShot(int(waitNs / 1000000), Qt::PreciseTimer, this, &SessionReplayer::runFrame);
+            return;
+        }
+    }
+
+    QElapsedTimer frame;
+    frame.start();
+    while (m_hasNext && m_next.timeNs < m_frameEndNs) {
+        apply(m_next);
+        m_hasNext = m_reader.readNext(m_next);
+    }
+    flushRemote(std::numeric_limits<int>::max()); // в конце прохода цикла событий, как у клиента
+    m_frameNs.append(frame.nsecsElapsed());
+
+    if (!m_hasNext && !m_reader.errorString().isEmpty()) {
+        qWarning() << "Запись" << m_path << "прочитана не до конца:" << m_reader.errorString();
+    }
+    QTimer::singleShot(0, this, &SessionReplayer::runFrame);
+}
+
+void SessionReplayer::apply(const SessionRecorder::Record& record)
+{
+    m_lastRecordNs = record.timeNs;
+    if (record.direction == SessionRecorder::Direction::Inbound) {
+        ++m_inbound;
+        m_inboundBytes += record.wireBytes;
+        applyInbound(record.message);
+    } else {
+        ++m_outbound;
+        m_outboundBytes += record.wireBytes;
+        applyOutbound(record.message);
+    }
+}
+
+void SessionReplayer::applyInbound(const QJsonObject& message)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const InboundMessage inbound = ServerMessageDecoder::decode(message);
+    m_decodeNs.append(timer.nsecsElapsed());
+
+    if (ServerMessageDecoder::isEdit(inbound.type)) {
+        const OpsMessage& ops = inbound.as<OpsMessage>();
+        // неразборчивую пачку клиент не применяет, а переподключается - в записи дальше идет session_info
+        if (ops.path == m_documentPath && ops.valid) {
+            m_pendingRemote.append({ops.senderId, ops.revision, ops.ops});
+        }
+        return;
+    }
+    flushRemote(std::numeric_limits<int>::max()); // ack и снимки относятся к состоянию после уже пришедших правок
+
+    switch (inbound.type) {
+    case ServerMessageType::Ack: {
+        const AckMessage& ack = inbound.as<AckMessage>();
+        if (m_otEnabled && ack.path == m_documentPath) {
+            m_otClient.serverAck(ack.revision);
+        }
+        break;
+    }
+    case ServerMessageType::SessionInfo: {
+        const SessionInfoMessage& info = inbound.as<SessionInfoMessage>();
+        m_documentPath = info.path;
+        m_otEnabled = info.revision >= 0;
+        if (info.hasCatchUp && info.catchUpValid) {
+            // возобновление после обрыва: документ остается, пропущенное приходит операциями
+            for (const CatchUpEntry& entry : info.catchUp) {
+                m_remoteOps->enqueue({entry.senderId, entry.revision, entry.ops});
+            }
+            m_remoteOps->drain();
+        } else {
+            // seed: документ создан пустым, текст придет нашими же вставками
+            resetDocument(info.seed ? QString() : info.text, info.revision);
+        }
+        break;
+    }
+    case ServerMessageType::DocumentInfo: {
+        const DocumentInfoMessage& info = inbound.as<DocumentInfoMessage>();
+        if (info.path == m_documentPath) {
+            resetDocument(info.seed ? QString() : info.text, info.revision);
+        }
+        break;
+    }
+    case ServerMessageType::FileContentUpdate: {
+        const FileContentMessage& update = inbound.as<FileContentMessage>();
+        if (update.path == m_documentPath) {
+            resetDocument(update.text, update.revision);
+        }
+        break;
+    }
+    default:
+        break; // чат, участники, курсоры и прочее документ не меняют
+    }
+}
+
+void SessionReplayer::applyOutbound(const QJsonObject& message)
+{
+    const QString type = message.value(QLatin1String("type")).toString();
+    const QString path = message.value(QLatin1String("path")).toString();
+    if (type == QLatin1String("create_session") || type == QLatin1String("join_session")) {
+        m_clientId = message.value(QLatin1String("client_id")).toString();
+        m_otClient.setClientId(m_clientId);
+        m_documentPath = path;
+        return;
+    }
+    if (type == QLatin1String("open_document")) {
+        flushRemote(std::numeric_limits<int>::max());
+        m_pendingRemote.clear();
+        m_documentPath = path; // текст придет в document_info
+        m_otClient.reset(0);
+        return;
+    }
+    if (path != m_documentPath) return; // правки закрываемого документа
+    if (type == QLatin1String("file_content_update")) {
+        flushRemote(std::numeric_limits<int>::max());
+        ++m_snapshots;
+        m_document.setPlainText(message.value(QLatin1String("text")).toString());
+        return;
+    }
+
+    // insert/delete/batch на сервер устроены так же, как от сервера
+    const InboundMessage parsed = ServerMessageDecoder::decode(message);
+    if (!ServerMessageDecoder::isEdit(parsed.type)) return;
+    const OpsMessage& ops = parsed.as<OpsMessage>();
+
+    // чужие правки, которые клиент успел применить до отправки, видны по ревизии пачки
+    flushRemote(m_otEnabled && ops.revision >= 0 ? ops.revision : std::numeric_limits<int>::max());
+    if (m_otEnabled && m_otClient.isAwaitingAck()) {
+        // отправка, пока прошлая пачка не подтверждена, бывает только при повторе после переподключения:
+        // эти правки уже в документе
+        m_otClient.resendPending();
+        ++m_resentBatches;
+        return;
+    }
+    applyLocal(ops.ops);
+}
+
+void SessionReplayer::flushRemote(int upToRevision)
+{
+    int count = 0;
+    while (count < m_pendingRemote.size() && m_pendingRemote.at(count).revision <= upToRevision) {
+        ++count;
+    }
+    if (count == 0) return;
+    for (int i = 0; i < count; ++i) {
+        m_remoteOps->enqueue(m_pendingRemote.takeFirst());
+    }
+    m_remoteOps->drain();
+}
+
+void SessionReplayer::resetDocument(const QString& text, int revision)
+{
+    ++m_snapshots;
+    m_pendingRemote.clear();
+    m_document.setPlainText(text);
+    if (m_otEnabled && revision >= 0) {
+        m_otClient.reset(revision);
+    }
+}
+
+void SessionReplayer::applyLocal(const QList<CollabOp>& ops)
+{
+    QTextCursor cursor(&m_document);
+    cursor.beginEditBlock();
+    RemoteOpApplier::applyOps(cursor, ops, nullptr);
+    cursor.endEditBlock();
+    if (m_otEnabled) {
+        m_otClient.applyLocal(ops);
+    }
+    m_localOps += ops.size();
+}
+
+QJsonObject SessionReplayer::report() const
+{
+    const QString finalText = text();
+    BlockHashTree tree;
+    tree.rebuild(BlockHashTree::hashLines(finalText));
+    qint64 overBudget = 0;
+    for (qint64 ns : m_frameNs) {
+        if (ns > FrameBudgetNs) ++overBudget;
+    }
+    // пропускная способность применения: чужие операции за суммарное время RemoteOpApplier::drain
+    qint64 applyTotalNs = 0;
+    for (qint64 ns : m_applyNs) {
+        applyTotalNs += ns;
+    }
+    const qint64 remoteOps = m_remoteOps->appliedOpCount();
+    return QJsonObject{
+        {"recording", m_path},
+        {"recorded_at", m_reader.startedAt().toString(Qt::ISODate)},
+        {"speed", m_speed},
+        {"recorded_s", m_lastRecordNs / 1e9},
+        {"replay_s", m_wallNs / 1e9},
+        {"messages", QJsonObject{{"inbound", m_inbound}, {"outbound", m_outbound}}},
+        {"bytes", QJsonObject{{"inbound", m_inboundBytes}, {"outbound", m_outboundBytes}}},
+        {"remote_ops_applied", remoteOps},
+        {"remote_apply_total_ms", applyTotalNs / 1e6},
+        {"remote_ops_per_s", applyTotalNs > 0 ? remoteOps * 1e9 / applyTotalNs : 0.0},
+        {"local_ops_applied", m_localOps},
+        {"snapshots", m_snapshots},
+        {"resent_batches", m_resentBatches},
+        {"decode_ms", latencySummary(m_decodeNs)},
+        {"apply_ms", latencySummary(m_applyNs)},
+        {"frame_ms", latencySummary(m_frameNs)},
+        {"frames_over_budget", overBudget},
+        {"final", QJsonObject{
+            {"path", m_documentPath},
+            {"revision", m_otEnabled ? m_otClient.revision() : -1},
+            {"settled", !m_otClient.isAwaitingAck() && m_otClient.bufferedOps().isEmpty()},
+            {"length", qint64(finalText.length())},
+            {"lines", tree.lineCount()},
+            {"hash", QString::number(tree.rootHash(), 16)}, // тот же хеш, что в doc_hash
+        }},
+    };
+}
@@ -0,0 +1,86 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SESSIONREPLAYER_H
+#define SESSIONREPLAYER_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTextDocument>
+#include "collabmessages.h"
+#include "otengine.h"
+#include "remoteopapplier.h"
+#include "sessionrecorder.h"
+
+// воспроизведение записи SessionRecorder в редакторе без окна (bam_replay, Doc.md 3.3.5)
+// документ ведется как у клиента: чужие правки проходят OtClient и RemoteOpApplier, свои отправленные
+// применяются в момент отправки; итоговый текст совпадает с серверным, когда в записи все подтверждено
+// записи делятся на кадры по FrameMs времени записи - столько клиент успел бы получить за один кадр отрисовки
+class SessionReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SessionReplayer(QObject *parent = nullptr);
+
+    bool open(const QString& path);
+    const QString& errorString() const { return m_error; }
+    // 0 - как можно быстрее, 1 - в темпе записи, 2 - вдвое быстрее и т.д.
+    void setSpeed(double speed) { m_speed = qMax(0.0, speed); }
+
+    void start(); // асинхронно, по окончании - finished()
+    QJsonObject report() const; // задержки, время кадров и хеш итогового документа
+    QString text() const { return m_document.toPlainText(); }
+
+    static constexpr int FrameMs = 16; // 60 кадров в секунду
+    static constexpr qint64 FrameBudgetNs = 16666667;
+
+signals:
+    void finished();
+
+private:
+    void runFrame();
+    void apply(const SessionRecorder::Record& record);
+    void applyInbound(const QJsonObject& message);
+    void applyOutbound(const QJsonObject& message);
+    // применить пришедшие чужие пачки с ревизией не больше upToRevision (клиент применил их до своей отправки)
+    void flushRemote(int upToRevision);
+    void resetDocument(const QString& text, int revision); // полная замена текста (снимок от сервера)
+    void applyLocal(const QList<CollabOp>& ops); // свои правки, уже отправленные на сервер
+
+    QString m_path;
+    QString m_error;
+    SessionRecordingReader m_reader;
+    SessionRecorder::Record m_next;
+    bool m_hasNext = false;
+    double m_speed = 0;
+
+    QTextDocument m_document;
+    RemoteOpApplier *m_remoteOps = nullptr;
+    QList<RemoteOpApplier::Batch> m_pendingRemote; // пришли, но клиент их еще не применил
+    OtClient m_otClient;
+    bool m_otEnabled = false;
+    QString m_clientId;
+    QString m_documentPath; // документ, который открыт в записанном клиенте
+
+    QElapsedTimer m_clock; // от начала воспроизведения
+    qint64 m_frameEndNs = 0; // конец текущего кадра во времени записи
+    qint64 m_lastRecordNs = 0;
+    qint64 m_wallNs = 0;
+    qint64 m_inbound = 0;
+    qint64 m_outbound = 0;
+    qint64 m_inboundBytes = 0;
+    qint64 m_outboundBytes = 0;
+    qint64 m_localOps = 0;
+    qint64 m_snapshots = 0;
+    qint64 m_resentBatches = 0;
+    QList<qint64> m_decodeNs; // разбор входящего сообщения
+    QList<qint64> m_applyNs; // применение накопленных чужих правок (RemoteOpApplier::drain)
+    QList<qint64> m_frameNs; // вся работа кадра
+};
+
+#endif // SESSIONREPLAYER_H
@@ -0,0 +1,80 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "sessionuserlist.h"
+#include <QSet>
+
+namespace {
+
+bool sameUser(const CollabUser& a, const CollabUser& b)
+{
+    return a.username == b.username && a.color == b.color && a.isAdmin == b.isAdmin
+           && a.hasMuteEndTime == b.hasMuteEndTime && a.muteEndTime == b.muteEndTime;
+}
+
+} // namespace
+
+SessionUserList::Diff SessionUserList::replaceAll(const QList<CollabUser>& users)
+{
+    Diff diff;
+    QSet<QString> present;
+    present.reserve(users.size());
+    for (const CollabUser& user : users) {
+        present.insert(user.clientId);
+        const Diff one = upsert(user);
+        diff.added += one.added;
+        diff.updated += one.updated;
+    }
+    for (auto it = m_users.begin(); it != m_users.end();) {
+        if (present.contains(it.key())) {
+            ++it;
+        } else {
+            diff.removed.append(it.key());
+            it = m_users.erase(it);
+        }
+    }
+    return diff;
+}
+
+SessionUserList::Diff SessionUserList::upsert(const CollabUser& user)
+{
+    Diff diff;
+    auto it = m_users.find(user.clientId);
+    if (it == m_users.end()) {
+        m_users.insert(user.clientId, user);
+        diff.added.append(user.clientId);
+    } else if (!sameUser(*it, user)) {
+        *it = user;
+        diff.updated.append(user.clientId);
+    }
+    return diff;
+}
+
+SessionUserList::Diff SessionUserList::remove(const QString& clientId)
+{
+    Diff diff;
+    if (m_users.remove(clientId) > 0) {
+        diff.removed.append(clientId);
+    }
+    return diff;
+}
+
+SessionUserList::Diff SessionUserList::setAdmin(const QString& adminId)
+{
+    Diff diff;
+    for (auto it = m_users.begin(); it != m_users.end(); ++it) {
+        const bool isAdmin = it.key() == adminId;
+        if (it->isAdmin != isAdmin) {
+            it->isAdmin = isAdmin;
+            diff.updated.append(it.key());
+        }
+    }
+    return diff;
+}
+
+QString SessionUserList::nextClientId(const QString& clientId) const
+{
+    const auto it = m_users.upperBound(clientId);
+    return it == m_users.cend() ? QString() : it.key();
+}
@@ -0,0 +1,45 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SESSIONUSERLIST_H
+#define SESSIONUSERLIST_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include "collabmessages.h"
+
+// участники сессии по client_id (Doc.md 3.6)
+// и полный user_list_update, и дельты (user_joined, user_disconnected, admin_changed) сводятся к списку
+// затронутых записей, по которому интерфейс обновляет только их; порядок - по client_id, как в QMap
+class SessionUserList
+{
+public:
+    struct Diff
+    {
+        QStringList added;
+        QStringList updated;
+        QStringList removed;
+
+        bool isEmpty() const { return added.isEmpty() && updated.isEmpty() && removed.isEmpty(); }
+    };
+
+    Diff replaceAll(const QList<CollabUser>& users); // полный список: кого нет - удален
+    Diff upsert(const CollabUser& user); // вошел новый или вернулся прежний
+    Diff remove(const QString& clientId);
+    Diff setAdmin(const QString& adminId); // флаг is_admin у прежнего и нового админа
+    void clear() { m_users.clear(); }
+
+    bool contains(const QString& clientId) const { return m_users.contains(clientId); }
+    CollabUser value(const QString& clientId) const { return m_users.value(clientId); }
+    int size() const { return m_users.size(); }
+    const QMap<QString, CollabUser>& users() const { return m_users; }
+    // следующий по порядку участник (пусто - последний); перед ним вставляется пункт меню нового
+    QString nextClientId(const QString& clientId) const;
+
+private:
+    QMap<QString, CollabUser> m_users;
+};
+
+#endif // SESSIONUSERLIST_H
@@ -0,0 +1,72 @@
+// CodeEditor - A collaborative C++ IDE with LSP, chat, and terminal integration.
+// Copyright (C) 2025 ToMaTiKkk
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// очередь без блокировок для ровно одного писателя и одного читателя в разных потоках
+// односвязный список с фиктивной головой: писатель трогает только хвост, читатель - только голову,
+// поэтому мьютекс не нужен, а порядок элементов сохраняется
+// размер не ограничен: писатель (поток GUI или сети) никогда не ждет читателя
+template <typename T>
+class SpscQueue
+{
+public:
+    SpscQueue()
+        : m_head(new Node)
+        , m_tail(m_head)
+    {
+    }
+
+    ~SpscQueue()
+    {
+        while (Node *node = m_head) {
+            m_head = node->next.load(std::memory_order_relaxed);
+            delete node;
+        }
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // только из потока писателя
+    void push(T value)
+    {
+        Node *node = new Node;
+        node->value = std::move(value);
+        m_tail->next.store(node, std::memory_order_release); // после этого читатель видит готовое значение
+        m_tail = node;
+    }
+
+    // только из потока читателя; false - очередь пуста
+    bool tryPop(T& out)
+    {
+        Node *next = m_head->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        out = std::move(next->value);
+        delete m_head;
+        m_head = next; // забранный узел становится новой фиктивной головой
+        return true;
+    }
+
+    // только из потока читателя
+    bool isEmpty() const { return m_head->next.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node
+    {
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    alignas(64) Node *m_head; // читатель
+    alignas(64) Node *m_tail; // писатель
+};
+
+#endif // SPSCQUEUE_H